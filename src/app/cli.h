@@ -49,6 +49,9 @@ struct CliParameters {
 
     QString pattern;
 
+    QString metrics_file;
+    QString trace_file;
+
     CliParameters( QCoreApplication& app, bool console = false )
     {
         QCommandLineParser parser;
@@ -88,7 +91,15 @@ struct CliParameters {
                           << "debug",
             "output more debug (increase number for more verbosity)", "debug_level", "0" );
 
+        const QCommandLineOption dumpMetricsOption(
+            "dump-metrics", "write performance metrics as JSON to file on exit", "file" );
+
+        const QCommandLineOption traceOption(
+            "trace", "record a timeline of indexing and searching to Chrome trace file", "file" );
+
         parser.addOption( debugOption );
+        parser.addOption( dumpMetricsOption );
+        parser.addOption( traceOption );
 
         if ( !console ) {
             const QCommandLineOption windowWidthOption( "window-width", "new window width",
@@ -124,6 +135,14 @@ struct CliParameters {
 
         log_level += parser.value( debugOption ).toInt();
 
+        if ( parser.isSet( dumpMetricsOption ) ) {
+            metrics_file = QFileInfo( parser.value( dumpMetricsOption ) ).absoluteFilePath();
+        }
+
+        if ( parser.isSet( traceOption ) ) {
+            trace_file = QFileInfo( parser.value( traceOption ) ).absoluteFilePath();
+        }
+
         if ( !console ) {
             if ( parser.isSet( multiInstanceOption ) ) {
                 multi_instance = true;
@@ -28,7 +28,9 @@
 #include "logfiltereddata.h"
 #include "dispatch_to.h"
 #include "logger.h"
+#include "metrics.h"
 #include "persistentinfo.h"
+#include "tracing.h"
 
 #include "cli.h"
 
@@ -47,6 +49,10 @@ int main( int argc, char* argv[] )
 
     logging::enableLogging( true, static_cast<logging::LogLevel>( parameters.log_level ) );
 
+    if ( !parameters.trace_file.isEmpty() ) {
+        Tracer::get().start( parameters.trace_file );
+    }
+
     auto configuration = Configuration::getSynced();
 
     LogData logData;
@@ -70,6 +76,14 @@ int main( int argc, char* argv[] )
                     }
                 }
 
+                if ( !parameters.metrics_file.isEmpty() ) {
+                    Metrics::get().dumpToFile( parameters.metrics_file );
+                }
+
+                if ( !parameters.trace_file.isEmpty() ) {
+                    Tracer::get().stop();
+                }
+
                 exit( EXIT_SUCCESS );
             }
         } );
@@ -62,6 +62,8 @@
 #include "cpu_info.h"
 #include "logger.h"
 #include "mainwindow.h"
+#include "metrics.h"
+#include "tracing.h"
 #include "styles.h"
 
 #include "cli.h"
@@ -134,6 +136,10 @@ int main( int argc, char* argv[] )
     logging::enableLogging( parameters.enable_logging || config.enableLogging(), logLevel );
     logging::enableFileLogging( parameters.log_to_file || config.enableLogging(), logLevel );
 
+    if ( !parameters.trace_file.isEmpty() ) {
+        Tracer::get().start( parameters.trace_file );
+    }
+
     app.initCrashHandler();
 
     auto maxConcurrency
@@ -192,5 +198,15 @@ int main( int argc, char* argv[] )
         app.startBackgroundTasks();
     }
 
-    return app.exec();
+    const auto exitCode = app.exec();
+
+    if ( !parameters.metrics_file.isEmpty() ) {
+        Metrics::get().dumpToFile( parameters.metrics_file );
+    }
+
+    if ( !parameters.trace_file.isEmpty() ) {
+        Tracer::get().stop();
+    }
+
+    return exitCode;
 }
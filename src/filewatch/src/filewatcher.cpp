@@ -23,6 +23,7 @@
 #include "dispatch_to.h"
 #include "log.h"
 #include "synchronization.h"
+#include "tracing.h"
 
 #include <KDSignalThrottler.h>
 #include <efsw/efsw.hpp>
@@ -198,6 +199,8 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
 
     void checkWatches()
     {
+        KLOGG_TRACE_SCOPE( "filewatch", "check_watches" );
+
         const auto collectChangedFiles = [ this ]() {
             ScopedRecursiveLock lock( mutex_ );
 
@@ -251,6 +254,8 @@ class EfswFileWatcher final : public efsw::FileWatchListener {
     void notifyOnFileAction( const std::string& dir, const std::string& filename,
                              const std::string& oldFilename )
     {
+        KLOGG_TRACE_SCOPE( "filewatch", "file_action" );
+
         auto qtDir = QString::fromStdString( dir );
         if ( qtDir.endsWith( QDir::separator() ) ) {
             qtDir.chop( 1 );
@@ -371,6 +376,7 @@ void FileWatcher::fileChangedOnDisk( const QString& fileName )
 
 void FileWatcher::sendChangesNotifications()
 {
+    KLOGG_TRACE_SCOPE_ARG( "filewatch", "send_notifications", "files", changes_.size() );
     for ( const auto& fileName : changes_ ) {
         Q_EMIT fileChanged( fileName );
     }
@@ -39,6 +39,9 @@
 #ifndef ABSTRACTLOGDATA_H
 #define ABSTRACTLOGDATA_H
 
+#include <utility>
+#include <vector>
+
 #include <QObject>
 #include <QString>
 #include <QStringList>
@@ -52,6 +55,13 @@ class AbstractLogData : public QObject {
     Q_OBJECT
 
   public:
+    // Part of a line: its text, tabs not expanded, starting
+    // at the column firstColumn of the expanded line.
+    struct LineWindow {
+        QString text;
+        int firstColumn = 0;
+    };
+
     // Returns the line passed as a QString
     QString getLineString( LineNumber line ) const;
     // Returns the line passed as a QString, with tabs expanded
@@ -60,6 +70,11 @@ class AbstractLogData : public QObject {
     std::vector<QString> getLines( LineNumber first_line, LinesCount number ) const;
     // Returns a set of lines with tabs expanded
     std::vector<QString> getExpandedLines( LineNumber first_line, LinesCount number ) const;
+    // Returns a set of lines covering at least the expanded columns from
+    // first_column to first_column + nb_columns, only very long lines
+    // are actually cut.
+    std::vector<LineWindow> getLineWindows( LineNumber first_line, LinesCount number,
+                                            int first_column, int nb_columns ) const;
     // Returns the total number of lines
     LinesCount getNbLine() const;
     // Returns the visible length of the longest line
@@ -68,6 +83,9 @@ class AbstractLogData : public QObject {
     // Returns the visible length of the passed line
     // Tabs are expanded
     LineLength getLineLength( LineNumber line ) const;
+    // Returns the visible lengths of a set of lines
+    // Tabs are expanded
+    std::vector<LineLength> getLineLengths( LineNumber first_line, LinesCount number ) const;
 
     // Set the view to use the passed encoding for display
     void setDisplayEncoding( const char* encoding_name );
@@ -81,6 +99,18 @@ class AbstractLogData : public QObject {
     void attachReader() const;
     void detachReader() const;
 
+    // Reads the passed lines in the background so they are ready when
+    // displayed, prefetches asked for before and not started are cancelled.
+    void prefetchLines( LineNumber first_line, LinesCount number ) const;
+
+    // Runs of consecutive lines of the source data
+    using SourceRuns = std::vector<std::pair<LineNumber, LinesCount>>;
+    // Returns the data holding the text of the lines, unlike a filtered
+    // view it can be read from any thread.
+    const AbstractLogData* getSourceData() const;
+    // Returns where the passed lines are in the source data
+    SourceRuns getSourceRuns( LineNumber first_line, LinesCount number ) const;
+
     // The "type" of a line, which will appear in the FilteredView
     enum class LineTypeFlags {
         Plain = 0, // 0 can be checked like a proper flag in QFlags
@@ -99,18 +129,30 @@ class AbstractLogData : public QObject {
     // Internal function called to get a set of expanded lines
     virtual std::vector<QString> doGetExpandedLines( LineNumber first_line,
                                                      LinesCount number ) const = 0;
+    // Internal function called to get a set of line windows
+    virtual std::vector<LineWindow> doGetLineWindows( LineNumber first_line, LinesCount number,
+                                                      int first_column,
+                                                      int nb_columns ) const = 0;
     // Internal function called to get the number of lines
     virtual LinesCount doGetNbLine() const = 0;
     // Internal function called to get the maximum length
     virtual LineLength doGetMaxLength() const = 0;
     // Internal function called to get the line length
     virtual LineLength doGetLineLength( LineNumber line ) const = 0;
+    // Internal function called to get the lengths of a set of lines
+    virtual std::vector<LineLength> doGetLineLengths( LineNumber first_line,
+                                                      LinesCount number ) const = 0;
     // Internal function called to set the encoding
     virtual void doSetDisplayEncoding( const char* encoding ) = 0;
     virtual QTextCodec* doGetDisplayEncoding() const = 0;
 
     virtual void doAttachReader() const = 0;
     virtual void doDetachReader() const = 0;
+
+    virtual void doPrefetchLines( LineNumber first_line, LinesCount number ) const = 0;
+
+    virtual const AbstractLogData* doGetSourceData() const = 0;
+    virtual SourceRuns doGetSourceRuns( LineNumber first_line, LinesCount number ) const = 0;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( AbstractLogData::LineType )
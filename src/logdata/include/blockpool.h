@@ -23,6 +23,9 @@
 #include <vector>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+
+class QTemporaryFile;
 
 class BlockPoolBase
 {
@@ -33,6 +36,8 @@ public:
     BlockPoolBase( BlockPoolBase&& other ) noexcept ;
     BlockPoolBase& operator=( BlockPoolBase&& other ) noexcept ;
 
+    ~BlockPoolBase();
+
     size_t getElementSize() const;
     size_t getPaddedElementSize() const;
 
@@ -43,6 +48,18 @@ public:
 
     size_t allocatedSize() const;
 
+    // Size of the pool kept in process memory, 0 once spilled
+    size_t residentSize() const;
+
+    // Moves the pool to a memory mapped temporary file, the pool
+    // keeps growing in that file. Pages of the file are loaded back
+    // by the OS on access, so cold blocks do not take physical memory.
+    bool spillToDisk();
+    bool isSpilled() const;
+
+    // Loads a spilled pool back into process memory and drops the file
+    void restoreFromDisk();
+
 protected:
     BlockPoolBase( size_t elementSize, size_t alignment );
 
@@ -53,9 +70,19 @@ protected:
 
     size_t lastBlockSize() const;
 
+private:
+  uint8_t* poolData();
+  const uint8_t* poolData() const;
+  size_t poolSize() const;
+  void increasePool();
+
 private:
   std::vector<uint8_t> pool_;
 
+  std::unique_ptr<QTemporaryFile> spillFile_;
+  uint8_t* spilledPool_ = nullptr;
+  size_t spilledPoolSize_ = 0;
+
   size_t elementSize_;
   size_t alignment_;
 
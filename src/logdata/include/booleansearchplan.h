@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_BOOLEANSEARCHPLAN_H
+#define KLOGG_BOOLEANSEARCHPLAN_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "linetypes.h"
+#include "logfiltereddataworker.h"
+#include "regularexpression.h"
+
+class BooleanExpressionEvaluator;
+
+// Boolean combination of patterns computed from the lines matching each of
+// its sub-patterns.
+//
+// Results of sub-patterns are cached with the same keys as any other
+// search, so plain searches and previous combinations are reused. If all
+// sub-patterns have results, the searched range is split into cells of
+// lines matching the same set of sub-patterns (one intersection and one
+// difference per sub-pattern and cell, empty cells are dropped) and the
+// expression is evaluated once per cell instead of once per line.
+// Otherwise only the missing sub-patterns are matched against lines in
+// a single multi-pattern pass, flags of the others come from their bitmaps.
+class BooleanSearchPlan {
+  public:
+    // Combinations of more sub-patterns are searched line by line
+    static constexpr size_t MaxSubPatterns = 16;
+
+    // Returns cached lines of a sub-pattern if there are some
+    using ResultsLookup
+        = std::function<std::optional<SubPatternResults>( const RegularExpressionPattern& )>;
+
+    BooleanSearchPlan( const RegularExpressionPattern& pattern, const ResultsLookup& findResults );
+
+    // False if the pattern is not a valid boolean combination
+    // of at most MaxSubPatterns sub-patterns
+    bool isValid() const;
+
+    const std::vector<RegularExpressionPattern>& subPatterns() const;
+
+    // Indexes of the sub-patterns without cached results
+    const std::vector<size_t>& missingSubPatterns() const;
+
+    bool isComplete() const
+    {
+        return missingSubPatterns().empty();
+    }
+
+    // Lines between startLine and endLine matching the combination,
+    // plan must be complete. Lines matching none of the sub-patterns
+    // have unknown length, maxLineLength is used for them.
+    SubPatternResults combine( LineNumber startLine, LineNumber endLine,
+                               LineLength maxLineLength ) const;
+
+    // Matches lines against missing sub-patterns, one per searching thread
+    class LineMatcher {
+      public:
+        explicit LineMatcher( const BooleanSearchPlan& plan );
+        ~LineMatcher();
+
+        LineMatcher( const LineMatcher& ) = delete;
+        LineMatcher& operator=( const LineMatcher& ) = delete;
+
+        // Returns whether the line matches the combination, stores flags
+        // of the missing sub-patterns into missingMatches
+        bool hasMatch( std::string_view line, LineNumber lineNumber,
+                       MatchedPatterns& missingMatches );
+
+      private:
+        const BooleanSearchPlan& plan_;
+        std::unique_ptr<PatternMatcher> matcher_;
+        std::unique_ptr<BooleanExpressionEvaluator> evaluator_;
+        MatchedPatterns variables_;
+    };
+
+    std::unique_ptr<LineMatcher> createLineMatcher() const;
+
+  private:
+    RegularExpression expression_;
+    std::vector<std::optional<SubPatternResults>> results_;
+    std::vector<size_t> missing_;
+    std::optional<RegularExpression> missingExpression_;
+    bool isValid_ = false;
+};
+
+#endif
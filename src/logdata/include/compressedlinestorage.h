@@ -38,9 +38,11 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "blockpool.h"
+#include "eliasfanolinestorage.h"
 #include "linetypes.h"
 
 // This class is a compressed storage backend for LinePositionArray
@@ -94,6 +96,11 @@
  * long-ish (30 KB) lines.
  *
  * The table32 always starts at 0, the table64 starts at first_long_line_
+ *
+ * For huge files the storage can instead be created with the EliasFano
+ * encoding, it then forwards everything to EliasFanoLinePositionStorage
+ * which codes every line on about 2 + log2( line length ) bits, so long lines
+ * past UINT32_MAX do not fall back to absolute addresses.
  */
 
 #ifndef COMPRESSEDLINESTORAGE_H
@@ -101,6 +108,8 @@
 
 class CompressedLinePositionStorage {
   public:
+    enum class Encoding { Blocks, EliasFano };
+
     // Default constructor
     CompressedLinePositionStorage()
         : block_index_{ 0 }
@@ -108,6 +117,14 @@ class CompressedLinePositionStorage {
     {
     }
 
+    explicit CompressedLinePositionStorage( Encoding encoding )
+        : CompressedLinePositionStorage()
+    {
+        if ( encoding == Encoding::EliasFano ) {
+            eliasFano_ = std::make_unique<EliasFanoLinePositionStorage>();
+        }
+    }
+
     // Copy constructor would be slow, delete!
     CompressedLinePositionStorage( const CompressedLinePositionStorage& orig ) = delete;
     CompressedLinePositionStorage& operator=( const CompressedLinePositionStorage& orig ) = delete;
@@ -127,10 +144,16 @@ class CompressedLinePositionStorage {
     // Size of the array
     LinesCount size() const
     {
-        return nb_lines_;
+        return eliasFano_ ? eliasFano_->size() : nb_lines_;
     }
 
     size_t allocatedSize() const;
+    // Part of allocated size kept in process memory
+    size_t residentSize() const;
+
+    // Moves the index blocks to memory mapped temporary files,
+    // nothing is moved if one of the pools fails to spill
+    bool spillToDisk();
 
    using BlockOffset = fluent::NamedType<size_t, struct block_offset, fluent::Incrementable, fluent::PreIncrementable,
                                           fluent::Addable, fluent::Comparable>;
@@ -164,6 +187,9 @@ class CompressedLinePositionStorage {
     BlockPool<uint32_t> pool32_;
     BlockPool<uint64_t> pool64_;
 
+    // Used instead of the two indexes for the EliasFano encoding
+    std::unique_ptr<EliasFanoLinePositionStorage> eliasFano_;
+
     // Total number of lines in storage
     LinesCount nb_lines_;
 
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_ELIASFANOLINESTORAGE_H
+#define KLOGG_ELIASFANOLINESTORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "blockpool.h"
+#include "linetypes.h"
+
+// This class is an alternative storage backend for LinePositionArray,
+// meant for huge files where most lines do not fit the short relative
+// codes of CompressedLinePositionStorage.
+//
+// End of lines are split in chunks of EliasFanoChunkSize (256) lines,
+// each finished chunk is Elias-Fano coded in its own block of the pool:
+// 00 - Position of the first line of the chunk (8 bytes)
+// 08 - Number of low bits L kept for each line (8 bytes)
+// 16 - Low L bits of each (position - first position), packed
+//    - High bits of each (position - first position) in unary code: bit
+//      ( high >> L ) + j is set for the line j of the chunk
+//
+// L is chosen from the average line length of the chunk, so every line costs
+// about 2 + log2( average length ) bits whatever the position in the file.
+// Access is constant time: the unary part of a chunk is a few words long.
+// Lines of the last, unfinished chunk are kept uncompressed until it is full.
+class EliasFanoLinePositionStorage {
+  public:
+    EliasFanoLinePositionStorage();
+
+    EliasFanoLinePositionStorage( const EliasFanoLinePositionStorage& ) = delete;
+    EliasFanoLinePositionStorage& operator=( const EliasFanoLinePositionStorage& ) = delete;
+
+    EliasFanoLinePositionStorage( EliasFanoLinePositionStorage&& ) = default;
+    EliasFanoLinePositionStorage& operator=( EliasFanoLinePositionStorage&& ) = default;
+
+    // Append the passed end-of-line to the storage
+    void append( LineOffset pos );
+    void push_back( LineOffset pos )
+    {
+        append( pos );
+    }
+
+    // Size of the array
+    LinesCount size() const;
+
+    size_t allocatedSize() const;
+    // Part of allocated size kept in process memory
+    size_t residentSize() const;
+
+    // Moves the index blocks to memory mapped temporary files
+    bool spillToDisk();
+
+    // Element at index
+    LineOffset at( size_t i ) const
+    {
+        return at( LineNumber( i ) );
+    }
+    LineOffset at( LineNumber i ) const;
+
+    // Add one list to the other
+    void append_list( const std::vector<LineOffset>& positions );
+
+    // Pop the last element of the storage
+    void pop_back();
+
+  private:
+    void encodeTail();
+    void decodeLastChunk();
+
+  private:
+    BlockPool<uint64_t> pool_;
+
+    // Number of chunks coded in the pool
+    size_t chunksCount_ = 0;
+
+    // Lines of the chunk being filled
+    std::vector<uint64_t> tail_;
+};
+
+#endif
@@ -34,6 +34,9 @@ struct EncodingParameters {
 
     bool isUtf8Compatible{ false };
     bool isUtf16LE{ false };
+    // Meaning of the bytes depends on escape sequences seen before,
+    // decoding can't start in the middle of a line.
+    bool hasShiftStates{ false };
 
     int lineFeedWidth{ 1 };
     int lineFeedIndex{ 0 };
@@ -72,13 +75,13 @@ class EncodingDetector {
     EncodingDetector( const EncodingDetector&& ) = delete;
     EncodingDetector& operator=( const EncodingDetector&& ) = delete;
 
+    // Each call uses its own uchardet instance, so files opened
+    // at the same time are not waiting for each other
     QTextCodec* detectEncoding( const QByteArray& block ) const;
 
   private:
     EncodingDetector() = default;
     ~EncodingDetector() = default;
-
-    mutable SharedMutex mutex_;
 };
 
 struct TextDecoder {
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_ENCODINGVALIDATOR_H
+#define KLOGG_ENCODINGVALIDATOR_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <QByteArray>
+
+#include "encodingdetector.h"
+#include "linepositionarray.h"
+
+// Checks that the blocks of a file are valid in the encoding used to decode
+// them, so that a wrong guess shows up while indexing instead of as garbled
+// text later. Only UTF-8 (and ASCII) and UTF-16LE can be validated.
+//
+// Whole blocks are validated with simdutf, lines holding the invalid
+// sequences are only looked for in the blocks that failed. A character
+// split between two blocks is validated with the next block.
+class EncodingValidator {
+  public:
+    explicit EncodingValidator( const EncodingParameters& encodingParams );
+
+    bool isEnabled() const
+    {
+        return encoding_ != Encoding::None;
+    }
+
+    struct BlockResult {
+        bool isValid = true;
+        // Lines with invalid sequences, numbered from the first line ending
+        // in the block. The line not terminated in the block is lineEnds.size().
+        std::vector<LinesCount::UnderlyingType> invalidLines;
+    };
+
+    // lineEnds are the offsets after the end of the lines ending in the block,
+    // firstLineStart the offset the first of them starts at.
+    BlockResult validateBlock( LineOffset::UnderlyingType blockBeginning, const QByteArray& block,
+                               LineOffset::UnderlyingType firstLineStart,
+                               const FastLinePositionArray& lineEnds );
+
+  private:
+    enum class Encoding { None, Utf8, Utf16LE };
+
+    // Bytes at the end that can be the beginning of a character
+    // continued in the next block
+    size_t incompleteTailSize( const char* data, size_t size ) const;
+    bool isValid( const char* data, size_t size ) const;
+
+    Encoding encoding_;
+    std::string carry_;
+};
+
+#endif // KLOGG_ENCODINGVALIDATOR_H
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FIELDINDEX_H
+#define KLOGG_FIELDINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <roaring64map.hh>
+
+#include "linetypes.h"
+
+// Lines of a file grouped by the values of a few structured (JSON) fields.
+//
+// Every field keeps a dictionary of its values and a bitmap of the lines
+// holding each of them, filters like level=error are then answered by bitmap
+// algebra. Values are compared ignoring ASCII case.
+//
+// Fields with more than MaxDictionarySize distinct values (ids, timestamps)
+// switch to HashBuckets bitmaps of lines grouped by hash of the value. Lookups
+// on them only give candidate lines, that have to be checked on the text.
+class FieldIndex {
+  public:
+    static constexpr size_t MaxDictionarySize = 4096;
+    static constexpr size_t HashBuckets = 4096;
+
+    // Values of a run of lines, grouped by value while a block is parsed
+    // and added to the index at once.
+    class Batch {
+      public:
+        explicit Batch( size_t nbFields );
+
+        // Adds a value of the current line
+        void add( size_t field, std::string_view value );
+        void endLine();
+
+        LinesCount size() const
+        {
+            return LinesCount( nbLines_ );
+        }
+
+      private:
+        friend FieldIndex;
+
+        std::vector<std::unordered_map<std::string, std::vector<uint32_t>>> lines_;
+        uint32_t nbLines_ = 0;
+    };
+
+    struct Lookup {
+        roaring::Roaring64Map lines;
+        // False if lines are only candidates sharing the hash of the value
+        bool isExact = true;
+    };
+
+    // Clears the index
+    void setFields( std::vector<std::string> fields );
+
+    const std::vector<std::string>& fields() const
+    {
+        return fieldNames_;
+    }
+
+    std::optional<size_t> findField( std::string_view name ) const;
+
+    void append( const Batch& batch );
+    // Drops lines after newSize
+    void truncate( LinesCount newSize );
+    // Drops all lines, keeps the fields
+    void clear();
+
+    LinesCount size() const
+    {
+        return LinesCount( nbLines_ );
+    }
+
+    // True if at least one line has one of the fields
+    bool hasValues() const
+    {
+        return hasValues_;
+    }
+
+    Lookup find( size_t field, std::string_view value ) const;
+
+    size_t allocatedSize() const;
+
+    static std::string normalize( std::string_view value );
+
+  private:
+    struct Field {
+        std::unordered_map<std::string, size_t> valueIds;
+        // Lines of each value, or of each hash bucket once hashed
+        std::vector<roaring::Roaring64Map> lines;
+        bool isHashed = false;
+    };
+
+    roaring::Roaring64Map& linesOf( Field& field, const std::string& value );
+    static size_t bucketOf( std::string_view value );
+
+  private:
+    std::vector<std::string> fieldNames_;
+    std::vector<Field> fields_;
+
+    uint64_t nbLines_ = 0;
+    bool hasValues_ = false;
+};
+
+#endif // KLOGG_FIELDINDEX_H
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_FIELDQUERY_H
+#define KLOGG_FIELDQUERY_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <roaring64map.hh>
+
+#include "fieldindex.h"
+#include "linetypes.h"
+
+// Filter on structured fields, like `level=error AND NOT service=payments`.
+//
+// Terms are field=value or field!=value, values with spaces are quoted.
+// Terms are combined with AND (also && or just a space), OR (||), NOT (!)
+// and parentheses. field!=value is the same as NOT field=value, so it
+// matches lines without the field too.
+class FieldQuery {
+  public:
+    // Lines found in the field index
+    struct Matches {
+        roaring::Roaring64Map lines;
+        // Lines that may match because of hashed fields, the text of these
+        // has to be checked with matches()
+        roaring::Roaring64Map candidates;
+    };
+
+    // Field names are resolved against the passed indexed fields
+    static FieldQuery parse( std::string_view text, const std::vector<std::string>& fields );
+
+    bool isValid() const
+    {
+        return error_.empty();
+    }
+
+    const std::string& errorString() const
+    {
+        return error_;
+    }
+
+    // Evaluates the query on lines [startLine, endLine)
+    Matches evaluate( const FieldIndex& index, LineNumber startLine, LineNumber endLine ) const;
+
+    // Checks a line given the normalized value of each indexed field
+    bool matches( const std::vector<std::optional<std::string>>& values ) const;
+
+  private:
+    struct Node {
+        enum class Type { Term, Not, And, Or };
+
+        Type type;
+        size_t field = 0;
+        std::string value;
+        size_t left = 0;
+        size_t right = 0;
+    };
+
+    class Parser;
+
+    // Lines surely matching and lines that may match
+    std::pair<roaring::Roaring64Map, roaring::Roaring64Map>
+    evaluate( size_t node, const FieldIndex& index, const roaring::Roaring64Map& allLines ) const;
+    bool matches( size_t node, const std::vector<std::optional<std::string>>& values ) const;
+
+  private:
+    std::vector<Node> nodes_;
+    size_t root_ = 0;
+    std::string error_;
+};
+
+#endif // KLOGG_FIELDQUERY_H
@@ -46,6 +46,7 @@ template <typename T> class ScopedFileHolder {
 
 class FileHolder {
     friend class ScopedFileHolder<FileHolder>;
+    friend class PositionalFileReader;
 
   public:
     explicit FileHolder( bool keepClosed );
@@ -81,4 +82,27 @@ class FileHolder {
     bool keep_closed_ = false;
 };
 
+// Private read only handle of a file for readers working in parallel.
+// Reads are positional (pread, ReadFile at an offset on Windows), they
+// neither share a seek position nor take the lock of a FileHolder.
+class PositionalFileReader {
+  public:
+    // Duplicates the handle of the holder, so the file read is the one
+    // indexed even if it was renamed or replaced since. On Windows opens
+    // a new handle and checks its FileId against the held file instead.
+    // Not opened if the holder keeps the file closed between reads.
+    explicit PositionalFileReader( FileHolder& fileHolder );
+
+    bool isOpen() const;
+
+    // Reads up to size bytes at offset, returns the number of bytes read
+    // or -1 on error
+    qint64 read( qint64 offset, char* data, qint64 size );
+
+  private:
+    Q_DISABLE_COPY( PositionalFileReader )
+
+    QFile file_;
+};
+
 #endif // FILEHOLDER_H
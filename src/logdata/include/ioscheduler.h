@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_IOSCHEDULER_H
+#define KLOGG_IOSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+
+#include <QString>
+
+#ifndef Q_MOC_RUN
+#include <tbb/flow_graph.h>
+#include <tbb/task_arena.h>
+#endif
+
+#include "atomicflag.h"
+#include "synchronization.h"
+
+// Process wide scheduling of file reads done by indexing and searching
+// in all tabs.
+//
+// A device has at most perf.ioStreamsPerDevice reads running. Reads of the
+// file shown in the current tab (foreground file) take the first free slot.
+// Reads of other files wait in first come first served order until the
+// device has a free slot and no foreground reads running or waiting.
+// Background reads check between blocks if a foreground read needs their
+// device and give it their slot until it is done. Restoring a big session
+// reads the active file first at full speed while the other tabs are
+// indexed one after another in the background.
+//
+// Until a foreground file is set all reads are background ones.
+//
+// Flow graphs of all operations run in one shared arena, so that
+// operations of many tabs don't oversubscribe the CPU.
+class IoScheduler {
+  public:
+    // Read slot on a device, released when destroyed
+    class Stream {
+      public:
+        Stream( Stream&& other ) noexcept;
+        Stream& operator=( Stream&& other ) = delete;
+        Stream( const Stream& ) = delete;
+        Stream& operator=( const Stream& ) = delete;
+        ~Stream();
+
+        // Called between blocks, waits while a foreground read needs
+        // the device. Returns false if interrupted while waiting.
+        // Takes the scheduler lock only if something changed since
+        // the previous call.
+        bool yield();
+
+        bool isOpen() const
+        {
+            return isOpen_;
+        }
+
+      private:
+        friend class IoScheduler;
+        Stream( IoScheduler* scheduler, const QString& fileName, const QString& device,
+                const AtomicFlag& interruptRequest );
+
+        IoScheduler* scheduler_;
+        QString fileName_;
+        QString device_;
+        const AtomicFlag* interruptRequest_;
+
+        bool isOpen_ = false;
+        bool isForeground_ = false;
+        // Scheduler generation the stream state was last checked at
+        uint64_t generation_ = 0;
+    };
+
+    static IoScheduler& get();
+
+    // Waits for a read slot on the device of the file. Returned stream
+    // is not open if interruptRequest was set while waiting.
+    Stream openStream( const QString& fileName, const AtomicFlag& interruptRequest );
+
+    // File of the current tab, empty if there is none
+    void setForegroundFile( const QString& fileName );
+
+    // Wakes up streams waiting for a slot, to be called
+    // after setting the interrupt request of one of them
+    void notifyInterrupted();
+
+    // True if no file is being read or waiting to be read
+    bool isIdle() const;
+
+    // Creates a flow graph running its nodes in the shared arena
+    std::unique_ptr<tbb::flow::graph> createGraph();
+
+  private:
+    IoScheduler();
+
+    struct Device {
+        int foregroundStreams = 0;
+        int backgroundStreams = 0;
+        int foregroundWaiting = 0;
+        // Tickets of background streams waiting for a slot
+        std::deque<uint64_t> waiting;
+
+        int streams() const
+        {
+            return foregroundStreams + backgroundStreams;
+        }
+    };
+
+    bool isForeground( const QString& fileName ) const;
+    bool acquire( Stream& stream, ScopedLock& lock );
+    void release( Stream& stream );
+    // Tells open streams to check their state at the next yield,
+    // called with the lock held
+    void advanceGeneration();
+
+  private:
+    mutable Mutex mutex_;
+    std::condition_variable_any slotReleased_;
+    std::atomic<uint64_t> generation_{ 0 };
+
+    std::map<QString, Device> devices_;
+    QString foregroundFile_;
+    uint64_t nextTicket_ = 0;
+
+    tbb::task_arena arena_;
+};
+
+#endif
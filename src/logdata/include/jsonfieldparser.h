@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_JSONFIELDPARSER_H
+#define KLOGG_JSONFIELDPARSER_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Extracts a few fields from lines holding a JSON object (JSON lines logs).
+//
+// Fields are named by their key, keys of nested objects are joined with
+// a dot (log.level). Lines are parsed with simdjson on-demand API, so the
+// values of other keys are skipped without being parsed.
+class JsonFieldParser {
+  public:
+    explicit JsonFieldParser( std::vector<std::string> fields );
+    ~JsonFieldParser();
+
+    JsonFieldParser( JsonFieldParser&& ) noexcept;
+    JsonFieldParser& operator=( JsonFieldParser&& ) noexcept;
+
+    const std::vector<std::string>& fields() const
+    {
+        return fields_;
+    }
+
+    // Calls onValue with the position in fields() and the value of each field
+    // found in the line. Strings are unescaped, numbers and booleans are
+    // passed as written. Returns false if the line is not a JSON object.
+    bool parse( std::string_view line,
+                const std::function<void( size_t, std::string_view )>& onValue );
+
+  private:
+    struct Parser;
+
+    std::vector<std::string> fields_;
+    std::unique_ptr<Parser> parser_;
+};
+
+#endif // KLOGG_JSONFIELDPARSER_H
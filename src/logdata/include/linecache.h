@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_LINECACHE_H
+#define KLOGG_LINECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+#include "linetypes.h"
+#include "synchronization.h"
+
+// Decoded lines of a file, kept in blocks of consecutive lines so the view
+// and the read ahead share what was read. Least recently used blocks are
+// dropped once the capacity is reached.
+//
+// Lines are stored the way getLines returns them.
+class LineCache {
+  public:
+    static constexpr LinesCount::UnderlyingType BlockSize = 128;
+
+    using Block = std::shared_ptr<const std::vector<QString>>;
+
+    explicit LineCache( size_t maxBlocks );
+
+    static uint64_t blockIndex( LineNumber line )
+    {
+        return line.get() / BlockSize;
+    }
+
+    static LineNumber blockStart( uint64_t blockIndex )
+    {
+        return LineNumber( blockIndex * BlockSize );
+    }
+
+    // Returns the block and marks it as the most recently used one.
+    Block find( uint64_t blockIndex );
+    bool contains( uint64_t blockIndex ) const;
+
+    // Blocks read before the cache was cleared are not inserted,
+    // generation is the one returned before starting the read.
+    // Returns the lines as a block in either case.
+    Block insert( uint64_t blockIndex, std::vector<QString> lines, uint64_t generation );
+    uint64_t generation() const
+    {
+        return generation_.load();
+    }
+
+    // Drops all blocks, returns the number of bytes freed.
+    uint64_t clear();
+
+    uint64_t sizeInBytes() const;
+
+  private:
+    struct CachedBlock {
+        uint64_t index;
+        Block lines;
+        uint64_t sizeInBytes;
+    };
+
+    const size_t maxBlocks_;
+
+    mutable Mutex mutex_;
+    std::atomic<uint64_t> generation_{ 0 };
+    std::list<CachedBlock> blocks_;
+    std::unordered_map<uint64_t, std::list<CachedBlock>::iterator> index_;
+    uint64_t sizeInBytes_ = 0;
+};
+
+#endif
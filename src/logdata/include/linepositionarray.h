@@ -81,6 +81,17 @@ class SimpleLinePositionStorage {
         return storage_.capacity();
     }
 
+    size_t residentSize() const
+    {
+        return allocatedSize();
+    }
+
+    // Only used for temporary arrays, never spilled
+    bool spillToDisk()
+    {
+        return false;
+    }
+
     // Element at index
     LineOffset at( size_t i, Cache* = nullptr ) const
     {
@@ -124,6 +135,11 @@ class LinePosition {
     friend class LinePosition;
 
     LinePosition() = default;
+    explicit LinePosition( Storage&& storage )
+        : array( std::move( storage ) )
+    {
+    }
+
     LinePosition( const LinePosition& ) = delete;
     LinePosition& operator=( const LinePosition& ) = delete;
 
@@ -161,6 +177,16 @@ class LinePosition {
         return array.allocatedSize();
     }
 
+    size_t residentSize() const
+    {
+        return array.residentSize();
+    }
+
+    bool spillToDisk()
+    {
+        return array.spillToDisk();
+    }
+
     // Extract an element
     inline LineOffset at( LineNumber::UnderlyingType i,
                           typename Storage::Cache* lastPosition = nullptr ) const
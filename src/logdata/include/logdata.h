@@ -39,7 +39,11 @@
 #ifndef LOGDATA_H
 #define LOGDATA_H
 
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 
 #include <QDateTime>
 #include <QFile>
@@ -48,14 +52,23 @@
 #include <QTextCodec>
 #include <qregularexpression.h>
 #include <qtextcodec.h>
+#include <string>
 #include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <tbb/task_group.h>
 
 #include "abstractlogdata.h"
 #include "fileholder.h"
+#include "linecache.h"
+#include "longlineindex.h"
 #include "filewatcher.h"
 #include "loadingstatus.h"
 #include "logdataoperation.h"
 #include "logdataworker.h"
+#include "memorybudget.h"
 
 class LogFilteredData;
 
@@ -70,7 +83,7 @@ class LogData : public AbstractLogData {
 
   public:
     LogData();
-    ~LogData();
+    ~LogData() noexcept override;
 
     LogData( const LogData& ) = delete;
     LogData& operator=( const LogData&& ) = delete;
@@ -92,6 +105,10 @@ class LogData : public AbstractLogData {
     std::unique_ptr<LogFilteredData> getNewFilteredData() const;
     // Returns the size if the file in bytes
     qint64 getFileSize() const;
+    // Returns the hash of the indexed data
+    IndexedHash getIndexedHash() const;
+    // Returns the name of the attached file
+    QString getFileName() const;
     // Returns the last modification date for the file.
     // Null if the file is not on disk.
     QDateTime getLastModifiedDate() const;
@@ -100,9 +117,30 @@ class LogData : public AbstractLogData {
 
     // Get the auto-detected encoding for the indexed text.
     QTextCodec* getDetectedEncoding() const;
+    // Lines holding byte sequences invalid in the encoding the file is
+    // indexed with, only UTF-8 and UTF-16LE files are validated
+    roaring::Roaring64Map getInvalidEncodingLines() const;
 
     void setPrefilter(const QString& prefilterPattern);
 
+    // True if timestamps were found while indexing (see Configuration::timestampFormat)
+    bool hasTimestamps() const;
+    // Returns timestamp of the line, lines without one inherit it from the previous line
+    OptionalTimestamp getLineTimestamp( LineNumber line ) const;
+    // Returns timestamps of a set of lines, empty if the file has none
+    std::vector<Timestamp> getLineTimestamps( LineNumber first, LinesCount number ) const;
+    // Returns smallest and biggest timestamps of the file
+    std::pair<Timestamp, Timestamp> getTimestampRange() const;
+    // Returns the first line logged at or after the passed time
+    OptionalLineNumber findLineByTimestamp( Timestamp timestamp ) const;
+
+    // Fields indexed from JSON lines (see Configuration::structuredFields),
+    // empty if none of the lines has them
+    std::vector<std::string> getStructuredFields() const;
+    // Returns the lines between startLine and endLine matching a field filter
+    FieldQuery::Matches findLinesByFields( const FieldQuery& query, LineNumber startLine,
+                                           LineNumber endLine ) const;
+
     struct RawLines {
         LineNumber startLine;
 
@@ -122,6 +160,26 @@ class LogData : public AbstractLogData {
     };
 
     RawLines getLinesRaw( LineNumber first, LinesCount number ) const;
+    // Returns a private reader of the indexed file, closed if the file
+    // is kept closed between reads (see Configuration::keepFileClosed)
+    std::unique_ptr<PositionalFileReader> createFileReader() const;
+    // Reads with the reader passed instead of the shared file,
+    // for reading in many threads at once
+    RawLines getLinesRaw( LineNumber first, LinesCount number,
+                          PositionalFileReader& fileReader ) const;
+
+    // Returns how many lines starting at first fit in maxBytes,
+    // at least one and at most maxLines
+    LinesCount getLinesCountInBytes( LineNumber first, LinesCount maxLines,
+                                     qint64 maxBytes ) const;
+    // Same counting backwards from the line before end
+    LinesCount getLinesCountInBytesBefore( LineNumber end, LinesCount maxLines,
+                                           qint64 maxBytes ) const;
+
+    using LineRange = std::pair<LineNumber, LinesCount>;
+    // Reads the passed ranges into the line cache in the background,
+    // replacing the ranges of the previous call not read yet.
+    void prefetchLineRanges( const std::vector<LineRange>& ranges ) const;
 
   Q_SIGNALS:
     // Sent during the 'attach' process to signal progress
@@ -132,6 +190,9 @@ class LogData : public AbstractLogData {
     // Sent when the file on disk has changed, will be followed
     // by loadingProgressed if needed and then a loadingFinished.
     void fileChanged( MonitoredFileStatus status );
+    // Sent from a background thread when long lines shown from their
+    // beginning only are indexed and can be shown entirely.
+    void longLinesIndexed();
 
   private Q_SLOTS:
     // Consider reloading the file when it changes on disk updated
@@ -147,19 +208,63 @@ class LogData : public AbstractLogData {
     QString doGetExpandedLineString( LineNumber line ) const override;
     std::vector<QString> doGetLines( LineNumber first, LinesCount number ) const override;
     std::vector<QString> doGetExpandedLines( LineNumber first, LinesCount number ) const override;
+    std::vector<LineWindow> doGetLineWindows( LineNumber first, LinesCount number,
+                                              int firstColumn, int nbColumns ) const override;
     LinesCount doGetNbLine() const override;
     LineLength doGetMaxLength() const override;
     LineLength doGetLineLength( LineNumber line ) const override;
+    std::vector<LineLength> doGetLineLengths( LineNumber first, LinesCount number ) const override;
     void doSetDisplayEncoding( const char* encoding ) override;
     QTextCodec* doGetDisplayEncoding() const override;
     void doAttachReader() const override;
     void doDetachReader() const override;
+    void doPrefetchLines( LineNumber first, LinesCount number ) const override;
+    const AbstractLogData* doGetSourceData() const override;
+    SourceRuns doGetSourceRuns( LineNumber first, LinesCount number ) const override;
 
     void reOpenFile() const;
 
     std::vector<QString> getLinesFromFile( LineNumber first, LinesCount number,
                                            QString ( *processLine )( QString&& ) ) const;
 
+    // Reads size bytes at offset to data, returns the number of bytes read
+    using BytesReader = std::function<qint64( qint64 offset, char* data, qint64 size )>;
+    RawLines readLinesRaw( LineNumber first, LinesCount number,
+                           const BytesReader& readBytes ) const;
+
+    // Serves lines from the line cache, reading the missing blocks.
+    // Returns nothing if the lines are not to be cached.
+    std::optional<std::vector<QString>> getCachedLines( LineNumber first,
+                                                        LinesCount number ) const;
+    // Reads and decodes a whole block, empty on failure.
+    std::vector<QString> readLineBlock( uint64_t blockIndex ) const;
+    // The block holding the last line is never cached as the line might
+    // still be growing.
+    bool isBlockCacheable( uint64_t blockIndex ) const;
+    void runPrefetch() const;
+    // Drops what was read from the file, returns the number of bytes freed.
+    uint64_t clearLineCaches() const;
+
+    // Bytes of the line passed, without the line feed, if it is too long
+    // to be read entirely for display.
+    std::optional<std::pair<LineOffset::UnderlyingType, LineOffset::UnderlyingType>>
+    longLineBytes( LineNumber line ) const;
+    // Index of the long line, the GUI thread gets nothing until it is
+    // built in the background.
+    LongLineIndex::LinePtr getLongLineIndex( LineNumber line, LineOffset::UnderlyingType start,
+                                             LineOffset::UnderlyingType end ) const;
+    LongLineIndex::LinePtr buildLongLineIndex( LineNumber line, LineOffset::UnderlyingType start,
+                                               LineOffset::UnderlyingType end ) const;
+    LineWindow getLongLineWindow( LineNumber line, LineOffset::UnderlyingType start,
+                                  LineOffset::UnderlyingType end, int firstColumn,
+                                  int nbColumns ) const;
+    QByteArray readBytes( LineOffset::UnderlyingType offset, int64_t size ) const;
+
+    // Reports index size to the memory budget
+    void updateMemoryUsage();
+    // Moves line index to temporary files, returns number of bytes freed
+    uint64_t spillIndexToDisk();
+
   private:
     mutable std::unique_ptr<FileHolder> attached_file_;
 
@@ -181,6 +286,20 @@ class LogData : public AbstractLogData {
     MonitoredFileStatus fileChangedOnDisk_;
 
     QString prefilterPattern_;
+
+    MemoryBudget::ConsumerId memoryConsumer_;
+
+    // Room for a few dozen screens around each view of the file
+    mutable LineCache lineCache_{ 256 };
+    mutable LongLineIndex longLineIndex_{ 64 };
+
+    // Blocks waiting to be read ahead, the queue is replaced on each request
+    mutable std::mutex prefetchMutex_;
+    mutable std::deque<uint64_t> prefetchQueue_;
+    mutable bool isPrefetchRunning_ = false;
+    // Long lines being indexed in the background
+    mutable std::unordered_set<LineNumber::UnderlyingType> pendingLongLines_;
+    mutable tbb::task_group prefetchTasks_;
 };
 
 #endif
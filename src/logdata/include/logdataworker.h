@@ -40,12 +40,19 @@
 #define LOGDATAWORKERTHREAD_H
 
 #include <qthreadpool.h>
+#include <atomic>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <variant>
+#include <vector>
 
 #include <QObject>
 #include <QFile>
 #include <QTextCodec>
 
+#include <roaring64map.hh>
+
 #if !defined(Q_MOC_RUN)
 #include <tbb/enumerable_thread_specific.h>
 #include <tbb/flow_graph.h>
@@ -57,8 +64,14 @@
 #include "synchronization.h"
 
 #include "encodingdetector.h"
+#include "encodingvalidator.h"
+#include "fieldindex.h"
+#include "fieldquery.h"
+#include "ioscheduler.h"
+#include "jsonfieldparser.h"
 #include "linepositionarray.h"
 #include "loadingstatus.h"
+#include "timestampindex.h"
 
 struct IndexedHash {
     qint64 size = 0;
@@ -72,6 +85,14 @@ struct IndexedHash {
     quint64 tailDigest = 0;
 };
 
+// Part of the indexing data published after each indexed block.
+struct IndexingSnapshot {
+    LinesCount nbLines;
+    LineLength maxLength;
+    qint64 indexedSize = 0;
+    int progress = 0;
+};
+
 template <typename Data, typename LockGuard>
 class IndexingDataAccessor {
   public:
@@ -139,6 +160,78 @@ class IndexingDataAccessor {
         data_->addAll( block, length, linePosition, encoding );
     }
 
+    // Add timestamps of the lines added by the last addAll
+    void addTimestamps( const std::vector<OptionalTimestamp>& timestamps )
+    {
+        data_->addTimestamps( timestamps );
+    }
+
+    bool hasTimestamps() const
+    {
+        return data_->hasTimestamps();
+    }
+
+    Timestamp getTimestamp( LineNumber line ) const
+    {
+        return data_->getTimestamp( line );
+    }
+
+    std::vector<Timestamp> getTimestamps( LineNumber first, LinesCount count ) const
+    {
+        return data_->getTimestamps( first, count );
+    }
+
+    std::pair<Timestamp, Timestamp> getTimestampRange() const
+    {
+        return data_->getTimestampRange();
+    }
+
+    // Get the first line logged at or after the passed time
+    OptionalLineNumber findLineByTimestamp( Timestamp timestamp ) const
+    {
+        return data_->findLineByTimestamp( timestamp );
+    }
+
+    // Sets the structured fields to index, clears them if they changed
+    void setStructuredFields( const std::vector<std::string>& fields )
+    {
+        data_->setStructuredFields( fields );
+    }
+
+    // Add field values of the lines added by the last addAll
+    void addFieldValues( const FieldIndex::Batch& values )
+    {
+        data_->addFieldValues( values );
+    }
+
+    bool hasStructuredFields() const
+    {
+        return data_->hasStructuredFields();
+    }
+
+    std::vector<std::string> getStructuredFields() const
+    {
+        return data_->getStructuredFields();
+    }
+
+    FieldQuery::Matches findLinesByFields( const FieldQuery& query, LineNumber startLine,
+                                           LineNumber endLine ) const
+    {
+        return data_->findLinesByFields( query, startLine, endLine );
+    }
+
+    // Add lines with sequences invalid in the encoding, numbered from firstLine
+    void addInvalidEncodingLines( LineNumber firstLine,
+                                  const std::vector<LinesCount::UnderlyingType>& lines )
+    {
+        data_->addInvalidEncodingLines( firstLine, lines );
+    }
+
+    roaring::Roaring64Map getInvalidEncodingLines() const
+    {
+        return data_->getInvalidEncodingLines();
+    }
+
     void setHeaderHash( quint64 digest, qint64 size )
     {
         data_->hash_.headerSize = size;
@@ -168,11 +261,29 @@ class IndexingDataAccessor {
         data_->clear();
     }
 
+    // Only changes the encoding while no line is indexed
+    void setLinePositionEncoding( CompressedLinePositionStorage::Encoding encoding )
+    {
+        data_->setLinePositionEncoding( encoding );
+    }
+
     size_t allocatedSize() const
     {
         return data_->allocatedSize();
     }
 
+    // Part of allocated size kept in process memory
+    size_t residentSize() const
+    {
+        return data_->residentSize();
+    }
+
+    // Moves line positions to memory mapped temporary files
+    bool spillToDisk()
+    {
+        return data_->spillToDisk();
+    }
+
   private:
     Data data_;
     LockGuard guard_;
@@ -184,6 +295,12 @@ class IndexingData {
     using ConstAccessor = IndexingDataAccessor<const IndexingData*, SharedLock>;
     using MutateAccessor = IndexingDataAccessor<IndexingData*, UniqueLock>;
 
+    // Returns the last published line count, max length, size and progress
+    // without taking the data lock, so readers are never stalled by the indexer.
+    // Lines below the returned count are guaranteed to be available
+    // through a ConstAccessor until the data is cleared.
+    IndexingSnapshot getSnapshot() const;
+
   private:
     qint64 getIndexedSize() const;
 
@@ -211,22 +328,58 @@ class IndexingData {
     void addAll( const QByteArray& block, LineLength length,
                  const FastLinePositionArray& linePosition, QTextCodec* encoding );
 
+    void addTimestamps( const std::vector<OptionalTimestamp>& timestamps );
+    bool hasTimestamps() const;
+    Timestamp getTimestamp( LineNumber line ) const;
+    std::vector<Timestamp> getTimestamps( LineNumber first, LinesCount count ) const;
+    std::pair<Timestamp, Timestamp> getTimestampRange() const;
+    OptionalLineNumber findLineByTimestamp( Timestamp timestamp ) const;
+
+    void setStructuredFields( const std::vector<std::string>& fields );
+    void addFieldValues( const FieldIndex::Batch& values );
+    bool hasStructuredFields() const;
+    std::vector<std::string> getStructuredFields() const;
+    FieldQuery::Matches findLinesByFields( const FieldQuery& query, LineNumber startLine,
+                                           LineNumber endLine ) const;
+
+    void addInvalidEncodingLines( LineNumber firstLine,
+                                  const std::vector<LinesCount::UnderlyingType>& lines );
+    roaring::Roaring64Map getInvalidEncodingLines() const;
+
     // Completely clear the indexing data.
     void clear();
 
+    void setLinePositionEncoding( CompressedLinePositionStorage::Encoding encoding );
+
     size_t allocatedSize() const;
+    size_t residentSize() const;
+    bool spillToDisk();
 
     int getProgress() const;
     void setProgress( int progress );
 
+    // Called by the writer holding the unique lock
+    void publishSnapshot();
+
   private:
     mutable SharedMutex dataMutex_;
 
+    // Seqlock protecting the published snapshot: odd while it is being written
+    std::atomic<uint64_t> snapshotSequence_{};
+    std::atomic<LinesCount::UnderlyingType> publishedNbLines_{};
+    std::atomic<LineLength::UnderlyingType> publishedMaxLength_{};
+    std::atomic<qint64> publishedIndexedSize_{};
+    std::atomic<int> publishedProgress_{};
+
     LinePositionArray linePosition_;
     mutable tbb::enumerable_thread_specific<CompressedLinePositionStorage::Cache> linePositionCache_;
 
     LineLength maxLength_;
 
+    TimestampIndex timestamps_;
+    FieldIndex fields_;
+    roaring::Roaring64Map invalidEncodingLines_;
+
     int progress_{};
 
     FileDigest hashBuilder_;
@@ -252,8 +405,51 @@ struct IndexingState {
 
     QTextCodec* encodingGuess{};
     QTextCodec* fileTextCodec{};
+    bool isEncodingForced{};
+
+    // Set once the encoding to validate the blocks against is known
+    std::optional<EncodingValidator> encodingValidator;
+    // The encoding is guessed again only once if the blocks contradict the guess
+    bool isEncodingReguessed{};
+
+    // Set if timestamps are indexed
+    std::optional<TimestampLayout> timestampLayout;
+    // Beginning of the line not yet terminated at the end of the previous block
+    std::string lineHead;
+
+    // Set if structured fields are indexed
+    std::optional<JsonFieldParser> fieldParser;
+    // Line not yet terminated at the end of the previous block
+    std::string fieldLine;
 };
 
+// Line feed and tab lookup used when indexing blocks, exposed for tests.
+// Positions returned are those of the delimeter byte within the code unit.
+namespace parse_data_block {
+
+using FindDelimeter = std::string_view::size_type ( * )( EncodingParameters encodingParams,
+                                                         std::string_view, char );
+
+std::string_view::size_type findNextSingleByteDelimeter( EncodingParameters encodingParams,
+                                                         std::string_view data, char delimeter );
+
+std::string_view::size_type findNextMultiByteDelimeter( EncodingParameters encodingParams,
+                                                        std::string_view data, char delimeter );
+
+// Instantiated for uint16_t (UTF-16) and uint32_t (UTF-32)
+template <typename CodeUnit>
+std::string_view::size_type findNextWideDelimeter( EncodingParameters encodingParams,
+                                                   std::string_view data, char delimeter );
+
+// Returns the spaces added to the line by the tabs of blockToExpand,
+// posWithinBlock is where the line starts in block.
+LineLength::UnderlyingType
+expandTabsInLine( const QByteArray& block, std::string_view blockToExpand, int posWithinBlock,
+                  EncodingParameters encodingParams, FindDelimeter findNextDelimeter,
+                  LineLength::UnderlyingType initialAdditionalSpaces = 0 );
+
+} // namespace parse_data_block
+
 using OperationResult = std::variant<bool, MonitoredFileStatus>;
 
 class IndexOperation : public QObject {
@@ -292,10 +488,28 @@ class IndexOperation : public QObject {
     FastLinePositionArray parseDataBlock( LineOffset::UnderlyingType blockBegining,
                                           const QByteArray& block, IndexingState& state ) const;
 
-    void guessEncoding( const QByteArray& block, IndexingData::MutateAccessor& scopedAccessor,
-                        IndexingState& state ) const;
+    std::vector<OptionalTimestamp> parseTimestamps( LineOffset::UnderlyingType blockBeginning,
+                                                    const QByteArray& block,
+                                                    LineOffset::UnderlyingType firstLineStart,
+                                                    const FastLinePositionArray& linePositions,
+                                                    IndexingState& state ) const;
+
+    FieldIndex::Batch parseFields( LineOffset::UnderlyingType blockBeginning,
+                                   const QByteArray& block,
+                                   LineOffset::UnderlyingType firstLineStart,
+                                   const FastLinePositionArray& linePositions,
+                                   IndexingState& state ) const;
+
+    void guessEncoding( const QByteArray& block, IndexingState& state ) const;
+
+    EncodingValidator::BlockResult validateEncoding( LineOffset::UnderlyingType blockBeginning,
+                                                     const QByteArray& block,
+                                                     LineOffset::UnderlyingType firstLineStart,
+                                                     const FastLinePositionArray& linePositions,
+                                                     IndexingState& state ) const;
 
-    std::chrono::microseconds readFileInBlocks( QFile& file, BlockPrefetcher& blockPrefetcher );
+    std::chrono::microseconds readFileInBlocks( QFile& file, BlockPrefetcher& blockPrefetcher,
+                                                IoScheduler::Stream& stream );
     void indexNextBlock( IndexingState& state, const BlockData& blockData );
 };
 
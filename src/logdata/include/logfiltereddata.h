@@ -42,24 +42,30 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <tuple>
-#include <unordered_map>
 
 #include <QByteArray>
 #include <QList>
 #include <QObject>
 #include <QStringList>
+#include <QThreadPool>
 
 #include <KDSignalThrottler.h>
 
 #include "abstractlogdata.h"
+#include "fieldquery.h"
 #include "hsregularexpression.h"
 #include "linetypes.h"
 #include "logfiltereddataworker.h"
+#include "memorybudget.h"
+#include "searchresultscache.h"
 #include "synchronization.h"
+#include "timestampparser.h"
 
 class LogData;
 class QTimer;
+class BooleanSearchPlan;
 
 // A list of matches found in a LogData, it stores all the matching lines,
 // which can be accessed using the AbstractLogData interface, together with
@@ -72,14 +78,26 @@ class LogFilteredData : public AbstractLogData {
   public:
     // Constructor used by LogData
     explicit LogFilteredData( const LogData* logData );
+    // Saves search results cache if it has to be kept between sessions
+    ~LogFilteredData() override;
 
     // Starts the async search, sending newDataAvailable() when new data found.
     // If a search is already in progress this function will block until
     // it is done, so the application should call interruptSearch() first.
+    // Matches around focusLine, if set, are found first.
     void runSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
-                    LineNumber endLine );
+                    LineNumber endLine, OptionalLineNumber focusLine = {} );
     // Shortcut for runSearch on all file
     void runSearch( const RegularExpressionPattern& regExp );
+    // Runs the search on lines between startLine and endLine logged between
+    // from and to (inclusive), the time range is ignored if the file has no
+    // timestamps. Later updates of the search keep the time range.
+    void runSearchInTimeRange( const RegularExpressionPattern& regExp, LineNumber startLine,
+                               LineNumber endLine, Timestamp from, Timestamp to,
+                               OptionalLineNumber focusLine = {} );
+    // Filters lines on structured fields instead of a regular expression,
+    // results are taken from the field index on the worker thread.
+    void runFieldSearch( const FieldQuery& query, LineNumber startLine, LineNumber endLine );
 
     // Add to the existing search, starting at the line when the search was
     // last stopped. Used when the file on disk has been added too.
@@ -104,6 +122,9 @@ class LogFilteredData : public AbstractLogData {
     // Returns the number of marks (independently of the visibility)
     LinesCount getNbMarks() const;
 
+    // Returns the original line numbers of the range of indexes passed.
+    SearchResultArray getMatchingLines( LineNumber firstIndex, LinesCount count ) const;
+
     LineType lineTypeByIndex( LineNumber index ) const;
     LineType lineTypeByLine( LineNumber lineNumber ) const;
 
@@ -119,6 +140,8 @@ class LogFilteredData : public AbstractLogData {
     void deleteMark( LineNumber line );
     // Toggle presence of the mark on the passed line.
     void toggleMark( LineNumber line );
+    // Mark all the lines passed, or unmark them if they all are already marked.
+    void toggleMarks( const SearchResultArray& lines );
     // Completely clear the marks list.
     void clearMarks();
     // Get all marked lines
@@ -152,11 +175,21 @@ class LogFilteredData : public AbstractLogData {
     QString doGetExpandedLineString( LineNumber line ) const override;
     std::vector<QString> doGetLines( LineNumber first, LinesCount number ) const override;
     std::vector<QString> doGetExpandedLines( LineNumber first, LinesCount number ) const override;
-    std::vector<QString> doGetLines( LineNumber first, LinesCount number,
-                                     const std::function<QString( LineNumber )>& lineGetter ) const;
+    void doPrefetchLines( LineNumber first, LinesCount number ) const override;
+    const AbstractLogData* doGetSourceData() const override;
+    SourceRuns doGetSourceRuns( LineNumber first, LinesCount number ) const override;
+    std::vector<QString> doGetLines(
+        LineNumber first, LinesCount number,
+        const std::function<std::vector<QString>( LineNumber, LinesCount )>& linesGetter ) const;
+    std::vector<LineWindow> doGetLineWindows( LineNumber first, LinesCount number,
+                                              int firstColumn, int nbColumns ) const override;
+    // Calls readRun for each run of consecutive source lines of the range passed.
+    void forEachSourceRun( LineNumber first, LinesCount number,
+                           const std::function<void( LineNumber, LinesCount )>& readRun ) const;
     LinesCount doGetNbLine() const override;
     LineLength doGetMaxLength() const override;
     LineLength doGetLineLength( LineNumber line ) const override;
+    std::vector<LineLength> doGetLineLengths( LineNumber first, LinesCount number ) const override;
 
     void doSetDisplayEncoding( const char* encoding ) override;
     QTextCodec* doGetDisplayEncoding() const override;
@@ -180,6 +213,9 @@ class LogFilteredData : public AbstractLogData {
     const LogData* sourceLogData_;
 
     RegularExpressionPattern currentRegExp_;
+    std::optional<FieldQuery> currentFieldQuery_;
+    // Set if the current search is restricted to a time range
+    std::optional<std::pair<Timestamp, Timestamp>> currentTimeRange_;
     LineLength maxLength_;
     LineLength maxLengthMarks_;
     // Number of lines of the LogData that has been searched for:
@@ -195,43 +231,68 @@ class LogFilteredData : public AbstractLogData {
     KDToolBox::KDSignalThrottler searchProgressThrottler_;
 
   private:
-    struct CachedSearchResult {
-        SearchResultArray matching_lines;
-        LineLength maxLength;
-    };
-
-    using SearchCacheKey = std::tuple<RegularExpressionPattern, LineNumber::UnderlyingType, LineNumber::UnderlyingType>;
-    struct SearchCacheKeyHash {
-        template <class T>
-        void hash_combine( std::size_t& seed, const T& v ) const
-        {
-            seed ^= std::hash<T>()( v ) + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 );
-        }
-        std::size_t operator()( const SearchCacheKey& k ) const
-        {
-            size_t seed = qHash( std::get<0>( k ).pattern );
-
-            hash_combine( seed, std::get<0>( k ).isPlainText );
-            hash_combine( seed, std::get<0>( k ).isBoolean );
-            hash_combine( seed, std::get<0>( k ).isCaseSensitive );
-            hash_combine( seed, std::get<0>( k ).isExclude );
-            hash_combine( seed, std::get<1>( k ) );
-            hash_combine( seed, std::get<2>( k ) );
-            return seed;
-        }
-    };
+    using SearchCacheKey = SearchResultsCache::Key;
 
-    std::unordered_map<SearchCacheKey, CachedSearchResult, SearchCacheKeyHash> searchResultsCache_;
+    SearchResultsCache searchResultsCache_;
     SearchCacheKey currentSearchKey_;
+    // Set while a boolean search matches its uncached sub-patterns
+    std::shared_ptr<const BooleanSearchPlan> currentSearchPlan_;
+    bool isSearchResultsCacheLoaded_ = false;
+    bool isSearchResultsCacheLoading_ = false;
+    // Incremented when the cache is dropped, loads started before are ignored
+    uint64_t searchResultsCacheGeneration_ = 0;
+
+    // Search waiting for the cache to be loaded
+    struct PendingSearch {
+        LineNumber startLine;
+        LineNumber endLine;
+        OptionalLineNumber focusLine;
+    };
+    std::optional<PendingSearch> pendingSearch_;
+    // Where and for which data the cache is saved, source log data
+    // can be gone by the time we are destroyed
+    QString searchResultsCachePath_;
+    IndexedHash searchResultsCacheHash_;
+    // Loads, saves and removals of the cache file, one at a time in order
+    QThreadPool searchResultsCachePool_;
 
     SearchCacheKey makeCacheKey( const RegularExpressionPattern& regExp, LineNumber startLine,
                                  LineNumber endLine )
     {
-        return std::make_tuple( regExp, startLine.get(), endLine.get() );
+        return SearchResultsCache::makeKey( regExp, startLine, endLine );
     }
 
+    // Looks the current search up in the cache and runs what is not cached
+    void startSearch( LineNumber startLine, LineNumber endLine, OptionalLineNumber focusLine );
+
+    // Restricts a range of lines to the lines logged in the current time range
+    std::pair<LineNumber, LineNumber> clampToTimeRange( LineNumber startLine,
+                                                        LineNumber endLine ) const;
+
+    // Starts loading the cache of the file from disk if it has not been loaded,
+    // returns true while it is loading
+    bool loadSearchResultsCache();
+    void handleSearchResultsCacheLoaded( uint64_t generation,
+                                         std::shared_ptr<SearchResultsCache> cache,
+                                         const QString& cachePath, const IndexedHash& indexedHash );
+    // Moves the cache out and writes it to disk on a background thread
+    void saveSearchResultsCache();
+    // Drops in-memory cache, it is saved to disk first if persistence is enabled
+    uint64_t evictSearchResultsCache();
+
+    // Reports results and cache sizes to the memory budget
+    void updateMemoryUsage();
+    MemoryBudget::ConsumerId memoryConsumer_;
     void updateSearchResultsCache();
 
+    // Plans a boolean search over cached results of its sub-patterns,
+    // empty if the pattern can't be planned
+    std::shared_ptr<const BooleanSearchPlan>
+    planBooleanSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
+                       LineNumber endLine );
+    // Caches lines of sub-patterns matched by the current search plan
+    void cacheSubPatternResults();
+
     inline LineNumber getExpectedSearchEnd( const SearchCacheKey& cacheKey ) const
     {
         return LineNumber( std::get<2>( cacheKey ) );
@@ -244,6 +305,7 @@ class LogFilteredData : public AbstractLogData {
 
     // update maxLengthMarks_ when a Marks was changed.
     void updateMaxLengthMarks( OptionalLineNumber added_line, OptionalLineNumber removed_line );
+    LineLength maxLineLength( const SearchResultArray& lines ) const;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( LogFilteredData::Visibility )
@@ -41,6 +41,11 @@
 
 #include <QObject>
 
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
 #include <qthreadpool.h>
 #include <roaring.hh>
 #include <roaring64map.hh>
@@ -50,11 +55,13 @@
 #endif
 
 #include "atomicflag.h"
+#include "fieldquery.h"
 #include "regularexpression.h"
 #include "linetypes.h"
 #include "synchronization.h"
 
 class LogData;
+class BooleanSearchPlan;
 
 // Class encapsulating a single matching line
 // Contains the line number the line was found in and its content.
@@ -91,6 +98,12 @@ struct SearchResults {
     LinesCount processedLines;
 };
 
+// Lines matching one sub-pattern of a boolean combination
+struct SubPatternResults {
+    SearchResultArray matchingLines;
+    LineLength maxLength;
+};
+
 // This class is a mutex protected set of search result data.
 // It is thread safe.
 class SearchData {
@@ -98,8 +111,17 @@ class SearchData {
     // will clear new matches
     SearchResults takeCurrentResults() const;
 
-    // Atomically add to all the existing search data.
-    void addAll( LineLength length, const SearchResultArray& matches, LinesCount nbLinesProcessed );
+    // Lines before initialLine are not going to be scanned
+    void beginScan( LineNumber initialLine );
+    // Atomically add to all the existing search data the results
+    // of a scanned chunk, chunks can be added in any order. Matches
+    // of lines scanned before are not counted again.
+    void addAll( LineLength length, const SearchResultArray& matches, LineNumber chunkStart,
+                 LinesCount chunkLines );
+    // Add lines matching missing sub-patterns of a planned boolean search
+    void addSubPatternMatches( const std::vector<SubPatternResults>& matches );
+    // Lines found so far for each missing sub-pattern
+    std::vector<SubPatternResults> getSubPatternMatches() const;
     // Get the number of matches
     LinesCount getNbMatches() const;
     // Get the last matched line number
@@ -107,22 +129,42 @@ class SearchData {
     // 0 if no matches have been found yet
     LineNumber getLastMatchedLineNumber() const;
 
+    // End of the lines processed without gaps from the search start
     LineNumber getLastProcessedLine() const;
 
-    // Delete the match for the passed line (if it exist)
+    // Forget the scan of the passed line so that its match is counted
+    // again by the next scan, only the last processed line can be forgotten
     void deleteMatch( LineNumber line );
 
     // Atomically clear the data.
     void clear();
 
   private:
+    struct ScannedRange {
+        LineNumber end;
+        bool lastLineMatched;
+    };
+
+    // Adds a range scanned after the processed lines, merged
+    // with the ranges it overlaps or touches
+    void addScannedAhead( LineNumber begin, LineNumber end, bool lastLineMatched );
+    // Moves the processed lines past the ranges scanned ahead they reach
+    void mergeScannedAhead();
+
     mutable SharedMutex dataMutex_;
 
-    SearchResultArray matches_;
     mutable SearchResultArray newMatches_;
     LineLength maxLength_{ 0 };
     LinesCount nbLinesProcessed_{ 0 };
     LinesCount nbMatches_{ 0 };
+    // Unknown if the last processed line was skipped or forgotten
+    std::optional<bool> lastProcessedLineMatched_;
+    // Chunks scanned after a gap, by first line, merged into nbLinesProcessed_
+    // when the gap is filled. Matches of lines in these ranges and before
+    // nbLinesProcessed_ have been counted.
+    std::map<LineNumber, ScannedRange> scannedAhead_;
+
+    std::vector<SubPatternResults> subPatternMatches_;
 };
 
 class SearchOperation : public QObject {
@@ -130,7 +172,7 @@ class SearchOperation : public QObject {
   public:
     SearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
                      const RegularExpressionPattern& regExp, LineNumber startLine,
-                     LineNumber endLine );
+                     LineNumber endLine, std::shared_ptr<const BooleanSearchPlan> plan = {} );
 
     // Run the search operation, returns true if it has been done
     // and false if it has been cancelled (results not copied)
@@ -143,13 +185,17 @@ class SearchOperation : public QObject {
   protected:
     // Implement the common part of the search, passing
     // the shared results and the line to begin the search from.
-    void doSearch( SearchData& result, LineNumber initialLine );
+    // With a focus line the lines around it are scanned first.
+    void doSearch( SearchData& result, LineNumber initialLine,
+                   OptionalLineNumber focusLine = {} );
 
     AtomicFlag& interruptRequested_;
     const RegularExpressionPattern regexp_;
     const LogData& sourceLogData_;
     LineNumber startLine_;
     LineNumber endLine_;
+    // Matches only sub-patterns without cached results if set
+    std::shared_ptr<const BooleanSearchPlan> plan_;
 };
 
 class FullSearchOperation : public SearchOperation {
@@ -157,12 +203,18 @@ class FullSearchOperation : public SearchOperation {
   public:
     FullSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
                          const RegularExpressionPattern& regExp, LineNumber startLine,
-                         LineNumber endLine )
-        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine )
+                         LineNumber endLine, std::shared_ptr<const BooleanSearchPlan> plan,
+                         OptionalLineNumber focusLine )
+        : SearchOperation( sourceLogData, interruptRequested, regExp, startLine, endLine,
+                           std::move( plan ) )
+        , focusLine_( focusLine )
     {
     }
 
     void run( SearchData& result ) override;
+
+  private:
+    OptionalLineNumber focusLine_;
 };
 
 class UpdateSearchOperation : public SearchOperation {
@@ -182,6 +234,31 @@ class UpdateSearchOperation : public SearchOperation {
     LineNumber initialPosition_;
 };
 
+// Filters lines on structured fields. Lines come from the field index,
+// only the candidates of hashed fields are read and parsed.
+class FieldSearchOperation : public SearchOperation {
+    Q_OBJECT
+  public:
+    FieldSearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
+                          const FieldQuery& query, LineNumber startLine, LineNumber endLine,
+                          OptionalLineNumber position )
+        : SearchOperation( sourceLogData, interruptRequested, RegularExpressionPattern{},
+                           startLine, endLine )
+        , query_( query )
+        , initialPosition_( position )
+    {
+    }
+
+    void run( SearchData& result ) override;
+
+  private:
+    void doFieldSearch( SearchData& result, LineNumber initialLine );
+
+    const FieldQuery query_;
+    // Continues the previous search from this line if set
+    OptionalLineNumber initialPosition_;
+};
+
 class LogFilteredDataWorker : public QObject {
     Q_OBJECT
 
@@ -195,18 +272,29 @@ class LogFilteredDataWorker : public QObject {
     LogFilteredDataWorker( LogFilteredDataWorker&& ) = delete;
     LogFilteredDataWorker& operator=( LogFilteredDataWorker&& ) = delete;
 
-    // Start the search with the passed regexp
-    void search( const RegularExpressionPattern& regExp, LineNumber startLine, LineNumber endLine );
+    // Start the search with the passed regexp, boolean combinations
+    // can be computed from the results of their sub-patterns by a plan.
+    // Matches around the focus line are searched for first if it is set.
+    void search( const RegularExpressionPattern& regExp, LineNumber startLine, LineNumber endLine,
+                 std::shared_ptr<const BooleanSearchPlan> plan = {},
+                 OptionalLineNumber focusLine = {} );
     // Continue the previous search starting at the passed position
     // in the source file (line number)
     void updateSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
                        LineNumber endLine, LineNumber position );
 
+    // Start filtering lines on structured fields, or continue
+    // the previous field search from position if it is set
+    void searchFields( const FieldQuery& query, LineNumber startLine, LineNumber endLine,
+                       OptionalLineNumber position = {} );
+
     // Interrupts the search if one is in progress
     void interrupt();
 
     // get the current indexing data
     SearchResults getSearchResults() const;
+    // Lines matching the sub-patterns the plan of the search did not have
+    std::vector<SubPatternResults> getSubPatternResults() const;
 
   Q_SIGNALS:
     // Sent during the indexing process to signal progress
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LONGLINEINDEX_H
+#define KLOGG_LONGLINEINDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "encodingdetector.h"
+#include "linetypes.h"
+#include "synchronization.h"
+
+// Positions within the longest lines of a file, so that only the part of
+// such a line shown by a view has to be read and decoded.
+//
+// A checkpoint is taken every few kilobytes of the line, at a byte
+// where decoding can start, and maps it to the expanded column of the
+// character found there.
+class LongLineIndex {
+  public:
+    // Lines shorter than that, in bytes, are always read entirely
+    static constexpr int64_t MinLineBytes = 64 * 1024;
+
+    struct Checkpoint {
+        int64_t byteOffset;
+        int64_t column;
+    };
+
+    struct Line {
+        std::vector<Checkpoint> checkpoints;
+        int64_t byteLength = 0;
+        int64_t expandedLength = 0;
+
+        // Returns the checkpoint to start decoding from to get the
+        // column passed and the offset of the byte where to stop
+        // decoding to get the column lastColumn.
+        std::pair<Checkpoint, int64_t> byteRange( int64_t firstColumn,
+                                                  int64_t lastColumn ) const;
+    };
+
+    using LinePtr = std::shared_ptr<const Line>;
+
+    explicit LongLineIndex( size_t maxLines );
+
+    // Decodes the passed line once to build its checkpoints.
+    static Line build( std::string_view lineBytes, TextDecoder decoder );
+
+    LinePtr find( LineNumber line ) const;
+    // Lines indexed before the index was cleared are not inserted,
+    // generation is the one returned before starting to build it.
+    void insert( LineNumber line, LinePtr index, uint64_t generation );
+    uint64_t generation() const
+    {
+        return generation_.load();
+    }
+
+    // Drops all the lines, returns the number of bytes freed.
+    uint64_t clear();
+
+  private:
+    const size_t maxLines_;
+
+    mutable Mutex mutex_;
+    std::atomic<uint64_t> generation_{ 0 };
+    mutable std::list<LineNumber::UnderlyingType> recentLines_;
+    std::unordered_map<LineNumber::UnderlyingType,
+                       std::pair<LinePtr, std::list<LineNumber::UnderlyingType>::iterator>>
+        lines_;
+};
+
+#endif
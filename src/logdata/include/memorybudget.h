@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_MEMORYBUDGET_H
+#define KLOGG_MEMORYBUDGET_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+
+#include <QObject>
+
+#include "synchronization.h"
+
+class LogData;
+
+// Process wide accounting of memory used by opened files.
+//
+// Each LogData and LogFilteredData registers a consumer and reports its
+// index, search results and search cache sizes. When the sum goes over
+// the budget (perf.memoryBudgetMb, half of physical memory by default)
+// memory is reclaimed on the main thread: first search caches of all
+// tabs are dropped (they are kept on disk if persistence is enabled),
+// then line indexes are spilled to memory mapped temporary files,
+// biggest first, until the usage fits 10% below the budget. If that is not
+// possible, reclaim is tried again only once the usage grows further.
+class MemoryBudget : public QObject {
+    Q_OBJECT
+
+  public:
+    // SpilledIndex is not counted against the budget
+    enum class Usage { Index, SearchResults, SearchCache, SpilledIndex };
+
+    using ConsumerId = uint64_t;
+
+    struct Consumer {
+        // Tab the consumer belongs to
+        const LogData* owner = nullptr;
+
+        // Both return number of bytes freed, can be empty
+        std::function<uint64_t()> evictCaches;
+        std::function<uint64_t()> spillToDisk;
+    };
+
+    struct Accounting {
+        uint64_t index = 0;
+        uint64_t searchResults = 0;
+        uint64_t searchCache = 0;
+        // Index bytes moved to temporary files
+        uint64_t spilled = 0;
+
+        uint64_t total() const
+        {
+            return index + searchResults + searchCache;
+        }
+    };
+
+    static MemoryBudget& get();
+
+    ConsumerId registerConsumer( Consumer consumer );
+    void unregisterConsumer( ConsumerId id );
+
+    // Can be called from any thread, reclaims memory if usage goes over budget
+    void update( ConsumerId id, Usage usage, uint64_t bytes );
+
+    // Called after an allocation failure, reclaims everything that can be reclaimed
+    void reclaimAll();
+
+    Accounting usage( const LogData* owner ) const;
+    Accounting totalUsage() const;
+    uint64_t budget() const;
+
+  Q_SIGNALS:
+    void usageChanged();
+
+  private:
+    MemoryBudget();
+
+    void scheduleReclaim( bool reclaimEverything );
+    void reclaim( bool reclaimEverything );
+
+  private:
+    struct ConsumerData {
+        Consumer consumer;
+        Accounting accounting;
+    };
+
+    mutable Mutex mutex_;
+    std::map<ConsumerId, ConsumerData> consumers_;
+    ConsumerId nextId_ = 1;
+
+    bool isReclaimScheduled_ = false;
+    bool isReclaiming_ = false;
+
+    // Usage left by the last reclaim
+    uint64_t usageAfterReclaim_ = 0;
+};
+
+#endif // KLOGG_MEMORYBUDGET_H
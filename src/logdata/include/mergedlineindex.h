@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_MERGEDLINEINDEX_H
+#define KLOGG_MERGEDLINEINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "linetypes.h"
+
+// Maps lines of a merged view to the lines of its sources.
+//
+// The merged view is stored as a sequence of runs, a run being a number of
+// consecutive lines taken from the same source. Each run is written as one
+// LEB128 varint holding ( length * sourcesCount + source ), lines positions
+// in the sources are never stored, they are the running sum of the
+// preceding runs of the same source. Files that interleave in large chunks
+// cost a couple of bytes per chunk, worst case is a couple of bytes per line.
+//
+// Every CheckpointInterval runs we store a checkpoint: the merged line the
+// run starts at, its offset in the run stream and the position reached in
+// every source. A lookup is a binary search on checkpoints followed by
+// decoding at most CheckpointInterval runs.
+class MergedLineIndex {
+  public:
+    struct Location {
+        size_t source;
+        LineNumber line;
+    };
+
+    struct Segment {
+        size_t source;
+        LineNumber sourceLine;
+        LineNumber mergedLine;
+        LinesCount count;
+    };
+
+    MergedLineIndex() = default;
+    explicit MergedLineIndex( size_t sourcesCount );
+
+    // Appends count lines of the passed source, extends the last run
+    // if it belongs to the same source.
+    void append( size_t source, LinesCount count );
+
+    LinesCount size() const
+    {
+        return LinesCount( nbLines_ );
+    }
+
+    size_t sourcesCount() const
+    {
+        return sourcesCount_;
+    }
+
+    // Returns where the merged line comes from,
+    // line must be less than size().
+    Location at( LineNumber line ) const;
+
+    // Returns the runs covering [first, first + count), clipped to the range.
+    std::vector<Segment> segments( LineNumber first, LinesCount count ) const;
+
+    // Calls function for every run of the index, in merged order.
+    template <typename Function>
+    void forEachSegment( Function function ) const
+    {
+        std::vector<uint64_t> positions( sourcesCount_, 0 );
+        uint64_t mergedLine = 0;
+        size_t offset = 0;
+        while ( offset < runs_.size() ) {
+            const auto [ source, length ] = readRun( offset );
+            function( Segment{ source, LineNumber( positions[ source ] ), LineNumber( mergedLine ),
+                               LinesCount( length ) } );
+            positions[ source ] += length;
+            mergedLine += length;
+        }
+    }
+
+    size_t allocatedSize() const;
+
+  private:
+    struct Run {
+        size_t source;
+        uint64_t length;
+    };
+
+    struct Checkpoint {
+        uint64_t mergedLine;
+        size_t offset;
+    };
+
+    static constexpr size_t CheckpointInterval = 64;
+
+    Run readRun( size_t& offset ) const;
+    void writeRun( const Run& run );
+
+    // Index of the last checkpoint at or before line
+    size_t findCheckpoint( uint64_t line ) const;
+
+  private:
+    size_t sourcesCount_ = 0;
+    uint64_t nbLines_ = 0;
+
+    std::vector<uint8_t> runs_;
+    size_t nbRuns_ = 0;
+
+    // Last run is kept decoded to be extended by append
+    Run lastRun_{ 0, 0 };
+    size_t lastRunOffset_ = 0;
+
+    std::vector<Checkpoint> checkpoints_;
+    // sourcesCount_ values per checkpoint
+    std::vector<uint64_t> checkpointPositions_;
+
+    // Position reached in every source, after the last run
+    std::vector<uint64_t> positions_;
+};
+
+#endif // KLOGG_MERGEDLINEINDEX_H
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_MERGEDLOGDATA_H
+#define KLOGG_MERGEDLOGDATA_H
+
+#include <memory>
+#include <vector>
+
+#include <QThreadPool>
+
+#include "abstractlogdata.h"
+#include "atomicflag.h"
+#include "logfiltereddataworker.h"
+#include "mergedlineindex.h"
+#include "regularexpressionpattern.h"
+#include "synchronization.h"
+
+class LogData;
+
+// Presents several indexed files as one log ordered by the timestamp found
+// at the beginning of their lines. Lines without a timestamp keep the one
+// of the previous line so multi-line records stay together.
+//
+// Sources are merged with a k-way merge over per-file timestamp columns.
+// Columns are only alive during the merge, after that the view keeps the
+// compact MergedLineIndex, so memory stays close to the sum of the sources
+// line indexes.
+// This class is thread-safe.
+class MergedLogData : public AbstractLogData {
+    Q_OBJECT
+
+  public:
+    explicit MergedLogData( std::vector<std::shared_ptr<LogData>> sources );
+    ~MergedLogData() override;
+
+    MergedLogData( const MergedLogData& ) = delete;
+    MergedLogData& operator=( const MergedLogData& ) = delete;
+
+    MergedLogData( MergedLogData&& ) = delete;
+    MergedLogData& operator=( MergedLogData&& ) = delete;
+
+    // Rebuilds the merge index from the current content of the sources.
+    // Runs asynchronously, mergeFinished is sent when the new index is in place.
+    void rebuildIndex();
+    // Interrupts the merge in progress, the previous index is kept.
+    void interruptRebuild();
+
+    size_t getNbSources() const;
+    const LogData& getSource( size_t index ) const;
+
+    // Returns the source and the line within that source for a merged line.
+    MergedLineIndex::Location mapToSource( LineNumber line ) const;
+
+    // Runs the search pipeline on all sources in parallel and returns
+    // matching lines numbered as in the merged view.
+    SearchResults search( const RegularExpressionPattern& regExp,
+                          AtomicFlag& interruptRequested ) const;
+
+  Q_SIGNALS:
+    void mergeProgressed( int percent );
+    void mergeFinished();
+
+  private:
+    QString doGetLineString( LineNumber line ) const override;
+    QString doGetExpandedLineString( LineNumber line ) const override;
+    std::vector<QString> doGetLines( LineNumber first, LinesCount number ) const override;
+    std::vector<QString> doGetExpandedLines( LineNumber first, LinesCount number ) const override;
+    std::vector<LineWindow> doGetLineWindows( LineNumber first, LinesCount number,
+                                              int firstColumn, int nbColumns ) const override;
+    LinesCount doGetNbLine() const override;
+    LineLength doGetMaxLength() const override;
+    LineLength doGetLineLength( LineNumber line ) const override;
+    std::vector<LineLength> doGetLineLengths( LineNumber first, LinesCount number ) const override;
+    void doSetDisplayEncoding( const char* encoding ) override;
+    QTextCodec* doGetDisplayEncoding() const override;
+    void doAttachReader() const override;
+    void doDetachReader() const override;
+    void doPrefetchLines( LineNumber first, LinesCount number ) const override;
+    const AbstractLogData* doGetSourceData() const override;
+    SourceRuns doGetSourceRuns( LineNumber first, LinesCount number ) const override;
+
+    std::vector<QString> getLinesFromSources( LineNumber first, LinesCount number,
+                                              bool expanded ) const;
+
+    MergedLineIndex buildIndex();
+
+  private:
+    std::vector<std::shared_ptr<LogData>> sources_;
+
+    mutable SharedMutex indexMutex_;
+    MergedLineIndex index_;
+
+    AtomicFlag interruptRequested_;
+    QThreadPool mergePool_;
+};
+
+#endif // KLOGG_MERGEDLOGDATA_H
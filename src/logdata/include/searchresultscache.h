@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_SEARCHRESULTSCACHE_H
+#define KLOGG_SEARCHRESULTSCACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+
+#include <QString>
+
+#include "linetypes.h"
+#include "logdataworker.h"
+#include "logfiltereddataworker.h"
+#include "regularexpressionpattern.h"
+
+// Results of previous searches on a file, evicted in least recently
+// used order once their total size goes over the configured budget.
+//
+// Size of an entry is the size of its portable roaring serialization,
+// the same format is used to keep the cache on disk between sessions.
+// The file on disk stores the hash of the indexed data and is only
+// loaded back if the file has not changed since.
+class SearchResultsCache {
+  public:
+    struct CachedSearchResult {
+        SearchResultArray matching_lines;
+        LineLength maxLength;
+    };
+
+    using Key = std::tuple<RegularExpressionPattern, LineNumber::UnderlyingType,
+                           LineNumber::UnderlyingType>;
+
+    static Key makeKey( const RegularExpressionPattern& regExp, LineNumber startLine,
+                        LineNumber endLine )
+    {
+        return std::make_tuple( regExp, startLine.get(), endLine.get() );
+    }
+
+    // Returns cached result and makes it the most recently used one
+    std::optional<CachedSearchResult> find( const Key& key );
+
+    // Adds result as the most recently used one and evicts the least
+    // recently used ones until the cache fits into maxSizeInBytes.
+    // Returns false if the result alone is bigger than maxSizeInBytes.
+    bool insert( const Key& key, CachedSearchResult result, uint64_t maxSizeInBytes );
+
+    void clear();
+
+    bool empty() const
+    {
+        return entries_.empty();
+    }
+
+    uint64_t sizeInBytes() const
+    {
+        return sizeInBytes_;
+    }
+
+    // Cache file for the log file, located in the application cache directory
+    static QString cacheFilePath( const QString& logFileName );
+
+    // The file is replaced atomically so a load running at the same time
+    // reads either the old or the new cache
+    bool save( const QString& path, const IndexedHash& hash ) const;
+    // Replaces the cache content with the one from path if it was saved
+    // for the same indexed data
+    bool load( const QString& path, const IndexedHash& hash, uint64_t maxSizeInBytes );
+
+    // Removes cache files not saved for MaxCacheFileAge, then the least recently
+    // saved ones until the cache directory holds at most MaxCachedFiles caches
+    // of maxSizeInBytes each
+    static void prune( uint64_t maxSizeInBytes );
+
+  private:
+    struct KeyHash {
+        template <class T>
+        void hash_combine( std::size_t& seed, const T& v ) const
+        {
+            seed ^= std::hash<T>()( v ) + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 );
+        }
+        std::size_t operator()( const Key& k ) const
+        {
+            size_t seed = qHash( std::get<0>( k ).pattern );
+
+            hash_combine( seed, std::get<0>( k ).isPlainText );
+            hash_combine( seed, std::get<0>( k ).isBoolean );
+            hash_combine( seed, std::get<0>( k ).isCaseSensitive );
+            hash_combine( seed, std::get<0>( k ).isExclude );
+            hash_combine( seed, std::get<1>( k ) );
+            hash_combine( seed, std::get<2>( k ) );
+            return seed;
+        }
+    };
+
+    struct Entry {
+        Key key;
+        CachedSearchResult result;
+        uint64_t sizeInBytes;
+    };
+
+    void evict( uint64_t maxSizeInBytes );
+
+  private:
+    // Most recently used first
+    std::list<Entry> entries_;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    uint64_t sizeInBytes_ = 0;
+};
+
+#endif // KLOGG_SEARCHRESULTSCACHE_H
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TIMESTAMPINDEX_H
+#define KLOGG_TIMESTAMPINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "linetypes.h"
+#include "timestampparser.h"
+
+// Timestamp of every line of a file.
+//
+// Lines are grouped in blocks of BlockSize lines. For every block we keep
+// the timestamp of its first line, min and max timestamps of the block and
+// the max timestamp of all lines up to the end of the block. The other lines
+// are stored as zigzag varint deltas to the previous line, so lines logged
+// in the same millisecond take 1 byte and typical logs take 1-3 bytes per line.
+//
+// Lines without a timestamp get the one of the previous line, lines before
+// the first timestamp of the file get the first one.
+//
+// Running max is monotonic even if the log is not perfectly ordered, binary
+// search on it finds the first line at or after a given time in O(log n)
+// followed by decoding a single block.
+class TimestampIndex {
+  public:
+    void append( OptionalTimestamp timestamp );
+    // Drops lines after newSize
+    void truncate( LinesCount newSize );
+    void clear();
+
+    LinesCount size() const
+    {
+        return LinesCount( nbLines_ + pendingLines_ );
+    }
+
+    // True if at least one line has a timestamp
+    bool hasTimestamps() const
+    {
+        return nbLines_ > 0;
+    }
+
+    Timestamp at( LineNumber line ) const;
+    // Timestamps of lines [first, first + count), decoding each block once
+    std::vector<Timestamp> slice( LineNumber first, LinesCount count ) const;
+
+    // Smallest and biggest timestamps in the file
+    std::pair<Timestamp, Timestamp> range() const;
+
+    // First line with timestamp at or after the passed one,
+    // empty if all lines are before it.
+    OptionalLineNumber findLineAtOrAfter( Timestamp timestamp ) const;
+
+    size_t allocatedSize() const;
+
+  private:
+    struct Block {
+        Timestamp first;
+        Timestamp min;
+        Timestamp max;
+        Timestamp runningMax;
+        size_t offset;
+    };
+
+    static constexpr uint64_t BlockSize = 256;
+
+    void push( Timestamp timestamp );
+    std::vector<Timestamp> decodeBlock( size_t blockIndex, uint64_t count ) const;
+    Timestamp readDelta( size_t& offset ) const;
+
+  private:
+    std::vector<Block> blocks_;
+    std::vector<uint8_t> deltas_;
+
+    uint64_t nbLines_ = 0;
+    // Lines seen before the first timestamp
+    uint64_t pendingLines_ = 0;
+
+    Timestamp last_ = 0;
+    Timestamp min_ = 0;
+};
+
+#endif // KLOGG_TIMESTAMPINDEX_H
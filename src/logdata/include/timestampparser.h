@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TIMESTAMPPARSER_H
+#define KLOGG_TIMESTAMPPARSER_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// Milliseconds since epoch. Time zones are ignored, all timestamps
+// compared together are expected to be logged in the same zone.
+using Timestamp = int64_t;
+using OptionalTimestamp = std::optional<Timestamp>;
+
+// Timestamp layouts parseTimestamp can recognize
+enum class TimestampLayout { Auto, Iso8601, Syslog };
+
+// Tries to parse a timestamp at the beginning of the line.
+// Supported layouts are
+//   ISO-8601: "YYYY-MM-DD[T ]hh:mm:ss[.fraction]"
+//   syslog:   "Mmm dd hh:mm:ss", year is not logged so 1970 is assumed
+// both optionally preceded by an opening bracket.
+// Auto picks the layout by looking at the first character.
+OptionalTimestamp parseTimestamp( std::string_view line,
+                                  TimestampLayout layout = TimestampLayout::Auto );
+
+// Parses time of day "hh:mm[:ss[.fraction]]", returns milliseconds since midnight.
+OptionalTimestamp parseTimeOfDay( std::string_view text );
+
+#endif // KLOGG_TIMESTAMPPARSER_H
@@ -68,6 +68,14 @@ std::vector<QString> AbstractLogData::getExpandedLines( LineNumber first_line, L
     return doGetExpandedLines( first_line, number );
 }
 
+// Simple wrapper in order to use a clean Template Method
+std::vector<AbstractLogData::LineWindow>
+AbstractLogData::getLineWindows( LineNumber first_line, LinesCount number, int first_column,
+                                 int nb_columns ) const
+{
+    return doGetLineWindows( first_line, number, first_column, nb_columns );
+}
+
 // Simple wrapper in order to use a clean Template Method
 LinesCount AbstractLogData::getNbLine() const
 {
@@ -86,6 +94,13 @@ LineLength AbstractLogData::getLineLength( LineNumber line ) const
     return doGetLineLength( line );
 }
 
+// Simple wrapper in order to use a clean Template Method
+std::vector<LineLength> AbstractLogData::getLineLengths( LineNumber first_line,
+                                                         LinesCount number ) const
+{
+    return doGetLineLengths( first_line, number );
+}
+
 void AbstractLogData::setDisplayEncoding( const char* encoding )
 {
     doSetDisplayEncoding( encoding );
@@ -106,4 +121,20 @@ void AbstractLogData::detachReader() const
     doDetachReader();
 }
 
+void AbstractLogData::prefetchLines( LineNumber first_line, LinesCount number ) const
+{
+    doPrefetchLines( first_line, number );
+}
+
+const AbstractLogData* AbstractLogData::getSourceData() const
+{
+    return doGetSourceData();
+}
+
+AbstractLogData::SourceRuns AbstractLogData::getSourceRuns( LineNumber first_line,
+                                                            LinesCount number ) const
+{
+    return doGetSourceRuns( first_line, number );
+}
+
 
@@ -19,6 +19,11 @@
 
 #include "blockpool.h"
 
+#include <cstring>
+#include <new>
+
+#include <QTemporaryFile>
+
 #include "log.h"
 
 namespace {
@@ -40,11 +45,9 @@ size_t getBlockStorageSize( size_t elementsCount, std::size_t elementSize, size_
     return getAlignedSize( elementSize + 2 * elementsCount * getElementSizeWithHeader( elementSize ), alignement );
 }
 
-template<typename PoolType>
-void increasePool(PoolType& pool)
+size_t getIncreasedPoolSize( size_t oldSize )
 {
-    const auto oldSize = pool.size();
-    pool.resize( oldSize + (oldSize >> 1 ) );
+    return oldSize + ( oldSize >> 1 );
 }
 
 }
@@ -63,10 +66,18 @@ BlockPoolBase::BlockPoolBase( BlockPoolBase&& other ) noexcept
     *this = std::move( other );
 }
 
+BlockPoolBase::~BlockPoolBase() = default;
+
 BlockPoolBase& BlockPoolBase::operator=( BlockPoolBase&& other ) noexcept
 {
     pool_ = std::move( other.pool_ );
 
+    spillFile_ = std::move( other.spillFile_ );
+    spilledPool_ = other.spilledPool_;
+    spilledPoolSize_ = other.spilledPoolSize_;
+    other.spilledPool_ = nullptr;
+    other.spilledPoolSize_ = 0;
+
     elementSize_ = other.elementSize_;
     alignment_ = other.alignment_;
 
@@ -79,12 +90,117 @@ BlockPoolBase& BlockPoolBase::operator=( BlockPoolBase&& other ) noexcept
 
 uint8_t* BlockPoolBase::at(size_t index)
 {
-    return pool_.data() + blockIndex_.at( index );
+    return poolData() + blockIndex_.at( index );
 }
 
 const uint8_t* BlockPoolBase::at(size_t index) const
 {
-    return pool_.data() + blockIndex_.at( index );
+    return poolData() + blockIndex_.at( index );
+}
+
+uint8_t* BlockPoolBase::poolData()
+{
+    return spilledPool_ ? spilledPool_ : pool_.data();
+}
+
+const uint8_t* BlockPoolBase::poolData() const
+{
+    return spilledPool_ ? spilledPool_ : pool_.data();
+}
+
+size_t BlockPoolBase::poolSize() const
+{
+    return spilledPool_ ? spilledPoolSize_ : pool_.size();
+}
+
+void BlockPoolBase::increasePool()
+{
+    const auto newSize = getIncreasedPoolSize( poolSize() );
+
+    if ( !spilledPool_ ) {
+        pool_.resize( newSize );
+        return;
+    }
+
+    // Some platforms can't resize a mapped file, remap it then
+    if ( !spillFile_->resize( static_cast<qint64>( newSize ) ) ) {
+        spillFile_->unmap( spilledPool_ );
+        spilledPool_ = nullptr;
+        if ( !spillFile_->resize( static_cast<qint64>( newSize ) ) ) {
+            LOG_ERROR << "Failed to grow spilled pool to " << newSize;
+            throw std::bad_alloc();
+        }
+    }
+
+    auto newPool = spillFile_->map( 0, static_cast<qint64>( newSize ) );
+    if ( !newPool ) {
+        LOG_ERROR << "Failed to map spilled pool of " << newSize;
+        throw std::bad_alloc();
+    }
+
+    if ( spilledPool_ ) {
+        spillFile_->unmap( spilledPool_ );
+    }
+    spilledPool_ = newPool;
+    spilledPoolSize_ = newSize;
+}
+
+bool BlockPoolBase::spillToDisk()
+{
+    if ( spilledPool_ ) {
+        return true;
+    }
+
+    auto spillFile = std::make_unique<QTemporaryFile>();
+    if ( !spillFile->open() ) {
+        LOG_WARNING << "Failed to create spill file";
+        return false;
+    }
+
+    const auto size = pool_.size();
+    if ( !spillFile->resize( static_cast<qint64>( size ) ) ) {
+        LOG_WARNING << "Failed to resize spill file to " << size;
+        return false;
+    }
+
+    auto spilledPool = spillFile->map( 0, static_cast<qint64>( size ) );
+    if ( !spilledPool ) {
+        LOG_WARNING << "Failed to map spill file of " << size;
+        return false;
+    }
+
+    std::memcpy( spilledPool, pool_.data(), allocationSize_ );
+
+    spillFile_ = std::move( spillFile );
+    spilledPool_ = spilledPool;
+    spilledPoolSize_ = size;
+    std::vector<uint8_t>{}.swap( pool_ );
+
+    LOG_INFO << "Spilled pool of " << allocationSize_ << " bytes to " << spillFile_->fileName();
+    return true;
+}
+
+void BlockPoolBase::restoreFromDisk()
+{
+    if ( !spilledPool_ ) {
+        return;
+    }
+
+    std::vector<uint8_t> pool( spilledPoolSize_ );
+    std::memcpy( pool.data(), spilledPool_, allocationSize_ );
+
+    spillFile_->unmap( spilledPool_ );
+    spillFile_.reset();
+    spilledPool_ = nullptr;
+    spilledPoolSize_ = 0;
+    pool_.swap( pool );
+
+    LOG_INFO << "Restored spilled pool of " << allocationSize_ << " bytes";
+}
+
+bool BlockPoolBase::isSpilled() const
+{
+    return spilledPool_ != nullptr;
 }
 
 size_t BlockPoolBase::getElementSize() const
@@ -109,18 +225,18 @@ uint8_t* BlockPoolBase::getBlock( size_t elementsCount )
     const auto alignedAllocationSize = getAlignedSize(allocationSize_, alignment_);
 
     LOG_DEBUG << "Get block " << elementSize_
-                   << " pool " << pool_.size()
+                   << " pool " << poolSize()
                    << " alloc " << allocationSize_
                    << " blocks " << blockIndex_.size();
 
-    if ( alignedAllocationSize + requiredSize >= pool_.size() ) {
-        increasePool( pool_ );
+    if ( alignedAllocationSize + requiredSize >= poolSize() ) {
+        increasePool();
     }
 
     blockIndex_.push_back( alignedAllocationSize );
     allocationSize_ = alignedAllocationSize + requiredSize;
 
-    return pool_.data() + blockIndex_.back();
+    return poolData() + blockIndex_.back();
 }
 
 uint8_t* BlockPoolBase::resizeLastBlock( size_t newSize )
@@ -141,15 +257,15 @@ uint8_t* BlockPoolBase::resizeLastBlock( size_t newSize )
         const auto delta = alignedNewSize - currentBlockSize;
         LOG_DEBUG << "Increasing last block size by " << delta;
 
-        if ( allocationSize_ + delta >= pool_.size() ) {
-            increasePool( pool_ );
+        if ( allocationSize_ + delta >= poolSize() ) {
+            increasePool();
         }
         allocationSize_ += delta;
     }
 
     LOG_DEBUG << "Resized block, alloc " << allocationSize_;
 
-    return pool_.data() + blockIndex_.back();
+    return poolData() + blockIndex_.back();
 }
 
 size_t BlockPoolBase::lastBlockSize() const
@@ -181,3 +297,8 @@ size_t BlockPoolBase::allocatedSize() const
 {
     return allocationSize_;
 }
+
+size_t BlockPoolBase::residentSize() const
+{
+    return spilledPool_ ? 0 : allocationSize_;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "booleansearchplan.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "booleanevaluator.h"
+#include "log.h"
+
+BooleanSearchPlan::BooleanSearchPlan( const RegularExpressionPattern& pattern,
+                                      const ResultsLookup& findResults )
+    : expression_( pattern )
+{
+    if ( !expression_.isValid() || !expression_.isBooleanCombination() ) {
+        return;
+    }
+
+    const auto& subPatterns = expression_.subPatterns();
+    if ( subPatterns.empty() || subPatterns.size() > MaxSubPatterns ) {
+        return;
+    }
+
+    results_.reserve( subPatterns.size() );
+    std::vector<RegularExpressionPattern> missingPatterns;
+    for ( auto index = 0u; index < subPatterns.size(); ++index ) {
+        results_.push_back( findResults( subPatterns[ index ] ) );
+        if ( !results_.back() ) {
+            missing_.push_back( index );
+            missingPatterns.push_back( subPatterns[ index ] );
+        }
+    }
+
+    LOG_INFO << "Boolean search has " << subPatterns.size() << " sub-patterns, "
+             << missing_.size() << " of them not cached";
+
+    if ( !missingPatterns.empty() ) {
+        missingExpression_.emplace( missingPatterns );
+        if ( !missingExpression_->isValid() ) {
+            return;
+        }
+    }
+
+    isValid_ = true;
+}
+
+bool BooleanSearchPlan::isValid() const
+{
+    return isValid_;
+}
+
+const std::vector<RegularExpressionPattern>& BooleanSearchPlan::subPatterns() const
+{
+    return expression_.subPatterns();
+}
+
+const std::vector<size_t>& BooleanSearchPlan::missingSubPatterns() const
+{
+    return missing_;
+}
+
+SubPatternResults BooleanSearchPlan::combine( LineNumber startLine, LineNumber endLine,
+                                              LineLength maxLineLength ) const
+{
+    struct Cell {
+        SearchResultArray lines;
+        MatchedPatterns flags;
+    };
+
+    SubPatternResults combined{ {}, 0_length };
+    if ( !isValid() || !isComplete() || startLine >= endLine ) {
+        return combined;
+    }
+
+    std::vector<Cell> cells;
+    cells.emplace_back();
+    cells.back().lines.addRange( startLine.get(), endLine.get() );
+
+    SearchResultArray anyMatch;
+    LineLength anyMatchMaxLength = 0_length;
+
+    for ( const auto& result : results_ ) {
+        anyMatch |= result->matchingLines;
+        anyMatchMaxLength = qMax( anyMatchMaxLength, result->maxLength );
+
+        std::vector<Cell> splitCells;
+        splitCells.reserve( cells.size() * 2 );
+        for ( auto& cell : cells ) {
+            auto matching = cell.lines & result->matchingLines;
+            cell.lines -= matching;
+
+            if ( !matching.isEmpty() ) {
+                splitCells.push_back( { std::move( matching ), cell.flags + '\1' } );
+            }
+            if ( !cell.lines.isEmpty() ) {
+                splitCells.push_back( { std::move( cell.lines ), cell.flags + '\0' } );
+            }
+        }
+        cells = std::move( splitCells );
+    }
+
+    BooleanExpressionEvaluator evaluator{ expression_.expression().toStdString(),
+                                          expression_.subPatterns() };
+    for ( const auto& cell : cells ) {
+        if ( evaluator.evaluate( cell.flags ) != expression_.isInverse() ) {
+            combined.matchingLines |= cell.lines;
+        }
+    }
+
+    LOG_INFO << "Combined " << results_.size() << " sub-patterns in " << cells.size()
+             << " cells";
+
+    combined.maxLength = ( combined.matchingLines - anyMatch ).isEmpty()
+                             ? anyMatchMaxLength
+                             : qMax( anyMatchMaxLength, maxLineLength );
+    return combined;
+}
+
+std::unique_ptr<BooleanSearchPlan::LineMatcher> BooleanSearchPlan::createLineMatcher() const
+{
+    return std::make_unique<LineMatcher>( *this );
+}
+
+BooleanSearchPlan::LineMatcher::LineMatcher( const BooleanSearchPlan& plan )
+    : plan_( plan )
+    , evaluator_( std::make_unique<BooleanExpressionEvaluator>(
+          plan.expression_.expression().toStdString(), plan.expression_.subPatterns() ) )
+    , variables_( plan.results_.size(), 0 )
+{
+    if ( plan.missingExpression_ ) {
+        matcher_ = plan.missingExpression_->createMatcher();
+    }
+}
+
+BooleanSearchPlan::LineMatcher::~LineMatcher() = default;
+
+bool BooleanSearchPlan::LineMatcher::hasMatch( std::string_view line, LineNumber lineNumber,
+                                               MatchedPatterns& missingMatches )
+{
+    if ( matcher_ ) {
+        missingMatches = matcher_->matchedPatterns( line );
+    }
+    else {
+        missingMatches.clear();
+    }
+
+    auto missingIndex = 0u;
+    for ( auto index = 0u; index < variables_.size(); ++index ) {
+        const auto& result = plan_.results_[ index ];
+        if ( result ) {
+            variables_[ index ] = result->matchingLines.contains( lineNumber.get() );
+        }
+        else {
+            variables_[ index ] = missingIndex < missingMatches.size()
+                                  && missingMatches[ missingIndex ];
+            ++missingIndex;
+        }
+    }
+
+    return evaluator_->evaluate( variables_ ) != plan_.expression_.isInverse();
+}
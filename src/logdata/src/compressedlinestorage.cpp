@@ -176,6 +176,7 @@ void CompressedLinePositionStorage::move_from( CompressedLinePositionStorage&& o
     long_block_index_ = orig.long_block_index_;
     block_offset_ = orig.block_offset_;
     previous_block_offset_ = orig.previous_block_offset_;
+    eliasFano_ = std::move( orig.eliasFano_ );
 
     orig.nb_lines_ = 0_lcount;
 }
@@ -201,6 +202,11 @@ CompressedLinePositionStorage::operator=( CompressedLinePositionStorage&& orig )
 
 void CompressedLinePositionStorage::append( LineOffset pos )
 {
+    if ( eliasFano_ ) {
+        eliasFano_->append( pos );
+        return;
+    }
+
     // Lines must be stored in order
     assert( ( pos > current_pos_ ) || ( pos == 0_offset ) );
 
@@ -288,6 +294,11 @@ void CompressedLinePositionStorage::append( LineOffset pos )
 
 LineOffset CompressedLinePositionStorage::at( LineNumber index, Cache* lastPosition ) const
 {
+    if ( eliasFano_ ) {
+        // Constant time access, nothing to cache
+        return eliasFano_->at( index );
+    }
+
     if (index >= nb_lines_) {
         LOG_ERROR << "Line number not in storage: " << index.get() << ", storage size is " << nb_lines_;
         throw std::runtime_error("Line number not in storage");
@@ -351,6 +362,11 @@ LineOffset CompressedLinePositionStorage::at( LineNumber index, Cache* lastPosit
 
 void CompressedLinePositionStorage::append_list( const std::vector<LineOffset>& positions )
 {
+    if ( eliasFano_ ) {
+        eliasFano_->append_list( positions );
+        return;
+    }
+
     // This is not very clever, but caching should make it
     // reasonably fast.
     for ( auto position : positions )
@@ -359,6 +375,11 @@ void CompressedLinePositionStorage::append_list( const std::vector<LineOffset>&
 
 void CompressedLinePositionStorage::pop_back()
 {
+    if ( eliasFano_ ) {
+        eliasFano_->pop_back();
+        return;
+    }
+
     // Removing the last entered data, there are two cases
     if ( previous_block_offset_.get() ) {
         // The last append was a normal entry in an existing block,
@@ -388,5 +409,41 @@ void CompressedLinePositionStorage::pop_back()
 
 size_t CompressedLinePositionStorage::allocatedSize() const
 {
+    if ( eliasFano_ ) {
+        return eliasFano_->allocatedSize();
+    }
+
     return pool32_.allocatedSize() + pool64_.allocatedSize();
+}
+
+size_t CompressedLinePositionStorage::residentSize() const
+{
+    if ( eliasFano_ ) {
+        return eliasFano_->residentSize();
+    }
+
+    return pool32_.residentSize() + pool64_.residentSize();
+}
+
+bool CompressedLinePositionStorage::spillToDisk()
+{
+    if ( eliasFano_ ) {
+        return eliasFano_->spillToDisk();
+    }
+
+    // Both pools are spilled or none, so that the index is never left
+    // half in memory after a failure
+    const auto wasSpilled32 = pool32_.isSpilled();
+    if ( !pool32_.spillToDisk() ) {
+        return false;
+    }
+
+    if ( !pool64_.spillToDisk() ) {
+        if ( !wasSpilled32 ) {
+            pool32_.restoreFromDisk();
+        }
+        return false;
+    }
+
+    return true;
 }
\ No newline at end of file
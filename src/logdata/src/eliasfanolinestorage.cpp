@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "eliasfanolinestorage.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "log.h"
+
+namespace {
+
+static constexpr size_t EliasFanoChunkSize = 256;
+
+// Header words of a coded chunk: first position and number of low bits
+static constexpr size_t ChunkHeaderWords = 2;
+
+static constexpr size_t BitsPerWord = 64;
+
+inline uint32_t popCount( uint64_t word )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return static_cast<uint32_t>( __builtin_popcountll( word ) );
+#else
+    word = word - ( ( word >> 1 ) & 0x5555555555555555ULL );
+    word = ( word & 0x3333333333333333ULL ) + ( ( word >> 2 ) & 0x3333333333333333ULL );
+    word = ( word + ( word >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<uint32_t>( ( word * 0x0101010101010101ULL ) >> 56 );
+#endif
+}
+
+inline uint32_t countTrailingZeros( uint64_t word )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return static_cast<uint32_t>( __builtin_ctzll( word ) );
+#else
+    return popCount( ( word & ( ~word + 1 ) ) - 1 );
+#endif
+}
+
+inline uint64_t floorLog2( uint64_t value )
+{
+    uint64_t log = 0;
+    while ( value >>= 1 ) {
+        ++log;
+    }
+    return log;
+}
+
+inline size_t wordsForBits( size_t bits )
+{
+    return ( bits + BitsPerWord - 1 ) / BitsPerWord;
+}
+
+inline uint64_t readLowBits( const uint64_t* lowBits, size_t index, uint64_t lowBitsCount )
+{
+    if ( lowBitsCount == 0 ) {
+        return 0;
+    }
+
+    const auto bitPosition = index * lowBitsCount;
+    const auto word = bitPosition / BitsPerWord;
+    const auto shift = bitPosition % BitsPerWord;
+
+    auto value = lowBits[ word ] >> shift;
+    if ( shift + lowBitsCount > BitsPerWord ) {
+        value |= lowBits[ word + 1 ] << ( BitsPerWord - shift );
+    }
+
+    return value & ( ( uint64_t{ 1 } << lowBitsCount ) - 1 );
+}
+
+inline void writeLowBits( uint64_t* lowBits, size_t index, uint64_t lowBitsCount,
+                          uint64_t value )
+{
+    if ( lowBitsCount == 0 ) {
+        return;
+    }
+
+    value &= ( uint64_t{ 1 } << lowBitsCount ) - 1;
+
+    const auto bitPosition = index * lowBitsCount;
+    const auto word = bitPosition / BitsPerWord;
+    const auto shift = bitPosition % BitsPerWord;
+
+    lowBits[ word ] |= value << shift;
+    if ( shift + lowBitsCount > BitsPerWord ) {
+        lowBits[ word + 1 ] |= value >> ( BitsPerWord - shift );
+    }
+}
+
+// Position of the set bit number index in the unary part of a chunk.
+// The unary part of a chunk is at most 3 * EliasFanoChunkSize bits long.
+inline uint64_t selectHighBit( const uint64_t* highBits, size_t index )
+{
+    size_t word = 0;
+    auto remaining = static_cast<uint32_t>( index );
+    for ( auto bits = popCount( highBits[ word ] ); bits <= remaining;
+          bits = popCount( highBits[ word ] ) ) {
+        remaining -= bits;
+        ++word;
+    }
+
+    auto bits = highBits[ word ];
+    for ( ; remaining > 0; --remaining ) {
+        bits &= bits - 1;
+    }
+
+    return word * BitsPerWord + countTrailingZeros( bits );
+}
+
+} // namespace
+
+EliasFanoLinePositionStorage::EliasFanoLinePositionStorage()
+{
+    tail_.reserve( EliasFanoChunkSize );
+}
+
+void EliasFanoLinePositionStorage::append( LineOffset pos )
+{
+    // Lines must be stored in order
+    assert( tail_.empty() || static_cast<uint64_t>( pos.get() ) >= tail_.back() );
+
+    tail_.push_back( static_cast<uint64_t>( pos.get() ) );
+    if ( tail_.size() == EliasFanoChunkSize ) {
+        encodeTail();
+    }
+}
+
+LinesCount EliasFanoLinePositionStorage::size() const
+{
+    return LinesCount(
+        static_cast<LinesCount::UnderlyingType>( chunksCount_ * EliasFanoChunkSize + tail_.size() ) );
+}
+
+LineOffset EliasFanoLinePositionStorage::at( LineNumber index ) const
+{
+    if ( index >= size() ) {
+        LOG_ERROR << "Line number not in storage: " << index.get() << ", storage size is "
+                  << size();
+        throw std::runtime_error( "Line number not in storage" );
+    }
+
+    const auto chunk = index.get() / EliasFanoChunkSize;
+    const auto indexInChunk = index.get() % EliasFanoChunkSize;
+
+    if ( chunk >= chunksCount_ ) {
+        return LineOffset( static_cast<LineOffset::UnderlyingType>( tail_[ indexInChunk ] ) );
+    }
+
+    const auto* block = reinterpret_cast<const uint64_t*>( pool_.at( chunk ) );
+    const auto base = block[ 0 ];
+    const auto lowBitsCount = block[ 1 ];
+
+    const auto* lowBits = block + ChunkHeaderWords;
+    const auto* highBits = lowBits + wordsForBits( EliasFanoChunkSize * lowBitsCount );
+
+    const auto high = selectHighBit( highBits, indexInChunk ) - indexInChunk;
+    const auto low = readLowBits( lowBits, indexInChunk, lowBitsCount );
+
+    return LineOffset(
+        static_cast<LineOffset::UnderlyingType>( base + ( ( high << lowBitsCount ) | low ) ) );
+}
+
+void EliasFanoLinePositionStorage::append_list( const std::vector<LineOffset>& positions )
+{
+    for ( auto position : positions )
+        append( position );
+}
+
+void EliasFanoLinePositionStorage::pop_back()
+{
+    if ( tail_.empty() ) {
+        // The last chunk is complete, bring it back to be able to change it
+        decodeLastChunk();
+    }
+
+    tail_.pop_back();
+}
+
+void EliasFanoLinePositionStorage::encodeTail()
+{
+    const auto base = tail_.front();
+    const auto universe = tail_.back() - base;
+
+    const auto averageDelta = universe / EliasFanoChunkSize;
+    const auto lowBitsCount = averageDelta > 0 ? floorLog2( averageDelta ) : 0;
+
+    const auto lowWords = wordsForBits( EliasFanoChunkSize * lowBitsCount );
+    const auto highWords = wordsForBits( EliasFanoChunkSize + ( universe >> lowBitsCount ) + 1 );
+    const auto blockWords = ChunkHeaderWords + lowWords + highWords;
+
+    pool_.get_block( 1, base, nullptr );
+    auto* block
+        = reinterpret_cast<uint64_t*>( pool_.resize_last_block( blockWords * sizeof( uint64_t ) ) );
+
+    std::memset( block, 0, blockWords * sizeof( uint64_t ) );
+    block[ 0 ] = base;
+    block[ 1 ] = lowBitsCount;
+
+    auto* lowBits = block + ChunkHeaderWords;
+    auto* highBits = lowBits + lowWords;
+
+    for ( size_t i = 0; i < tail_.size(); ++i ) {
+        const auto delta = tail_[ i ] - base;
+        writeLowBits( lowBits, i, lowBitsCount, delta );
+
+        const auto highBit = ( delta >> lowBitsCount ) + i;
+        highBits[ highBit / BitsPerWord ] |= uint64_t{ 1 } << ( highBit % BitsPerWord );
+    }
+
+    ++chunksCount_;
+    tail_.clear();
+}
+
+void EliasFanoLinePositionStorage::decodeLastChunk()
+{
+    assert( chunksCount_ > 0 );
+
+    const auto* block = reinterpret_cast<const uint64_t*>( pool_.at( chunksCount_ - 1 ) );
+    const auto base = block[ 0 ];
+    const auto lowBitsCount = block[ 1 ];
+
+    const auto* lowBits = block + ChunkHeaderWords;
+    const auto* highBits = lowBits + wordsForBits( EliasFanoChunkSize * lowBitsCount );
+
+    size_t word = 0;
+    while ( tail_.size() < EliasFanoChunkSize ) {
+        auto bits = highBits[ word ];
+        while ( bits != 0 && tail_.size() < EliasFanoChunkSize ) {
+            const auto index = tail_.size();
+            const auto high = word * BitsPerWord + countTrailingZeros( bits ) - index;
+            tail_.push_back( base
+                             + ( ( high << lowBitsCount )
+                                 | readLowBits( lowBits, index, lowBitsCount ) ) );
+            bits &= bits - 1;
+        }
+        ++word;
+    }
+
+    pool_.free_last_block();
+    --chunksCount_;
+}
+
+size_t EliasFanoLinePositionStorage::allocatedSize() const
+{
+    return pool_.allocatedSize() + tail_.capacity() * sizeof( uint64_t );
+}
+
+size_t EliasFanoLinePositionStorage::residentSize() const
+{
+    return pool_.residentSize() + tail_.capacity() * sizeof( uint64_t );
+}
+
+bool EliasFanoLinePositionStorage::spillToDisk()
+{
+    return pool_.spillToDisk();
+}
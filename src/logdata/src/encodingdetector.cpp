@@ -19,6 +19,9 @@
 
 #include "encodingdetector.h"
 
+#include <algorithm>
+#include <iterator>
+
 #include <QTextCodec>
 
 #include "log.h"
@@ -71,8 +74,14 @@ EncodingParameters::EncodingParameters( const QTextCodec* codec )
     static constexpr int Utf16LEMib = 1014;
     static constexpr int UsAsciiMib = 3;
 
+    // ISO-2022-KR, ISO-2022-JP, ISO-2022-CN, ISO-2022-CN-EXT, UTF-7, HZ-GB-2312
+    static constexpr int ShiftStatesMibs[] = { 37, 39, 104, 105, 1012, 2085 };
+
     isUtf8Compatible = codec->mibEnum() == Utf8Mib || codec->mibEnum() == UsAsciiMib;
     isUtf16LE = codec->mibEnum() == Utf16LEMib;
+    hasShiftStates = std::find( std::begin( ShiftStatesMibs ), std::end( ShiftStatesMibs ),
+                                codec->mibEnum() )
+                     != std::end( ShiftStatesMibs );
 
     QTextCodec::ConverterState convertState( QTextCodec::IgnoreHeader );
     QByteArray encodedLineFeed = codec->fromUnicode( &LineFeed, 1, &convertState );
@@ -84,8 +93,6 @@ EncodingParameters::EncodingParameters( const QTextCodec* codec )
 
 QTextCodec* EncodingDetector::detectEncoding( const QByteArray& block ) const
 {
-    UniqueLock lock( mutex_ );
-
     UchardetHolder ud;
 
     auto rc = ud.handle_data( block.data(), static_cast<size_t>( block.size() ) );
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "encodingvalidator.h"
+
+#include <algorithm>
+
+#include <simdutf.h>
+
+EncodingValidator::EncodingValidator( const EncodingParameters& encodingParams )
+    : encoding_( encodingParams.isUtf8Compatible ? Encoding::Utf8
+                 : encodingParams.isUtf16LE      ? Encoding::Utf16LE
+                                                 : Encoding::None )
+{
+}
+
+size_t EncodingValidator::incompleteTailSize( const char* data, size_t size ) const
+{
+    if ( encoding_ == Encoding::Utf8 ) {
+        for ( auto tail = 1u; tail <= std::min<size_t>( 3, size ); ++tail ) {
+            const auto byte = static_cast<unsigned char>( data[ size - tail ] );
+            if ( ( byte & 0xC0 ) == 0x80 ) {
+                continue;
+            }
+
+            const auto length = ( byte & 0xE0 ) == 0xC0   ? 2u
+                                : ( byte & 0xF0 ) == 0xE0 ? 3u
+                                : ( byte & 0xF8 ) == 0xF0 ? 4u
+                                                          : 1u;
+            return length > tail ? tail : 0u;
+        }
+        return 0u;
+    }
+
+    if ( encoding_ == Encoding::Utf16LE ) {
+        const auto oddByte = size % 2;
+        if ( size - oddByte >= 2 ) {
+            const auto unit = static_cast<unsigned char>( data[ size - oddByte - 2 ] )
+                              | static_cast<unsigned char>( data[ size - oddByte - 1 ] ) << 8;
+            // High surrogate waiting for the low one
+            if ( unit >= 0xD800 && unit <= 0xDBFF ) {
+                return oddByte + 2;
+            }
+        }
+        return oddByte;
+    }
+
+    return 0u;
+}
+
+bool EncodingValidator::isValid( const char* data, size_t size ) const
+{
+    switch ( encoding_ ) {
+    case Encoding::Utf8:
+        return simdutf::validate_utf8( data, size );
+    case Encoding::Utf16LE:
+        return size % 2 == 0
+               && simdutf::validate_utf16( reinterpret_cast<const char16_t*>( data ), size / 2 );
+    case Encoding::None:
+        break;
+    }
+    return true;
+}
+
+EncodingValidator::BlockResult
+EncodingValidator::validateBlock( LineOffset::UnderlyingType blockBeginning,
+                                  const QByteArray& block,
+                                  LineOffset::UnderlyingType firstLineStart,
+                                  const FastLinePositionArray& lineEnds )
+{
+    BlockResult result;
+    if ( !isEnabled() || block.isEmpty() ) {
+        return result;
+    }
+
+    const auto* data = block.data();
+    const auto size = static_cast<size_t>( block.size() );
+
+    // Complete the character started at the end of the previous block
+    size_t begin = 0;
+    auto isJunctionValid = true;
+    if ( !carry_.empty() ) {
+        auto junction = carry_;
+        junction.append( data, std::min<size_t>( size, 4 ) );
+        const auto junctionEnd
+            = junction.size() - incompleteTailSize( junction.data(), junction.size() );
+        if ( junctionEnd <= carry_.size() ) {
+            carry_ = std::move( junction );
+            return result;
+        }
+
+        isJunctionValid = isValid( junction.data(), junctionEnd );
+        begin = junctionEnd - carry_.size();
+    }
+
+    const auto end = size - incompleteTailSize( data + begin, size - begin );
+    carry_.assign( data + end, size - end );
+
+    result.isValid = isJunctionValid && isValid( data + begin, end - begin );
+    if ( result.isValid ) {
+        return result;
+    }
+
+    // Only failed blocks are checked line by line
+    if ( !isJunctionValid ) {
+        result.invalidLines.push_back( 0 );
+    }
+
+    const auto validBegin = blockBeginning + static_cast<LineOffset::UnderlyingType>( begin );
+    const auto validEnd = blockBeginning + static_cast<LineOffset::UnderlyingType>( end );
+    const auto nbLines = lineEnds.size().get();
+
+    auto lineStart = firstLineStart;
+    for ( auto line = LinesCount::UnderlyingType{}; line <= nbLines; ++line ) {
+        const auto lineEnd = line < nbLines ? lineEnds.at( line ).get() : validEnd;
+        const auto checkBegin = std::max( lineStart, validBegin );
+        const auto checkEnd = std::min( lineEnd, validEnd );
+
+        if ( checkEnd > checkBegin
+             && !isValid( data + ( checkBegin - blockBeginning ),
+                          static_cast<size_t>( checkEnd - checkBegin ) ) ) {
+            if ( result.invalidLines.empty() || result.invalidLines.back() != line ) {
+                result.invalidLines.push_back( line );
+            }
+        }
+
+        lineStart = lineEnd;
+    }
+
+    return result;
+}
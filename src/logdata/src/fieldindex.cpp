@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "fieldindex.h"
+
+FieldIndex::Batch::Batch( size_t nbFields )
+    : lines_( nbFields )
+{
+}
+
+void FieldIndex::Batch::add( size_t field, std::string_view value )
+{
+    lines_[ field ][ normalize( value ) ].push_back( nbLines_ );
+}
+
+void FieldIndex::Batch::endLine()
+{
+    ++nbLines_;
+}
+
+void FieldIndex::setFields( std::vector<std::string> fields )
+{
+    fieldNames_ = std::move( fields );
+    clear();
+}
+
+std::optional<size_t> FieldIndex::findField( std::string_view name ) const
+{
+    const auto field = std::find( fieldNames_.begin(), fieldNames_.end(), name );
+    if ( field == fieldNames_.end() ) {
+        return {};
+    }
+
+    return static_cast<size_t>( field - fieldNames_.begin() );
+}
+
+void FieldIndex::append( const Batch& batch )
+{
+    for ( auto fieldIndex = 0u; fieldIndex < fields_.size() && fieldIndex < batch.lines_.size();
+          ++fieldIndex ) {
+        auto& field = fields_[ fieldIndex ];
+        for ( const auto& [ value, lines ] : batch.lines_[ fieldIndex ] ) {
+            auto& valueLines = linesOf( field, value );
+            for ( const auto line : lines ) {
+                valueLines.add( nbLines_ + line );
+            }
+            hasValues_ = true;
+        }
+    }
+
+    nbLines_ += batch.nbLines_;
+}
+
+void FieldIndex::truncate( LinesCount newSize )
+{
+    if ( newSize.get() >= nbLines_ ) {
+        return;
+    }
+
+    roaring::Roaring64Map droppedLines;
+    droppedLines.addRange( newSize.get(), nbLines_ );
+
+    for ( auto& field : fields_ ) {
+        for ( auto& lines : field.lines ) {
+            lines -= droppedLines;
+        }
+    }
+
+    nbLines_ = newSize.get();
+}
+
+void FieldIndex::clear()
+{
+    fields_.clear();
+    fields_.resize( fieldNames_.size() );
+    nbLines_ = 0;
+    hasValues_ = false;
+}
+
+FieldIndex::Lookup FieldIndex::find( size_t fieldIndex, std::string_view value ) const
+{
+    if ( fieldIndex >= fields_.size() ) {
+        return {};
+    }
+
+    const auto& field = fields_[ fieldIndex ];
+    const auto normalizedValue = normalize( value );
+
+    if ( field.isHashed ) {
+        return { field.lines[ bucketOf( normalizedValue ) ], false };
+    }
+
+    const auto valueId = field.valueIds.find( normalizedValue );
+    if ( valueId == field.valueIds.end() ) {
+        return {};
+    }
+
+    return { field.lines[ valueId->second ], true };
+}
+
+size_t FieldIndex::allocatedSize() const
+{
+    size_t size = 0;
+    for ( const auto& field : fields_ ) {
+        for ( const auto& lines : field.lines ) {
+            size += lines.getSizeInBytes( false );
+        }
+        for ( const auto& value : field.valueIds ) {
+            size += sizeof( value ) + value.first.capacity();
+        }
+    }
+    return size;
+}
+
+std::string FieldIndex::normalize( std::string_view value )
+{
+    std::string normalizedValue{ value };
+    std::transform( normalizedValue.begin(), normalizedValue.end(), normalizedValue.begin(),
+                    []( char c ) {
+                        return ( c >= 'A' && c <= 'Z' ) ? static_cast<char>( c - 'A' + 'a' ) : c;
+                    } );
+    return normalizedValue;
+}
+
+roaring::Roaring64Map& FieldIndex::linesOf( Field& field, const std::string& value )
+{
+    if ( field.isHashed ) {
+        return field.lines[ bucketOf( value ) ];
+    }
+
+    const auto valueId = field.valueIds.find( value );
+    if ( valueId != field.valueIds.end() ) {
+        return field.lines[ valueId->second ];
+    }
+
+    if ( field.valueIds.size() < MaxDictionarySize ) {
+        field.valueIds.emplace( value, field.lines.size() );
+        return field.lines.emplace_back();
+    }
+
+    // Too many distinct values, lines are now grouped by hash of the value
+    std::vector<roaring::Roaring64Map> buckets( HashBuckets );
+    for ( const auto& [ knownValue, id ] : field.valueIds ) {
+        buckets[ bucketOf( knownValue ) ] |= field.lines[ id ];
+    }
+
+    field.valueIds.clear();
+    field.lines = std::move( buckets );
+    field.isHashed = true;
+
+    return field.lines[ bucketOf( value ) ];
+}
+
+size_t FieldIndex::bucketOf( std::string_view value )
+{
+    return std::hash<std::string_view>{}( value ) % HashBuckets;
+}
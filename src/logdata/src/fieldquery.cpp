@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+#include "fieldquery.h"
+
+class FieldQuery::Parser {
+  public:
+    Parser( std::string_view text, const std::vector<std::string>& fields, FieldQuery& query )
+        : text_( text )
+        , fields_( fields )
+        , query_( query )
+    {
+    }
+
+    void parse()
+    {
+        skipSpaces();
+        if ( atEnd() ) {
+            fail( "Empty query" );
+            return;
+        }
+
+        query_.root_ = parseOr();
+
+        skipSpaces();
+        if ( !atEnd() ) {
+            fail( "Unexpected text at position " + std::to_string( position_ + 1 ) );
+        }
+    }
+
+  private:
+    size_t parseOr()
+    {
+        auto left = parseAnd();
+        while ( !hasFailed() ) {
+            skipSpaces();
+            if ( !consumeKeyword( "OR" ) && !consume( "||" ) ) {
+                break;
+            }
+
+            const auto right = parseAnd();
+            left = addNode( { Node::Type::Or, 0, {}, left, right } );
+        }
+        return left;
+    }
+
+    size_t parseAnd()
+    {
+        auto left = parseUnary();
+        while ( !hasFailed() ) {
+            skipSpaces();
+            if ( atEnd() || peek() == ')' || isKeywordAhead( "OR" ) || isAhead( "||" ) ) {
+                break;
+            }
+
+            // Terms next to each other are implicitly combined with AND
+            if ( !consumeKeyword( "AND" ) ) {
+                consume( "&&" );
+            }
+
+            const auto right = parseUnary();
+            left = addNode( { Node::Type::And, 0, {}, left, right } );
+        }
+        return left;
+    }
+
+    size_t parseUnary()
+    {
+        skipSpaces();
+        if ( consumeKeyword( "NOT" ) || consume( "!" ) ) {
+            const auto operand = parseUnary();
+            return addNode( { Node::Type::Not, 0, {}, operand, 0 } );
+        }
+
+        if ( consume( "(" ) ) {
+            const auto expression = parseOr();
+            skipSpaces();
+            if ( !hasFailed() && !consume( ")" ) ) {
+                fail( "Missing closing parenthesis" );
+            }
+            return expression;
+        }
+
+        return parseTerm();
+    }
+
+    size_t parseTerm()
+    {
+        const auto nameStart = position_;
+        while ( !atEnd() && isNameChar( peek() ) ) {
+            ++position_;
+        }
+
+        const auto name = text_.substr( nameStart, position_ - nameStart );
+        if ( name.empty() ) {
+            fail( "Expected a field name at position " + std::to_string( position_ + 1 ) );
+            return 0;
+        }
+
+        skipSpaces();
+        const auto isNegated = consume( "!=" );
+        if ( !isNegated && !consume( "=" ) ) {
+            fail( "Expected = or != after " + std::string{ name } );
+            return 0;
+        }
+
+        skipSpaces();
+        const auto value = parseValue();
+        if ( !value ) {
+            return 0;
+        }
+
+        const auto field = std::find( fields_.begin(), fields_.end(), name );
+        if ( field == fields_.end() ) {
+            fail( "Field " + std::string{ name } + " is not indexed" );
+            return 0;
+        }
+
+        const auto term
+            = addNode( { Node::Type::Term, static_cast<size_t>( field - fields_.begin() ),
+                         FieldIndex::normalize( *value ), 0, 0 } );
+
+        return isNegated ? addNode( { Node::Type::Not, 0, {}, term, 0 } ) : term;
+    }
+
+    std::optional<std::string> parseValue()
+    {
+        std::string value;
+
+        if ( consume( "\"" ) ) {
+            while ( !atEnd() && peek() != '"' ) {
+                if ( peek() == '\\' && position_ + 1 < text_.size() ) {
+                    ++position_;
+                }
+                value.push_back( text_[ position_++ ] );
+            }
+
+            if ( !consume( "\"" ) ) {
+                fail( "Missing closing quote" );
+                return {};
+            }
+            return value;
+        }
+
+        while ( !atEnd() && !std::isspace( static_cast<unsigned char>( peek() ) )
+                && peek() != ')' ) {
+            value.push_back( text_[ position_++ ] );
+        }
+
+        if ( value.empty() ) {
+            fail( "Expected a value at position " + std::to_string( position_ + 1 ) );
+            return {};
+        }
+        return value;
+    }
+
+    static bool isNameChar( char c )
+    {
+        return std::isalnum( static_cast<unsigned char>( c ) ) || c == '_' || c == '.' || c == '-'
+               || c == '@';
+    }
+
+    bool isAhead( std::string_view symbol ) const
+    {
+        return text_.substr( position_, symbol.size() ) == symbol;
+    }
+
+    bool isKeywordAhead( std::string_view keyword ) const
+    {
+        if ( text_.size() - position_ < keyword.size() ) {
+            return false;
+        }
+
+        for ( auto i = 0u; i < keyword.size(); ++i ) {
+            if ( std::toupper( static_cast<unsigned char>( text_[ position_ + i ] ) )
+                 != keyword[ i ] ) {
+                return false;
+            }
+        }
+
+        // Fields may start with a keyword (notes=...)
+        const auto next = position_ + keyword.size();
+        return next == text_.size() || !isNameChar( text_[ next ] );
+    }
+
+    bool consume( std::string_view symbol )
+    {
+        if ( !isAhead( symbol ) ) {
+            return false;
+        }
+        position_ += symbol.size();
+        return true;
+    }
+
+    bool consumeKeyword( std::string_view keyword )
+    {
+        if ( !isKeywordAhead( keyword ) ) {
+            return false;
+        }
+        position_ += keyword.size();
+        return true;
+    }
+
+    void skipSpaces()
+    {
+        while ( !atEnd() && std::isspace( static_cast<unsigned char>( peek() ) ) ) {
+            ++position_;
+        }
+    }
+
+    bool atEnd() const
+    {
+        return position_ >= text_.size();
+    }
+
+    char peek() const
+    {
+        return text_[ position_ ];
+    }
+
+    size_t addNode( Node node )
+    {
+        query_.nodes_.push_back( std::move( node ) );
+        return query_.nodes_.size() - 1;
+    }
+
+    bool hasFailed() const
+    {
+        return !query_.error_.empty();
+    }
+
+    void fail( std::string error )
+    {
+        if ( !hasFailed() ) {
+            query_.error_ = std::move( error );
+        }
+        // Stops the parsing
+        position_ = text_.size();
+    }
+
+  private:
+    std::string_view text_;
+    const std::vector<std::string>& fields_;
+    FieldQuery& query_;
+    size_t position_ = 0;
+};
+
+FieldQuery FieldQuery::parse( std::string_view text, const std::vector<std::string>& fields )
+{
+    FieldQuery query;
+    Parser{ text, fields, query }.parse();
+    return query;
+}
+
+FieldQuery::Matches FieldQuery::evaluate( const FieldIndex& index, LineNumber startLine,
+                                          LineNumber endLine ) const
+{
+    if ( !isValid() || startLine >= endLine ) {
+        return {};
+    }
+
+    roaring::Roaring64Map allLines;
+    allLines.addRange( startLine.get(), endLine.get() );
+
+    auto [ lines, possibleLines ] = evaluate( root_, index, allLines );
+    lines &= allLines;
+    possibleLines &= allLines;
+
+    return { lines, possibleLines - lines };
+}
+
+std::pair<roaring::Roaring64Map, roaring::Roaring64Map>
+FieldQuery::evaluate( size_t nodeIndex, const FieldIndex& index,
+                      const roaring::Roaring64Map& allLines ) const
+{
+    const auto& node = nodes_[ nodeIndex ];
+    switch ( node.type ) {
+    case Node::Type::Term: {
+        auto lookup = index.find( node.field, node.value );
+        if ( lookup.isExact ) {
+            return { lookup.lines, lookup.lines };
+        }
+        return { {}, std::move( lookup.lines ) };
+    }
+    case Node::Type::Not: {
+        const auto [ lines, possibleLines ] = evaluate( node.left, index, allLines );
+        return { allLines - possibleLines, allLines - lines };
+    }
+    case Node::Type::And: {
+        auto [ lines, possibleLines ] = evaluate( node.left, index, allLines );
+        const auto [ rightLines, rightPossibleLines ] = evaluate( node.right, index, allLines );
+        lines &= rightLines;
+        possibleLines &= rightPossibleLines;
+        return { lines, possibleLines };
+    }
+    case Node::Type::Or: {
+        auto [ lines, possibleLines ] = evaluate( node.left, index, allLines );
+        const auto [ rightLines, rightPossibleLines ] = evaluate( node.right, index, allLines );
+        lines |= rightLines;
+        possibleLines |= rightPossibleLines;
+        return { lines, possibleLines };
+    }
+    }
+
+    return {};
+}
+
+bool FieldQuery::matches( const std::vector<std::optional<std::string>>& values ) const
+{
+    return isValid() && matches( root_, values );
+}
+
+bool FieldQuery::matches( size_t nodeIndex,
+                          const std::vector<std::optional<std::string>>& values ) const
+{
+    const auto& node = nodes_[ nodeIndex ];
+    switch ( node.type ) {
+    case Node::Type::Term:
+        return node.field < values.size() && values[ node.field ]
+               && *values[ node.field ] == node.value;
+    case Node::Type::Not:
+        return !matches( node.left, values );
+    case Node::Type::And:
+        return matches( node.left, values ) && matches( node.right, values );
+    case Node::Type::Or:
+        return matches( node.left, values ) || matches( node.right, values );
+    }
+
+    return false;
+}
@@ -2,18 +2,36 @@
 
 #include <filewatcher.h>
 
+#include <algorithm>
+
 #ifdef Q_OS_WIN
 #include <fcntl.h>
 #include <windows.h>
 #include <io.h>
 #else
+#include <cerrno>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include "log.h"
 #include <QtCore/QFileInfo>
 
 namespace {
+#ifdef Q_OS_WIN
+FileId getFileIdByHandle( HANDLE fileHandle )
+{
+    BY_HANDLE_FILE_INFORMATION info;
+    if ( !::GetFileInformationByHandle( fileHandle, &info ) ) {
+        LOG_DEBUG << "Failed to get file info by handle, gle " << ::GetLastError();
+        return FileId{};
+    }
+
+    ULARGE_INTEGER fileIndex = { info.nFileIndexLow, info.nFileIndexHigh };
+    return FileId{ fileIndex.QuadPart, static_cast<uint64_t>( info.dwVolumeSerialNumber ) };
+}
+#endif
+
 void openFileByHandle( QFile* file )
 {
     bool openedByHandle = false;
@@ -187,15 +205,7 @@ FileId FileId::getFileId( const QString& filename )
     using FileHandleGuard = std::unique_ptr<void, decltype( &CloseHandle )>;
     auto fileHandleGuard = FileHandleGuard{ fileHandle, CloseHandle };
 
-    BY_HANDLE_FILE_INFORMATION info;
-    if ( !::GetFileInformationByHandle( fileHandle, &info ) ) {
-        LOG_DEBUG << "Failed to get file info for " << filename.toStdString() << ", gle "
-                  << ::GetLastError();
-        return FileId{};
-    }
-
-    ULARGE_INTEGER fileIndex = { info.nFileIndexLow, info.nFileIndexHigh };
-    return FileId{ fileIndex.QuadPart, static_cast<uint64_t>( info.dwVolumeSerialNumber ) };
+    return getFileIdByHandle( fileHandle );
 #else
     struct stat info;
     if ( lstat( filename.toUtf8().constData(), &info ) != 0 ) {
@@ -206,3 +216,117 @@ FileId FileId::getFileId( const QString& filename )
     return FileId{ info.st_ino, static_cast<uint64_t>( info.st_dev ) };
 #endif
 }
+
+PositionalFileReader::PositionalFileReader( FileHolder& fileHolder )
+{
+    ScopedRecursiveLock locker( fileHolder.file_mutex_ );
+
+    if ( fileHolder.keep_closed_ || !fileHolder.isOpen() ) {
+        return;
+    }
+
+#ifdef Q_OS_WIN
+    // A duplicated descriptor would share its file pointer with the holder
+    // and Windows has no pread, so each reader opens a handle of its own.
+    // It is kept only if it still points to the file the holder indexed.
+    DWORD shareMode = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    SECURITY_ATTRIBUTES securityAtts = { sizeof( SECURITY_ATTRIBUTES ), NULL, FALSE };
+    HANDLE fileHandle = CreateFileW( (const wchar_t*)fileHolder.file_name_.utf16(), GENERIC_READ,
+                                     shareMode, &securityAtts, OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL, NULL );
+
+    if ( fileHandle == INVALID_HANDLE_VALUE ) {
+        LOG_WARNING << "Failed to open reader handle of " << fileHolder.file_name_ << ", gle "
+                    << ::GetLastError();
+        return;
+    }
+
+    if ( getFileIdByHandle( fileHandle ) != fileHolder.attached_file_id_ ) {
+        LOG_WARNING << "File " << fileHolder.file_name_ << " was replaced since it was opened";
+        ::CloseHandle( fileHandle );
+        return;
+    }
+
+    const int fd = _open_osfhandle( (intptr_t)fileHandle, _O_RDONLY );
+    if ( fd == -1 ) {
+        LOG_WARNING << "Failed to open reader handle of " << fileHolder.file_name_;
+        ::CloseHandle( fileHandle );
+        return;
+    }
+
+    if ( !file_.open( fd, QIODevice::ReadOnly, QFile::AutoCloseHandle ) ) {
+        ::_close( fd );
+    }
+#else
+    // pread does not use the file position, so sharing it with the holder is fine
+    const auto handle = fileHolder.getFile()->handle();
+    const auto duplicatedHandle = handle != -1 ? ::dup( handle ) : -1;
+
+    if ( duplicatedHandle == -1 ) {
+        LOG_WARNING << "Failed to duplicate file handle of " << fileHolder.file_name_;
+        return;
+    }
+
+    if ( !file_.open( duplicatedHandle, QIODevice::ReadOnly, QFile::AutoCloseHandle ) ) {
+        ::close( duplicatedHandle );
+    }
+#endif
+}
+
+bool PositionalFileReader::isOpen() const
+{
+    return file_.isOpen();
+}
+
+qint64 PositionalFileReader::read( qint64 offset, char* data, qint64 size )
+{
+#ifdef Q_OS_WIN
+    // ReadFile with an explicit offset in OVERLAPPED, the handle is private
+    // to this reader so its file pointer moving along does not matter
+    const auto fileHandle = reinterpret_cast<HANDLE>( ::_get_osfhandle( file_.handle() ) );
+    if ( fileHandle == INVALID_HANDLE_VALUE ) {
+        return -1;
+    }
+
+    constexpr qint64 MaxChunk = 1 << 30;
+    qint64 bytesRead = 0;
+    while ( bytesRead < size ) {
+        const auto position = static_cast<quint64>( offset + bytesRead );
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>( position & 0xFFFFFFFFu );
+        overlapped.OffsetHigh = static_cast<DWORD>( position >> 32 );
+
+        DWORD result = 0;
+        const auto chunk = static_cast<DWORD>( std::min( size - bytesRead, MaxChunk ) );
+        if ( !::ReadFile( fileHandle, data + bytesRead, chunk, &result, &overlapped ) ) {
+            if ( ::GetLastError() == ERROR_HANDLE_EOF ) {
+                break;
+            }
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+        if ( result == 0 ) {
+            break;
+        }
+        bytesRead += result;
+    }
+    return bytesRead;
+#else
+    qint64 bytesRead = 0;
+    while ( bytesRead < size ) {
+        const auto result = ::pread( file_.handle(), data + bytesRead,
+                                     static_cast<size_t>( size - bytesRead ),
+                                     static_cast<off_t>( offset + bytesRead ) );
+        if ( result < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return bytesRead > 0 ? bytesRead : -1;
+        }
+        if ( result == 0 ) {
+            break;
+        }
+        bytesRead += result;
+    }
+    return bytesRead;
+#endif
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ioscheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include <QFileInfo>
+#include <QStorageInfo>
+
+#include "configuration.h"
+#include "log.h"
+#include "metrics.h"
+#include "tracing.h"
+
+namespace {
+// Waiting streams are woken up by notifyInterrupted(),
+// this only bounds the wait if an interrupt was not notified
+constexpr auto MissedInterruptTimeout = std::chrono::seconds( 1 );
+
+QString deviceOfFile( const QString& fileName )
+{
+    const QStorageInfo storage( QFileInfo( fileName ).absolutePath() );
+    if ( !storage.isValid() ) {
+        return {};
+    }
+
+    const auto device = storage.device();
+    return device.isEmpty() ? storage.rootPath() : QString::fromUtf8( device );
+}
+} // namespace
+
+IoScheduler& IoScheduler::get()
+{
+    static IoScheduler scheduler;
+    return scheduler;
+}
+
+IoScheduler::IoScheduler()
+    : arena_( tbb::task_arena::automatic )
+{
+}
+
+IoScheduler::Stream::Stream( IoScheduler* scheduler, const QString& fileName,
+                             const QString& device, const AtomicFlag& interruptRequest )
+    : scheduler_( scheduler )
+    , fileName_( fileName )
+    , device_( device )
+    , interruptRequest_( &interruptRequest )
+{
+}
+
+IoScheduler::Stream::Stream( Stream&& other ) noexcept
+    : scheduler_( other.scheduler_ )
+    , fileName_( std::move( other.fileName_ ) )
+    , device_( std::move( other.device_ ) )
+    , interruptRequest_( other.interruptRequest_ )
+    , isOpen_( std::exchange( other.isOpen_, false ) )
+    , isForeground_( other.isForeground_ )
+    , generation_( other.generation_ )
+{
+}
+
+IoScheduler::Stream::~Stream()
+{
+    if ( isOpen_ ) {
+        scheduler_->release( *this );
+    }
+}
+
+bool IoScheduler::Stream::yield()
+{
+    // Nothing that could make this stream give up its slot has happened
+    if ( isOpen_ && scheduler_->generation_.load( std::memory_order_acquire ) == generation_ ) {
+        return true;
+    }
+
+    ScopedLock lock( scheduler_->mutex_ );
+    generation_ = scheduler_->generation_.load( std::memory_order_relaxed );
+
+    const auto isForeground = scheduler_->isForeground( fileName_ );
+    auto& device = scheduler_->devices_[ device_ ];
+
+    if ( isOpen_ && isForeground_ ) {
+        if ( isForeground ) {
+            return true;
+        }
+
+        // Tab is not visible anymore, the slot is kept if nobody waits for it
+        --device.foregroundStreams;
+        isForeground_ = false;
+        if ( device.foregroundStreams == 0 && device.foregroundWaiting == 0
+             && device.waiting.empty() ) {
+            ++device.backgroundStreams;
+            return true;
+        }
+
+        isOpen_ = false;
+        scheduler_->slotReleased_.notify_all();
+    }
+    else if ( isOpen_ ) {
+        if ( isForeground ) {
+            --device.backgroundStreams;
+            ++device.foregroundStreams;
+            isForeground_ = true;
+            // Other background streams of the device give way
+            scheduler_->advanceGeneration();
+            generation_ = scheduler_->generation_.load( std::memory_order_relaxed );
+            scheduler_->slotReleased_.notify_all();
+            return true;
+        }
+
+        if ( device.foregroundStreams == 0 && device.foregroundWaiting == 0 ) {
+            return true;
+        }
+
+        LOG_INFO << "Pausing reads of " << fileName_ << " for foreground file";
+        --device.backgroundStreams;
+        isOpen_ = false;
+        scheduler_->slotReleased_.notify_all();
+    }
+
+    return scheduler_->acquire( *this, lock );
+}
+
+IoScheduler::Stream IoScheduler::openStream( const QString& fileName,
+                                             const AtomicFlag& interruptRequest )
+{
+    Stream stream{ this, fileName, deviceOfFile( fileName ), interruptRequest };
+
+    ScopedLock lock( mutex_ );
+    acquire( stream, lock );
+    return stream;
+}
+
+void IoScheduler::setForegroundFile( const QString& fileName )
+{
+    {
+        ScopedLock lock( mutex_ );
+        foregroundFile_ = fileName;
+        advanceGeneration();
+    }
+
+    LOG_INFO << "Foreground file " << fileName;
+    slotReleased_.notify_all();
+}
+
+void IoScheduler::notifyInterrupted()
+{
+    // Taking the lock makes sure a stream that checked its
+    // interrupt request before it was set is already waiting
+    {
+        ScopedLock lock( mutex_ );
+    }
+    slotReleased_.notify_all();
+}
+
+bool IoScheduler::isIdle() const
+{
+    ScopedLock lock( mutex_ );
+    return std::all_of( devices_.begin(), devices_.end(), []( const auto& device ) {
+        return device.second.streams() == 0 && device.second.waiting.empty();
+    } );
+}
+
+std::unique_ptr<tbb::flow::graph> IoScheduler::createGraph()
+{
+    // Graph is attached to the arena it is constructed in
+    std::unique_ptr<tbb::flow::graph> graph;
+    arena_.execute( [ &graph ] { graph = std::make_unique<tbb::flow::graph>(); } );
+    return graph;
+}
+
+bool IoScheduler::isForeground( const QString& fileName ) const
+{
+    return !foregroundFile_.isEmpty() && foregroundFile_ == fileName;
+}
+
+void IoScheduler::advanceGeneration()
+{
+    generation_.fetch_add( 1, std::memory_order_release );
+}
+
+bool IoScheduler::acquire( Stream& stream, ScopedLock& lock )
+{
+    auto& device = devices_[ stream.device_ ];
+    const auto maxStreams = std::max( 1, Configuration::get().ioStreamsPerDevice() );
+
+    static auto& waitingStreams = Metrics::get().gauge( "io.waiting_streams" );
+    KLOGG_TRACE_SCOPE( "io", "wait_for_device" );
+
+    // The stream keeps its place in the queue if its file
+    // becomes foreground or background while it waits
+    const auto ticket = nextTicket_++;
+    device.waiting.push_back( ticket );
+    waitingStreams.add( 1 );
+    bool isWaitingAsForeground = false;
+
+    const auto leaveQueue = [ & ] {
+        device.waiting.erase( std::find( device.waiting.begin(), device.waiting.end(), ticket ) );
+        if ( isWaitingAsForeground ) {
+            --device.foregroundWaiting;
+        }
+        waitingStreams.add( -1 );
+    };
+
+    while ( !( *stream.interruptRequest_ ) ) {
+        const auto isForegroundFile = isForeground( stream.fileName_ );
+        if ( isForegroundFile != isWaitingAsForeground ) {
+            isWaitingAsForeground = isForegroundFile;
+            device.foregroundWaiting += isForegroundFile ? 1 : -1;
+            // Background streams of the device give their slot at their next block
+            advanceGeneration();
+        }
+
+        // Foreground streams take the first free slot, background ones
+        // also wait for their turn and for the foreground ones to be done
+        const auto hasFreeSlot = device.streams() < maxStreams;
+        const auto canStart
+            = isForegroundFile
+                  ? hasFreeSlot
+                  : hasFreeSlot && device.foregroundStreams == 0 && device.foregroundWaiting == 0
+                        && device.waiting.front() == ticket;
+
+        if ( canStart ) {
+            leaveQueue();
+            if ( isForegroundFile ) {
+                ++device.foregroundStreams;
+            }
+            else {
+                ++device.backgroundStreams;
+            }
+            stream.isForeground_ = isForegroundFile;
+            stream.isOpen_ = true;
+            stream.generation_ = generation_.load( std::memory_order_relaxed );
+            // Next one in the queue might fit too
+            slotReleased_.notify_all();
+            return true;
+        }
+
+        slotReleased_.wait_for( lock, MissedInterruptTimeout );
+    }
+
+    leaveQueue();
+    slotReleased_.notify_all();
+    return false;
+}
+
+void IoScheduler::release( Stream& stream )
+{
+    {
+        ScopedLock lock( mutex_ );
+        auto& device = devices_[ stream.device_ ];
+        if ( stream.isForeground_ ) {
+            --device.foregroundStreams;
+        }
+        else {
+            --device.backgroundStreams;
+        }
+        stream.isOpen_ = false;
+    }
+
+    slotReleased_.notify_all();
+}
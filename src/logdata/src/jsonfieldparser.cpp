@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include <simdjson.h>
+
+#include "jsonfieldparser.h"
+
+namespace {
+
+using OnValue = std::function<void( size_t, std::string_view )>;
+
+// Objects nested deeper than this are not looked into
+constexpr int MaxObjectDepth = 4;
+
+bool hasFieldsUnder( const std::vector<std::string>& fields, std::string_view path )
+{
+    return std::any_of( fields.begin(), fields.end(), [ path ]( const std::string& field ) {
+        return field.size() > path.size() && field.compare( 0, path.size(), path ) == 0
+               && field[ path.size() ] == '.';
+    } );
+}
+
+simdjson::error_code parseObject( simdjson::ondemand::object& object, std::string& path,
+                                  int depth, const std::vector<std::string>& fields,
+                                  const OnValue& onValue )
+{
+    const auto parentPathLength = path.size();
+
+    for ( auto fieldResult : object ) {
+        simdjson::ondemand::field field;
+        std::string_view key;
+        if ( const auto error = std::move( fieldResult ).get( field ) ) {
+            return error;
+        }
+        if ( const auto error = field.unescaped_key().get( key ) ) {
+            return error;
+        }
+
+        path.resize( parentPathLength );
+        if ( parentPathLength > 0 ) {
+            path.push_back( '.' );
+        }
+        path.append( key );
+
+        auto& value = field.value();
+        const auto fieldIt = std::find( fields.begin(), fields.end(), path );
+        if ( fieldIt != fields.end() ) {
+            simdjson::ondemand::json_type type;
+            if ( const auto error = value.type().get( type ) ) {
+                return error;
+            }
+
+            const auto fieldIndex = static_cast<size_t>( fieldIt - fields.begin() );
+            if ( type == simdjson::ondemand::json_type::string ) {
+                std::string_view text;
+                if ( const auto error = value.get_string().get( text ) ) {
+                    return error;
+                }
+                onValue( fieldIndex, text );
+            }
+            else if ( type == simdjson::ondemand::json_type::number
+                      || type == simdjson::ondemand::json_type::boolean ) {
+                auto token = value.raw_json_token();
+                token = token.substr( 0, token.find_last_not_of( " \t\r\n" ) + 1 );
+                onValue( fieldIndex, token );
+            }
+        }
+        else if ( depth < MaxObjectDepth && hasFieldsUnder( fields, path ) ) {
+            simdjson::ondemand::object child;
+            if ( value.get_object().get( child ) == simdjson::SUCCESS ) {
+                if ( const auto error = parseObject( child, path, depth + 1, fields, onValue ) ) {
+                    return error;
+                }
+            }
+        }
+    }
+
+    path.resize( parentPathLength );
+    return simdjson::SUCCESS;
+}
+
+} // namespace
+
+struct JsonFieldParser::Parser {
+    simdjson::ondemand::parser parser;
+    // Copy of the line followed by the padding simdjson may read
+    std::string buffer;
+    std::string path;
+};
+
+JsonFieldParser::JsonFieldParser( std::vector<std::string> fields )
+    : fields_( std::move( fields ) )
+    , parser_( std::make_unique<Parser>() )
+{
+}
+
+JsonFieldParser::~JsonFieldParser() = default;
+
+JsonFieldParser::JsonFieldParser( JsonFieldParser&& ) noexcept = default;
+JsonFieldParser& JsonFieldParser::operator=( JsonFieldParser&& ) noexcept = default;
+
+bool JsonFieldParser::parse( std::string_view line, const OnValue& onValue )
+{
+    // Plain text lines are rejected without being copied
+    const auto objectStart = line.find_first_not_of( " \t" );
+    if ( objectStart == std::string_view::npos || line[ objectStart ] != '{' ) {
+        return false;
+    }
+    line.remove_prefix( objectStart );
+
+    auto& buffer = parser_->buffer;
+    buffer.assign( line );
+    buffer.append( simdjson::SIMDJSON_PADDING, '\0' );
+
+    simdjson::ondemand::document document;
+    simdjson::ondemand::object object;
+    if ( parser_->parser.iterate( buffer.data(), line.size(), buffer.size() ).get( document )
+         || document.get_object().get( object ) ) {
+        return false;
+    }
+
+    // Values found before a syntax error are kept
+    parser_->path.clear();
+    parseObject( object, parser_->path, 0, fields_, onValue );
+    return true;
+}
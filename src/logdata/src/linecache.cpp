@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "linecache.h"
+
+#include <numeric>
+
+LineCache::LineCache( size_t maxBlocks )
+    : maxBlocks_{ maxBlocks }
+{
+}
+
+LineCache::Block LineCache::find( uint64_t blockIndex )
+{
+    ScopedLock lock( mutex_ );
+    const auto cached = index_.find( blockIndex );
+    if ( cached == index_.end() ) {
+        return {};
+    }
+
+    blocks_.splice( blocks_.begin(), blocks_, cached->second );
+    return cached->second->lines;
+}
+
+bool LineCache::contains( uint64_t blockIndex ) const
+{
+    SharedLock lock( mutex_ );
+    return index_.count( blockIndex ) > 0;
+}
+
+LineCache::Block LineCache::insert( uint64_t blockIndex, std::vector<QString> lines,
+                                   uint64_t generation )
+{
+    const auto blockSize = std::accumulate(
+        lines.begin(), lines.end(), uint64_t{ 0 }, []( uint64_t size, const QString& line ) {
+            return size + static_cast<uint64_t>( line.size() ) * sizeof( QChar );
+        } );
+
+    auto block = std::make_shared<const std::vector<QString>>( std::move( lines ) );
+
+    ScopedLock lock( mutex_ );
+    if ( generation != generation_ || index_.count( blockIndex ) ) {
+        return block;
+    }
+
+    blocks_.push_front( { blockIndex, block, blockSize } );
+    index_.emplace( blockIndex, blocks_.begin() );
+    sizeInBytes_ += blockSize;
+
+    while ( blocks_.size() > maxBlocks_ ) {
+        sizeInBytes_ -= blocks_.back().sizeInBytes;
+        index_.erase( blocks_.back().index );
+        blocks_.pop_back();
+    }
+
+    return block;
+}
+
+uint64_t LineCache::clear()
+{
+    ScopedLock lock( mutex_ );
+    ++generation_;
+
+    const auto freed = sizeInBytes_;
+    blocks_.clear();
+    index_.clear();
+    sizeInBytes_ = 0;
+
+    return freed;
+}
+
+uint64_t LineCache::sizeInBytes() const
+{
+    SharedLock lock( mutex_ );
+    return sizeInBytes_;
+}
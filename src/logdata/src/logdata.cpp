@@ -43,6 +43,7 @@
 #include <cstddef>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <numeric>
 #include <qregularexpression.h>
 #include <qtextcodec.h>
@@ -52,6 +53,7 @@
 
 #include <QFileInfo>
 #include <QIODevice>
+#include <QThread>
 
 #include <simdutf.h>
 
@@ -59,9 +61,23 @@
 #include "linetypes.h"
 #include "log.h"
 #include "logfiltereddata.h"
+#include "metrics.h"
+#include "readablesize.h"
+#include "tracing.h"
 
 #include "logdata.h"
 
+namespace {
+// Lines are split on LF only, CRLF line ends leave a CR behind
+QString chopCarriageReturn( QString&& line )
+{
+    if ( line.endsWith( QChar::CarriageReturn ) ) {
+        line.chop( 1 );
+    }
+    return std::move( line );
+}
+} // namespace
+
 LogData::LogData()
     : AbstractLogData()
     , indexing_data_( std::make_shared<IndexingData>() )
@@ -76,6 +92,9 @@ LogData::LogData()
 
     // Forward the update signal
     connect( worker.get(), &LogDataWorker::indexingProgressed, this, &LogData::loadingProgressed );
+    connect(
+        worker.get(), &LogDataWorker::indexingProgressed, this,
+        [ this ]( auto ) { updateMemoryUsage(); }, Qt::QueuedConnection );
     connect( worker.get(), &LogDataWorker::indexingFinished, this, &LogData::indexingFinished,
              Qt::QueuedConnection );
     connect( worker.get(), &LogDataWorker::checkFileChangesFinished, this,
@@ -94,18 +113,64 @@ LogData::LogData()
     if ( defaultEncodingMib >= 0 ) {
         codec_.setCodec( QTextCodec::codecForMib( defaultEncodingMib ) );
     }
+
+    MemoryBudget::Consumer memoryConsumer;
+    memoryConsumer.owner = this;
+    memoryConsumer.evictCaches = [ this ] { return clearLineCaches(); };
+    memoryConsumer.spillToDisk = [ this ] { return spillIndexToDisk(); };
+    memoryConsumer_ = MemoryBudget::get().registerConsumer( std::move( memoryConsumer ) );
 }
 
-LogData::~LogData()
+LogData::~LogData() noexcept
 {
     LOG_DEBUG << "Destroying log data";
+    MemoryBudget::get().unregisterConsumer( memoryConsumer_ );
+    {
+        std::lock_guard<std::mutex> lock( prefetchMutex_ );
+        prefetchQueue_.clear();
+    }
+    prefetchTasks_.wait();
     operationQueue_.shutdown();
 }
 
+void LogData::updateMemoryUsage()
+{
+    size_t allocatedSize = 0;
+    size_t residentSize = 0;
+    {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+        allocatedSize = scopedAccessor.allocatedSize();
+        residentSize = scopedAccessor.residentSize();
+    }
+
+    auto& memoryBudget = MemoryBudget::get();
+    memoryBudget.update( memoryConsumer_, MemoryBudget::Usage::SpilledIndex,
+                         allocatedSize > residentSize ? allocatedSize - residentSize : 0u );
+    memoryBudget.update( memoryConsumer_, MemoryBudget::Usage::Index, residentSize );
+}
+
+uint64_t LogData::spillIndexToDisk()
+{
+    size_t freed = 0;
+    {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        const auto residentSize = scopedAccessor.residentSize();
+        if ( scopedAccessor.spillToDisk() ) {
+            freed = residentSize - scopedAccessor.residentSize();
+        }
+    }
+
+    LOG_INFO << "Spilled index of " << indexingFileName_ << ", " << readableSize( freed );
+
+    updateMemoryUsage();
+    return freed;
+}
+
 void LogData::setPrefilter( const QString& prefilterPattern )
 {
     IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
     prefilterPattern_ = prefilterPattern;
+    clearLineCaches();
 }
 
 void LogData::attachFile( const QString& fileName )
@@ -131,7 +196,17 @@ void LogData::interruptLoading()
 
 qint64 LogData::getFileSize() const
 {
-    return IndexingData::ConstAccessor{ indexing_data_.get() }.getIndexedSize();
+    return indexing_data_->getSnapshot().indexedSize;
+}
+
+IndexedHash LogData::getIndexedHash() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.getHash();
+}
+
+QString LogData::getFileName() const
+{
+    return indexingFileName_;
 }
 
 QDateTime LogData::getLastModifiedDate() const
@@ -148,6 +223,7 @@ std::unique_ptr<LogFilteredData> LogData::getNewFilteredData() const
 void LogData::reload( QTextCodec* forcedEncoding )
 {
     operationQueue_.interrupt();
+    clearLineCaches();
 
     // Re-open the file, useful in case the file has been moved
     attached_file_->reOpenFile();
@@ -157,6 +233,7 @@ void LogData::reload( QTextCodec* forcedEncoding )
 
 void LogData::fileChangedOnDisk( const QString& filename )
 {
+    KLOGG_TRACE_SCOPE( "filewatch", "file_changed" );
     LOG_INFO << "signalFileChanged " << filename << ", indexed file " << indexingFileName_;
 
     QFileInfo info( indexingFileName_ );
@@ -217,8 +294,15 @@ void LogData::indexingFinished( LoadingStatus status )
             lastModifiedDate_ = fileInfo.lastModified();
     }
 
+    // Lines already read stay valid if data was only appended
+    if ( fileChangedOnDisk_ != MonitoredFileStatus::DataAdded ) {
+        clearLineCaches();
+    }
+
     fileChangedOnDisk_ = MonitoredFileStatus::Unchanged;
 
+    updateMemoryUsage();
+
     LOG_DEBUG << "Sending indexingFinished.";
     Q_EMIT loadingFinished( status );
 
@@ -263,28 +347,82 @@ void LogData::checkFileChangesFinished( MonitoredFileStatus status )
 //
 LinesCount LogData::doGetNbLine() const
 {
-    return IndexingData::ConstAccessor{ indexing_data_.get() }.getNbLines();
+    return indexing_data_->getSnapshot().nbLines;
 }
 
 LineLength LogData::doGetMaxLength() const
 {
-    return IndexingData::ConstAccessor{ indexing_data_.get() }.getMaxLength();
+    return indexing_data_->getSnapshot().maxLength;
 }
 
 LineLength LogData::doGetLineLength( LineNumber line ) const
 {
-    if ( line >= IndexingData::ConstAccessor{ indexing_data_.get() }.getNbLines() ) {
+    if ( line >= indexing_data_->getSnapshot().nbLines ) {
         return 0_length; /* exception? */
     }
 
+    // Long lines are decoded only once to get their length,
+    // it is estimated from their size until then
+    if ( const auto bytes = longLineBytes( line ) ) {
+        const auto index = getLongLineIndex( line, bytes->first, bytes->second );
+        const auto length = index ? index->expandedLength
+                                  : ( bytes->second - bytes->first )
+                                        / codec_.encodingParameters().lineFeedWidth;
+        return LineLength( static_cast<LineLength::UnderlyingType>( std::min(
+            length, int64_t{ std::numeric_limits<LineLength::UnderlyingType>::max() } ) ) );
+    }
+
     return LineLength(
         static_cast<LineLength::UnderlyingType>( doGetExpandedLineString( line ).length() ) );
 }
 
+std::vector<LineLength> LogData::doGetLineLengths( LineNumber first, LinesCount number ) const
+{
+    std::vector<LineLength> lengths;
+    const auto nbLines = indexing_data_->getSnapshot().nbLines;
+    if ( first >= nbLines ) {
+        return lengths;
+    }
+    number = std::min( number, nbLines - LinesCount( first.get() ) );
+    lengths.reserve( number.get() );
+
+    // Lines of usual length are read together, long lines use their index
+    LineNumber runStart;
+    auto runLength = 0_lcount;
+    const auto measureRun = [ & ] {
+        if ( runLength.get() == 0 ) {
+            return;
+        }
+        auto lines = doGetExpandedLines( runStart, runLength );
+        lines.resize( runLength.get() );
+        for ( const auto& line : lines ) {
+            lengths.emplace_back( static_cast<LineLength::UnderlyingType>( line.length() ) );
+        }
+        runLength = 0_lcount;
+    };
+
+    for ( auto line = first; line < first + number; ++line ) {
+        if ( !longLineBytes( line ) ) {
+            if ( runLength.get() == 0 ) {
+                runStart = line;
+            }
+            ++runLength;
+            continue;
+        }
+
+        measureRun();
+        lengths.push_back( doGetLineLength( line ) );
+    }
+    measureRun();
+
+    return lengths;
+}
+
 void LogData::doSetDisplayEncoding( const char* encoding )
 {
     LOG_DEBUG << "AbstractLogData::setDisplayEncoding: " << encoding;
     codec_.setCodec( QTextCodec::codecForName( encoding ) );
+    clearLineCaches();
     auto needReload = false;
     auto useGuessedCodec = false;
 
@@ -330,23 +468,368 @@ QString LogData::doGetExpandedLineString( LineNumber line ) const
 // indexingFinished).
 std::vector<QString> LogData::doGetLines( LineNumber first_line, LinesCount number ) const
 {
+    if ( auto cachedLines = getCachedLines( first_line, number ) ) {
+        return std::move( *cachedLines );
+    }
+
     return getLinesFromFile( first_line, number, []( QString&& lineData ) {
-        if ( lineData.endsWith( QChar::CarriageReturn ) ) {
-            lineData.chop( 1 );
-        }
-        return std::move( lineData );
+        return chopCarriageReturn( std::move( lineData ) );
     } );
 }
 
 std::vector<QString> LogData::doGetExpandedLines( LineNumber first_line, LinesCount number ) const
 {
+    if ( auto cachedLines = getCachedLines( first_line, number ) ) {
+        std::transform( cachedLines->begin(), cachedLines->end(), cachedLines->begin(),
+                        []( QString& line ) { return untabify( std::move( line ) ); } );
+        return std::move( *cachedLines );
+    }
+
+    // Same lines as the ones cached, without the CR of CRLF line ends
     return getLinesFromFile( first_line, number, []( QString&& lineData ) {
-        return untabify( std::move( lineData ) );
+        return untabify( chopCarriageReturn( std::move( lineData ) ) );
     } );
 }
 
+bool LogData::isBlockCacheable( uint64_t blockIndex ) const
+{
+    const auto blockEnd = LineCache::blockStart( blockIndex ) + LinesCount( LineCache::BlockSize );
+    return blockEnd.get() < doGetNbLine().get();
+}
+
+std::optional<std::vector<QString>> LogData::getCachedLines( LineNumber first,
+                                                            LinesCount number ) const
+{
+    // Big reads (copy, save) would only flush what the views use
+    static constexpr auto MaxCachedBlocks = 4u;
+
+    if ( number.get() == 0 ) {
+        return {};
+    }
+
+    const auto firstBlock = LineCache::blockIndex( first );
+    const auto lastBlock = LineCache::blockIndex( first + number - 1_lcount );
+    if ( lastBlock - firstBlock >= MaxCachedBlocks || !isBlockCacheable( lastBlock ) ) {
+        return {};
+    }
+
+    std::vector<QString> lines;
+    lines.reserve( number.get() );
+
+    for ( auto blockIndex = firstBlock; blockIndex <= lastBlock; ++blockIndex ) {
+        auto block = lineCache_.find( blockIndex );
+        if ( !block ) {
+            const auto generation = lineCache_.generation();
+            auto blockLines = readLineBlock( blockIndex );
+            if ( blockLines.size() != LineCache::BlockSize ) {
+                return {};
+            }
+
+            block = lineCache_.insert( blockIndex, std::move( blockLines ), generation );
+        }
+
+        const auto blockStart = LineCache::blockStart( blockIndex );
+        const auto from = blockIndex == firstBlock ? ( first - blockStart ).get() : 0u;
+        const auto to = blockIndex == lastBlock
+                            ? ( first + number - 1_lcount - blockStart ).get() + 1
+                            : LineCache::BlockSize;
+        lines.insert( lines.end(), block->begin() + static_cast<std::ptrdiff_t>( from ),
+                      block->begin() + static_cast<std::ptrdiff_t>( to ) );
+    }
+
+    return lines;
+}
+
+std::vector<QString> LogData::readLineBlock( uint64_t blockIndex ) const
+{
+    std::vector<QString> lines;
+    try {
+        const auto rawLines = getLinesRaw( LineCache::blockStart( blockIndex ),
+                                           LinesCount( LineCache::BlockSize ) );
+        lines = rawLines.decodeLines();
+    } catch ( const std::bad_alloc& e ) {
+        LOG_ERROR << "not enough memory " << e.what();
+        return {};
+    }
+
+    for ( auto& line : lines ) {
+        line = chopCarriageReturn( std::move( line ) );
+    }
+
+    return lines;
+}
+
+uint64_t LogData::clearLineCaches() const
+{
+    return lineCache_.clear() + longLineIndex_.clear();
+}
+
+std::optional<std::pair<LineOffset::UnderlyingType, LineOffset::UnderlyingType>>
+LogData::longLineBytes( LineNumber line ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+
+    // Removing the prefilter matches can't be done on a part of the line,
+    // and the last line might still be growing.
+    if ( !prefilterPattern_.isEmpty() || line + 1_lcount >= scopedAccessor.getNbLines() ) {
+        return {};
+    }
+
+    const auto start
+        = line == 0_lnum ? 0 : scopedAccessor.getEndOfLineOffset( line - 1_lcount ).get();
+    const auto end = scopedAccessor.getEndOfLineOffset( line ).get()
+                     - static_cast<LineOffset::UnderlyingType>(
+                         codec_.encodingParameters().lineFeedWidth );
+
+    if ( end < start + LongLineIndex::MinLineBytes ) {
+        return {};
+    }
+
+    return std::make_pair( start, end );
+}
+
+QByteArray LogData::readBytes( LineOffset::UnderlyingType offset, int64_t size ) const
+{
+    ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
+    fileHolder.getFile()->seek( offset );
+    return fileHolder.getFile()->read( size );
+}
+
+LongLineIndex::LinePtr LogData::getLongLineIndex( LineNumber line,
+                                                  LineOffset::UnderlyingType start,
+                                                  LineOffset::UnderlyingType end ) const
+{
+    if ( auto index = longLineIndex_.find( line ) ) {
+        return index;
+    }
+
+    if ( QThread::currentThread() != thread() ) {
+        return buildLongLineIndex( line, start, end );
+    }
+
+    // Decoding the whole line takes a while, the views show its beginning
+    // until it is indexed in the background.
+    std::lock_guard<std::mutex> lock( prefetchMutex_ );
+    if ( pendingLongLines_.insert( line.get() ).second ) {
+        prefetchTasks_.run( [ this, line, start, end ] {
+            const auto index = buildLongLineIndex( line, start, end );
+            {
+                std::lock_guard<std::mutex> pendingLock( prefetchMutex_ );
+                pendingLongLines_.erase( line.get() );
+            }
+            if ( index ) {
+                Q_EMIT longLinesIndexed();
+            }
+        } );
+    }
+
+    return {};
+}
+
+LongLineIndex::LinePtr LogData::buildLongLineIndex( LineNumber line,
+                                                    LineOffset::UnderlyingType start,
+                                                    LineOffset::UnderlyingType end ) const
+{
+    LOG_INFO << "Indexing long line " << line << " of " << ( end - start ) << " bytes";
+    const auto generation = longLineIndex_.generation();
+
+    try {
+        const auto bytes = readBytes( start, static_cast<int64_t>( end - start ) );
+        if ( static_cast<LineOffset::UnderlyingType>( bytes.size() ) != end - start ) {
+            LOG_WARNING << "Failed to read long line " << line;
+            return {};
+        }
+
+        auto index = std::make_shared<const LongLineIndex::Line>( LongLineIndex::build(
+            std::string_view( bytes.data(), static_cast<size_t>( bytes.size() ) ),
+            codec_.makeDecoder() ) );
+        longLineIndex_.insert( line, index, generation );
+        return index;
+
+    } catch ( const std::bad_alloc& e ) {
+        LOG_ERROR << "not enough memory " << e.what();
+        return {};
+    }
+}
+
+AbstractLogData::LineWindow LogData::getLongLineWindow( LineNumber line,
+                                                        LineOffset::UnderlyingType start,
+                                                        LineOffset::UnderlyingType end,
+                                                        int firstColumn, int nbColumns ) const
+{
+    const auto index = getLongLineIndex( line, start, end );
+    if ( !index ) {
+        // Only the beginning of the line is decoded, the rest is not
+        // shown until the line is indexed
+        const auto size = std::min( end - start, LongLineIndex::MinLineBytes );
+        const auto bytes = readBytes( start, size );
+        auto text = codec_.makeDecoder().decoder->toUnicode( bytes );
+        if ( size == end - start && text.endsWith( QChar::CarriageReturn ) ) {
+            text.chop( 1 );
+        }
+        return { std::move( text ), 0 };
+    }
+
+    const auto [ from, to ] = index->byteRange( firstColumn, int64_t{ firstColumn } + nbColumns );
+    const auto bytes
+        = readBytes( start + static_cast<LineOffset::UnderlyingType>( from.byteOffset ),
+                     to - from.byteOffset );
+
+    auto text = codec_.makeDecoder().decoder->toUnicode( bytes );
+    if ( to == index->byteLength && text.endsWith( QChar::CarriageReturn ) ) {
+        text.chop( 1 );
+    }
+
+    return { std::move( text ), static_cast<int>( from.column ) };
+}
+
+std::vector<AbstractLogData::LineWindow>
+LogData::doGetLineWindows( LineNumber first, LinesCount number, int firstColumn,
+                           int nbColumns ) const
+{
+    std::vector<LineWindow> windows;
+    windows.reserve( number.get() );
+
+    // Lines of usual length are read together, as whole lines
+    LineNumber runStart;
+    auto runLength = 0_lcount;
+    const auto readRun = [ & ] {
+        if ( runLength.get() == 0 ) {
+            return;
+        }
+        for ( auto& line : doGetLines( runStart, runLength ) ) {
+            windows.push_back( { std::move( line ), 0 } );
+        }
+        runLength = 0_lcount;
+    };
+
+    for ( auto line = first; line < first + number; ++line ) {
+        const auto bytes = longLineBytes( line );
+        if ( !bytes ) {
+            if ( runLength.get() == 0 ) {
+                runStart = line;
+            }
+            ++runLength;
+            continue;
+        }
+
+        readRun();
+        windows.push_back(
+            getLongLineWindow( line, bytes->first, bytes->second, firstColumn, nbColumns ) );
+    }
+    readRun();
+
+    return windows;
+}
+
+void LogData::doPrefetchLines( LineNumber first, LinesCount number ) const
+{
+    prefetchLineRanges( { { first, number } } );
+}
+
+const AbstractLogData* LogData::doGetSourceData() const
+{
+    return this;
+}
+
+AbstractLogData::SourceRuns LogData::doGetSourceRuns( LineNumber first, LinesCount number ) const
+{
+    const auto nbLines = doGetNbLine();
+    if ( first >= nbLines ) {
+        return {};
+    }
+
+    return { { first, std::min( number, nbLines - LinesCount( first.get() ) ) } };
+}
+
+void LogData::prefetchLineRanges( const std::vector<LineRange>& ranges ) const
+{
+    // Don't keep reading for a view that moved on
+    static constexpr auto MaxPrefetchBlocks = 64u;
+
+    std::deque<uint64_t> blocks;
+    for ( const auto& range : ranges ) {
+        if ( range.second.get() == 0 ) {
+            continue;
+        }
+
+        const auto firstBlock = LineCache::blockIndex( range.first );
+        const auto lastBlock = LineCache::blockIndex( range.first + range.second - 1_lcount );
+        for ( auto blockIndex = firstBlock;
+              blockIndex <= lastBlock && blocks.size() < MaxPrefetchBlocks; ++blockIndex ) {
+            if ( isBlockCacheable( blockIndex ) && !lineCache_.contains( blockIndex )
+                 && std::find( blocks.begin(), blocks.end(), blockIndex ) == blocks.end() ) {
+                blocks.push_back( blockIndex );
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock( prefetchMutex_ );
+    prefetchQueue_ = std::move( blocks );
+    if ( !prefetchQueue_.empty() && !isPrefetchRunning_ ) {
+        isPrefetchRunning_ = true;
+        prefetchTasks_.run( [ this ] { runPrefetch(); } );
+    }
+}
+
+void LogData::runPrefetch() const
+{
+    for ( ;; ) {
+        uint64_t blockIndex = 0;
+        {
+            std::lock_guard<std::mutex> lock( prefetchMutex_ );
+            if ( prefetchQueue_.empty() ) {
+                isPrefetchRunning_ = false;
+                return;
+            }
+            blockIndex = prefetchQueue_.front();
+            prefetchQueue_.pop_front();
+        }
+
+        if ( lineCache_.contains( blockIndex ) || !isBlockCacheable( blockIndex ) ) {
+            continue;
+        }
+
+        const auto generation = lineCache_.generation();
+        auto lines = readLineBlock( blockIndex );
+        if ( lines.size() == LineCache::BlockSize ) {
+            LOG_DEBUG << "Prefetched lines from " << LineCache::blockStart( blockIndex );
+            lineCache_.insert( blockIndex, std::move( lines ), generation );
+        }
+    }
+}
+
 LogData::RawLines LogData::getLinesRaw( LineNumber firstLine, LinesCount number ) const
 {
+    return readLinesRaw( firstLine, number, [ this ]( qint64 offset, char* data, qint64 size ) {
+        ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
+        fileHolder.getFile()->seek( offset );
+        return fileHolder.getFile()->read( data, size );
+    } );
+}
+
+std::unique_ptr<PositionalFileReader> LogData::createFileReader() const
+{
+    return std::make_unique<PositionalFileReader>( *attached_file_ );
+}
+
+LogData::RawLines LogData::getLinesRaw( LineNumber firstLine, LinesCount number,
+                                        PositionalFileReader& fileReader ) const
+{
+    return readLinesRaw( firstLine, number,
+                         [ &fileReader ]( qint64 offset, char* data, qint64 size ) {
+                             return fileReader.read( offset, data, size );
+                         } );
+}
+
+LogData::RawLines LogData::readLinesRaw( LineNumber firstLine, LinesCount number,
+                                         const BytesReader& readBytes ) const
+{
+    static auto& readLatency = Metrics::get().histogram( "logdata.read_lines_us" );
+    static auto& readBytesTotal = Metrics::get().counter( "logdata.bytes_read" );
+    const auto readTimer = readLatency.startTimer();
+    KLOGG_TRACE_SCOPE_ARG( "logdata", "read_lines", "lines", number.get() );
+
     RawLines rawLines;
     rawLines.startLine = firstLine;
 
@@ -366,8 +849,6 @@ LogData::RawLines LogData::getLinesRaw( LineNumber firstLine, LinesCount number
             return {}; /* exception? */
         }
 
-        ScopedFileHolder<FileHolder> fileHolder( attached_file_.get() );
-
         const auto firstByte
             = ( firstLine == 0_lnum )
                   ? 0
@@ -384,12 +865,12 @@ LogData::RawLines LogData::getLinesRaw( LineNumber firstLine, LinesCount number
         LOG_DEBUG << "will try to read:" << bytesToRead << " bytes";
         rawLines.buffer.resize( static_cast<std::size_t>( bytesToRead ) );
 
-        fileHolder.getFile()->seek( firstByte );
-        const auto bytesRead = fileHolder.getFile()->read( rawLines.buffer.data(), bytesToRead );
+        const auto bytesRead = readBytes( firstByte, rawLines.buffer.data(), bytesToRead );
 
         if ( bytesRead != bytesToRead ) {
             LOG_DEBUG << "failed to read " << bytesToRead << " bytes, got " << bytesRead;
         }
+        readBytesTotal.add( static_cast<uint64_t>( std::max( qint64{ 0 }, bytesRead ) ) );
 
         LOG_DEBUG << "done reading lines:" << rawLines.buffer.size();
         rawLines.textDecoder = codec_.makeDecoder();
@@ -397,12 +878,93 @@ LogData::RawLines LogData::getLinesRaw( LineNumber firstLine, LinesCount number
 
     } catch ( const std::bad_alloc& ) {
         LOG_ERROR << "not enough memory";
+        MemoryBudget::get().reclaimAll();
         rawLines.endOfLines.clear();
         rawLines.buffer.clear();
         return rawLines;
     }
 }
 
+LinesCount LogData::getLinesCountInBytes( LineNumber first, LinesCount maxLines,
+                                          qint64 maxBytes ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+
+    const auto nbLines = scopedAccessor.getNbLines();
+    if ( first.get() >= nbLines.get() || maxLines.get() == 0 ) {
+        return 0_lcount;
+    }
+
+    const auto startOffset = ( first == 0_lnum )
+                                 ? 0
+                                 : scopedAccessor.getEndOfLineOffset( first - 1_lcount ).get();
+    const auto fits = [ & ]( LinesCount::UnderlyingType count ) {
+        const auto endOffset
+            = scopedAccessor.getEndOfLineOffset( first + LinesCount( count - 1 ) ).get();
+        return endOffset - startOffset <= maxBytes;
+    };
+
+    // Binary search of the last line ending within maxBytes
+    auto low = LinesCount::UnderlyingType{ 1 };
+    auto high = std::min( maxLines.get(), nbLines.get() - first.get() );
+    if ( fits( high ) ) {
+        return LinesCount( high );
+    }
+
+    --high;
+    while ( low < high ) {
+        const auto middle = low + ( high - low + 1 ) / 2;
+        if ( fits( middle ) ) {
+            low = middle;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+
+    return LinesCount( low );
+}
+
+LinesCount LogData::getLinesCountInBytesBefore( LineNumber end, LinesCount maxLines,
+                                                qint64 maxBytes ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+
+    const auto nbLines = scopedAccessor.getNbLines();
+    if ( end == 0_lnum || end.get() > nbLines.get() || maxLines.get() == 0 ) {
+        return 0_lcount;
+    }
+
+    const auto endOffset = scopedAccessor.getEndOfLineOffset( end - 1_lcount ).get();
+    const auto fits = [ & ]( LinesCount::UnderlyingType count ) {
+        const auto first = end - LinesCount( count );
+        const auto startOffset = ( first == 0_lnum )
+                                     ? 0
+                                     : scopedAccessor.getEndOfLineOffset( first - 1_lcount ).get();
+        return endOffset - startOffset <= maxBytes;
+    };
+
+    // Binary search of the first line starting within maxBytes
+    auto low = LinesCount::UnderlyingType{ 1 };
+    auto high = std::min( maxLines.get(), end.get() );
+    if ( fits( high ) ) {
+        return LinesCount( high );
+    }
+
+    --high;
+    while ( low < high ) {
+        const auto middle = low + ( high - low + 1 ) / 2;
+        if ( fits( middle ) ) {
+            low = middle;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+
+    return LinesCount( low );
+}
+
 std::vector<QString> LogData::getLinesFromFile( LineNumber firstLine, LinesCount number,
                                                 QString ( *processLine )( QString&& ) ) const
 {
@@ -440,6 +1002,67 @@ QTextCodec* LogData::getDetectedEncoding() const
     return IndexingData::ConstAccessor{ indexing_data_.get() }.getEncodingGuess();
 }
 
+roaring::Roaring64Map LogData::getInvalidEncodingLines() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.getInvalidEncodingLines();
+}
+
+bool LogData::hasTimestamps() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.hasTimestamps();
+}
+
+OptionalTimestamp LogData::getLineTimestamp( LineNumber line ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    if ( !scopedAccessor.hasTimestamps() || line >= scopedAccessor.getNbLines() ) {
+        return {};
+    }
+
+    return scopedAccessor.getTimestamp( line );
+}
+
+std::vector<Timestamp> LogData::getLineTimestamps( LineNumber first, LinesCount number ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    if ( !scopedAccessor.hasTimestamps() || first >= scopedAccessor.getNbLines() ) {
+        return {};
+    }
+
+    return scopedAccessor.getTimestamps( first, number );
+}
+
+std::pair<Timestamp, Timestamp> LogData::getTimestampRange() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.getTimestampRange();
+}
+
+OptionalLineNumber LogData::findLineByTimestamp( Timestamp timestamp ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    if ( !scopedAccessor.hasTimestamps() ) {
+        return {};
+    }
+
+    return scopedAccessor.findLineByTimestamp( timestamp );
+}
+
+std::vector<std::string> LogData::getStructuredFields() const
+{
+    return IndexingData::ConstAccessor{ indexing_data_.get() }.getStructuredFields();
+}
+
+FieldQuery::Matches LogData::findLinesByFields( const FieldQuery& query, LineNumber startLine,
+                                                LineNumber endLine ) const
+{
+    IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
+    if ( !scopedAccessor.hasStructuredFields() ) {
+        return {};
+    }
+
+    return scopedAccessor.findLinesByFields( query, startLine, endLine );
+}
+
 void LogData::doAttachReader() const
 {
     attached_file_->attachReader();
@@ -37,8 +37,10 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cmath>
+#include <cstring>
 #include <exception>
 #include <functional>
 #include <qrunnable.h>
@@ -54,6 +56,15 @@
 #include <QThreadPool>
 #include <tuple>
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define KLOGG_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#include <intrin.h>
+#endif
+
 #include "configuration.h"
 #include "dispatch_to.h"
 #include "encodingdetector.h"
@@ -62,15 +73,75 @@
 #include "log.h"
 #include "logdata.h"
 #include "memory_info.h"
+#include "metrics.h"
 #include "progress.h"
 #include "readablesize.h"
 #include "runnable_lambda.h"
 
 #include "logdataworker.h"
 #include "synchronization.h"
+#include "tracing.h"
 
 constexpr int IndexingBlockSize = 1 * 1024 * 1024;
 
+namespace {
+std::optional<TimestampLayout> toTimestampLayout( TimestampFormat format )
+{
+    switch ( format ) {
+    case TimestampFormat::None:
+        return {};
+    case TimestampFormat::Iso8601:
+        return TimestampLayout::Iso8601;
+    case TimestampFormat::Syslog:
+        return TimestampLayout::Syslog;
+    case TimestampFormat::Auto:
+        break;
+    }
+
+    return TimestampLayout::Auto;
+}
+} // namespace
+
+IndexingSnapshot IndexingData::getSnapshot() const
+{
+    IndexingSnapshot snapshot;
+    auto sequence = snapshotSequence_.load( std::memory_order_acquire );
+    for ( ;; ) {
+        if ( sequence % 2 == 0 ) {
+            snapshot.nbLines = LinesCount( publishedNbLines_.load( std::memory_order_relaxed ) );
+            snapshot.maxLength
+                = LineLength( publishedMaxLength_.load( std::memory_order_relaxed ) );
+            snapshot.indexedSize = publishedIndexedSize_.load( std::memory_order_relaxed );
+            snapshot.progress = publishedProgress_.load( std::memory_order_relaxed );
+
+            std::atomic_thread_fence( std::memory_order_acquire );
+            const auto sequenceAfterRead = snapshotSequence_.load( std::memory_order_relaxed );
+            if ( sequenceAfterRead == sequence ) {
+                return snapshot;
+            }
+            sequence = sequenceAfterRead;
+        }
+        else {
+            std::this_thread::yield();
+            sequence = snapshotSequence_.load( std::memory_order_acquire );
+        }
+    }
+}
+
+void IndexingData::publishSnapshot()
+{
+    const auto sequence = snapshotSequence_.load( std::memory_order_relaxed );
+    snapshotSequence_.store( sequence + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    publishedNbLines_.store( linePosition_.size().get(), std::memory_order_relaxed );
+    publishedMaxLength_.store( maxLength_.get(), std::memory_order_relaxed );
+    publishedIndexedSize_.store( hash_.size, std::memory_order_relaxed );
+    publishedProgress_.store( progress_, std::memory_order_relaxed );
+
+    snapshotSequence_.store( sequence + 2, std::memory_order_release );
+}
+
 qint64 IndexingData::getIndexedSize() const
 {
     return hash_.size;
@@ -133,6 +204,105 @@ void IndexingData::addAll( const QByteArray& block, LineLength length,
     }
 
     encodingGuess_ = encoding;
+
+    publishSnapshot();
+}
+
+void IndexingData::addTimestamps( const std::vector<OptionalTimestamp>& timestamps )
+{
+    // addAll could have dropped a fake final line
+    const auto nbLines = getNbLines().get();
+    const auto expectedSize = nbLines >= timestamps.size() ? nbLines - timestamps.size() : 0u;
+    timestamps_.truncate( LinesCount( expectedSize ) );
+
+    if ( timestamps_.size().get() != expectedSize ) {
+        // Previous lines were indexed without timestamps
+        timestamps_.clear();
+        return;
+    }
+
+    for ( const auto& timestamp : timestamps ) {
+        timestamps_.append( timestamp );
+    }
+}
+
+bool IndexingData::hasTimestamps() const
+{
+    return timestamps_.hasTimestamps() && timestamps_.size() == getNbLines();
+}
+
+Timestamp IndexingData::getTimestamp( LineNumber line ) const
+{
+    return timestamps_.at( line );
+}
+
+std::vector<Timestamp> IndexingData::getTimestamps( LineNumber first, LinesCount count ) const
+{
+    return timestamps_.slice( first, count );
+}
+
+std::pair<Timestamp, Timestamp> IndexingData::getTimestampRange() const
+{
+    return timestamps_.range();
+}
+
+OptionalLineNumber IndexingData::findLineByTimestamp( Timestamp timestamp ) const
+{
+    return timestamps_.findLineAtOrAfter( timestamp );
+}
+
+void IndexingData::setStructuredFields( const std::vector<std::string>& fields )
+{
+    if ( fields != fields_.fields() ) {
+        fields_.setFields( fields );
+    }
+}
+
+void IndexingData::addFieldValues( const FieldIndex::Batch& values )
+{
+    // addAll could have dropped a fake final line
+    const auto nbLines = getNbLines().get();
+    const auto expectedSize
+        = nbLines >= values.size().get() ? nbLines - values.size().get() : 0u;
+    fields_.truncate( LinesCount( expectedSize ) );
+
+    if ( fields_.size().get() != expectedSize ) {
+        // Previous lines were indexed without these fields
+        fields_.clear();
+        return;
+    }
+
+    fields_.append( values );
+}
+
+bool IndexingData::hasStructuredFields() const
+{
+    return fields_.hasValues() && fields_.size() == getNbLines();
+}
+
+std::vector<std::string> IndexingData::getStructuredFields() const
+{
+    return hasStructuredFields() ? fields_.fields() : std::vector<std::string>{};
+}
+
+FieldQuery::Matches IndexingData::findLinesByFields( const FieldQuery& query,
+                                                     LineNumber startLine,
+                                                     LineNumber endLine ) const
+{
+    return query.evaluate( fields_, startLine, endLine );
+}
+
+void IndexingData::addInvalidEncodingLines( LineNumber firstLine,
+                                            const std::vector<LinesCount::UnderlyingType>& lines )
+{
+    for ( const auto line : lines ) {
+        invalidEncodingLines_.add( firstLine.get() + line );
+    }
+}
+
+roaring::Roaring64Map IndexingData::getInvalidEncodingLines() const
+{
+    return invalidEncodingLines_;
 }
 
 int IndexingData::getProgress() const
@@ -143,6 +313,7 @@ int IndexingData::getProgress() const
 void IndexingData::setProgress( int progress )
 {
     progress_ = progress;
+    publishSnapshot();
 }
 
 void IndexingData::clear()
@@ -151,6 +322,9 @@ void IndexingData::clear()
     hash_ = {};
     hashBuilder_.reset();
     linePosition_ = LinePositionArray();
+    timestamps_.clear();
+    fields_.clear();
+    invalidEncodingLines_ = {};
     encodingGuess_ = nullptr;
     encodingForced_ = nullptr;
 
@@ -159,11 +333,36 @@ void IndexingData::clear()
 
     const auto& config = Configuration::get();
     useFastModificationDetection_ = config.fastModificationDetection();
+
+    publishSnapshot();
+}
+
+void IndexingData::setLinePositionEncoding( CompressedLinePositionStorage::Encoding encoding )
+{
+    if ( linePosition_.size().get() > 0 ) {
+        LOG_WARNING << "Can't change encoding of non-empty line positions";
+        return;
+    }
+
+    linePosition_ = LinePositionArray( CompressedLinePositionStorage( encoding ) );
+    linePositionCache_.clear();
 }
 
 size_t IndexingData::allocatedSize() const
 {
-    return linePosition_.allocatedSize();
+    return linePosition_.allocatedSize() + timestamps_.allocatedSize()
+           + fields_.allocatedSize();
+}
+
+size_t IndexingData::residentSize() const
+{
+    return linePosition_.residentSize() + timestamps_.allocatedSize()
+           + fields_.allocatedSize();
+}
+
+bool IndexingData::spillToDisk()
+{
+    return linePosition_.spillToDisk();
 }
 
 LogDataWorker::LogDataWorker( const std::shared_ptr<IndexingData>& indexing_data )
@@ -176,6 +375,7 @@ LogDataWorker::~LogDataWorker() noexcept
 {
     try {
         interruptRequest_.set();
+        IoScheduler::get().notifyInterrupted();
         ScopedLock locker( operationsMutex_ );
         operationsPool_.waitForDone();
         LOG_INFO << "LogDataWorker shutdown";
@@ -276,6 +476,7 @@ void LogDataWorker::interrupt()
 {
     LOG_INFO << "Load interrupt requested";
     interruptRequest_.set();
+    IoScheduler::get().notifyInterrupted();
 }
 
 void LogDataWorker::onIndexingFinished( bool result )
@@ -346,6 +547,86 @@ std::string_view::size_type findNextSingleByteDelimeter( EncodingParameters, std
     return data.find( delimeter );
 }
 
+inline uint32_t countTrailingZeros( uint32_t mask )
+{
+#if defined( _MSC_VER ) && !defined( __clang__ )
+    unsigned long index = 0;
+    _BitScanForward( &index, mask );
+    return static_cast<uint32_t>( index );
+#else
+    return static_cast<uint32_t>( __builtin_ctz( mask ) );
+#endif
+}
+
+// Compares whole UTF-16 or UTF-32 code units with the delimeter, so no
+// neighbouring bytes have to be checked. Data has to start at a code unit,
+// the position of the delimeter byte is returned as for single byte encodings.
+template <typename CodeUnit>
+std::string_view::size_type findNextWideDelimeter( EncodingParameters encodingParams,
+                                                   std::string_view data, char delimeter )
+{
+    constexpr auto UnitSize = sizeof( CodeUnit );
+
+    // Code unit of the delimeter as laid out in the file
+    std::array<char, UnitSize> delimeterBytes{};
+    delimeterBytes[ static_cast<size_t>( encodingParams.lineFeedIndex ) ] = delimeter;
+    CodeUnit delimeterUnit{};
+    std::memcpy( &delimeterUnit, delimeterBytes.data(), UnitSize );
+
+    const auto delimeterOffset = static_cast<std::string_view::size_type>(
+        encodingParams.lineFeedIndex );
+    const auto unitsCount = data.size() / UnitSize;
+    std::string_view::size_type unit = 0;
+
+#ifdef KLOGG_USE_SSE2
+    constexpr auto UnitsPerVector = sizeof( __m128i ) / UnitSize;
+
+    const auto compareUnits = []( __m128i units, __m128i pattern ) {
+        if constexpr ( UnitSize == 2 ) {
+            return _mm_cmpeq_epi16( units, pattern );
+        }
+        else {
+            return _mm_cmpeq_epi32( units, pattern );
+        }
+    };
+
+    const auto pattern = [ delimeterUnit ] {
+        if constexpr ( UnitSize == 2 ) {
+            return _mm_set1_epi16( static_cast<short>( delimeterUnit ) );
+        }
+        else {
+            return _mm_set1_epi32( static_cast<int>( delimeterUnit ) );
+        }
+    }();
+
+    for ( ; unit + UnitsPerVector <= unitsCount; unit += UnitsPerVector ) {
+        const auto units
+            = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data.data() + unit * UnitSize ) );
+        const auto mask
+            = static_cast<uint32_t>( _mm_movemask_epi8( compareUnits( units, pattern ) ) );
+        if ( mask != 0 ) {
+            // Lowest bit is the first byte of the first matching unit
+            return unit * UnitSize + countTrailingZeros( mask ) + delimeterOffset;
+        }
+    }
+#endif
+
+    for ( ; unit < unitsCount; ++unit ) {
+        CodeUnit value{};
+        std::memcpy( &value, data.data() + unit * UnitSize, UnitSize );
+        if ( value == delimeterUnit ) {
+            return unit * UnitSize + delimeterOffset;
+        }
+    }
+
+    return std::string_view::npos;
+}
+
+template std::string_view::size_type
+findNextWideDelimeter<uint16_t>( EncodingParameters, std::string_view, char );
+template std::string_view::size_type
+findNextWideDelimeter<uint32_t>( EncodingParameters, std::string_view, char );
+
 int charOffsetWithinBlock( const char* blockStart, const char* pointer,
                            const EncodingParameters& encodingParams )
 {
@@ -353,13 +634,10 @@ int charOffsetWithinBlock( const char* blockStart, const char* pointer,
            - encodingParams.getBeforeCrOffset();
 }
 
-using FindDelimeter = std::string_view::size_type ( * )( EncodingParameters encodingParams,
-                                                         std::string_view, char );
-
 LineLength::UnderlyingType
 expandTabsInLine( const QByteArray& block, std::string_view blockToExpand, int posWithinBlock,
                   EncodingParameters encodingParams, FindDelimeter findNextDelimeter,
-                  LineLength::UnderlyingType initialAdditionalSpaces = 0 )
+                  LineLength::UnderlyingType initialAdditionalSpaces )
 {
     auto additionalSpaces = initialAdditionalSpaces;
     while ( !blockToExpand.empty() ) {
@@ -376,11 +654,15 @@ expandTabsInLine( const QByteArray& block, std::string_view blockToExpand, int p
         const auto currentExpandedSize = tabPosWithinBlock - posWithinBlock + additionalSpaces;
 
         additionalSpaces += TabStop - ( currentExpandedSize % TabStop ) - 1;
-        if ( nextTab >= blockToExpand.size() ) {
+
+        // Continue after the whole tab character to stay on code units
+        const auto nextCharacter
+            = nextTab + 1 + static_cast<size_t>( encodingParams.getAfterCrOffset() );
+        if ( nextCharacter >= blockToExpand.size() ) {
             break;
         }
 
-        blockToExpand.remove_prefix( nextTab + 1 );
+        blockToExpand.remove_prefix( nextCharacter );
     }
 
     return additionalSpaces;
@@ -417,11 +699,19 @@ FastLinePositionArray IndexOperation::parseDataBlock( LineOffset::UnderlyingType
     using namespace parse_data_block;
 
     FindDelimeter findNextDelimeter;
-    if ( state.encodingParams.lineFeedWidth == 1 ) {
+    switch ( state.encodingParams.lineFeedWidth ) {
+    case 1:
         findNextDelimeter = findNextSingleByteDelimeter;
-    }
-    else {
+        break;
+    case 2:
+        findNextDelimeter = findNextWideDelimeter<uint16_t>;
+        break;
+    case 4:
+        findNextDelimeter = findNextWideDelimeter<uint32_t>;
+        break;
+    default:
         findNextDelimeter = findNextMultiByteDelimeter;
+        break;
     }
 
     bool isEndOfBlock = false;
@@ -462,9 +752,112 @@ FastLinePositionArray IndexOperation::parseDataBlock( LineOffset::UnderlyingType
     return linePositions;
 }
 
-void IndexOperation::guessEncoding( const QByteArray& block,
-                                    IndexingData::MutateAccessor& scopedAccessor,
-                                    IndexingState& state ) const
+std::vector<OptionalTimestamp>
+IndexOperation::parseTimestamps( LineOffset::UnderlyingType blockBeginning, const QByteArray& block,
+                                 LineOffset::UnderlyingType firstLineStart,
+                                 const FastLinePositionArray& linePositions,
+                                 IndexingState& state ) const
+{
+    // Longest layout with a bracket and microseconds fits easily
+    constexpr LineOffset::UnderlyingType TimestampMaxLength = 40;
+
+    const auto blockView = std::string_view( block.data(), static_cast<size_t>( block.size() ) );
+    const auto lineFeedWidth = state.encodingParams.lineFeedWidth;
+
+    // Only the beginning of the line is needed
+    const auto lineHead = [ & ]( LineOffset::UnderlyingType begin, LineOffset::UnderlyingType end ) {
+        const auto length = std::min( end - begin, TimestampMaxLength );
+        return blockView.substr( static_cast<size_t>( begin - blockBeginning ),
+                                 static_cast<size_t>( length ) );
+    };
+
+    std::vector<OptionalTimestamp> timestamps;
+    timestamps.reserve( linePositions.size().get() );
+
+    auto lineStart = firstLineStart;
+    for ( auto i = 0u; i < linePositions.size().get(); ++i ) {
+        const auto nextLineStart = linePositions.at( i ).get();
+        const auto lineEnd = std::max( nextLineStart - lineFeedWidth, blockBeginning );
+
+        if ( lineStart < blockBeginning ) {
+            state.lineHead.append( lineHead( blockBeginning, lineEnd ) );
+            timestamps.push_back( parseTimestamp( state.lineHead, *state.timestampLayout ) );
+        }
+        else {
+            timestamps.push_back(
+                parseTimestamp( lineHead( lineStart, lineEnd ), *state.timestampLayout ) );
+        }
+
+        lineStart = nextLineStart;
+    }
+
+    // Keep the beginning of the unfinished line for the next block
+    const auto blockEnd = blockBeginning + block.size();
+    if ( lineStart >= blockBeginning ) {
+        state.lineHead = lineHead( lineStart, blockEnd );
+    }
+    else if ( state.lineHead.size() < static_cast<size_t>( TimestampMaxLength ) ) {
+        state.lineHead.append( lineHead( blockBeginning, blockEnd ) );
+    }
+
+    return timestamps;
+}
+
+FieldIndex::Batch IndexOperation::parseFields( LineOffset::UnderlyingType blockBeginning,
+                                               const QByteArray& block,
+                                               LineOffset::UnderlyingType firstLineStart,
+                                               const FastLinePositionArray& linePositions,
+                                               IndexingState& state ) const
+{
+    // Longer lines are not parsed rather than kept in memory across blocks
+    constexpr size_t FieldLineMaxLength = 1024 * 1024;
+
+    const auto blockView = std::string_view( block.data(), static_cast<size_t>( block.size() ) );
+    const auto lineFeedWidth = state.encodingParams.lineFeedWidth;
+
+    const auto lineText = [ & ]( LineOffset::UnderlyingType begin, LineOffset::UnderlyingType end ) {
+        return blockView.substr( static_cast<size_t>( begin - blockBeginning ),
+                                 static_cast<size_t>( end - begin ) );
+    };
+
+    auto& parser = *state.fieldParser;
+    FieldIndex::Batch values( parser.fields().size() );
+    const auto addValue
+        = [ &values ]( size_t field, std::string_view value ) { values.add( field, value ); };
+
+    auto lineStart = firstLineStart;
+    for ( auto i = 0u; i < linePositions.size().get(); ++i ) {
+        const auto nextLineStart = linePositions.at( i ).get();
+        const auto lineEnd = std::max( nextLineStart - lineFeedWidth, blockBeginning );
+
+        if ( lineStart < blockBeginning ) {
+            if ( state.fieldLine.size() < FieldLineMaxLength ) {
+                state.fieldLine.append( lineText( blockBeginning, lineEnd ) );
+                parser.parse( state.fieldLine, addValue );
+            }
+            state.fieldLine.clear();
+        }
+        else {
+            parser.parse( lineText( lineStart, lineEnd ), addValue );
+        }
+
+        values.endLine();
+        lineStart = nextLineStart;
+    }
+
+    // Keep the unfinished line for the next block
+    const auto blockEnd = blockBeginning + block.size();
+    if ( lineStart >= blockBeginning ) {
+        state.fieldLine = lineText( lineStart, blockEnd );
+    }
+    else if ( state.fieldLine.size() < FieldLineMaxLength ) {
+        state.fieldLine.append( lineText( blockBeginning, blockEnd ) );
+    }
+
+    return values;
+}
+
+void IndexOperation::guessEncoding( const QByteArray& block, IndexingState& state ) const
 {
     if ( !state.encodingGuess ) {
         state.encodingGuess = EncodingDetector::getInstance().detectEncoding( block );
@@ -472,7 +865,9 @@ void IndexOperation::guessEncoding( const QByteArray& block,
     }
 
     if ( !state.fileTextCodec ) {
+        IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
         state.fileTextCodec = scopedAccessor.getForcedEncoding();
+        state.isEncodingForced = state.fileTextCodec != nullptr;
 
         if ( !state.fileTextCodec ) {
             state.fileTextCodec = scopedAccessor.getEncodingGuess();
@@ -485,30 +880,102 @@ void IndexOperation::guessEncoding( const QByteArray& block,
 
     state.encodingParams = EncodingParameters( state.fileTextCodec );
 
+    if ( !state.encodingValidator ) {
+        state.encodingValidator.emplace( state.encodingParams );
+    }
+
     LOG_DEBUG << "Encoding " << state.fileTextCodec->name().toStdString() << ", Char width "
               << state.encodingParams.lineFeedWidth;
 }
 
+EncodingValidator::BlockResult
+IndexOperation::validateEncoding( LineOffset::UnderlyingType blockBeginning,
+                                  const QByteArray& block,
+                                  LineOffset::UnderlyingType firstLineStart,
+                                  const FastLinePositionArray& linePositions,
+                                  IndexingState& state ) const
+{
+    static auto& blockValidateLatency = Metrics::get().histogram( "index.block_validate_us" );
+    static auto& invalidBlocks = Metrics::get().counter( "index.invalid_encoding_blocks" );
+    static auto& invalidLines = Metrics::get().counter( "index.invalid_encoding_lines" );
+
+    if ( !state.encodingValidator->isEnabled() ) {
+        return {};
+    }
+
+    auto result = [ & ] {
+        KLOGG_TRACE_SCOPE_ARG( "index", "validate_block", "offset", blockBeginning );
+        const auto timer = blockValidateLatency.startTimer();
+        return state.encodingValidator->validateBlock( blockBeginning, block, firstLineStart,
+                                                       linePositions );
+    }();
+
+    if ( result.isValid ) {
+        return result;
+    }
+
+    invalidBlocks.add();
+    invalidLines.add( result.invalidLines.size() );
+    LOG_DEBUG << "Block " << blockBeginning << " has " << result.invalidLines.size()
+              << " lines invalid in " << state.fileTextCodec->name().toStdString();
+
+    if ( state.isEncodingForced || state.isEncodingReguessed ) {
+        return result;
+    }
+
+    // The guess was made on the first block, the rest of the file disagrees with it
+    state.isEncodingReguessed = true;
+    const auto encodingGuess = EncodingDetector::getInstance().detectEncoding( block );
+    if ( encodingGuess->mibEnum() == state.fileTextCodec->mibEnum() ) {
+        return result;
+    }
+
+    if ( EncodingParameters( encodingGuess ) != state.encodingParams ) {
+        // Lines are split by the width of the line feed, changing it needs reloading
+        LOG_WARNING << "Block " << blockBeginning << " looks like "
+                    << encodingGuess->name().toStdString() << ", not "
+                    << state.fileTextCodec->name().toStdString();
+        return result;
+    }
+
+    LOG_WARNING << "Encoding guess changed from " << state.fileTextCodec->name().toStdString()
+                << " to " << encodingGuess->name().toStdString() << " at " << blockBeginning;
+    state.encodingGuess = encodingGuess;
+    state.fileTextCodec = encodingGuess;
+    state.encodingParams = EncodingParameters( encodingGuess );
+    state.encodingValidator.emplace( state.encodingParams );
+
+    return result;
+}
+
 std::chrono::microseconds IndexOperation::readFileInBlocks( QFile& file,
-                                                            BlockPrefetcher& blockPrefetcher )
+                                                            BlockPrefetcher& blockPrefetcher,
+                                                            IoScheduler::Stream& stream )
 {
     using namespace std::chrono;
     using clock = high_resolution_clock;
 
     LOG_INFO << "Starting IO thread";
 
+    static auto& blockReadLatency = Metrics::get().histogram( "index.block_read_us" );
+    static auto& bytesRead = Metrics::get().counter( "index.bytes_read" );
+    static auto& blocksInFlight = Metrics::get().gauge( "index.blocks_in_flight" );
+
     microseconds ioDuration{};
     while ( !file.atEnd() ) {
 
-        if ( interruptRequest_ ) {
+        if ( interruptRequest_ || !stream.yield() ) {
             break;
         }
 
         BlockData blockData{ file.pos(), QByteArray{ IndexingBlockSize, Qt::Uninitialized } };
 
         clock::time_point ioT1 = clock::now();
-        const auto readBytes
-            = static_cast<int>( file.read( blockData.second.data(), blockData.second.size() ) );
+        const auto readBytes = [ &file, &blockData ] {
+            KLOGG_TRACE_SCOPE_ARG( "index", "read_block", "offset", blockData.first );
+            return static_cast<int>(
+                file.read( blockData.second.data(), blockData.second.size() ) );
+        }();
 
         if ( readBytes < 0 ) {
             LOG_ERROR << "Reading past the end of file";
@@ -521,11 +988,20 @@ std::chrono::microseconds IndexOperation::readFileInBlocks( QFile& file,
 
         clock::time_point ioT2 = clock::now();
 
-        ioDuration += duration_cast<microseconds>( ioT2 - ioT1 );
+        const auto blockReadDuration = duration_cast<microseconds>( ioT2 - ioT1 );
+        ioDuration += blockReadDuration;
+        blockReadLatency.record( blockReadDuration );
+        bytesRead.add( static_cast<uint64_t>( readBytes ) );
 
         LOG_DEBUG << "Sending block " << blockData.first << " size " << blockData.second.size();
 
-        while ( !blockPrefetcher.try_put( blockData ) && !interruptRequest_ ) {
+        blocksInFlight.add( 1 );
+        KLOGG_TRACE_SCOPE( "index", "queue_block" );
+        while ( !blockPrefetcher.try_put( blockData ) ) {
+            if ( interruptRequest_ ) {
+                blocksInFlight.add( -1 );
+                break;
+            }
             std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
         }
     }
@@ -550,41 +1026,87 @@ void IndexOperation::indexNextBlock( IndexingState& state, const BlockData& bloc
         return;
     }
 
-    IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
-
-    guessEncoding( block, scopedAccessor, state );
+    // Parsing is done without holding the lock, this thread is the only writer
+    // so only publishing the results blocks the readers.
+    guessEncoding( block, state );
 
-    if ( !block.isEmpty() ) {
+    if ( block.isEmpty() ) {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        scopedAccessor.setEncodingGuess( state.encodingGuess );
+    }
+    else {
+        const auto firstLineStart = state.pos;
         const auto linePositions = parseDataBlock( blockBeginning, block, state );
+
+        const auto validation
+            = validateEncoding( blockBeginning, block, firstLineStart, linePositions, state );
         auto maxLength = state.max_length;
         if ( maxLength > std::numeric_limits<LineLength::UnderlyingType>::max() ) {
             LOG_ERROR << "Too long lines " << maxLength;
             maxLength = std::numeric_limits<LineLength::UnderlyingType>::max();
         }
 
-        scopedAccessor.addAll( block,
-                               LineLength( static_cast<LineLength::UnderlyingType>( maxLength ) ),
-                               linePositions, state.encodingGuess );
+        // Timestamps are only looked for in encodings with single byte digits
+        std::vector<OptionalTimestamp> timestamps;
+        const auto hasTimestamps
+            = state.timestampLayout.has_value() && state.encodingParams.lineFeedWidth == 1;
+        if ( hasTimestamps ) {
+            timestamps
+                = parseTimestamps( blockBeginning, block, firstLineStart, linePositions, state );
+        }
+
+        // JSON fields are only looked for in UTF-8 and compatible encodings
+        std::optional<FieldIndex::Batch> fieldValues;
+        if ( state.fieldParser && state.encodingParams.lineFeedWidth == 1 ) {
+            fieldValues
+                = parseFields( blockBeginning, block, firstLineStart, linePositions, state );
+        }
 
         // Update the caller for progress indication
         const auto progress
             = ( state.file_size > 0 ) ? calculateProgress( state.pos, state.file_size ) : 100;
+        bool isProgressChanged = false;
+
+        {
+            IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+
+            scopedAccessor.addAll(
+                block, LineLength( static_cast<LineLength::UnderlyingType>( maxLength ) ),
+                linePositions, state.encodingGuess );
+
+            if ( !validation.invalidLines.empty() ) {
+                scopedAccessor.addInvalidEncodingLines(
+                    LineNumber( scopedAccessor.getNbLines().get() - linePositions.size().get() ),
+                    validation.invalidLines );
+            }
+
+            if ( hasTimestamps ) {
+                scopedAccessor.addTimestamps( timestamps );
+            }
+
+            if ( fieldValues ) {
+                scopedAccessor.addFieldValues( *fieldValues );
+            }
+
+            if ( progress != scopedAccessor.getProgress() ) {
+                scopedAccessor.setProgress( progress );
+                isProgressChanged = true;
+            }
+        }
 
-        if ( progress != scopedAccessor.getProgress() ) {
-            scopedAccessor.setProgress( progress );
+        if ( isProgressChanged ) {
             LOG_DEBUG << "Indexing progress " << progress << ", indexed size " << state.pos;
             Q_EMIT indexingProgressed( progress );
         }
     }
-    else {
-        scopedAccessor.setEncodingGuess( state.encodingGuess );
-    }
 
     LOG_DEBUG << "Indexing block " << blockBeginning << " done";
 }
 
 void IndexOperation::doIndex( LineOffset initialPosition )
 {
+    KLOGG_TRACE_SCOPE_ARG( "index", "index", "offset", initialPosition.get() );
+
     QFile file( fileName_ );
 
     if ( !( file.isOpen() || file.open( QIODevice::ReadOnly ) ) ) {
@@ -610,6 +1132,7 @@ void IndexOperation::doIndex( LineOffset initialPosition )
         IndexingData::ConstAccessor scopedAccessor{ indexing_data_.get() };
 
         state.fileTextCodec = scopedAccessor.getForcedEncoding();
+        state.isEncodingForced = state.fileTextCodec != nullptr;
         if ( !state.fileTextCodec ) {
             state.fileTextCodec = scopedAccessor.getEncodingGuess();
         }
@@ -622,6 +1145,20 @@ void IndexOperation::doIndex( LineOffset initialPosition )
 
     const auto& config = Configuration::get();
     const auto prefetchBufferSize = static_cast<size_t>( config.indexReadBufferSizeMb() );
+    state.timestampLayout = toTimestampLayout( config.timestampFormat() );
+
+    std::vector<std::string> structuredFields;
+    for ( const auto& field : config.structuredFields() ) {
+        structuredFields.push_back( field.trimmed().toStdString() );
+    }
+    if ( !structuredFields.empty() ) {
+        state.fieldParser.emplace( structuredFields );
+    }
+
+    {
+        IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
+        scopedAccessor.setStructuredFields( structuredFields );
+    }
 
     LOG_INFO << "Prefetch buffer " << readableSize( prefetchBufferSize * IndexingBlockSize );
 
@@ -629,15 +1166,28 @@ void IndexOperation::doIndex( LineOffset initialPosition )
     using clock = high_resolution_clock;
     microseconds ioDuration{};
 
+    // Background tabs wait here until the device is free
+    auto stream = IoScheduler::get().openStream( fileName_, interruptRequest_ );
+
     const auto indexingStartTime = clock::now();
 
-    tbb::flow::graph indexingGraph;
+    const auto indexingGraphPtr = IoScheduler::get().createGraph();
+    auto& indexingGraph = *indexingGraphPtr;
     auto blockPrefetcher = tbb::flow::limiter_node<BlockData>( indexingGraph, prefetchBufferSize );
     auto blockQueue = tbb::flow::queue_node<BlockData>( indexingGraph );
 
     auto blockParser = tbb::flow::function_node<BlockData, tbb::flow::continue_msg>(
         indexingGraph, tbb::flow::serial, [ this, &state ]( const BlockData& blockData ) {
-            indexNextBlock( state, blockData );
+            static auto& blockIndexLatency = Metrics::get().histogram( "index.block_parse_us" );
+            static auto& blocksInFlight = Metrics::get().gauge( "index.blocks_in_flight" );
+            {
+                KLOGG_TRACE_SCOPE_ARG( "index", "parse_block", "offset", blockData.first );
+                const auto timer = blockIndexLatency.startTimer();
+                indexNextBlock( state, blockData );
+            }
+            if ( blockData.first >= 0 ) {
+                blocksInFlight.add( -1 );
+            }
             return tbb::flow::continue_msg{};
         } );
 
@@ -646,8 +1196,11 @@ void IndexOperation::doIndex( LineOffset initialPosition )
     tbb::flow::make_edge( blockParser, blockPrefetcher.decrementer() );
 
     file.seek( state.pos );
-    ioDuration = readFileInBlocks( file, blockPrefetcher );
-    indexingGraph.wait_for_all();
+    ioDuration = readFileInBlocks( file, blockPrefetcher, stream );
+    {
+        KLOGG_TRACE_SCOPE( "index", "wait_for_graph" );
+        indexingGraph.wait_for_all();
+    }
 
     IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
 
@@ -662,6 +1215,21 @@ void IndexOperation::doIndex( LineOffset initialPosition )
         line_position.setFakeFinalLF();
 
         scopedAccessor.addAll( {}, 0_length, line_position, state.encodingGuess );
+
+        if ( state.timestampLayout && state.encodingParams.lineFeedWidth == 1 ) {
+            scopedAccessor.addTimestamps(
+                { parseTimestamp( state.lineHead, *state.timestampLayout ) } );
+        }
+
+        if ( state.fieldParser && state.encodingParams.lineFeedWidth == 1 ) {
+            FieldIndex::Batch values( state.fieldParser->fields().size() );
+            state.fieldParser->parse( state.fieldLine,
+                                      [ &values ]( size_t field, std::string_view value ) {
+                                          values.add( field, value );
+                                      } );
+            values.endLine();
+            scopedAccessor.addFieldValues( values );
+        }
     }
 
     const auto endFilePos = file.pos();
@@ -693,6 +1261,8 @@ void IndexOperation::doIndex( LineOffset initialPosition )
              << readableSize( static_cast<uint64_t>( scopedAccessor.allocatedSize() ) );
     LOG_INFO << "Indexed lines " << scopedAccessor.getNbLines();
     LOG_INFO << "Max line " << scopedAccessor.getMaxLength();
+    LOG_INFO << "Lines invalid in the encoding "
+             << scopedAccessor.getInvalidEncodingLines().cardinality();
     LOG_INFO << "Indexing perf "
              << ( 1000.f * 1000.f * static_cast<float>( state.file_size )
                   / static_cast<float>( duration.count() ) )
@@ -700,6 +1270,17 @@ void IndexOperation::doIndex( LineOffset initialPosition )
              << " MiB/s";
     LOG_INFO << "Memory usage " << readableSize( usedMemory() );
 
+    const auto indexedBytes = state.file_size - initialPosition.get();
+    auto& metrics = Metrics::get();
+    metrics.counter( "index.runs" ).add();
+    metrics.counter( "index.bytes" ).add( static_cast<uint64_t>( indexedBytes ) );
+    metrics.histogram( "index.duration_us" ).record( duration );
+    metrics.histogram( "index.io_us" ).record( ioDuration );
+    if ( duration.count() > 0 ) {
+        metrics.gauge( "index.last_throughput_bps" )
+            .set( static_cast<int64_t>( 1000 * 1000 * indexedBytes / duration.count() ) );
+    }
+
     if ( interruptRequest_ ) {
         scopedAccessor.clear();
     }
@@ -731,6 +1312,16 @@ OperationResult FullIndexOperation::run()
             IndexingData::MutateAccessor scopedAccessor{ indexing_data_.get() };
             scopedAccessor.clear();
             scopedAccessor.forceEncoding( forcedEncoding_ );
+
+            const auto compactIndexMinFileSize
+                = static_cast<qint64>( Configuration::get().compactIndexMinFileSizeGb() ) << 30;
+            const auto fileSize = QFileInfo( fileName_ ).size();
+            if ( compactIndexMinFileSize > 0 && fileSize >= compactIndexMinFileSize ) {
+                LOG_INFO << "Using Elias-Fano line index for file of "
+                         << readableSize( static_cast<uint64_t>( fileSize ) );
+                scopedAccessor.setLinePositionEncoding(
+                    CompressedLinePositionStorage::Encoding::EliasFano );
+            }
         }
 
         doIndex( 0_offset );
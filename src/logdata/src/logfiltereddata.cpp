@@ -43,6 +43,7 @@
 #include "log.h"
 
 #include <KDSignalThrottler.h>
+#include <QFile>
 #include <QString>
 #include <QTimer>
 
@@ -50,8 +51,12 @@
 #include <cassert>
 #include <cstdint>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -59,8 +64,10 @@
 #include "logdata.h"
 #include "logfiltereddata.h"
 
+#include "booleansearchplan.h"
 #include "configuration.h"
 #include "readablesize.h"
+#include "runnable_lambda.h"
 #include "synchronization.h"
 
 // Usual constructor: just copy the data, the search is started by runSearch()
@@ -90,6 +97,22 @@ LogFilteredData::LogFilteredData( const LogData* logData )
 
     connect( &searchProgressThrottler_, &KDToolBox::KDGenericSignalThrottler::triggered, this,
              &LogFilteredData::handleSearchProgressedThrottled );
+
+    searchResultsCachePool_.setMaxThreadCount( 1 );
+
+    MemoryBudget::Consumer memoryConsumer;
+    memoryConsumer.owner = logData;
+    memoryConsumer.evictCaches = [ this ] { return evictSearchResultsCache(); };
+    memoryConsumer_ = MemoryBudget::get().registerConsumer( std::move( memoryConsumer ) );
+}
+
+LogFilteredData::~LogFilteredData()
+{
+    MemoryBudget::get().unregisterConsumer( memoryConsumer_ );
+    interruptSearch();
+    saveSearchResultsCache();
+    // Finish writing the cache while the application is still there
+    searchResultsCachePool_.waitForDone();
 }
 
 void LogFilteredData::runSearch( const RegularExpressionPattern& regExp )
@@ -97,39 +120,182 @@ void LogFilteredData::runSearch( const RegularExpressionPattern& regExp )
     runSearch( regExp, 0_lnum, LineNumber( getNbTotalLines().get() ) );
 }
 
+void LogFilteredData::runSearchInTimeRange( const RegularExpressionPattern& regExp,
+                                            LineNumber startLine, LineNumber endLine,
+                                            Timestamp from, Timestamp to,
+                                            OptionalLineNumber focusLine )
+{
+    if ( !sourceLogData_->hasTimestamps() ) {
+        runSearch( regExp, startLine, endLine, focusLine );
+        return;
+    }
+
+    currentTimeRange_ = std::make_pair( from, to );
+    const auto [ rangeStart, rangeEnd ] = clampToTimeRange( startLine, endLine );
+
+    LOG_INFO << "Time range " << from << " - " << to << " is lines " << rangeStart << " - "
+             << rangeEnd;
+
+    runSearch( regExp, rangeStart, rangeEnd, focusLine );
+    // runSearch clears the previous search, time range included
+    currentTimeRange_ = std::make_pair( from, to );
+}
+
+std::pair<LineNumber, LineNumber> LogFilteredData::clampToTimeRange( LineNumber startLine,
+                                                                     LineNumber endLine ) const
+{
+    if ( !currentTimeRange_ ) {
+        return { startLine, endLine };
+    }
+
+    const auto [ from, to ] = *currentTimeRange_;
+    const auto nbLines = LineNumber( getNbTotalLines().get() );
+
+    // Both ends are found by binary search in the timestamp index
+    const auto firstLine = sourceLogData_->findLineByTimestamp( from ).value_or( nbLines );
+    const auto lastLine
+        = to < std::numeric_limits<Timestamp>::max()
+              ? sourceLogData_->findLineByTimestamp( to + 1 ).value_or( nbLines )
+              : nbLines;
+
+    const auto rangeStart = std::max( startLine, firstLine );
+    return { rangeStart, std::max( rangeStart, std::min( endLine, lastLine ) ) };
+}
+
+void LogFilteredData::runFieldSearch( const FieldQuery& query, LineNumber startLine,
+                                      LineNumber endLine )
+{
+    LOG_DEBUG << "Entering runFieldSearch";
+
+    clearSearch();
+    currentFieldQuery_ = query;
+
+    attachReader();
+    workerThread_.searchFields( query, startLine, endLine );
+}
+
 // Run the search and send newDataAvailable() signals.
 void LogFilteredData::runSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
-                                 LineNumber endLine )
+                                 LineNumber endLine, OptionalLineNumber focusLine )
 {
     LOG_DEBUG << "Entering runSearch";
 
-    const auto& config = Configuration::get();
-
     clearSearch();
     currentRegExp_ = regExp;
     currentSearchKey_ = makeCacheKey( regExp, startLine, endLine );
     LOG_INFO << "Search cache key: " << regExp.pattern << "_" << startLine.get() << "_"
              << endLine.get();
 
+    if ( Configuration::get().useSearchResultsCache() && loadSearchResultsCache() ) {
+        LOG_INFO << "Search starts once the results cache is loaded";
+        pendingSearch_ = PendingSearch{ startLine, endLine, focusLine };
+        return;
+    }
+
+    startSearch( startLine, endLine, focusLine );
+}
+
+void LogFilteredData::startSearch( LineNumber startLine, LineNumber endLine,
+                                   OptionalLineNumber focusLine )
+{
+    const auto& regExp = currentRegExp_;
+    const auto& config = Configuration::get();
+
     bool shouldRunSearch = true;
     if ( config.useSearchResultsCache() ) {
         const auto cachedResults = searchResultsCache_.find( currentSearchKey_ );
-        if ( cachedResults != std::end( searchResultsCache_ ) ) {
+        if ( cachedResults ) {
             LOG_INFO << "Got result from cache";
             shouldRunSearch = false;
-            matching_lines_ = cachedResults->second.matching_lines;
-            maxLength_ = cachedResults->second.maxLength;
+            matching_lines_ = cachedResults->matching_lines;
+            maxLength_ = cachedResults->maxLength;
 
             marks_and_matches_ = matching_lines_ | marks_;
+            updateMemoryUsage();
 
             Q_EMIT searchProgressed( LinesCount( matching_lines_.cardinality() ), 100, startLine );
         }
+        else if ( regExp.isBoolean ) {
+            currentSearchPlan_ = planBooleanSearch( regExp, startLine, endLine );
+        }
+    }
+
+    if ( currentSearchPlan_ && currentSearchPlan_->isComplete() ) {
+        LOG_INFO << "Combining cached results of sub-patterns";
+        shouldRunSearch = false;
+
+        const auto searchEnd = qMin( endLine, LineNumber( getNbTotalLines().get() ) );
+        auto combined = currentSearchPlan_->combine( startLine, searchEnd,
+                                                     sourceLogData_->getMaxLength() );
+        currentSearchPlan_.reset();
+
+        matching_lines_ = std::move( combined.matchingLines );
+        maxLength_ = combined.maxLength;
+        nbLinesProcessed_ = LinesCount( searchEnd.get() );
+
+        marks_and_matches_ = matching_lines_ | marks_;
+        updateSearchResultsCache();
+
+        Q_EMIT searchProgressed( LinesCount( matching_lines_.cardinality() ), 100, startLine );
     }
 
     if ( shouldRunSearch ) {
         attachReader();
-        workerThread_.search( currentRegExp_, startLine, endLine );
+        workerThread_.search( currentRegExp_, startLine, endLine, currentSearchPlan_,
+                              focusLine );
+    }
+}
+
+std::shared_ptr<const BooleanSearchPlan>
+LogFilteredData::planBooleanSearch( const RegularExpressionPattern& regExp, LineNumber startLine,
+                                    LineNumber endLine )
+{
+    auto plan = std::make_shared<const BooleanSearchPlan>(
+        regExp,
+        [ this, startLine, endLine ](
+            const RegularExpressionPattern& subPattern ) -> std::optional<SubPatternResults> {
+            const auto cachedResults
+                = searchResultsCache_.find( makeCacheKey( subPattern, startLine, endLine ) );
+            if ( !cachedResults ) {
+                return {};
+            }
+            return SubPatternResults{ cachedResults->matching_lines, cachedResults->maxLength };
+        } );
+
+    if ( !plan->isValid() ) {
+        return {};
+    }
+
+    return plan;
+}
+
+void LogFilteredData::cacheSubPatternResults()
+{
+    const auto& config = Configuration::get();
+    if ( !config.useSearchResultsCache() || !currentSearchPlan_
+         || currentSearchKey_ == SearchCacheKey{} ) {
+        return;
     }
+
+    const uint64_t maxCacheSize = config.searchResultsCacheSizeMb() * 1024ull * 1024ull;
+    const auto startLine = LineNumber( std::get<1>( currentSearchKey_ ) );
+    const auto endLine = LineNumber( std::get<2>( currentSearchKey_ ) );
+
+    const auto& subPatterns = currentSearchPlan_->subPatterns();
+    const auto& missing = currentSearchPlan_->missingSubPatterns();
+    auto results = workerThread_.getSubPatternResults();
+    for ( auto index = 0u; index < missing.size() && index < results.size(); ++index ) {
+        const auto& subPattern = subPatterns[ missing[ index ] ];
+        LOG_INFO << "LogFilteredData: caching results for sub-pattern " << subPattern.pattern;
+
+        auto& result = results[ index ];
+        searchResultsCache_.insert( makeCacheKey( subPattern, startLine, endLine ),
+                                    { std::move( result.matchingLines ), result.maxLength },
+                                    maxCacheSize );
+    }
+
+    currentSearchPlan_.reset();
+    updateMemoryUsage();
 }
 
 void LogFilteredData::updateSearch( LineNumber startLine, LineNumber endLine )
@@ -137,6 +303,21 @@ void LogFilteredData::updateSearch( LineNumber startLine, LineNumber endLine )
     LOG_DEBUG << "Entering updateSearch";
 
     currentSearchKey_ = {};
+    currentSearchPlan_.reset();
+
+    // Lines added meanwhile are searched when it starts
+    if ( pendingSearch_ ) {
+        return;
+    }
+
+    if ( currentFieldQuery_ ) {
+        attachReader();
+        workerThread_.searchFields( *currentFieldQuery_, startLine, endLine,
+                                    LineNumber( nbLinesProcessed_.get() ) );
+        return;
+    }
+
+    std::tie( startLine, endLine ) = clampToTimeRange( startLine, endLine );
 
     attachReader();
     workerThread_.updateSearch( currentRegExp_, startLine, endLine,
@@ -147,6 +328,12 @@ void LogFilteredData::interruptSearch()
 {
     LOG_DEBUG << "Entering interruptSearch";
 
+    if ( pendingSearch_ ) {
+        const auto initialLine = pendingSearch_->startLine;
+        pendingSearch_.reset();
+        Q_EMIT searchProgressed( 0_lcount, 100, initialLine );
+    }
+
     workerThread_.interrupt();
 }
 
@@ -155,6 +342,9 @@ void LogFilteredData::clearSearch( bool dropCache )
     interruptSearch();
 
     currentRegExp_ = {};
+    currentFieldQuery_ = {};
+    currentTimeRange_ = {};
+    currentSearchPlan_.reset();
     matching_lines_ = {};
     marks_and_matches_ = marks_;
     maxLength_ = 0_length;
@@ -162,7 +352,18 @@ void LogFilteredData::clearSearch( bool dropCache )
 
     if ( dropCache ) {
         searchResultsCache_.clear();
+
+        // A load in progress would bring the dropped results back
+        ++searchResultsCacheGeneration_;
+        isSearchResultsCacheLoading_ = false;
+
+        // Removed after the saves already queued, these would write it again
+        const auto cachePath = SearchResultsCache::cacheFilePath( sourceLogData_->getFileName() );
+        searchResultsCachePool_.start(
+            createRunnable( [ cachePath ] { QFile::remove( cachePath ); } ) );
     }
+
+    updateMemoryUsage();
 }
 
 LineNumber LogFilteredData::getMatchingLineNumber( LineNumber matchNum ) const
@@ -196,7 +397,26 @@ LinesCount LogFilteredData::getNbMarks() const
     return LinesCount( marks_.cardinality() );
 }
 
-LogFilteredData::LineType LogFilteredData::lineTypeByIndex( LineNumber index ) const
+LogFilteredData::SearchResultArray LogFilteredData::getMatchingLines( LineNumber firstIndex,
+                                                     LinesCount count ) const
+{
+    SearchResultArray lines;
+    if ( count.get() == 0 ) {
+        return lines;
+    }
+
+    const auto firstLine = findLogDataLine( firstIndex );
+    const auto lastLine = findLogDataLine( firstIndex + count - 1_lcount );
+    if ( firstLine == maxValue<LineNumber>() || lastLine == maxValue<LineNumber>() ) {
+        return lines;
+    }
+
+    lines.addRange( firstLine.get(), lastLine.get() + 1 );
+    lines &= currentResultArray();
+    return lines;
+}
+
+LineType LogFilteredData::lineTypeByIndex( LineNumber index ) const
 {
     return lineTypeByLine( findLogDataLine( index ) );
 }
@@ -256,6 +476,44 @@ void LogFilteredData::addMark( LineNumber line )
     }
 }
 
+void LogFilteredData::toggleMarks( const SearchResultArray& lines )
+{
+    if ( lines.isEmpty() ) {
+        return;
+    }
+
+    if ( lines.isSubset( marks_ ) ) {
+        const auto removedLength = maxLineLength( lines );
+        marks_ -= lines;
+        if ( removedLength >= maxLengthMarks_ ) {
+            maxLengthMarks_ = maxLineLength( marks_ );
+        }
+    }
+    else {
+        marks_ |= lines;
+        maxLengthMarks_ = qMax( maxLengthMarks_, maxLineLength( lines ) );
+    }
+
+    marks_and_matches_ = matching_lines_ | marks_;
+}
+
+LineLength LogFilteredData::maxLineLength( const SearchResultArray& lines ) const
+{
+    // Measuring each line means reading it, past this
+    // the longest line of the file is good enough.
+    static constexpr auto MaxMeasuredLines = 10000u;
+
+    if ( lines.cardinality() > MaxMeasuredLines ) {
+        return sourceLogData_->getMaxLength();
+    }
+
+    auto maxLength = 0_length;
+    for ( const auto line : lines ) {
+        maxLength = qMax( maxLength, sourceLogData_->getLineLength( LineNumber( line ) ) );
+    }
+    return maxLength;
+}
+
 bool LogFilteredData::isLineMarked( LineNumber line ) const
 {
     return marks_.contains( line.get() );
@@ -358,38 +616,134 @@ void LogFilteredData::updateSearchResultsCache()
         return;
     }
 
-    const uint64_t maxCacheLines = config.searchResultsCacheLines();
+    const uint64_t maxCacheSize = config.searchResultsCacheSizeMb() * 1024ull * 1024ull;
+
+    LOG_INFO << "LogFilteredData: caching results for key "
+             << std::get<0>( currentSearchKey_ ).pattern << "_"
+             << std::get<1>( currentSearchKey_ ) << "_" << std::get<2>( currentSearchKey_ );
 
-    if ( matching_lines_.cardinality() > maxCacheLines ) {
+    if ( !searchResultsCache_.insert( currentSearchKey_, { matching_lines_, maxLength_ },
+                                      maxCacheSize ) ) {
         LOG_DEBUG << "LogFilteredData: too many matches to place in cache";
     }
     else {
-        LOG_INFO << "LogFilteredData: caching results for key "
-                 << std::get<0>( currentSearchKey_ ).pattern << "_"
-                 << std::get<1>( currentSearchKey_ ) << "_" << std::get<2>( currentSearchKey_ );
-
-        searchResultsCache_[ currentSearchKey_ ] = { matching_lines_, maxLength_ };
-        auto cacheSize = std::accumulate( searchResultsCache_.cbegin(), searchResultsCache_.cend(),
-                                          uint64_t{ 0 }, []( const auto& acc, const auto& next ) {
-                                              return acc + next.second.matching_lines.cardinality();
-                                          } );
+        searchResultsCachePath_
+            = SearchResultsCache::cacheFilePath( sourceLogData_->getFileName() );
+        searchResultsCacheHash_ = sourceLogData_->getIndexedHash();
+    }
 
-        LOG_INFO << "LogFilteredData: cache size " << cacheSize;
+    LOG_INFO << "LogFilteredData: cache size " << searchResultsCache_.sizeInBytes();
+    updateMemoryUsage();
+}
 
-        auto cachedResult = std::begin( searchResultsCache_ );
-        while ( cachedResult != std::end( searchResultsCache_ ) && cacheSize > maxCacheLines ) {
+bool LogFilteredData::loadSearchResultsCache()
+{
+    // Loading replaces the cache content, once there are results
+    // of this session they are kept
+    if ( isSearchResultsCacheLoading_ ) {
+        return true;
+    }
+    if ( isSearchResultsCacheLoaded_ || !searchResultsCache_.empty() ) {
+        return false;
+    }
 
-            if ( cachedResult->first == currentSearchKey_ ) {
-                ++cachedResult;
-                continue;
-            }
+    const auto& config = Configuration::get();
+    if ( !config.persistSearchResultsCache() ) {
+        return false;
+    }
 
-            cacheSize -= cachedResult->second.matching_lines.cardinality();
-            cachedResult = searchResultsCache_.erase( cachedResult );
+    const auto maxCacheSize = config.searchResultsCacheSizeMb() * 1024ull * 1024ull;
+    const auto cachePath = SearchResultsCache::cacheFilePath( sourceLogData_->getFileName() );
+    const auto indexedHash = sourceLogData_->getIndexedHash();
+    const auto generation = searchResultsCacheGeneration_;
+
+    isSearchResultsCacheLoading_ = true;
+    searchResultsCachePool_.start( createRunnable( [ this, cachePath, indexedHash, maxCacheSize,
+                                                     generation ] {
+        auto cache = std::make_shared<SearchResultsCache>();
+        if ( !cache->load( cachePath, indexedHash, maxCacheSize ) ) {
+            cache.reset();
         }
+
+        QMetaObject::invokeMethod(
+            this,
+            [ this, cache, cachePath, indexedHash, generation ] {
+                handleSearchResultsCacheLoaded( generation, cache, cachePath, indexedHash );
+            },
+            Qt::QueuedConnection );
+    } ) );
+
+    return true;
+}
+
+void LogFilteredData::handleSearchResultsCacheLoaded( uint64_t generation,
+                                                      std::shared_ptr<SearchResultsCache> cache,
+                                                      const QString& cachePath,
+                                                      const IndexedHash& indexedHash )
+{
+    if ( generation != searchResultsCacheGeneration_ ) {
+        LOG_INFO << "Search results cache was dropped while loading";
+        return;
+    }
+
+    isSearchResultsCacheLoading_ = false;
+
+    // Results of this session cached meanwhile are more recent
+    if ( cache && searchResultsCache_.empty() ) {
+        isSearchResultsCacheLoaded_ = true;
+        searchResultsCache_ = std::move( *cache );
+        searchResultsCachePath_ = cachePath;
+        searchResultsCacheHash_ = indexedHash;
+        updateMemoryUsage();
+    }
+
+    if ( pendingSearch_ ) {
+        const auto search = *pendingSearch_;
+        pendingSearch_.reset();
+        startSearch( search.startLine, search.endLine, search.focusLine );
     }
 }
 
+void LogFilteredData::saveSearchResultsCache()
+{
+    const auto& config = Configuration::get();
+    if ( !config.useSearchResultsCache() || !config.persistSearchResultsCache()
+         || searchResultsCachePath_.isEmpty() || searchResultsCache_.empty() ) {
+        searchResultsCache_.clear();
+        return;
+    }
+
+    const auto maxCacheSize = config.searchResultsCacheSizeMb() * 1024ull * 1024ull;
+    searchResultsCachePool_.start( createRunnable(
+        [ cache = std::exchange( searchResultsCache_, {} ), cachePath = searchResultsCachePath_,
+          indexedHash = searchResultsCacheHash_, maxCacheSize ] {
+            cache.save( cachePath, indexedHash );
+            SearchResultsCache::prune( maxCacheSize );
+        } ) );
+}
+
+uint64_t LogFilteredData::evictSearchResultsCache()
+{
+    const auto freed = searchResultsCache_.sizeInBytes();
+
+    saveSearchResultsCache();
+    // Will be loaded back from disk by the next search
+    isSearchResultsCacheLoaded_ = false;
+
+    updateMemoryUsage();
+    return freed;
+}
+
+void LogFilteredData::updateMemoryUsage()
+{
+    auto& memoryBudget = MemoryBudget::get();
+    memoryBudget.update( memoryConsumer_, MemoryBudget::Usage::SearchResults,
+                         matching_lines_.getSizeInBytes( false )
+                             + marks_and_matches_.getSizeInBytes( false ) );
+    memoryBudget.update( memoryConsumer_, MemoryBudget::Usage::SearchCache,
+                         searchResultsCache_.sizeInBytes() );
+}
+
 //
 // Q_SLOTS:
 //
@@ -409,6 +763,7 @@ void LogFilteredData::handleSearchProgressed( LinesCount nbMatches, int progress
     if ( progress == 100
          && nbLinesProcessed_.get() == getExpectedSearchEnd( currentSearchKey_ ).get() ) {
         updateSearchResultsCache();
+        cacheSubPatternResults();
     }
 
     {
@@ -420,6 +775,7 @@ void LogFilteredData::handleSearchProgressed( LinesCount nbMatches, int progress
 
     if ( progress == 100 ) {
         detachReader();
+        updateMemoryUsage();
 
         LOG_INFO << "Matches size " << readableSize( matching_lines_.getSizeInBytes( false ) )
                  << ", marks size " << readableSize( marks_.getSizeInBytes( false ) )
@@ -497,33 +853,135 @@ QString LogFilteredData::doGetExpandedLineString( LineNumber index ) const
 // Implementation of the virtual function.
 std::vector<QString> LogFilteredData::doGetLines( LineNumber first_line, LinesCount number ) const
 {
-    return doGetLines( first_line, number,
-                       [ this ]( const auto& line ) { return doGetLineString( line ); } );
+    return doGetLines( first_line, number, [ this ]( const auto& line, const auto& count ) {
+        return sourceLogData_->getLines( line, count );
+    } );
 }
 
 // Implementation of the virtual function.
 std::vector<QString> LogFilteredData::doGetExpandedLines( LineNumber first_line,
                                                           LinesCount number ) const
 {
-    return doGetLines( first_line, number,
-                       [ this ]( const auto& line ) { return doGetExpandedLineString( line ); } );
+    return doGetLines( first_line, number, [ this ]( const auto& line, const auto& count ) {
+        return sourceLogData_->getExpandedLines( line, count );
+    } );
+}
+
+void LogFilteredData::doPrefetchLines( LineNumber first, LinesCount number ) const
+{
+    // Read the matching lines and some context around them in the source file,
+    // where the main view will go when a match is selected.
+    static constexpr auto MaxPrefetchedMatches = 1000u;
+    static constexpr auto MatchContext = 32_lcount;
+
+    const auto nbMatches = doGetNbLine().get();
+    const auto lastIndex = std::min( { first.get() + number.get(), nbMatches,
+                                       first.get() + MaxPrefetchedMatches } );
+
+    std::vector<LogData::LineRange> ranges;
+    for ( auto index = first.get(); index < lastIndex; ++index ) {
+        const auto line = findLogDataLine( LineNumber( index ) );
+        if ( line == maxValue<LineNumber>() ) {
+            break;
+        }
+
+        const auto rangeStart = line - MatchContext;
+        const auto rangeEnd = line + MatchContext;
+        if ( !ranges.empty() && rangeStart <= ranges.back().first + ranges.back().second ) {
+            ranges.back().second = rangeEnd - ranges.back().first;
+        }
+        else {
+            ranges.emplace_back( rangeStart, rangeEnd - rangeStart );
+        }
+    }
+
+    sourceLogData_->prefetchLineRanges( ranges );
 }
 
-std::vector<QString>
-LogFilteredData::doGetLines( LineNumber first_line, LinesCount number,
-                             const std::function<QString( LineNumber )>& lineGetter ) const
+std::vector<QString> LogFilteredData::doGetLines(
+    LineNumber first_line, LinesCount number,
+    const std::function<std::vector<QString>( LineNumber, LinesCount )>& linesGetter ) const
 {
-    std::vector<LineNumber::UnderlyingType> lineNumbers( number.get() );
-    std::iota( lineNumbers.begin(), lineNumbers.end(), first_line.get() );
+    std::vector<QString> lines;
+    lines.reserve( number.get() );
 
-    std::vector<QString> lines( number.get() );
-    std::transform(
-        lineNumbers.cbegin(), lineNumbers.cend(), lines.begin(),
-        [ &lineGetter ]( const auto& line ) { return lineGetter( LineNumber( line ) ); } );
+    forEachSourceRun( first_line, number, [ & ]( LineNumber runStart, LinesCount runLength ) {
+        auto runLines = linesGetter( runStart, runLength );
+        runLines.resize( runLength.get() );
+        lines.insert( lines.end(), std::make_move_iterator( runLines.begin() ),
+                      std::make_move_iterator( runLines.end() ) );
+    } );
 
     return lines;
 }
 
+std::vector<AbstractLogData::LineWindow>
+LogFilteredData::doGetLineWindows( LineNumber first, LinesCount number, int firstColumn,
+                                   int nbColumns ) const
+{
+    std::vector<LineWindow> windows;
+    windows.reserve( number.get() );
+
+    forEachSourceRun( first, number, [ & ]( LineNumber runStart, LinesCount runLength ) {
+        auto runWindows
+            = sourceLogData_->getLineWindows( runStart, runLength, firstColumn, nbColumns );
+        runWindows.resize( runLength.get() );
+        windows.insert( windows.end(), std::make_move_iterator( runWindows.begin() ),
+                        std::make_move_iterator( runWindows.end() ) );
+    } );
+
+    return windows;
+}
+
+const AbstractLogData* LogFilteredData::doGetSourceData() const
+{
+    return sourceLogData_;
+}
+
+AbstractLogData::SourceRuns LogFilteredData::doGetSourceRuns( LineNumber first,
+                                                              LinesCount number ) const
+{
+    const auto nbLines = doGetNbLine();
+    if ( first >= nbLines ) {
+        return {};
+    }
+
+    SourceRuns runs;
+    forEachSourceRun( first, std::min( number, nbLines - LinesCount( first.get() ) ),
+                      [ &runs ]( LineNumber runStart, LinesCount runLength ) {
+                          runs.emplace_back( runStart, runLength );
+                      } );
+    return runs;
+}
+
+void LogFilteredData::forEachSourceRun(
+    LineNumber first, LinesCount number,
+    const std::function<void( LineNumber, LinesCount )>& readRun ) const
+{
+    // Matches are often consecutive in the source file,
+    // read each run of lines in one go instead of line by line.
+    LineNumber runStart;
+    auto runLength = 0_lcount;
+
+    for ( auto index = first.get(); index < first.get() + number.get(); ++index ) {
+        const auto line = findLogDataLine( LineNumber( index ) );
+        if ( runLength.get() > 0 && line == runStart + runLength ) {
+            ++runLength;
+        }
+        else {
+            if ( runLength.get() > 0 ) {
+                readRun( runStart, runLength );
+            }
+            runStart = line;
+            runLength = 1_lcount;
+        }
+    }
+
+    if ( runLength.get() > 0 ) {
+        readRun( runStart, runLength );
+    }
+}
+
 // Implementation of the virtual function.
 LinesCount LogFilteredData::doGetNbLine() const
 {
@@ -544,6 +1002,22 @@ LineLength LogFilteredData::doGetLineLength( LineNumber lineNum ) const
     return sourceLogData_->getLineLength( line );
 }
 
+// Implementation of the virtual function.
+std::vector<LineLength> LogFilteredData::doGetLineLengths( LineNumber first,
+                                                          LinesCount number ) const
+{
+    std::vector<LineLength> lengths;
+    lengths.reserve( number.get() );
+
+    forEachSourceRun( first, number, [ & ]( LineNumber runStart, LinesCount runLength ) {
+        auto runLengths = sourceLogData_->getLineLengths( runStart, runLength );
+        runLengths.resize( runLength.get() );
+        lengths.insert( lengths.end(), runLengths.begin(), runLengths.end() );
+    } );
+
+    return lengths;
+}
+
 void LogFilteredData::doSetDisplayEncoding( const char* encoding )
 {
     LOG_DEBUG << "AbstractLogData::setDisplayEncoding: " << encoding;
@@ -36,9 +36,12 @@
  * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <exception>
+#include <optional>
 #include <qsemaphore.h>
 #include <qthreadpool.h>
 #include <stdexcept>
@@ -51,18 +54,136 @@
 
 #include "configuration.h"
 #include "dispatch_to.h"
+#include "ioscheduler.h"
 #include "issuereporter.h"
 #include "log.h"
+#include "metrics.h"
 #include "overload_visitor.h"
 #include "progress.h"
 #include "runnable_lambda.h"
+#include "tracing.h"
 
+#include "booleansearchplan.h"
+#include "fieldindex.h"
+#include "jsonfieldparser.h"
 #include "logdata.h"
 #include "regularexpression.h"
 
 #include "logfiltereddataworker.h"
 
 namespace {
+// Chunks are sized in bytes, so that matching one takes about
+// TargetChunkMatchTime whatever the length of the lines is. Until
+// enough was matched to estimate the speed chunks are InitialChunkBytes.
+constexpr qint64 InitialChunkBytes = 1024 * 1024;
+constexpr qint64 MinChunkBytes = 64 * 1024;
+constexpr qint64 MaxChunkBytes = 16 * 1024 * 1024;
+constexpr auto TargetChunkMatchTime = std::chrono::microseconds{ 10000 };
+constexpr auto MinMatchTimeForEstimate = std::chrono::microseconds{ 2000 };
+constexpr auto MaxChunkLines = 1048576_lcount;
+
+// Reading beyond a few threads doesn't make even fast disks faster
+constexpr uint32_t MaxReadersCount = 4;
+
+// Field search candidates checked between progress reports
+constexpr uint64_t FieldCandidatesBatch = 1000;
+// Measuring each line means reading it, past this
+// the longest line of the file is good enough.
+constexpr uint64_t MaxMeasuredLines = 10000;
+
+// Matching speed measured by matchers, read by the reader
+class ChunkSizeEstimator {
+  public:
+    void addMatchedChunk( qint64 bytes, std::chrono::microseconds duration )
+    {
+        matchedBytes_.fetch_add( bytes, std::memory_order_relaxed );
+        matchDuration_.fetch_add( duration.count(), std::memory_order_relaxed );
+    }
+
+    qint64 nextChunkBytes() const
+    {
+        const auto matchDuration = matchDuration_.load( std::memory_order_relaxed );
+        if ( matchDuration < MinMatchTimeForEstimate.count() ) {
+            return InitialChunkBytes;
+        }
+
+        const auto bytesPerMicrosecond
+            = static_cast<double>( matchedBytes_.load( std::memory_order_relaxed ) )
+              / static_cast<double>( matchDuration );
+        return std::clamp(
+            static_cast<qint64>( bytesPerMicrosecond
+                                 * static_cast<double>( TargetChunkMatchTime.count() ) ),
+            MinChunkBytes, MaxChunkBytes );
+    }
+
+  private:
+    std::atomic<qint64> matchedBytes_{ 0 };
+    std::atomic<std::chrono::microseconds::rep> matchDuration_{ 0 };
+};
+
+// Decides which lines are scanned next. Without a focus line the range is
+// scanned from its beginning, otherwise it is scanned from the focus line
+// outwards, alternating chunks after and before the lines already planned.
+class ScanPlanner {
+  public:
+    using Chunk = std::pair<LineNumber, LinesCount>;
+
+    ScanPlanner( const LogData& logData, LineNumber begin, LineNumber end,
+                 OptionalLineNumber focusLine )
+        : logData_( logData )
+        , begin_( begin )
+        , end_( end )
+        , forward_( focusLine ? qMin( qMax( *focusLine, begin ), end ) : begin )
+        , backward_( forward_ )
+    {
+    }
+
+    // Returns an empty optional when all the lines have been planned
+    std::optional<Chunk> nextChunk( qint64 chunkBytes )
+    {
+        const auto hasForward = forward_ < end_;
+        const auto hasBackward = backward_ > begin_;
+        if ( !hasForward && !hasBackward ) {
+            return {};
+        }
+
+        const auto goBackward = hasBackward && ( !hasForward || backwardTurn_ );
+        backwardTurn_ = !backwardTurn_;
+
+        if ( goBackward ) {
+            const auto linesInChunk = logData_.getLinesCountInBytesBefore(
+                backward_, qMin( MaxChunkLines, backward_ - begin_ ), chunkBytes );
+            if ( linesInChunk.get() == 0 ) {
+                return {};
+            }
+
+            backward_ = backward_ - linesInChunk;
+            return Chunk{ backward_, linesInChunk };
+        }
+
+        const auto linesInChunk = logData_.getLinesCountInBytes(
+            forward_, qMin( MaxChunkLines, end_ - forward_ ), chunkBytes );
+        if ( linesInChunk.get() == 0 ) {
+            return {};
+        }
+
+        const auto chunkStart = forward_;
+        forward_ = forward_ + linesInChunk;
+        return Chunk{ chunkStart, linesInChunk };
+    }
+
+  private:
+    const LogData& logData_;
+    const LineNumber begin_;
+    const LineNumber end_;
+
+    // Next line to scan after the focus line
+    LineNumber forward_;
+    // Line after the next chunk to scan before the focus line
+    LineNumber backward_;
+    bool backwardTurn_ = false;
+};
+
 struct PartialSearchResults {
     PartialSearchResults() = default;
 
@@ -76,13 +197,16 @@ struct PartialSearchResults {
 
     LineNumber chunkStart;
     LinesCount processedLines;
+
+    std::vector<SubPatternResults> subPatternMatches;
 };
 
 struct SearchBlockData {
     SearchBlockData() = default;
-    SearchBlockData( LineNumber start, LogData::RawLines blockLines )
-        : chunkStart( start )
-        , lines( std::move( blockLines ) )
+    SearchBlockData( size_t chunkSequence, LineNumber start, LinesCount count )
+        : sequence( chunkSequence )
+        , chunkStart( start )
+        , linesCount( count )
     {
     }
 
@@ -92,7 +216,10 @@ struct SearchBlockData {
     SearchBlockData& operator=( const SearchBlockData& ) = delete;
     SearchBlockData& operator=( SearchBlockData&& ) = default;
 
+    // Chunks are combined in the order they were planned
+    size_t sequence = 0;
     LineNumber chunkStart;
+    LinesCount linesCount;
     LogData::RawLines lines;
 
     PartialSearchResults searchResults;
@@ -124,6 +251,59 @@ PartialSearchResults filterLines( const PatternMatcher& matcher, const LogData::
     return results;
 }
 
+PartialSearchResults filterLines( BooleanSearchPlan::LineMatcher& matcher,
+                                  size_t nbMissingSubPatterns, const LogData::RawLines& rawLines,
+                                  LineNumber chunkStart )
+{
+    LOG_DEBUG << "Filter lines with plan at " << chunkStart;
+    PartialSearchResults results;
+    results.chunkStart = chunkStart;
+    results.processedLines = LinesCount{ rawLines.endOfLines.size() };
+    results.subPatternMatches.resize( nbMissingSubPatterns );
+
+    const auto& lines = rawLines.buildUtf8View();
+
+    MatchedPatterns missingMatches;
+    for ( auto offset = 0u; offset < lines.size(); ++offset ) {
+        const auto& line = lines[ offset ];
+        const auto lineNumber = chunkStart + LinesCount{ offset };
+
+        const auto hasMatch = matcher.hasMatch( line, lineNumber, missingMatches );
+
+        std::optional<LineLength> length;
+        const auto getLength = [ &length, &line ] {
+            if ( !length ) {
+                length = getUntabifiedLength( line );
+            }
+            return *length;
+        };
+
+        for ( auto index = 0u; index < missingMatches.size() && index < nbMissingSubPatterns;
+              ++index ) {
+            if ( missingMatches[ index ] ) {
+                auto& subPatternMatches = results.subPatternMatches[ index ];
+                subPatternMatches.maxLength = qMax( subPatternMatches.maxLength, getLength() );
+                subPatternMatches.matchingLines.add( lineNumber.get() );
+            }
+        }
+
+        if ( hasMatch ) {
+            results.maxLength = qMax( results.maxLength, getLength() );
+            results.matchingLines.add( lineNumber.get() );
+        }
+    }
+    return results;
+}
+
+// Number of matches in lines [begin, end)
+uint64_t countMatches( const SearchResultArray& matches, uint64_t begin, uint64_t end )
+{
+    if ( end <= begin ) {
+        return 0;
+    }
+    return matches.rank( end - 1 ) - ( begin > 0 ? matches.rank( begin - 1 ) : 0 );
+}
+
 } // namespace
 
 SearchResults SearchData::takeCurrentResults() const
@@ -132,17 +312,112 @@ SearchResults SearchData::takeCurrentResults() const
     return SearchResults{ std::exchange( newMatches_, {} ), maxLength_, nbLinesProcessed_ };
 }
 
-void SearchData::addAll( LineLength length, const SearchResultArray& matches, LinesCount lines )
+void SearchData::beginScan( LineNumber initialLine )
+{
+    UniqueLock lock( dataMutex_ );
+
+    // Ranges scanned ahead are kept, a resumed scan
+    // does not count their matches again
+    if ( initialLine.get() > nbLinesProcessed_.get() ) {
+        nbLinesProcessed_ = LinesCount( initialLine.get() );
+        lastProcessedLineMatched_.reset();
+        mergeScannedAhead();
+    }
+}
+
+void SearchData::addAll( LineLength length, const SearchResultArray& matches,
+                         LineNumber chunkStart, LinesCount chunkLines )
 {
     UniqueLock lock( dataMutex_ );
 
     maxLength_ = qMax( maxLength_, length );
-    nbLinesProcessed_ = qMax( nbLinesProcessed_, lines );
-    nbMatches_ += LinesCount( matches.cardinality() );
+
+    const auto chunkEnd = chunkStart + chunkLines;
+
+    // Only the matches of the chunk lines already scanned are counted
+    // again, instead of keeping all the matches to count their union
+    auto countedMatches
+        = countMatches( matches, chunkStart.get(),
+                        std::min( chunkEnd.get(), nbLinesProcessed_.get() ) );
+    for ( const auto& [ rangeStart, range ] : scannedAhead_ ) {
+        if ( rangeStart >= chunkEnd ) {
+            break;
+        }
+        countedMatches += countMatches( matches, std::max( chunkStart, rangeStart ).get(),
+                                        std::min( chunkEnd, range.end ).get() );
+    }
+    nbMatches_ = LinesCount( nbMatches_.get() + matches.cardinality() - countedMatches );
+
+    if ( chunkLines.get() > 0 ) {
+        const auto lastLineMatched = matches.contains( chunkEnd.get() - 1 );
+        if ( chunkStart.get() > nbLinesProcessed_.get() ) {
+            addScannedAhead( chunkStart, chunkEnd, lastLineMatched );
+        }
+        else if ( chunkEnd.get() > nbLinesProcessed_.get() ) {
+            nbLinesProcessed_ = LinesCount( chunkEnd.get() );
+            lastProcessedLineMatched_ = lastLineMatched;
+            mergeScannedAhead();
+        }
+    }
 
     newMatches_ |= matches;
 }
 
+void SearchData::addScannedAhead( LineNumber begin, LineNumber end, bool lastLineMatched )
+{
+    auto range = scannedAhead_.upper_bound( begin );
+    if ( range != scannedAhead_.begin() && std::prev( range )->second.end >= begin ) {
+        --range;
+    }
+
+    // The chunk added last was scanned last, its last line wins a tie
+    while ( range != scannedAhead_.end() && range->first <= end ) {
+        begin = qMin( begin, range->first );
+        if ( range->second.end > end ) {
+            end = range->second.end;
+            lastLineMatched = range->second.lastLineMatched;
+        }
+        range = scannedAhead_.erase( range );
+    }
+
+    scannedAhead_.emplace( begin, ScannedRange{ end, lastLineMatched } );
+}
+
+void SearchData::mergeScannedAhead()
+{
+    auto scanned = scannedAhead_.begin();
+    while ( scanned != scannedAhead_.end()
+            && scanned->first.get() <= nbLinesProcessed_.get() ) {
+        if ( scanned->second.end.get() > nbLinesProcessed_.get() ) {
+            nbLinesProcessed_ = LinesCount( scanned->second.end.get() );
+            lastProcessedLineMatched_ = scanned->second.lastLineMatched;
+        }
+        scanned = scannedAhead_.erase( scanned );
+    }
+}
+
+void SearchData::addSubPatternMatches( const std::vector<SubPatternResults>& matches )
+{
+    UniqueLock lock( dataMutex_ );
+
+    if ( subPatternMatches_.size() < matches.size() ) {
+        subPatternMatches_.resize( matches.size() );
+    }
+
+    for ( auto index = 0u; index < matches.size(); ++index ) {
+        auto& subPatternMatches = subPatternMatches_[ index ];
+        subPatternMatches.matchingLines |= matches[ index ].matchingLines;
+        subPatternMatches.maxLength
+            = qMax( subPatternMatches.maxLength, matches[ index ].maxLength );
+    }
+}
+
+std::vector<SubPatternResults> SearchData::getSubPatternMatches() const
+{
+    SharedLock lock( dataMutex_ );
+    return subPatternMatches_;
+}
+
 LinesCount SearchData::getNbMatches() const
 {
     SharedLock lock( dataMutex_ );
@@ -158,7 +433,18 @@ LineNumber SearchData::getLastProcessedLine() const
 void SearchData::deleteMatch( LineNumber line )
 {
     UniqueLock lock( dataMutex_ );
-    matches_.remove( line.get() );
+
+    // Otherwise the line is either not counted yet or counted
+    // already, scanning it again does not count it twice
+    if ( line.get() + 1 != nbLinesProcessed_.get() || !lastProcessedLineMatched_ ) {
+        return;
+    }
+
+    if ( *lastProcessedLineMatched_ ) {
+        nbMatches_ = LinesCount( nbMatches_.get() - 1 );
+    }
+    nbLinesProcessed_ = LinesCount( line.get() );
+    lastProcessedLineMatched_.reset();
 }
 
 void SearchData::clear()
@@ -168,8 +454,10 @@ void SearchData::clear()
     maxLength_ = LineLength( 0 );
     nbLinesProcessed_ = LinesCount( 0 );
     nbMatches_ = LinesCount( 0 );
-    matches_ = {};
+    lastProcessedLineMatched_.reset();
+    scannedAhead_.clear();
     newMatches_ = {};
+    subPatternMatches_.clear();
 }
 
 LogFilteredDataWorker::LogFilteredDataWorker( const LogData& sourceLogData )
@@ -182,6 +470,7 @@ LogFilteredDataWorker::~LogFilteredDataWorker() noexcept
 {
     try {
         interruptRequested_.set();
+        IoScheduler::get().notifyInterrupted();
         ScopedLock locker( operationsMutex_ );
         operationsPool_.waitForDone();
         LOG_INFO << "LogFilteredDataWorker shutdown";
@@ -202,7 +491,9 @@ void LogFilteredDataWorker::connectSignalsAndRun( SearchOperation* operationRequ
 }
 
 void LogFilteredDataWorker::search( const RegularExpressionPattern& regExp, LineNumber startLine,
-                                    LineNumber endLine )
+                                    LineNumber endLine,
+                                    std::shared_ptr<const BooleanSearchPlan> plan,
+                                    OptionalLineNumber focusLine )
 {
     ScopedLock locker( operationsMutex_ ); // to protect operationRequested_
     operationsPool_.waitForDone();
@@ -211,11 +502,11 @@ void LogFilteredDataWorker::search( const RegularExpressionPattern& regExp, Line
     LOG_INFO << "Search requested";
     QSemaphore operationStarted;
     operationsPool_.start(
-        createRunnable( [ this, &operationStarted, regExp, startLine, endLine ] {
+        createRunnable( [ this, &operationStarted, regExp, startLine, endLine, plan, focusLine ] {
             operationStarted.release();
             ScopedLock operationLock( operationsMutex_ );
             auto operationRequested = std::make_unique<FullSearchOperation>(
-                sourceLogData_, interruptRequested_, regExp, startLine, endLine );
+                sourceLogData_, interruptRequested_, regExp, startLine, endLine, plan, focusLine );
             connectSignalsAndRun( operationRequested.get() );
         } ) );
     operationStarted.acquire();
@@ -244,10 +535,33 @@ void LogFilteredDataWorker::updateSearch( const RegularExpressionPattern& regExp
     operationStarted.acquire();
 }
 
+void LogFilteredDataWorker::searchFields( const FieldQuery& query, LineNumber startLine,
+                                          LineNumber endLine, OptionalLineNumber position )
+{
+    ScopedLock locker( operationsMutex_ );
+    operationsPool_.waitForDone();
+    interruptRequested_.clear();
+
+    LOG_INFO << "Field search requested";
+
+    QSemaphore operationStarted;
+    operationsPool_.start(
+        createRunnable( [ this, &operationStarted, query, startLine, endLine, position ] {
+            operationStarted.release();
+            ScopedLock operationLock( operationsMutex_ );
+            auto operationRequested = std::make_unique<FieldSearchOperation>(
+                sourceLogData_, interruptRequested_, query, startLine, endLine, position );
+            connectSignalsAndRun( operationRequested.get() );
+        } ) );
+
+    operationStarted.acquire();
+}
+
 void LogFilteredDataWorker::interrupt()
 {
     LOG_INFO << "Search interruption requested";
     interruptRequested_.set();
+    IoScheduler::get().notifyInterrupted();
 }
 
 // This will do an atomic copy of the object
@@ -256,25 +570,35 @@ SearchResults LogFilteredDataWorker::getSearchResults() const
     return searchData_.takeCurrentResults();
 }
 
+std::vector<SubPatternResults> LogFilteredDataWorker::getSubPatternResults() const
+{
+    return searchData_.getSubPatternMatches();
+}
+
 //
 // Operations implementation
 //
 
 SearchOperation::SearchOperation( const LogData& sourceLogData, AtomicFlag& interruptRequested,
                                   const RegularExpressionPattern& regExp, LineNumber startLine,
-                                  LineNumber endLine )
+                                  LineNumber endLine,
+                                  std::shared_ptr<const BooleanSearchPlan> plan )
 
     : interruptRequested_( interruptRequested )
     , regexp_( regExp )
     , sourceLogData_( sourceLogData )
     , startLine_( startLine )
     , endLine_( endLine )
+    , plan_( std::move( plan ) )
 
 {
 }
 
-void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
+void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine,
+                                OptionalLineNumber focusLine )
 {
+    KLOGG_TRACE_SCOPE_ARG( "search", "search", "first_line", initialLine.get() );
+
     const auto nbSourceLines = sourceLogData_.getNbLine();
 
     LOG_INFO << "Searching from line " << initialLine << " to " << nbSourceLines;
@@ -294,21 +618,80 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
 
     LOG_INFO << "Using " << matchingThreadsCount << " matching threads";
 
-    tbb::flow::graph searchGraph;
+    // Searches of background tabs wait here until the device is free
+    auto stream
+        = IoScheduler::get().openStream( sourceLogData_.getFileName(), interruptRequested_ );
+
+    const auto searchGraphPtr = IoScheduler::get().createGraph();
+    auto& searchGraph = *searchGraphPtr;
 
     if ( initialLine < startLine_ ) {
         initialLine = startLine_;
     }
 
     const auto endLine = qMin( LineNumber( nbSourceLines.get() ), endLine_ );
-    const auto nbLinesInChunk = LinesCount(
-        static_cast<LinesCount::UnderlyingType>( config.searchReadBufferSizeLines() ) );
+    ChunkSizeEstimator chunkSizeEstimator;
+    searchData.beginScan( initialLine );
 
-    std::chrono::microseconds fileReadingDuration{ 0 };
+    static auto& chunkReadLatency = Metrics::get().histogram( "search.chunk_read_us" );
+    static auto& blockMatchLatency = Metrics::get().histogram( "search.block_match_us" );
+    static auto& blockCombineLatency = Metrics::get().histogram( "search.block_combine_us" );
+    static auto& linesRead = Metrics::get().counter( "search.lines_read" );
+    static auto& blocksInFlight = Metrics::get().gauge( "search.blocks_in_flight" );
+    static auto& chunkSize = Metrics::get().gauge( "search.chunk_bytes" );
+
+    // The reader blocks on this while enough chunks wait for the matchers,
+    // the combiner frees a slot for each chunk it is done with
+    QSemaphore chunkSlots( static_cast<int>( matchingThreadsCount * 3 ) );
 
     using BlockDataType = std::shared_ptr<SearchBlockData>;
-    auto blockPrefetcher
-        = tbb::flow::limiter_node<BlockDataType>( searchGraph, matchingThreadsCount * 3 );
+    auto chunksQueue = tbb::flow::buffer_node<BlockDataType>( searchGraph );
+
+    // Readers of disjoint chunks, each with its own handle of the file,
+    // or reading the shared one if the file is kept closed
+    using ReaderNode
+        = tbb::flow::function_node<BlockDataType, BlockDataType, tbb::flow::rejecting>;
+    using FileReaderPtr = std::unique_ptr<PositionalFileReader>;
+    using ReaderContext = std::tuple<FileReaderPtr, microseconds, ReaderNode>;
+
+    const auto readersCount = std::min( MaxReadersCount, matchingThreadsCount );
+    LOG_INFO << "Using " << readersCount << " reading threads";
+
+    std::vector<ReaderContext> chunkReaders;
+    chunkReaders.reserve( readersCount );
+    for ( auto index = 0u; index < readersCount; ++index ) {
+        chunkReaders.emplace_back(
+            sourceLogData_.createFileReader(), microseconds{ 0 },
+            ReaderNode( searchGraph, 1, [ &chunkReaders, index, this ]( BlockDataType blockData ) {
+                if ( interruptRequested_ ) {
+                    return blockData;
+                }
+
+                KLOGG_TRACE_SCOPE_ARG( "search", "read_chunk", "first_line",
+                                       blockData->chunkStart.get() );
+
+                const auto readStartTime = high_resolution_clock::now();
+
+                auto& fileReader = *std::get<FileReaderPtr>( chunkReaders.at( index ) );
+                blockData->lines = fileReader.isOpen()
+                                       ? sourceLogData_.getLinesRaw( blockData->chunkStart,
+                                                                     blockData->linesCount,
+                                                                     fileReader )
+                                       : sourceLogData_.getLinesRaw( blockData->chunkStart,
+                                                                     blockData->linesCount );
+
+                const auto readDuration
+                    = duration_cast<microseconds>( high_resolution_clock::now() - readStartTime );
+                std::get<microseconds>( chunkReaders.at( index ) ) += readDuration;
+                chunkReadLatency.record( readDuration );
+                linesRead.add( blockData->linesCount.get() );
+
+                LOG_DEBUG << "Reader " << index << " read chunk starting at "
+                          << blockData->chunkStart << ", " << blockData->lines.buffer.size()
+                          << " bytes";
+                return blockData;
+            } ) );
+    }
 
     auto lineBlocksQueue = tbb::flow::buffer_node<BlockDataType>( searchGraph );
 
@@ -316,15 +699,25 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
         = tbb::flow::function_node<BlockDataType, BlockDataType, tbb::flow::rejecting>;
 
     using PatternMatcherPtr = std::unique_ptr<PatternMatcher>;
-    using MatcherContext = std::tuple<PatternMatcherPtr, microseconds, RegexMatcherNode>;
+    using PlanMatcherPtr = std::unique_ptr<BooleanSearchPlan::LineMatcher>;
+    using MatcherContext
+        = std::tuple<PatternMatcherPtr, PlanMatcherPtr, microseconds, RegexMatcherNode>;
+
+    if ( plan_ ) {
+        LOG_INFO << "Matching " << plan_->missingSubPatterns().size() << " of "
+                 << plan_->subPatterns().size() << " sub-patterns";
+    }
 
     std::vector<MatcherContext> regexMatchers;
     RegularExpression regularExpression{ regexp_ };
     for ( auto index = 0u; index < matchingThreadsCount; ++index ) {
         regexMatchers.emplace_back(
-            regularExpression.createMatcher(), microseconds{ 0 },
+            plan_ ? PatternMatcherPtr{} : regularExpression.createMatcher(),
+            plan_ ? plan_->createLineMatcher() : PlanMatcherPtr{}, microseconds{ 0 },
             RegexMatcherNode(
-                searchGraph, 1, [ &regexMatchers, index, this ]( const BlockDataType& blockData ) {
+                searchGraph, 1,
+                [ &regexMatchers, &chunkSizeEstimator, index,
+                  this ]( const BlockDataType& blockData ) {
                     if ( interruptRequested_ ) {
                         LOG_INFO << "Matcher " << index << " interrupted";
                         auto results = std::make_shared<PartialSearchResults>();
@@ -334,17 +727,31 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                         return blockData;
                     }
 
+                    KLOGG_TRACE_SCOPE_ARG( "search", "match_block", "first_line",
+                                           blockData->chunkStart.get() );
+
                     const auto& matcher = std::get<PatternMatcherPtr>( regexMatchers.at( index ) );
+                    const auto& planMatcher
+                        = std::get<PlanMatcherPtr>( regexMatchers.at( index ) );
                     const auto matchStartTime = high_resolution_clock::now();
 
                     blockData->searchResults
-                        = filterLines( *matcher, blockData->lines, blockData->chunkStart );
+                        = planMatcher
+                              ? filterLines( *planMatcher, plan_->missingSubPatterns().size(),
+                                             blockData->lines, blockData->chunkStart )
+                              : filterLines( *matcher, blockData->lines, blockData->chunkStart );
 
                     const auto matchEndTime = high_resolution_clock::now();
 
+                    const auto blockMatchDuration
+                        = duration_cast<microseconds>( matchEndTime - matchStartTime );
                     microseconds& matchDuration
                         = std::get<microseconds>( regexMatchers.at( index ) );
-                    matchDuration += duration_cast<microseconds>( matchEndTime - matchStartTime );
+                    matchDuration += blockMatchDuration;
+                    blockMatchLatency.record( blockMatchDuration );
+                    chunkSizeEstimator.addMatchedChunk(
+                        static_cast<qint64>( blockData->lines.buffer.size() ),
+                        blockMatchDuration );
                     LOG_DEBUG << "Searcher " << index << " block " << blockData->chunkStart
                               << " sending matches "
                               << blockData->searchResults.matchingLines.cardinality();
@@ -352,7 +759,8 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                 } ) );
     }
 
-    auto resultsQueue = tbb::flow::buffer_node<BlockDataType>( searchGraph );
+    auto resultsQueue = tbb::flow::sequencer_node<BlockDataType>(
+        searchGraph, []( const BlockDataType& blockData ) { return blockData->sequence; } );
 
     const auto totalLines = endLine - initialLine;
     LinesCount totalProcessedLines = 0_lcount;
@@ -366,11 +774,17 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
     auto matchProcessor
         = tbb::flow::function_node<BlockDataType, tbb::flow::continue_msg, tbb::flow::rejecting>(
             searchGraph, 1, [ & ]( const BlockDataType& blockData ) {
+                blocksInFlight.add( -1 );
+                chunkSlots.release();
+
                 if ( interruptRequested_ ) {
                     LOG_INFO << "Match processor interrupted";
                     return tbb::flow::continue_msg{};
                 }
 
+                KLOGG_TRACE_SCOPE_ARG( "search", "combine_block", "first_line",
+                                       blockData->chunkStart.get() );
+
                 const auto& matchResults = blockData->searchResults;
 
                 const auto matchProcessorStartTime = high_resolution_clock::now();
@@ -378,16 +792,15 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                 if ( matchResults.processedLines.get() ) {
 
                     maxLength = qMax( maxLength, matchResults.maxLength );
-                    nbMatches += LinesCount( matchResults.matchingLines.cardinality() );
-
-                    const auto processedLines = LinesCount{ matchResults.chunkStart.get()
-                                                            + matchResults.processedLines.get() };
 
                     totalProcessedLines += matchResults.processedLines;
 
                     // After each block, copy the data to shared data
                     // and update the client
-                    searchData.addAll( maxLength, matchResults.matchingLines, processedLines );
+                    searchData.addSubPatternMatches( matchResults.subPatternMatches );
+                    searchData.addAll( maxLength, matchResults.matchingLines,
+                                       matchResults.chunkStart, matchResults.processedLines );
+                    nbMatches = searchData.getNbMatches();
 
                     LOG_DEBUG << "done Searching chunk starting at " << matchResults.chunkStart
                               << ", " << matchResults.processedLines << " lines read.";
@@ -405,13 +818,18 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                 }
 
                 const auto matchProcessorEndTime = high_resolution_clock::now();
-                matchCombiningDuration += duration_cast<microseconds>( matchProcessorEndTime
-                                                                       - matchProcessorStartTime );
+                const auto blockCombineDuration
+                    = duration_cast<microseconds>( matchProcessorEndTime - matchProcessorStartTime );
+                matchCombiningDuration += blockCombineDuration;
+                blockCombineLatency.record( blockCombineDuration );
 
                 return tbb::flow::continue_msg{};
             } );
 
-    tbb::flow::make_edge( blockPrefetcher, lineBlocksQueue );
+    for ( auto& chunkReader : chunkReaders ) {
+        tbb::flow::make_edge( chunksQueue, std::get<ReaderNode>( chunkReader ) );
+        tbb::flow::make_edge( std::get<ReaderNode>( chunkReader ), lineBlocksQueue );
+    }
 
     for ( auto& regexMatcher : regexMatchers ) {
         tbb::flow::make_edge( lineBlocksQueue, std::get<RegexMatcherNode>( regexMatcher ) );
@@ -419,49 +837,57 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
     }
 
     tbb::flow::make_edge( resultsQueue, matchProcessor );
-    tbb::flow::make_edge( matchProcessor, blockPrefetcher.decrementer() );
-
-    auto chunkStart = initialLine;
-    while ( chunkStart < endLine && !interruptRequested_ ) {
-        const auto lineSourceStartTime = high_resolution_clock::now();
-        LOG_DEBUG << "Reading chunk starting at " << chunkStart;
-
-        const auto linesInChunk
-            = LinesCount( qMin( nbLinesInChunk.get(), ( endLine - chunkStart ).get() ) );
-        auto lines = sourceLogData_.getLinesRaw( chunkStart, linesInChunk );
-
-        /*LOG_DEBUG << "Sending chunk starting at " << chunkStart << ", " <<
-            lines.second.size()
-                << " lines read.";*/
 
-        auto blockData = std::make_shared<SearchBlockData>( chunkStart, std::move( lines ) );
+    const auto waitForChunkSlot = [ & ]() {
+        KLOGG_TRACE_SCOPE( "search", "wait_for_slot" );
+        while ( !chunkSlots.tryAcquire( 1, 50 ) ) {
+            if ( interruptRequested_ ) {
+                return false;
+            }
+        }
+        return true;
+    };
 
-        const auto lineSourceEndTime = high_resolution_clock::now();
-        const auto chunkReadTime
-            = duration_cast<microseconds>( lineSourceEndTime - lineSourceStartTime );
+    if ( focusLine ) {
+        LOG_INFO << "Searching around line " << *focusLine << " first";
+    }
 
-        /*LOG_DEBUG << "Sent chunk starting at " << chunkStart << ", " <<
-        blockData->lines.second.size()
-                << " lines read in " << static_cast<float>( chunkReadTime.count() )
-        / 1000.f
-                << " ms";*/
+    // Only planning the chunks is serial, reading them is done by the readers
+    ScanPlanner scanPlanner( sourceLogData_, initialLine, endLine, focusLine );
+    size_t chunkSequence = 0;
+    while ( !interruptRequested_ && stream.yield() && waitForChunkSlot() ) {
+        const auto chunkBytes = chunkSizeEstimator.nextChunkBytes();
+        chunkSize.set( chunkBytes );
+        const auto chunk = scanPlanner.nextChunk( chunkBytes );
+        if ( !chunk ) {
+            // Done, or the file has been truncated under our feet
+            chunkSlots.release();
+            break;
+        }
 
-        chunkStart = chunkStart + nbLinesInChunk;
-        fileReadingDuration += chunkReadTime;
+        const auto [ chunkStart, linesInChunk ] = *chunk;
+        LOG_DEBUG << "Planned chunk starting at " << chunkStart << ", " << linesInChunk
+                  << " lines";
 
-        while ( !blockPrefetcher.try_put( blockData ) && !interruptRequested_ ) {
-            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
-        }
+        // The queue takes all chunks, the slots limit how many there are
+        blocksInFlight.add( 1 );
+        chunksQueue.try_put(
+            std::make_shared<SearchBlockData>( chunkSequence++, chunkStart, linesInChunk ) );
     }
 
-    searchGraph.wait_for_all();
+    {
+        KLOGG_TRACE_SCOPE( "search", "wait_for_graph" );
+        searchGraph.wait_for_all();
+    }
 
     high_resolution_clock::time_point t2 = high_resolution_clock::now();
     const auto durationUs = duration_cast<microseconds>( t2 - t1 );
     const auto durationMs = duration_cast<milliseconds>( t2 - t1 );
 
     LOG_INFO << "Searching done, overall duration " << durationUs;
-    LOG_INFO << "Line reading took " << fileReadingDuration;
+    for ( const auto& chunkReader : chunkReaders ) {
+        LOG_INFO << "Line reading took " << std::get<microseconds>( chunkReader );
+    }
     LOG_INFO << "Results combining took " << matchCombiningDuration;
 
     for ( const auto& regexMatcher : regexMatchers ) {
@@ -481,6 +907,16 @@ void SearchOperation::doSearch( SearchData& searchData, LineNumber initialLine )
                     / ( 1024 * 1024 )
              << " MiB/s";
 
+    auto& metrics = Metrics::get();
+    metrics.counter( "search.runs" ).add();
+    metrics.counter( "search.lines" ).add( totalProcessedLines.get() );
+    metrics.histogram( "search.duration_us" ).record( durationUs );
+    if ( durationUs.count() > 0 ) {
+        metrics.gauge( "search.last_throughput_lps" )
+            .set( static_cast<int64_t>( 1000 * 1000 * totalProcessedLines.get()
+                                        / static_cast<uint64_t>( durationUs.count() ) ) );
+    }
+
     Q_EMIT searchProgressed( nbMatches, 100, initialLine );
     Q_EMIT searchFinished();
 }
@@ -491,7 +927,7 @@ void FullSearchOperation::run( SearchData& searchData )
     try {
         // Clear the shared data
         searchData.clear();
-        doSearch( searchData, 0_lnum );
+        doSearch( searchData, 0_lnum, focusLine_ );
     } catch ( const std::exception& err ) {
         const auto errorString = QString( "FullSearchOperation failed: %1" ).arg( err.what() );
         LOG_ERROR << errorString;
@@ -526,3 +962,98 @@ void UpdateSearchOperation::run( SearchData& searchData )
         searchData.clear();
     }
 }
+
+// Called in the worker thread's context
+void FieldSearchOperation::run( SearchData& searchData )
+{
+    try {
+        if ( !initialPosition_ ) {
+            searchData.clear();
+        }
+
+        const auto initialLine
+            = qMax( startLine_, initialPosition_ ? qMax( searchData.getLastProcessedLine(),
+                                                         *initialPosition_ )
+                                                 : startLine_ );
+        doFieldSearch( searchData, initialLine );
+    } catch ( const std::exception& err ) {
+        const auto errorString = QString( "FieldSearchOperation failed: %1" ).arg( err.what() );
+        LOG_ERROR << errorString;
+        dispatchToMainThread( [ errorString ]() {
+            IssueReporter::askUserAndReportIssue( IssueTemplate::Exception, errorString );
+        } );
+        searchData.clear();
+    }
+}
+
+void FieldSearchOperation::doFieldSearch( SearchData& searchData, LineNumber initialLine )
+{
+    KLOGG_TRACE_SCOPE_ARG( "search", "field_search", "first_line", initialLine.get() );
+
+    const auto endLine = qMax( initialLine,
+                               qMin( LineNumber( sourceLogData_.getNbLine().get() ), endLine_ ) );
+    searchData.beginScan( initialLine );
+
+    const auto maxLineLength = [ this ]( const SearchResultArray& lines ) {
+        if ( lines.cardinality() > MaxMeasuredLines ) {
+            return sourceLogData_.getMaxLength();
+        }
+
+        auto maxLength = 0_length;
+        for ( const auto line : lines ) {
+            maxLength = qMax( maxLength, sourceLogData_.getLineLength( LineNumber( line ) ) );
+        }
+        return maxLength;
+    };
+
+    auto matches = sourceLogData_.findLinesByFields( query_, initialLine, endLine );
+    auto maxLength = maxLineLength( matches.lines );
+    searchData.addAll( maxLength, matches.lines, initialLine, 0_lcount );
+
+    SearchResultArray verified;
+
+    // Lines of hashed fields share their bitmap with other values,
+    // these are few and checked by parsing their text
+    const auto nbCandidates = matches.candidates.cardinality();
+    if ( nbCandidates > 0 ) {
+        LOG_INFO << "Checking " << nbCandidates << " field filter candidates";
+
+        const auto fields = sourceLogData_.getStructuredFields();
+        JsonFieldParser parser{ fields };
+        std::vector<std::optional<std::string>> values( fields.size() );
+
+        uint64_t checked = 0;
+        for ( const auto line : matches.candidates ) {
+            if ( interruptRequested_ ) {
+                LOG_INFO << "Field search interrupted";
+                break;
+            }
+
+            std::fill( values.begin(), values.end(), std::nullopt );
+            parser.parse( sourceLogData_.getLineString( LineNumber( line ) ).toStdString(),
+                          [ &values ]( size_t field, std::string_view value ) {
+                              values[ field ] = FieldIndex::normalize( value );
+                          } );
+
+            if ( query_.matches( values ) ) {
+                verified.add( line );
+                maxLength = qMax( maxLength, sourceLogData_.getLineLength( LineNumber( line ) ) );
+            }
+
+            if ( ++checked % FieldCandidatesBatch == 0 ) {
+                searchData.addAll( maxLength, std::exchange( verified, {} ), initialLine,
+                                   0_lcount );
+                Q_EMIT searchProgressed(
+                    searchData.getNbMatches(),
+                    std::min( 99, calculateProgress( checked, nbCandidates ) ), initialLine );
+            }
+        }
+    }
+
+    // The lines are processed only if all the candidates were checked
+    searchData.addAll( maxLength, verified, initialLine,
+                       interruptRequested_ ? 0_lcount : endLine - initialLine );
+
+    Q_EMIT searchProgressed( searchData.getNbMatches(), 100, initialLine );
+    Q_EMIT searchFinished();
+}
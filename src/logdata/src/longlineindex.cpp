@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "longlineindex.h"
+
+#include <algorithm>
+
+#include <QString>
+
+namespace {
+// Bytes of the line between two checkpoints
+constexpr int64_t CheckpointBytes = 16 * 1024;
+// How far past that to look for a byte decoding can start from
+constexpr int64_t BoundarySearchBytes = 1024;
+
+bool isDecodingBoundary( std::string_view bytes, int64_t offset,
+                         const EncodingParameters& encodingParams )
+{
+    const auto width = encodingParams.lineFeedWidth;
+    if ( offset % width != 0 || encodingParams.hasShiftStates ) {
+        return false;
+    }
+
+    if ( width == 1 ) {
+        const auto byte = static_cast<unsigned char>( bytes[ static_cast<size_t>( offset ) ] );
+        if ( encodingParams.isUtf8Compatible ) {
+            // Not a continuation byte
+            return ( byte & 0xC0 ) != 0x80;
+        }
+
+        // Trail bytes of double-byte encodings are 0x40 and above, the second
+        // and fourth bytes of GB18030 four-byte characters are ASCII digits.
+        return byte < 0x30;
+    }
+    else if ( width == 2 ) {
+        // Must not be the second half of a surrogate pair
+        const auto highByteOffset = offset + ( encodingParams.lineFeedIndex == 0 ? 1 : 0 );
+        const auto highByte
+            = static_cast<unsigned char>( bytes[ static_cast<size_t>( highByteOffset ) ] );
+        return ( highByte & 0xFC ) != 0xDC;
+    }
+
+    return true;
+}
+} // namespace
+
+std::pair<LongLineIndex::Checkpoint, int64_t>
+LongLineIndex::Line::byteRange( int64_t firstColumn, int64_t lastColumn ) const
+{
+    // Last checkpoint at or before the first column, the first one is at column 0
+    auto first = std::upper_bound(
+        checkpoints.begin(), checkpoints.end(), std::max( firstColumn, int64_t{ 0 } ),
+        []( int64_t column, const Checkpoint& checkpoint ) { return column < checkpoint.column; } );
+    --first;
+
+    // First checkpoint at or after the last column
+    const auto last = std::lower_bound(
+        first, checkpoints.end(), lastColumn,
+        []( const Checkpoint& checkpoint, int64_t column ) { return checkpoint.column < column; } );
+
+    return { *first, last == checkpoints.end() ? byteLength : last->byteOffset };
+}
+
+LongLineIndex::LongLineIndex( size_t maxLines )
+    : maxLines_{ maxLines }
+{
+}
+
+LongLineIndex::Line LongLineIndex::build( std::string_view lineBytes, TextDecoder decoder )
+{
+    Line line;
+    line.byteLength = static_cast<int64_t>( lineBytes.size() );
+    line.checkpoints.push_back( { 0, 0 } );
+
+    int64_t column = 0;
+    QChar lastChar;
+
+    auto segmentStart = int64_t{ 0 };
+    while ( segmentStart < line.byteLength ) {
+        auto segmentEnd = std::min( segmentStart + CheckpointBytes, line.byteLength );
+        const auto searchEnd = std::min( segmentEnd + BoundarySearchBytes, line.byteLength );
+        while ( segmentEnd < searchEnd
+                && !isDecodingBoundary( lineBytes, segmentEnd, decoder.encodingParams ) ) {
+            ++segmentEnd;
+        }
+
+        // The decoder keeps incomplete characters for the next segment
+        const auto text
+            = decoder.decoder->toUnicode( lineBytes.data() + segmentStart,
+                                          static_cast<int>( segmentEnd - segmentStart ) );
+        for ( const auto& c : text ) {
+            column += c == QChar::Tabulation ? TabStop - ( column % TabStop ) : 1;
+        }
+        if ( !text.isEmpty() ) {
+            lastChar = text.back();
+        }
+
+        if ( segmentEnd < line.byteLength
+             && isDecodingBoundary( lineBytes, segmentEnd, decoder.encodingParams ) ) {
+            line.checkpoints.push_back( { segmentEnd, column } );
+        }
+
+        segmentStart = segmentEnd;
+    }
+
+    // Carriage return is not displayed
+    line.expandedLength = lastChar == QChar::CarriageReturn ? column - 1 : column;
+
+    return line;
+}
+
+LongLineIndex::LinePtr LongLineIndex::find( LineNumber line ) const
+{
+    ScopedLock lock( mutex_ );
+    const auto indexed = lines_.find( line.get() );
+    if ( indexed == lines_.end() ) {
+        return {};
+    }
+
+    recentLines_.splice( recentLines_.begin(), recentLines_, indexed->second.second );
+    return indexed->second.first;
+}
+
+void LongLineIndex::insert( LineNumber line, LinePtr index, uint64_t generation )
+{
+    ScopedLock lock( mutex_ );
+    if ( generation != generation_ || lines_.count( line.get() ) ) {
+        return;
+    }
+
+    recentLines_.push_front( line.get() );
+    lines_.emplace( line.get(), std::make_pair( std::move( index ), recentLines_.begin() ) );
+
+    while ( recentLines_.size() > maxLines_ ) {
+        lines_.erase( recentLines_.back() );
+        recentLines_.pop_back();
+    }
+}
+
+uint64_t LongLineIndex::clear()
+{
+    ScopedLock lock( mutex_ );
+    ++generation_;
+
+    uint64_t freed = 0;
+    for ( const auto& line : lines_ ) {
+        freed += sizeof( Line ) + line.second.first->checkpoints.size() * sizeof( Checkpoint );
+    }
+
+    lines_.clear();
+    recentLines_.clear();
+
+    return freed;
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "memorybudget.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <QCoreApplication>
+
+#include "configuration.h"
+#include "dispatch_to.h"
+#include "log.h"
+#include "memory_info.h"
+#include "readablesize.h"
+
+MemoryBudget& MemoryBudget::get()
+{
+    static MemoryBudget budget;
+    return budget;
+}
+
+MemoryBudget::MemoryBudget()
+{
+    if ( QCoreApplication::instance() ) {
+        moveToThread( QCoreApplication::instance()->thread() );
+    }
+}
+
+MemoryBudget::ConsumerId MemoryBudget::registerConsumer( MemoryBudget::Consumer consumer )
+{
+    ScopedLock lock( mutex_ );
+    const auto id = nextId_++;
+    consumers_.emplace( id, ConsumerData{ std::move( consumer ), {} } );
+    return id;
+}
+
+void MemoryBudget::unregisterConsumer( MemoryBudget::ConsumerId id )
+{
+    {
+        ScopedLock lock( mutex_ );
+        consumers_.erase( id );
+    }
+
+    Q_EMIT usageChanged();
+}
+
+void MemoryBudget::update( MemoryBudget::ConsumerId id, MemoryBudget::Usage usage,
+                           uint64_t bytes )
+{
+    {
+        ScopedLock lock( mutex_ );
+        auto consumer = consumers_.find( id );
+        if ( consumer == consumers_.end() ) {
+            return;
+        }
+
+        auto& accounting = consumer->second.accounting;
+        switch ( usage ) {
+        case Usage::Index:
+            accounting.index = bytes;
+            break;
+        case Usage::SearchResults:
+            accounting.searchResults = bytes;
+            break;
+        case Usage::SearchCache:
+            accounting.searchCache = bytes;
+            break;
+        case Usage::SpilledIndex:
+            accounting.spilled = bytes;
+            break;
+        }
+    }
+
+    const auto total = totalUsage().total();
+    const auto shouldReclaim = [ this, total ] {
+        if ( total <= budget() ) {
+            return false;
+        }
+
+        // Nothing more could be reclaimed last time at this usage
+        SharedLock lock( mutex_ );
+        return total > usageAfterReclaim_;
+    }();
+
+    Q_EMIT usageChanged();
+
+    if ( shouldReclaim ) {
+        scheduleReclaim( false );
+    }
+}
+
+void MemoryBudget::reclaimAll()
+{
+    scheduleReclaim( true );
+}
+
+MemoryBudget::Accounting MemoryBudget::usage( const LogData* owner ) const
+{
+    Accounting total;
+
+    SharedLock lock( mutex_ );
+    for ( const auto& consumer : consumers_ ) {
+        if ( consumer.second.consumer.owner != owner ) {
+            continue;
+        }
+
+        const auto& accounting = consumer.second.accounting;
+        total.index += accounting.index;
+        total.searchResults += accounting.searchResults;
+        total.searchCache += accounting.searchCache;
+        total.spilled += accounting.spilled;
+    }
+
+    return total;
+}
+
+MemoryBudget::Accounting MemoryBudget::totalUsage() const
+{
+    Accounting total;
+
+    SharedLock lock( mutex_ );
+    for ( const auto& consumer : consumers_ ) {
+        const auto& accounting = consumer.second.accounting;
+        total.index += accounting.index;
+        total.searchResults += accounting.searchResults;
+        total.searchCache += accounting.searchCache;
+        total.spilled += accounting.spilled;
+    }
+
+    return total;
+}
+
+uint64_t MemoryBudget::budget() const
+{
+    const auto& config = Configuration::get();
+    if ( config.memoryBudgetMb() > 0 ) {
+        return static_cast<uint64_t>( config.memoryBudgetMb() ) * 1024 * 1024;
+    }
+
+    const auto systemMemory = physicalMemory();
+    return systemMemory > 0 ? systemMemory / 2 : std::numeric_limits<uint64_t>::max();
+}
+
+void MemoryBudget::scheduleReclaim( bool reclaimEverything )
+{
+    {
+        ScopedLock lock( mutex_ );
+        if ( isReclaiming_ || ( isReclaimScheduled_ && !reclaimEverything ) ) {
+            return;
+        }
+        isReclaimScheduled_ = true;
+    }
+
+    dispatchToMainThread( [ this, reclaimEverything ] {
+        {
+            ScopedLock lock( mutex_ );
+            isReclaimScheduled_ = false;
+            isReclaiming_ = true;
+        }
+
+        reclaim( reclaimEverything );
+
+        ScopedLock lock( mutex_ );
+        isReclaiming_ = false;
+    } );
+}
+
+void MemoryBudget::reclaim( bool reclaimEverything )
+{
+    const auto limit = budget();
+    const auto target = limit - limit / 10;
+    const auto isOverBudget = [ & ] {
+        return reclaimEverything || totalUsage().total() > target;
+    };
+
+    LOG_INFO << "Reclaiming memory, usage " << readableSize( totalUsage().total() ) << ", budget "
+             << readableSize( limit );
+
+    // Biggest consumers first, callbacks are looked up again before the call
+    // as consumers can go away while we are reclaiming
+    const auto orderedConsumers = [ this ]( auto size ) {
+        std::vector<std::pair<uint64_t, ConsumerId>> ordered;
+
+        SharedLock lock( mutex_ );
+        for ( const auto& consumer : consumers_ ) {
+            const auto bytes = size( consumer.second.accounting );
+            if ( bytes > 0 ) {
+                ordered.emplace_back( bytes, consumer.first );
+            }
+        }
+
+        std::sort( ordered.begin(), ordered.end(), std::greater<>{} );
+        return ordered;
+    };
+
+    const auto callback = [ this ]( ConsumerId id, auto member ) {
+        SharedLock lock( mutex_ );
+        const auto consumer = consumers_.find( id );
+        return consumer != consumers_.end() ? consumer->second.consumer.*member
+                                            : std::function<uint64_t()>{};
+    };
+
+    for ( const auto& cache : orderedConsumers(
+              []( const Accounting& accounting ) { return accounting.searchCache; } ) ) {
+        if ( !isOverBudget() ) {
+            break;
+        }
+
+        if ( const auto evictCaches = callback( cache.second, &Consumer::evictCaches ) ) {
+            const auto freed = evictCaches();
+            LOG_INFO << "Evicted " << readableSize( freed ) << " of search caches";
+        }
+    }
+
+    for ( const auto& index : orderedConsumers(
+              []( const Accounting& accounting ) { return accounting.index; } ) ) {
+        if ( !isOverBudget() ) {
+            break;
+        }
+
+        if ( const auto spillToDisk = callback( index.second, &Consumer::spillToDisk ) ) {
+            const auto freed = spillToDisk();
+            LOG_INFO << "Spilled " << readableSize( freed ) << " of line index to disk";
+        }
+    }
+
+    const auto usageAfterReclaim = totalUsage().total();
+    {
+        ScopedLock lock( mutex_ );
+        usageAfterReclaim_ = usageAfterReclaim;
+    }
+
+    LOG_INFO << "Memory usage after reclaim " << readableSize( usageAfterReclaim );
+    Q_EMIT usageChanged();
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "mergedlineindex.h"
+
+MergedLineIndex::MergedLineIndex( size_t sourcesCount )
+    : sourcesCount_( sourcesCount )
+    , positions_( sourcesCount, 0 )
+{
+}
+
+void MergedLineIndex::append( size_t source, LinesCount count )
+{
+    assert( source < sourcesCount_ );
+
+    if ( count.get() == 0 ) {
+        return;
+    }
+
+    if ( nbRuns_ > 0 && lastRun_.source == source ) {
+        runs_.resize( lastRunOffset_ );
+        lastRun_.length += count.get();
+        writeRun( lastRun_ );
+    }
+    else {
+        if ( nbRuns_ % CheckpointInterval == 0 ) {
+            checkpoints_.push_back( Checkpoint{ nbLines_, runs_.size() } );
+            checkpointPositions_.insert( checkpointPositions_.end(), positions_.begin(),
+                                         positions_.end() );
+        }
+
+        lastRunOffset_ = runs_.size();
+        lastRun_ = Run{ source, count.get() };
+        writeRun( lastRun_ );
+        ++nbRuns_;
+    }
+
+    positions_[ source ] += count.get();
+    nbLines_ += count.get();
+}
+
+MergedLineIndex::Location MergedLineIndex::at( LineNumber line ) const
+{
+    assert( line.get() < nbLines_ );
+    if ( checkpoints_.empty() ) {
+        return Location{ 0, 0_lnum };
+    }
+
+    const auto checkpointIndex = findCheckpoint( line.get() );
+    const auto& checkpoint = checkpoints_[ checkpointIndex ];
+    const auto* checkpointPositions = checkpointPositions_.data() + checkpointIndex * sourcesCount_;
+
+    std::array<Run, CheckpointInterval> decodedRuns;
+    size_t nbDecodedRuns = 0;
+
+    auto offset = checkpoint.offset;
+    auto mergedLine = checkpoint.mergedLine;
+    while ( offset < runs_.size() ) {
+        const auto run = readRun( offset );
+        if ( line.get() < mergedLine + run.length ) {
+            auto position = checkpointPositions[ run.source ];
+            for ( auto i = 0u; i < nbDecodedRuns; ++i ) {
+                if ( decodedRuns[ i ].source == run.source ) {
+                    position += decodedRuns[ i ].length;
+                }
+            }
+            return Location{ run.source, LineNumber( position + line.get() - mergedLine ) };
+        }
+
+        decodedRuns[ nbDecodedRuns++ ] = run;
+        mergedLine += run.length;
+    }
+
+    return Location{ 0, 0_lnum };
+}
+
+std::vector<MergedLineIndex::Segment> MergedLineIndex::segments( LineNumber first,
+                                                                 LinesCount count ) const
+{
+    std::vector<Segment> result;
+
+    const auto end = std::min( nbLines_, ( first + count ).get() );
+    if ( first.get() >= end ) {
+        return result;
+    }
+
+    const auto checkpointIndex = findCheckpoint( first.get() );
+    const auto& checkpoint = checkpoints_[ checkpointIndex ];
+
+    const auto positionsBegin = checkpointPositions_.begin()
+                                + static_cast<std::ptrdiff_t>( checkpointIndex * sourcesCount_ );
+    std::vector<uint64_t> positions( positionsBegin,
+                                     positionsBegin + static_cast<std::ptrdiff_t>( sourcesCount_ ) );
+
+    auto offset = checkpoint.offset;
+    auto mergedLine = checkpoint.mergedLine;
+    while ( offset < runs_.size() && mergedLine < end ) {
+        const auto run = readRun( offset );
+        const auto runEnd = mergedLine + run.length;
+        if ( runEnd > first.get() ) {
+            const auto segmentStart = std::max( first.get(), mergedLine );
+            const auto segmentEnd = std::min( end, runEnd );
+            result.push_back( Segment{
+                run.source, LineNumber( positions[ run.source ] + segmentStart - mergedLine ),
+                LineNumber( segmentStart ), LinesCount( segmentEnd - segmentStart ) } );
+        }
+
+        positions[ run.source ] += run.length;
+        mergedLine = runEnd;
+    }
+
+    return result;
+}
+
+size_t MergedLineIndex::allocatedSize() const
+{
+    return runs_.capacity() + checkpoints_.capacity() * sizeof( Checkpoint )
+           + ( checkpointPositions_.capacity() + positions_.capacity() ) * sizeof( uint64_t );
+}
+
+MergedLineIndex::Run MergedLineIndex::readRun( size_t& offset ) const
+{
+    uint64_t value = 0;
+    unsigned shift = 0;
+    uint8_t byte = 0;
+    do {
+        byte = runs_[ offset++ ];
+        value |= static_cast<uint64_t>( byte & 0x7f ) << shift;
+        shift += 7;
+    } while ( byte & 0x80 );
+
+    return Run{ static_cast<size_t>( value % sourcesCount_ ), value / sourcesCount_ };
+}
+
+void MergedLineIndex::writeRun( const Run& run )
+{
+    auto value = run.length * sourcesCount_ + run.source;
+    while ( value >= 0x80 ) {
+        runs_.push_back( static_cast<uint8_t>( value | 0x80 ) );
+        value >>= 7;
+    }
+    runs_.push_back( static_cast<uint8_t>( value ) );
+}
+
+size_t MergedLineIndex::findCheckpoint( uint64_t line ) const
+{
+    const auto next = std::upper_bound(
+        checkpoints_.begin(), checkpoints_.end(), line,
+        []( uint64_t value, const Checkpoint& checkpoint ) { return value < checkpoint.mergedLine; } );
+
+    return next == checkpoints_.begin()
+               ? 0
+               : static_cast<size_t>( std::distance( checkpoints_.begin(), next ) ) - 1;
+}
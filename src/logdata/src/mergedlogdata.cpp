@@ -0,0 +1,468 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file implements MergedLogData, a timestamp ordered view of several files.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <queue>
+
+#include <tbb/parallel_for.h>
+
+#include "log.h"
+#include "logdata.h"
+#include "progress.h"
+#include "runnable_lambda.h"
+#include "timestampparser.h"
+
+#include "mergedlogdata.h"
+
+namespace {
+
+constexpr LinesCount TimestampsChunkLines{ 64 * 1024 };
+constexpr qint64 RawChunkBytes = 4 * 1024 * 1024;
+
+// Timestamp of every line of the source, lines without a timestamp
+// take the one of the previous line.
+std::vector<Timestamp> buildTimestampColumn( const LogData& source,
+                                             const AtomicFlag& interruptRequested )
+{
+    const auto nbLines = source.getNbLine();
+
+    std::vector<Timestamp> column;
+    column.reserve( nbLines.get() );
+
+    // Timestamps indexed with the file are only decoded
+    if ( source.hasTimestamps() ) {
+        auto chunkStart = 0_lnum;
+        while ( chunkStart < nbLines && !interruptRequested ) {
+            const auto linesInChunk = LinesCount( qMin(
+                TimestampsChunkLines.get(), ( LineNumber( nbLines.get() ) - chunkStart ).get() ) );
+
+            const auto timestamps = source.getLineTimestamps( chunkStart, linesInChunk );
+            if ( timestamps.empty() ) {
+                // File was reloaded without timestamps, parse the lines instead
+                break;
+            }
+
+            column.insert( column.end(), timestamps.begin(), timestamps.end() );
+            chunkStart = chunkStart + linesInChunk;
+        }
+
+        if ( column.size() == nbLines.get() || interruptRequested ) {
+            return column;
+        }
+    }
+
+    column.clear();
+    auto lastTimestamp = std::numeric_limits<Timestamp>::min();
+
+    auto chunkStart = 0_lnum;
+    while ( chunkStart < nbLines && !interruptRequested ) {
+        const auto linesInChunk = source.getLinesCountInBytes(
+            chunkStart, LinesCount( ( LineNumber( nbLines.get() ) - chunkStart ).get() ),
+            RawChunkBytes );
+
+        const auto rawLines = source.getLinesRaw( chunkStart, linesInChunk );
+        for ( const auto& line : rawLines.buildUtf8View() ) {
+            if ( const auto timestamp = parseTimestamp( line ) ) {
+                lastTimestamp = *timestamp;
+            }
+            column.push_back( lastTimestamp );
+        }
+
+        // Keep the column aligned with line numbers even if reading failed
+        const auto chunkEnd = chunkStart + linesInChunk;
+        column.resize( chunkEnd.get(), lastTimestamp );
+
+        chunkStart = chunkEnd;
+    }
+
+    return column;
+}
+
+} // namespace
+
+MergedLogData::MergedLogData( std::vector<std::shared_ptr<LogData>> sources )
+    : AbstractLogData()
+    , sources_( std::move( sources ) )
+    , index_( sources_.size() )
+{
+    mergePool_.setMaxThreadCount( 1 );
+
+    for ( const auto& source : sources_ ) {
+        connect( source.get(), &LogData::loadingFinished, this, [ this ]( LoadingStatus status ) {
+            if ( status == LoadingStatus::Successful ) {
+                rebuildIndex();
+            }
+        } );
+    }
+}
+
+MergedLogData::~MergedLogData()
+{
+    interruptRequested_.set();
+    mergePool_.waitForDone();
+}
+
+void MergedLogData::rebuildIndex()
+{
+    interruptRebuild();
+    mergePool_.waitForDone();
+    interruptRequested_.clear();
+
+    mergePool_.start( createRunnable( [ this ] {
+        auto index = buildIndex();
+        if ( interruptRequested_ ) {
+            LOG_INFO << "Merge interrupted";
+            return;
+        }
+
+        {
+            UniqueLock lock( indexMutex_ );
+            index_ = std::move( index );
+        }
+
+        Q_EMIT mergeFinished();
+    } ) );
+}
+
+void MergedLogData::interruptRebuild()
+{
+    interruptRequested_.set();
+}
+
+MergedLineIndex MergedLogData::buildIndex()
+{
+    using namespace std::chrono;
+    const auto startTime = high_resolution_clock::now();
+
+    const auto nbSources = sources_.size();
+    std::vector<std::vector<Timestamp>> columns( nbSources );
+    std::atomic<size_t> sourcesDone{ 0 };
+
+    tbb::parallel_for( size_t{ 0 }, nbSources, [ & ]( size_t source ) {
+        columns[ source ] = buildTimestampColumn( *sources_[ source ], interruptRequested_ );
+        Q_EMIT mergeProgressed( calculateProgress( ++sourcesDone, nbSources + 1 ) );
+    } );
+
+    MergedLineIndex index( nbSources );
+    if ( interruptRequested_ ) {
+        return index;
+    }
+
+    const auto columnsTime = high_resolution_clock::now();
+
+    // k-way merge, ties are resolved by source order. Instead of popping
+    // lines one by one the current source gives all its lines that sort
+    // before the head of the next source, this is what makes a run.
+    using HeapItem = std::pair<Timestamp, size_t>;
+    std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<>> heads;
+    std::vector<size_t> cursors( nbSources, 0 );
+
+    for ( auto source = 0u; source < nbSources; ++source ) {
+        if ( !columns[ source ].empty() ) {
+            heads.emplace( columns[ source ].front(), source );
+        }
+    }
+
+    while ( !heads.empty() && !interruptRequested_ ) {
+        const auto source = heads.top().second;
+        heads.pop();
+
+        auto& column = columns[ source ];
+        const auto runStart = cursors[ source ];
+        auto runEnd = runStart + 1;
+
+        if ( heads.empty() ) {
+            runEnd = column.size();
+        }
+        else {
+            const auto& nextHead = heads.top();
+            while ( runEnd < column.size() && HeapItem{ column[ runEnd ], source } < nextHead ) {
+                ++runEnd;
+            }
+        }
+
+        index.append( source, LinesCount( runEnd - runStart ) );
+        cursors[ source ] = runEnd;
+
+        if ( runEnd < column.size() ) {
+            heads.emplace( column[ runEnd ], source );
+        }
+        else {
+            column = {};
+        }
+    }
+
+    const auto endTime = high_resolution_clock::now();
+    LOG_INFO << "Merged " << nbSources << " files, " << index.size() << " lines, index size "
+             << index.allocatedSize() << " bytes";
+    LOG_INFO << "Timestamps parsing took "
+             << duration_cast<microseconds>( columnsTime - startTime );
+    LOG_INFO << "Merging took " << duration_cast<microseconds>( endTime - columnsTime );
+
+    Q_EMIT mergeProgressed( 100 );
+
+    return index;
+}
+
+size_t MergedLogData::getNbSources() const
+{
+    return sources_.size();
+}
+
+const LogData& MergedLogData::getSource( size_t index ) const
+{
+    return *sources_.at( index );
+}
+
+MergedLineIndex::Location MergedLogData::mapToSource( LineNumber line ) const
+{
+    SharedLock lock( indexMutex_ );
+    return index_.at( line );
+}
+
+SearchResults MergedLogData::search( const RegularExpressionPattern& regExp,
+                                     AtomicFlag& interruptRequested ) const
+{
+    const auto nbSources = sources_.size();
+    std::vector<SearchData> sourceResults( nbSources );
+
+    // Each source runs the usual search graph, they all share the same tbb pool
+    tbb::parallel_for( size_t{ 0 }, nbSources, [ & ]( size_t source ) {
+        FullSearchOperation operation( *sources_[ source ], interruptRequested, regExp, 0_lnum,
+                                       maxValue<LineNumber>(), {}, {} );
+        operation.run( sourceResults[ source ] );
+    } );
+
+    SearchResults mergedResults{ {}, 0_length, 0_lcount };
+    if ( interruptRequested ) {
+        return mergedResults;
+    }
+
+    std::vector<std::vector<uint64_t>> sourceMatches( nbSources );
+    std::vector<size_t> cursors( nbSources, 0 );
+    for ( auto source = 0u; source < nbSources; ++source ) {
+        auto results = sourceResults[ source ].takeCurrentResults();
+        sourceMatches[ source ].resize( results.newMatches.cardinality() );
+        results.newMatches.toUint64Array( sourceMatches[ source ].data() );
+        mergedResults.maxLength = qMax( mergedResults.maxLength, results.maxLength );
+    }
+
+    // Segments of each source come in increasing order, so one pass over
+    // the index with a cursor per source maps all matches.
+    std::vector<uint64_t> mergedMatches;
+    {
+        SharedLock lock( indexMutex_ );
+        mergedResults.processedLines = index_.size();
+        index_.forEachSegment( [ & ]( const MergedLineIndex::Segment& segment ) {
+            const auto& matches = sourceMatches[ segment.source ];
+            auto& cursor = cursors[ segment.source ];
+            const auto segmentEnd = ( segment.sourceLine + segment.count ).get();
+            while ( cursor < matches.size() && matches[ cursor ] < segmentEnd ) {
+                if ( matches[ cursor ] >= segment.sourceLine.get() ) {
+                    mergedMatches.push_back( segment.mergedLine.get() + matches[ cursor ]
+                                             - segment.sourceLine.get() );
+                }
+                ++cursor;
+            }
+        } );
+    }
+
+    mergedResults.newMatches.addMany( mergedMatches.size(), mergedMatches.data() );
+    return mergedResults;
+}
+
+//
+// Implementation of virtual functions
+//
+LinesCount MergedLogData::doGetNbLine() const
+{
+    SharedLock lock( indexMutex_ );
+    return index_.size();
+}
+
+LineLength MergedLogData::doGetMaxLength() const
+{
+    auto maxLength = 0_length;
+    for ( const auto& source : sources_ ) {
+        maxLength = qMax( maxLength, source->getMaxLength() );
+    }
+    return maxLength;
+}
+
+LineLength MergedLogData::doGetLineLength( LineNumber line ) const
+{
+    const auto location = mapToSource( line );
+    return sources_[ location.source ]->getLineLength( location.line );
+}
+
+std::vector<LineLength> MergedLogData::doGetLineLengths( LineNumber first,
+                                                        LinesCount number ) const
+{
+    std::vector<MergedLineIndex::Segment> segments;
+    {
+        SharedLock lock( indexMutex_ );
+        segments = index_.segments( first, number );
+    }
+
+    std::vector<LineLength> lengths;
+    lengths.reserve( number.get() );
+
+    for ( const auto& segment : segments ) {
+        const auto segmentLengths
+            = sources_[ segment.source ]->getLineLengths( segment.sourceLine, segment.count );
+        lengths.insert( lengths.end(), segmentLengths.begin(), segmentLengths.end() );
+    }
+
+    return lengths;
+}
+
+void MergedLogData::doSetDisplayEncoding( const char* encoding )
+{
+    for ( const auto& source : sources_ ) {
+        source->setDisplayEncoding( encoding );
+    }
+}
+
+QTextCodec* MergedLogData::doGetDisplayEncoding() const
+{
+    return sources_.empty() ? nullptr : sources_.front()->getDisplayEncoding();
+}
+
+QString MergedLogData::doGetLineString( LineNumber line ) const
+{
+    const auto lines = doGetLines( line, 1_lcount );
+    return lines.empty() ? QString{} : lines.front();
+}
+
+QString MergedLogData::doGetExpandedLineString( LineNumber line ) const
+{
+    const auto lines = doGetExpandedLines( line, 1_lcount );
+    return lines.empty() ? QString{} : lines.front();
+}
+
+std::vector<QString> MergedLogData::doGetLines( LineNumber first, LinesCount number ) const
+{
+    return getLinesFromSources( first, number, false );
+}
+
+std::vector<QString> MergedLogData::doGetExpandedLines( LineNumber first, LinesCount number ) const
+{
+    return getLinesFromSources( first, number, true );
+}
+
+std::vector<AbstractLogData::LineWindow>
+MergedLogData::doGetLineWindows( LineNumber first, LinesCount number, int firstColumn,
+                                 int nbColumns ) const
+{
+    std::vector<MergedLineIndex::Segment> segments;
+    {
+        SharedLock lock( indexMutex_ );
+        segments = index_.segments( first, number );
+    }
+
+    std::vector<LineWindow> windows;
+    windows.reserve( number.get() );
+
+    for ( const auto& segment : segments ) {
+        auto segmentWindows = sources_[ segment.source ]->getLineWindows(
+            segment.sourceLine, segment.count, firstColumn, nbColumns );
+        std::move( segmentWindows.begin(), segmentWindows.end(), std::back_inserter( windows ) );
+    }
+
+    return windows;
+}
+
+std::vector<QString> MergedLogData::getLinesFromSources( LineNumber first, LinesCount number,
+                                                         bool expanded ) const
+{
+    std::vector<MergedLineIndex::Segment> segments;
+    {
+        SharedLock lock( indexMutex_ );
+        segments = index_.segments( first, number );
+    }
+
+    std::vector<QString> lines;
+    lines.reserve( number.get() );
+
+    // Each segment is a contiguous range in one file, read it in one go
+    for ( const auto& segment : segments ) {
+        const auto& source = *sources_[ segment.source ];
+        auto segmentLines = expanded ? source.getExpandedLines( segment.sourceLine, segment.count )
+                                     : source.getLines( segment.sourceLine, segment.count );
+        std::move( segmentLines.begin(), segmentLines.end(), std::back_inserter( lines ) );
+    }
+
+    return lines;
+}
+
+void MergedLogData::doAttachReader() const
+{
+    for ( const auto& source : sources_ ) {
+        source->attachReader();
+    }
+}
+
+void MergedLogData::doDetachReader() const
+{
+    for ( const auto& source : sources_ ) {
+        source->detachReader();
+    }
+}
+
+const AbstractLogData* MergedLogData::doGetSourceData() const
+{
+    // Reading lines takes the index lock, any thread can do it
+    return this;
+}
+
+AbstractLogData::SourceRuns MergedLogData::doGetSourceRuns( LineNumber first,
+                                                           LinesCount number ) const
+{
+    const auto nbLines = doGetNbLine();
+    if ( first >= nbLines ) {
+        return {};
+    }
+
+    return { { first, std::min( number, nbLines - LinesCount( first.get() ) ) } };
+}
+
+void MergedLogData::doPrefetchLines( LineNumber first, LinesCount number ) const
+{
+    std::vector<MergedLineIndex::Segment> segments;
+    {
+        SharedLock lock( indexMutex_ );
+        segments = index_.segments( first, number );
+    }
+
+    std::vector<std::vector<LogData::LineRange>> sourceRanges( sources_.size() );
+    for ( const auto& segment : segments ) {
+        sourceRanges[ segment.source ].emplace_back( segment.sourceLine, segment.count );
+    }
+
+    for ( auto source = 0u; source < sources_.size(); ++source ) {
+        sources_[ source ]->prefetchLineRanges( sourceRanges[ source ] );
+    }
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "searchresultscache.h"
+
+#include <chrono>
+#include <exception>
+#include <utility>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QStandardPaths>
+
+#include "filedigest.h"
+#include "log.h"
+
+namespace {
+constexpr quint32 CacheFileMagic = 0x4b4c5343; // "KLSC"
+constexpr quint32 CacheFileVersion = 1;
+
+constexpr auto MaxCacheFileAge = std::chrono::hours{ 24 * 30 };
+constexpr uint64_t MaxCachedFiles = 16;
+
+QDir cacheDirectory()
+{
+    return QDir( QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) )
+        .filePath( "search" );
+}
+
+bool isSameIndexedData( const IndexedHash& lhs, const IndexedHash& rhs )
+{
+    return lhs.size == rhs.size && lhs.fullDigest == rhs.fullDigest
+           && lhs.headerSize == rhs.headerSize && lhs.headerDigest == rhs.headerDigest;
+}
+} // namespace
+
+std::optional<SearchResultsCache::CachedSearchResult>
+SearchResultsCache::find( const SearchResultsCache::Key& key )
+{
+    const auto entry = index_.find( key );
+    if ( entry == index_.end() ) {
+        return {};
+    }
+
+    entries_.splice( entries_.begin(), entries_, entry->second );
+    return entry->second->result;
+}
+
+bool SearchResultsCache::insert( const SearchResultsCache::Key& key,
+                                 SearchResultsCache::CachedSearchResult result,
+                                 uint64_t maxSizeInBytes )
+{
+    const auto existing = index_.find( key );
+    if ( existing != index_.end() ) {
+        sizeInBytes_ -= existing->second->sizeInBytes;
+        entries_.erase( existing->second );
+        index_.erase( existing );
+    }
+
+    const uint64_t resultSize = result.matching_lines.getSizeInBytes();
+    if ( resultSize > maxSizeInBytes ) {
+        return false;
+    }
+
+    entries_.push_front( Entry{ key, std::move( result ), resultSize } );
+    index_.emplace( key, entries_.begin() );
+    sizeInBytes_ += resultSize;
+
+    evict( maxSizeInBytes );
+    return true;
+}
+
+void SearchResultsCache::evict( uint64_t maxSizeInBytes )
+{
+    // The most recently used entry always fits, see insert
+    while ( sizeInBytes_ > maxSizeInBytes && entries_.size() > 1 ) {
+        const auto& leastRecent = entries_.back();
+        LOG_DEBUG << "SearchResultsCache: evicting " << std::get<0>( leastRecent.key ).pattern
+                  << ", " << leastRecent.sizeInBytes << " bytes";
+
+        sizeInBytes_ -= leastRecent.sizeInBytes;
+        index_.erase( leastRecent.key );
+        entries_.pop_back();
+    }
+}
+
+void SearchResultsCache::clear()
+{
+    index_.clear();
+    entries_.clear();
+    sizeInBytes_ = 0;
+}
+
+QString SearchResultsCache::cacheFilePath( const QString& logFileName )
+{
+    const auto absolutePath = QFileInfo( logFileName ).absoluteFilePath().toUtf8();
+    const auto pathDigest = FileDigest{}.addData( absolutePath ).digest();
+
+    return cacheDirectory().filePath(
+        QString( "%1.cache" ).arg( pathDigest, 16, 16, QChar( '0' ) ) );
+}
+
+bool SearchResultsCache::save( const QString& path, const IndexedHash& hash ) const
+{
+    QDir().mkpath( QFileInfo( path ).absolutePath() );
+
+    QSaveFile file{ path };
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG_ERROR << "Failed to open search cache file " << path;
+        return false;
+    }
+
+    QDataStream stream( &file );
+    stream << CacheFileMagic << CacheFileVersion;
+    stream << hash.size << hash.fullDigest << hash.headerSize << hash.headerDigest;
+    stream << static_cast<quint32>( entries_.size() );
+
+    QByteArray serialized;
+    for ( const auto& entry : entries_ ) {
+        const auto& pattern = std::get<0>( entry.key );
+        stream << pattern.pattern << pattern.isCaseSensitive << pattern.isExclude
+               << pattern.isBoolean << pattern.isPlainText;
+        stream << static_cast<quint64>( std::get<1>( entry.key ) )
+               << static_cast<quint64>( std::get<2>( entry.key ) );
+        stream << static_cast<qint32>( entry.result.maxLength.get() );
+
+        serialized.resize( static_cast<int>( entry.sizeInBytes ) );
+        entry.result.matching_lines.write( serialized.data() );
+        stream << serialized;
+    }
+
+    if ( stream.status() != QDataStream::Ok || !file.commit() ) {
+        LOG_ERROR << "Failed to write search cache file " << path;
+        return false;
+    }
+
+    LOG_INFO << "Saved " << entries_.size() << " cached searches, " << sizeInBytes_
+             << " bytes to " << path;
+    return true;
+}
+
+void SearchResultsCache::prune( uint64_t maxSizeInBytes )
+{
+    const auto oldestKept = QDateTime::currentDateTime().addSecs(
+        -std::chrono::duration_cast<std::chrono::seconds>( MaxCacheFileAge ).count() );
+    const auto maxDirectorySize = maxSizeInBytes * MaxCachedFiles;
+
+    // Most recently saved first
+    const auto cacheFiles = cacheDirectory().entryInfoList( { "*.cache" }, QDir::Files,
+                                                            QDir::Time );
+
+    uint64_t directorySize = 0;
+    for ( const auto& cacheFile : cacheFiles ) {
+        directorySize += static_cast<uint64_t>( cacheFile.size() );
+        if ( cacheFile.lastModified() >= oldestKept && directorySize <= maxDirectorySize ) {
+            continue;
+        }
+
+        LOG_INFO << "Removing search cache file " << cacheFile.filePath();
+        QFile::remove( cacheFile.filePath() );
+        directorySize -= static_cast<uint64_t>( cacheFile.size() );
+    }
+}
+
+bool SearchResultsCache::load( const QString& path, const IndexedHash& hash,
+                               uint64_t maxSizeInBytes )
+{
+    QFile file{ path };
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        return false;
+    }
+
+    QDataStream stream( &file );
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if ( magic != CacheFileMagic || version != CacheFileVersion ) {
+        LOG_WARNING << "Unknown search cache file format " << path;
+        return false;
+    }
+
+    IndexedHash savedHash;
+    stream >> savedHash.size >> savedHash.fullDigest >> savedHash.headerSize
+        >> savedHash.headerDigest;
+    if ( !isSameIndexedData( savedHash, hash ) ) {
+        LOG_INFO << "File changed since search cache was saved, ignoring " << path;
+        return false;
+    }
+
+    quint32 count = 0;
+    stream >> count;
+
+    std::vector<Entry> loaded;
+    QByteArray serialized;
+    for ( quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i ) {
+        RegularExpressionPattern pattern;
+        stream >> pattern.pattern >> pattern.isCaseSensitive >> pattern.isExclude
+            >> pattern.isBoolean >> pattern.isPlainText;
+
+        quint64 startLine = 0;
+        quint64 endLine = 0;
+        qint32 maxLength = 0;
+        stream >> startLine >> endLine >> maxLength >> serialized;
+
+        if ( stream.status() != QDataStream::Ok ) {
+            break;
+        }
+
+        try {
+            auto matches = SearchResultArray::readSafe( serialized.constData(),
+                                                        static_cast<size_t>( serialized.size() ) );
+            loaded.push_back(
+                Entry{ makeKey( pattern, LineNumber( startLine ), LineNumber( endLine ) ),
+                       { std::move( matches ), LineLength( maxLength ) },
+                       static_cast<uint64_t>( serialized.size() ) } );
+        } catch ( const std::exception& e ) {
+            LOG_WARNING << "Corrupted search cache file " << path << ": " << e.what();
+            return false;
+        }
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        LOG_WARNING << "Truncated search cache file " << path;
+        return false;
+    }
+
+    clear();
+    // Entries were saved most recent first
+    for ( auto entry = loaded.rbegin(); entry != loaded.rend(); ++entry ) {
+        insert( entry->key, std::move( entry->result ), maxSizeInBytes );
+    }
+
+    LOG_INFO << "Loaded " << entries_.size() << " cached searches, " << sizeInBytes_
+             << " bytes from " << path;
+    return true;
+}
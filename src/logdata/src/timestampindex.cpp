@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include "timestampindex.h"
+
+void TimestampIndex::append( OptionalTimestamp timestamp )
+{
+    if ( !timestamp ) {
+        if ( nbLines_ == 0 ) {
+            ++pendingLines_;
+        }
+        else {
+            push( last_ );
+        }
+        return;
+    }
+
+    for ( ; pendingLines_ > 0; --pendingLines_ ) {
+        push( *timestamp );
+    }
+
+    push( *timestamp );
+}
+
+void TimestampIndex::push( Timestamp timestamp )
+{
+    if ( nbLines_ % BlockSize == 0 ) {
+        const auto runningMax
+            = blocks_.empty() ? timestamp : std::max( blocks_.back().runningMax, timestamp );
+        blocks_.push_back( Block{ timestamp, timestamp, timestamp, runningMax, deltas_.size() } );
+    }
+    else {
+        const auto delta = timestamp - last_;
+        auto zigzag = ( static_cast<uint64_t>( delta ) << 1 ) ^ static_cast<uint64_t>( delta >> 63 );
+        while ( zigzag >= 0x80 ) {
+            deltas_.push_back( static_cast<uint8_t>( zigzag | 0x80 ) );
+            zigzag >>= 7;
+        }
+        deltas_.push_back( static_cast<uint8_t>( zigzag ) );
+
+        auto& block = blocks_.back();
+        block.min = std::min( block.min, timestamp );
+        block.max = std::max( block.max, timestamp );
+        block.runningMax = std::max( block.runningMax, timestamp );
+    }
+
+    min_ = nbLines_ == 0 ? timestamp : std::min( min_, timestamp );
+    last_ = timestamp;
+    ++nbLines_;
+}
+
+Timestamp TimestampIndex::readDelta( size_t& offset ) const
+{
+    uint64_t zigzag = 0;
+    unsigned shift = 0;
+    uint8_t byte = 0;
+    do {
+        byte = deltas_[ offset++ ];
+        zigzag |= static_cast<uint64_t>( byte & 0x7f ) << shift;
+        shift += 7;
+    } while ( byte & 0x80 );
+
+    return static_cast<Timestamp>( zigzag >> 1 ) ^ -static_cast<Timestamp>( zigzag & 1 );
+}
+
+std::vector<Timestamp> TimestampIndex::decodeBlock( size_t blockIndex, uint64_t count ) const
+{
+    std::vector<Timestamp> timestamps;
+    timestamps.reserve( count );
+
+    const auto& block = blocks_[ blockIndex ];
+    auto offset = block.offset;
+    auto timestamp = block.first;
+    for ( auto line = 0u; line < count; ++line ) {
+        if ( line > 0 ) {
+            timestamp += readDelta( offset );
+        }
+        timestamps.push_back( timestamp );
+    }
+
+    return timestamps;
+}
+
+void TimestampIndex::truncate( LinesCount newSize )
+{
+    if ( nbLines_ == 0 ) {
+        pendingLines_ = std::min( pendingLines_, newSize.get() );
+        return;
+    }
+
+    if ( newSize.get() >= nbLines_ ) {
+        return;
+    }
+
+    const auto blockIndex = newSize.get() / BlockSize;
+    const auto keptTimestamps = decodeBlock( blockIndex, newSize.get() % BlockSize );
+
+    deltas_.resize( blocks_[ blockIndex ].offset );
+    blocks_.resize( blockIndex );
+    nbLines_ = blockIndex * BlockSize;
+
+    min_ = std::numeric_limits<Timestamp>::max();
+    for ( const auto& block : blocks_ ) {
+        min_ = std::min( min_, block.min );
+    }
+
+    for ( const auto timestamp : keptTimestamps ) {
+        push( timestamp );
+    }
+}
+
+void TimestampIndex::clear()
+{
+    blocks_ = {};
+    deltas_ = {};
+    nbLines_ = 0;
+    pendingLines_ = 0;
+    last_ = 0;
+    min_ = 0;
+}
+
+Timestamp TimestampIndex::at( LineNumber line ) const
+{
+    if ( line.get() >= nbLines_ ) {
+        return last_;
+    }
+
+    const auto lineInBlock = line.get() % BlockSize;
+    const auto& block = blocks_[ line.get() / BlockSize ];
+
+    auto offset = block.offset;
+    auto timestamp = block.first;
+    for ( auto i = 0u; i < lineInBlock; ++i ) {
+        timestamp += readDelta( offset );
+    }
+
+    return timestamp;
+}
+
+std::vector<Timestamp> TimestampIndex::slice( LineNumber first, LinesCount count ) const
+{
+    std::vector<Timestamp> timestamps;
+    timestamps.reserve( count.get() );
+
+    auto line = first.get();
+    const auto end = first.get() + count.get();
+    while ( line < std::min( end, nbLines_ ) ) {
+        const auto blockIndex = line / BlockSize;
+        const auto blockEnd = std::min( ( blockIndex + 1 ) * BlockSize, nbLines_ );
+        const auto blockTimestamps = decodeBlock( blockIndex, blockEnd - blockIndex * BlockSize );
+
+        const auto sliceEnd = std::min( blockEnd, end );
+        timestamps.insert( timestamps.end(),
+                           blockTimestamps.begin() + static_cast<ptrdiff_t>( line % BlockSize ),
+                           blockTimestamps.begin()
+                               + static_cast<ptrdiff_t>( sliceEnd - blockIndex * BlockSize ) );
+        line = sliceEnd;
+    }
+
+    timestamps.resize( count.get(), last_ );
+    return timestamps;
+}
+
+std::pair<Timestamp, Timestamp> TimestampIndex::range() const
+{
+    if ( blocks_.empty() ) {
+        return { 0, 0 };
+    }
+
+    return { min_, blocks_.back().runningMax };
+}
+
+OptionalLineNumber TimestampIndex::findLineAtOrAfter( Timestamp timestamp ) const
+{
+    const auto block = std::partition_point(
+        blocks_.begin(), blocks_.end(),
+        [ timestamp ]( const Block& b ) { return b.runningMax < timestamp; } );
+
+    if ( block == blocks_.end() ) {
+        return {};
+    }
+
+    const auto blockIndex = static_cast<size_t>( std::distance( blocks_.begin(), block ) );
+    const auto blockStart = blockIndex * BlockSize;
+    const auto linesInBlock = std::min( BlockSize, nbLines_ - blockStart );
+    const auto timestamps = decodeBlock( blockIndex, linesInBlock );
+
+    const auto line = std::find_if( timestamps.begin(), timestamps.end(),
+                                    [ timestamp ]( Timestamp t ) { return t >= timestamp; } );
+
+    return LineNumber(
+        blockStart + static_cast<uint64_t>( std::distance( timestamps.begin(), line ) ) );
+}
+
+size_t TimestampIndex::allocatedSize() const
+{
+    return blocks_.capacity() * sizeof( Block ) + deltas_.capacity();
+}
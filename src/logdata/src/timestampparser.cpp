@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <QtEndian>
+
+#include "timestampparser.h"
+
+namespace {
+
+constexpr Timestamp MillisecondsInSecond = 1000;
+constexpr Timestamp SecondsInDay = 86400;
+
+constexpr bool isDigit( char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+constexpr int digitValue( char c )
+{
+    return c - '0';
+}
+
+// Fixed layouts are checked 8 bytes at a time: a byte is an ASCII digit if
+// its high nibble is 3 and adding 6 does not move it out of the 0x3X range.
+// Carries between bytes can only produce false negatives.
+bool areDigits( const char* data, uint64_t mask )
+{
+    constexpr uint64_t HighNibbles = 0xF0F0F0F0F0F0F0F0ull;
+    constexpr uint64_t Zeroes = 0x3030303030303030ull;
+    constexpr uint64_t Sixes = 0x0606060606060606ull;
+
+    const auto value = qFromLittleEndian<quint64>( data );
+    const auto wrongHigh = ( value & HighNibbles ) ^ Zeroes;
+    const auto overflow = ( ( value + Sixes ) & HighNibbles ) ^ Zeroes;
+
+    return ( ( wrongHigh | overflow ) & mask ) == 0;
+}
+
+int twoDigits( const char* data )
+{
+    return digitValue( data[ 0 ] ) * 10 + digitValue( data[ 1 ] );
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+int64_t daysFromCivil( int64_t year, unsigned month, unsigned day )
+{
+    year -= month <= 2 ? 1 : 0;
+    const auto era = ( year >= 0 ? year : year - 399 ) / 400;
+    const auto yearOfEra = static_cast<unsigned>( year - era * 400 );
+    const auto dayOfYear = ( 153 * ( month + ( month > 2 ? -3 : 9 ) ) + 2 ) / 5 + day - 1;
+    const auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>( dayOfEra ) - 719468;
+}
+
+int parseFraction( std::string_view line, size_t pos )
+{
+    int milliseconds = 0;
+    if ( pos + 1 < line.size() && ( line[ pos ] == '.' || line[ pos ] == ',' ) ) {
+        int scale = 100;
+        for ( ++pos; pos < line.size() && isDigit( line[ pos ] ); ++pos ) {
+            milliseconds += digitValue( line[ pos ] ) * scale;
+            scale /= 10;
+        }
+    }
+    return milliseconds;
+}
+
+// "hh:mm:ss", 8 bytes must be available
+OptionalTimestamp parseTime( const char* data )
+{
+    // digits at 0, 1, 3, 4, 6, 7
+    constexpr uint64_t TimeDigitsMask = 0xFFFF00FFFF00FFFFull;
+    if ( data[ 2 ] != ':' || data[ 5 ] != ':' || !areDigits( data, TimeDigitsMask ) ) {
+        return {};
+    }
+
+    const auto hour = twoDigits( data );
+    const auto minute = twoDigits( data + 3 );
+    const auto second = twoDigits( data + 6 );
+    if ( hour > 23 || minute > 59 || second > 60 ) {
+        return {};
+    }
+
+    return hour * 3600 + minute * 60 + second;
+}
+
+OptionalTimestamp parseIso8601( std::string_view line )
+{
+    // YYYY-MM-DD hh:mm:ss
+    if ( line.size() < 19 || line[ 4 ] != '-' || line[ 7 ] != '-'
+         || ( line[ 10 ] != 'T' && line[ 10 ] != ' ' ) ) {
+        return {};
+    }
+
+    // digits at 0, 1, 2, 3, 5, 6
+    constexpr uint64_t DateDigitsMask = 0x00FFFF00FFFFFFFFull;
+    if ( !areDigits( line.data(), DateDigitsMask ) || !isDigit( line[ 8 ] )
+         || !isDigit( line[ 9 ] ) ) {
+        return {};
+    }
+
+    const auto time = parseTime( line.data() + 11 );
+    if ( !time ) {
+        return {};
+    }
+
+    const auto year = twoDigits( line.data() ) * 100 + twoDigits( line.data() + 2 );
+    const auto month = twoDigits( line.data() + 5 );
+    const auto day = twoDigits( line.data() + 8 );
+    if ( month < 1 || month > 12 || day < 1 || day > 31 ) {
+        return {};
+    }
+
+    const auto days
+        = daysFromCivil( year, static_cast<unsigned>( month ), static_cast<unsigned>( day ) );
+    return ( days * SecondsInDay + *time ) * MillisecondsInSecond + parseFraction( line, 19 );
+}
+
+int syslogMonth( const char* data )
+{
+    static constexpr std::string_view Months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    const auto name = std::string_view( data, 3 );
+    for ( auto month = 0u; month < std::size( Months ); ++month ) {
+        if ( Months[ month ] == name ) {
+            return static_cast<int>( month ) + 1;
+        }
+    }
+    return 0;
+}
+
+OptionalTimestamp parseSyslog( std::string_view line )
+{
+    // Mmm dd hh:mm:ss, day is space padded
+    if ( line.size() < 15 || line[ 3 ] != ' ' || line[ 6 ] != ' ' || !isDigit( line[ 5 ] )
+         || ( line[ 4 ] != ' ' && !isDigit( line[ 4 ] ) ) ) {
+        return {};
+    }
+
+    const auto month = syslogMonth( line.data() );
+    const auto time = parseTime( line.data() + 7 );
+    if ( month == 0 || !time ) {
+        return {};
+    }
+
+    const auto day = ( line[ 4 ] == ' ' ? 0 : digitValue( line[ 4 ] ) * 10 )
+                     + digitValue( line[ 5 ] );
+    if ( day < 1 || day > 31 ) {
+        return {};
+    }
+
+    const auto days
+        = daysFromCivil( 1970, static_cast<unsigned>( month ), static_cast<unsigned>( day ) );
+    return ( days * SecondsInDay + *time ) * MillisecondsInSecond + parseFraction( line, 15 );
+}
+
+} // namespace
+
+OptionalTimestamp parseTimestamp( std::string_view line, TimestampLayout layout )
+{
+    if ( !line.empty() && line.front() == '[' ) {
+        line.remove_prefix( 1 );
+    }
+
+    if ( line.empty() ) {
+        return {};
+    }
+
+    switch ( layout ) {
+    case TimestampLayout::Iso8601:
+        return parseIso8601( line );
+    case TimestampLayout::Syslog:
+        return parseSyslog( line );
+    case TimestampLayout::Auto:
+        break;
+    }
+
+    return isDigit( line.front() ) ? parseIso8601( line ) : parseSyslog( line );
+}
+
+OptionalTimestamp parseTimeOfDay( std::string_view text )
+{
+    // hh:mm is completed with zero seconds
+    char time[ 8 ] = { '0', '0', ':', '0', '0', ':', '0', '0' };
+    if ( text.size() < 5 ) {
+        return {};
+    }
+
+    std::copy_n( text.data(), std::min( text.size(), sizeof( time ) ), time );
+
+    const auto seconds = parseTime( time );
+    if ( !seconds ) {
+        return {};
+    }
+
+    return *seconds * MillisecondsInSecond + parseFraction( text, 8 );
+}
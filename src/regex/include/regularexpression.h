@@ -34,12 +34,22 @@ class BooleanExpressionEvaluator;
 class RegularExpression {
   public:
     RegularExpression( const RegularExpressionPattern& pattern );
+    // Matches all patterns in one pass, use PatternMatcher::matchedPatterns
+    // to get which of them matched a line.
+    explicit RegularExpression( const std::vector<RegularExpressionPattern>& patterns );
 
     std::unique_ptr<PatternMatcher> createMatcher() const;
 
     bool isValid() const;
     QString errorString() const;
 
+    bool isInverse() const;
+    bool isBooleanCombination() const;
+
+    // Boolean expression over ids of the sub-patterns
+    const QString& expression() const;
+    const std::vector<RegularExpressionPattern>& subPatterns() const;
+
   private:
     bool isInverse_ = false;
     bool isBooleanCombination_ = false;
@@ -61,6 +71,8 @@ class PatternMatcher {
     ~PatternMatcher();
 
     bool hasMatch( std::string_view line ) const;
+    // One flag per sub-pattern, without applying the boolean expression
+    MatchedPatterns matchedPatterns( std::string_view line ) const;
 
   private:
     using MatchFunc = bool ( * )( std::string_view line, const MatcherVariant& matcher, BooleanExpressionEvaluator* evaluator );
@@ -137,6 +137,26 @@ RegularExpression::RegularExpression( const RegularExpressionPattern& pattern )
     }
 }
 
+RegularExpression::RegularExpression( const std::vector<RegularExpressionPattern>& patterns )
+    : subPatterns_( patterns )
+{
+    if ( subPatterns_.empty() ) {
+        errorString_ = "No patterns to match";
+        return;
+    }
+
+    expression_ = QString::fromStdString( subPatterns_.front().id() );
+
+    try {
+        hsExpression_ = HsRegularExpression( subPatterns_ );
+        isValid_ = hsExpression_.isValid();
+        errorString_ = hsExpression_.errorString();
+    } catch ( std::exception& err ) {
+        isValid_ = false;
+        errorString_ = err.what();
+    }
+}
+
 bool RegularExpression::isValid() const
 {
     return isValid_;
@@ -147,6 +167,26 @@ QString RegularExpression::errorString() const
     return errorString_;
 }
 
+bool RegularExpression::isInverse() const
+{
+    return isInverse_;
+}
+
+bool RegularExpression::isBooleanCombination() const
+{
+    return isBooleanCombination_;
+}
+
+const QString& RegularExpression::expression() const
+{
+    return expression_;
+}
+
+const std::vector<RegularExpressionPattern>& RegularExpression::subPatterns() const
+{
+    return subPatterns_;
+}
+
 std::unique_ptr<PatternMatcher> RegularExpression::createMatcher() const
 {
     return std::make_unique<PatternMatcher>( *this );
@@ -214,4 +254,9 @@ PatternMatcher::~PatternMatcher() = default;
 bool PatternMatcher::hasMatch( std::string_view line ) const
 {
     return hasMatchImpl_( line, matcher_, evaluator_.get() );
-}
\ No newline at end of file
+}
+
+MatchedPatterns PatternMatcher::matchedPatterns( std::string_view line ) const
+{
+    return std::visit( [ &line ]( const auto& m ) { return m.match( line ); }, matcher_ );
+}
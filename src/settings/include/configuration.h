@@ -43,6 +43,7 @@
 #include <QColor>
 #include <QFont>
 #include <QSettings>
+#include <QStringList>
 #include <qcolor.h>
 #include <string>
 #include <string_view>
@@ -57,6 +58,9 @@ enum class SearchRegexpType {
 };
 
 enum class RegexpEngine { Hyperscan, QRegularExpression };
+
+// Layout of the timestamp at the beginning of log lines
+enum class TimestampFormat { None, Auto, Iso8601, Syslog };
 static constexpr int MAX_RECENT_FILES = 25;
 
 // Configuration class containing everything in the "Settings" dialog
@@ -181,29 +185,74 @@ class Configuration final : public Persistable<Configuration> {
     {
         useSearchResultsCache_ = enabled;
     }
-    unsigned searchResultsCacheLines() const
+    unsigned searchResultsCacheSizeMb() const
     {
-        return searchResultsCacheLines_;
+        return searchResultsCacheSizeMb_;
     }
-    void setSearchResultsCacheLines( unsigned lines )
+    void setSearchResultsCacheSizeMb( unsigned sizeMb )
     {
-        searchResultsCacheLines_ = lines;
+        searchResultsCacheSizeMb_ = sizeMb;
     }
-    int indexReadBufferSizeMb() const
+    bool persistSearchResultsCache() const
     {
-        return indexReadBufferSizeMb_;
+        return persistSearchResultsCache_;
     }
-    void setIndexReadBufferSizeMb( int bufferSizeMb )
+    void setPersistSearchResultsCache( bool persist )
     {
-        indexReadBufferSizeMb_ = bufferSizeMb;
+        persistSearchResultsCache_ = persist;
+    }
+    // 0 means half of the physical memory
+    unsigned memoryBudgetMb() const
+    {
+        return memoryBudgetMb_;
+    }
+    void setMemoryBudgetMb( unsigned budgetMb )
+    {
+        memoryBudgetMb_ = budgetMb;
+    }
+    // Files of background tabs read at the same time from one device
+    int ioStreamsPerDevice() const
+    {
+        return ioStreamsPerDevice_;
+    }
+    void setIoStreamsPerDevice( int streams )
+    {
+        ioStreamsPerDevice_ = streams;
+    }
+    // Files from this size use the compact Elias-Fano line index, 0 means never
+    unsigned compactIndexMinFileSizeGb() const
+    {
+        return compactIndexMinFileSizeGb_;
+    }
+    void setCompactIndexMinFileSizeGb( unsigned sizeGb )
+    {
+        compactIndexMinFileSizeGb_ = sizeGb;
+    }
+    // Load tabs restored from the session in background when idle
+    bool warmUpSessionTabs() const
+    {
+        return warmUpSessionTabs_;
+    }
+    void setWarmUpSessionTabs( bool warmUp )
+    {
+        warmUpSessionTabs_ = warmUp;
     }
-    int searchReadBufferSizeLines() const
+    // Search the lines shown in the main view before the rest of the file
+    bool searchVisibleLinesFirst() const
     {
-        return searchReadBufferSizeLines_;
+        return searchVisibleLinesFirst_;
     }
-    void setSearchReadBufferSizeLines( int lines )
+    void setSearchVisibleLinesFirst( bool visibleFirst )
     {
-        searchReadBufferSizeLines_ = lines;
+        searchVisibleLinesFirst_ = visibleFirst;
+    }
+    int indexReadBufferSizeMb() const
+    {
+        return indexReadBufferSizeMb_;
+    }
+    void setIndexReadBufferSizeMb( int bufferSizeMb )
+    {
+        indexReadBufferSizeMb_ = bufferSizeMb;
     }
     int searchThreadPoolSize() const
     {
@@ -259,6 +308,14 @@ class Configuration final : public Persistable<Configuration> {
     {
         return lineNumbersVisibleInFiltered_;
     }
+    bool linesWrapped() const
+    {
+        return linesWrapped_;
+    }
+    bool fieldColumnsVisible() const
+    {
+        return fieldColumnsVisible_;
+    }
     bool minimizeToTray() const
     {
         return minimizeToTray_;
@@ -275,6 +332,14 @@ class Configuration final : public Persistable<Configuration> {
     {
         lineNumbersVisibleInFiltered_ = lineNumbersVisible;
     }
+    void setLinesWrapped( bool linesWrapped )
+    {
+        linesWrapped_ = linesWrapped;
+    }
+    void setFieldColumnsVisible( bool fieldColumnsVisible )
+    {
+        fieldColumnsVisible_ = fieldColumnsVisible;
+    }
     void setMinimizeToTray( bool minimizeToTray )
     {
         minimizeToTray_ = minimizeToTray;
@@ -463,6 +528,25 @@ class Configuration final : public Persistable<Configuration> {
         optimizeForNotLatinEncodings_ = enable;
     }
 
+    TimestampFormat timestampFormat() const
+    {
+        return timestampFormat_;
+    }
+    void setTimestampFormat( TimestampFormat format )
+    {
+        timestampFormat_ = format;
+    }
+
+    // Fields of JSON lines indexed for field filters, none if empty
+    QStringList structuredFields() const
+    {
+        return structuredFields_;
+    }
+    void setStructuredFields( const QStringList& fields )
+    {
+        structuredFields_ = fields;
+    }
+
     bool hideAnsiColorSequences() const
     {
         return hideAnsiColorSequences_;
@@ -515,6 +599,8 @@ class Configuration final : public Persistable<Configuration> {
     bool overviewVisible_ = true;
     bool lineNumbersVisibleInMain_ = false;
     bool lineNumbersVisibleInFiltered_ = true;
+    bool linesWrapped_ = false;
+    bool fieldColumnsVisible_ = false;
     bool minimizeToTray_ = false;
     QString style_;
 
@@ -525,12 +611,19 @@ class Configuration final : public Persistable<Configuration> {
 
     // Performance settings
     bool useSearchResultsCache_ = true;
-    unsigned searchResultsCacheLines_ = 1000000;
+    unsigned searchResultsCacheSizeMb_ = 128;
+    bool persistSearchResultsCache_ = true;
+    unsigned memoryBudgetMb_ = 0;
+    int ioStreamsPerDevice_ = 1;
+    unsigned compactIndexMinFileSizeGb_ = 64;
+    bool warmUpSessionTabs_ = false;
+    bool searchVisibleLinesFirst_ = true;
     bool useParallelSearch_ = true;
     int indexReadBufferSizeMb_ = 16;
-    int searchReadBufferSizeLines_ = 10000;
     int searchThreadPoolSize_ = 0;
     bool keepFileClosed_ = false;
+    TimestampFormat timestampFormat_ = TimestampFormat::Auto;
+    QStringList structuredFields_;
 
     bool enableLogging_ = false;
     int loggingLevel_ = 4;
@@ -216,18 +216,34 @@ void Configuration::retrieveFromStorage( QSettings& settings )
         = settings
               .value( "perf.useSearchResultsCache", DefaultConfiguration.useSearchResultsCache_ )
               .toBool();
-    searchResultsCacheLines_ = settings
-                                   .value( "perf.searchResultsCacheLines",
-                                           DefaultConfiguration.searchResultsCacheLines_ )
-                                   .toUInt();
+    searchResultsCacheSizeMb_ = settings
+                                    .value( "perf.searchResultsCacheSizeMb",
+                                            DefaultConfiguration.searchResultsCacheSizeMb_ )
+                                    .toUInt();
+    persistSearchResultsCache_ = settings
+                                     .value( "perf.persistSearchResultsCache",
+                                             DefaultConfiguration.persistSearchResultsCache_ )
+                                     .toBool();
+    memoryBudgetMb_
+        = settings.value( "perf.memoryBudgetMb", DefaultConfiguration.memoryBudgetMb_ ).toUInt();
+    ioStreamsPerDevice_
+        = settings.value( "perf.ioStreamsPerDevice", DefaultConfiguration.ioStreamsPerDevice_ )
+              .toInt();
+    compactIndexMinFileSizeGb_ = settings
+                                     .value( "perf.compactIndexMinFileSizeGb",
+                                             DefaultConfiguration.compactIndexMinFileSizeGb_ )
+                                     .toUInt();
+    warmUpSessionTabs_
+        = settings.value( "perf.warmUpSessionTabs", DefaultConfiguration.warmUpSessionTabs_ )
+              .toBool();
+    searchVisibleLinesFirst_ = settings
+                                   .value( "perf.searchVisibleLinesFirst",
+                                           DefaultConfiguration.searchVisibleLinesFirst_ )
+                                   .toBool();
     indexReadBufferSizeMb_
         = settings
               .value( "perf.indexReadBufferSizeMb", DefaultConfiguration.indexReadBufferSizeMb_ )
               .toInt();
-    searchReadBufferSizeLines_ = settings
-                                     .value( "perf.searchReadBufferSizeLines",
-                                             DefaultConfiguration.searchReadBufferSizeLines_ )
-                                     .toInt();
     searchThreadPoolSize_
         = settings.value( "perf.searchThreadPoolSize", DefaultConfiguration.searchThreadPoolSize_ )
               .toInt();
@@ -238,6 +254,14 @@ void Configuration::retrieveFromStorage( QSettings& settings )
                                         .value( "perf.optimizeForNotLatinEncodings",
                                                 DefaultConfiguration.optimizeForNotLatinEncodings_ )
                                         .toBool();
+    timestampFormat_ = static_cast<TimestampFormat>(
+        settings
+            .value( "perf.timestampFormat",
+                    static_cast<int>( DefaultConfiguration.timestampFormat_ ) )
+            .toInt() );
+    structuredFields_
+        = settings.value( "perf.structuredFields", DefaultConfiguration.structuredFields_ )
+              .toStringList();
 
     verifySslPeers_
         = settings.value( "net.verifySslPeers", DefaultConfiguration.verifySslPeers_ ).toBool();
@@ -253,6 +277,12 @@ void Configuration::retrieveFromStorage( QSettings& settings )
                                         .value( "view.lineNumbersVisibleInFiltered",
                                                 DefaultConfiguration.lineNumbersVisibleInFiltered_ )
                                         .toBool();
+    linesWrapped_
+        = settings.value( "view.linesWrapped", DefaultConfiguration.linesWrapped_ ).toBool();
+    fieldColumnsVisible_ = settings
+                               .value( "view.fieldColumnsVisible",
+                                       DefaultConfiguration.fieldColumnsVisible_ )
+                               .toBool();
     minimizeToTray_
         = settings.value( "view.minimizeToTray", DefaultConfiguration.minimizeToTray_ ).toBool();
 
@@ -363,18 +393,27 @@ void Configuration::saveToStorage( QSettings& settings ) const
 
     settings.setValue( "perf.useParallelSearch", useParallelSearch_ );
     settings.setValue( "perf.useSearchResultsCache", useSearchResultsCache_ );
-    settings.setValue( "perf.searchResultsCacheLines", searchResultsCacheLines_ );
+    settings.setValue( "perf.searchResultsCacheSizeMb", searchResultsCacheSizeMb_ );
+    settings.setValue( "perf.persistSearchResultsCache", persistSearchResultsCache_ );
+    settings.setValue( "perf.memoryBudgetMb", memoryBudgetMb_ );
+    settings.setValue( "perf.ioStreamsPerDevice", ioStreamsPerDevice_ );
+    settings.setValue( "perf.compactIndexMinFileSizeGb", compactIndexMinFileSizeGb_ );
+    settings.setValue( "perf.warmUpSessionTabs", warmUpSessionTabs_ );
+    settings.setValue( "perf.searchVisibleLinesFirst", searchVisibleLinesFirst_ );
     settings.setValue( "perf.indexReadBufferSizeMb", indexReadBufferSizeMb_ );
-    settings.setValue( "perf.searchReadBufferSizeLines", searchReadBufferSizeLines_ );
     settings.setValue( "perf.searchThreadPoolSize", searchThreadPoolSize_ );
     settings.setValue( "perf.keepFileClosed", keepFileClosed_ );
     settings.setValue( "perf.optimizeForNotLatinEncodings", optimizeForNotLatinEncodings_ );
+    settings.setValue( "perf.timestampFormat", static_cast<int>( timestampFormat_ ) );
+    settings.setValue( "perf.structuredFields", structuredFields_ );
 
     settings.setValue( "net.verifySslPeers", verifySslPeers_ );
 
     settings.setValue( "view.overviewVisible", overviewVisible_ );
     settings.setValue( "view.lineNumbersVisibleInMain", lineNumbersVisibleInMain_ );
     settings.setValue( "view.lineNumbersVisibleInFiltered", lineNumbersVisibleInFiltered_ );
+    settings.setValue( "view.linesWrapped", linesWrapped_ );
+    settings.setValue( "view.fieldColumnsVisible", fieldColumnsVisible_ );
     settings.setValue( "view.minimizeToTray", minimizeToTray_ );
     settings.setValue( "view.style", style_ );
 
@@ -43,6 +43,7 @@
 #include <array>
 #include <cstddef>
 #include <functional>
+#include <optional>
 #include <string_view>
 #include <vector>
 
@@ -52,11 +53,13 @@
 #include <QEvent>
 #include <QFontMetrics>
 
-#ifdef GLOGG_PERF_MEASURE_FPS
-#include "perfcounter.h"
-#endif
-
 #include "abstractlogdata.h"
+#include "glyphcache.h"
+#include "highlightengine.h"
+#include "jsonfieldparser.h"
+#include "lineprefetcher.h"
+#include "selectionexporter.h"
+#include "wrappedrowindex.h"
 #include "linetypes.h"
 #include "overviewwidget.h"
 #include "quickfind.h"
@@ -135,8 +138,9 @@ class LineDrawer {
     // leftExtraBackgroundPx is the an extra margin to start drawing
     // the coloured // background, going all the way to the element
     // left of the line looks better.
-    void draw( QPainter* painter, int xPos, int yPos, int lineWidth, const QString& line,
-               int leftExtraBackgroundPx );
+    // Chunks made of characters the glyph cache has are drawn through it.
+    void draw( QPainter* painter, GlyphCache& glyphCache, int xPos, int yPos, int lineWidth,
+               const QString& line, int leftExtraBackgroundPx );
 
   private:
     std::vector<LineChunk> chunks_;
@@ -197,6 +201,11 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
 
     // Refresh the widget when the data set has changed.
     void updateData();
+    // Draws and measures the lines again, e.g. once long lines are indexed.
+    void refreshLineLengths();
+    // Waits for the work reading the data in the background to be over,
+    // to be called before the data is destroyed.
+    void stopBackgroundWork();
     // Instructs the widget to update it's content geometry,
     // used when the font is changed.
     void updateDisplaySize();
@@ -246,6 +255,10 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     virtual LineNumber lineIndex( LineNumber lineNumber ) const;
     virtual LineNumber maxDisplayLineNumber() const;
 
+    // Whether the data only changes by getting new lines at its end,
+    // the rows of wrapped lines are then counted incrementally.
+    virtual bool isDataAppendOnly() const;
+
     // Get the overview associated with this view, or NULL if there is none
     Overview* getOverview() const
     {
@@ -274,9 +287,9 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     void notifyQuickFind( const QFNotification& message );
     // Sent up when quickFind wants to clear the notification.
     void clearQuickFindNotification();
-    // Sent when the view ask for a line to be marked
-    // (click in the left margin).
-    void markLines( const std::vector<LineNumber>& lines );
+    // Sent when the view ask for a range of lines to be marked
+    // (click in the left margin or selection).
+    void markLines( LineNumber firstLine, LinesCount count );
     // Sent up when the user wants to add the selection to the search
     void addToSearch( const QString& selection );
     // Sent up when the user wants to replace the search with the selection
@@ -340,6 +353,13 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // Configure the setting of whether to show line number margin
     void setLineNumbersVisible( bool lineNumbersVisible );
 
+    // Configure whether long lines are wrapped to the width of the view
+    void setLinesWrapped( bool wrapLines );
+
+    // Configure whether the structured fields of JSON lines are shown
+    // in columns next to the line numbers
+    void setFieldColumnsVisible( bool fieldColumnsVisible );
+
     // Force the next refresh to fully redraw the view by invalidating the cache.
     // To be used if the data might have changed.
     void forceRefresh();
@@ -363,6 +383,7 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     void setQuickFindResult( bool hasMatch, Portion selection );
     void setHighlighterSet( QAction* action );
     void setColorLabel( QAction* action );
+    void updateWrappedRows();
 
   private:
     // Graphic parameters
@@ -388,6 +409,15 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // Whether to show line numbers or not
     bool lineNumbersVisible_ = false;
 
+    // Whether long lines are wrapped, the view then scrolls by rows
+    // and has no horizontal scrolling
+    bool wrapLines_ = false;
+
+    // Whether to show structured fields in columns, values are parsed
+    // from the drawn lines
+    bool fieldColumnsVisible_ = false;
+    std::optional<JsonFieldParser> fieldParser_;
+
     // Pointer to the CrawlerWidget's data set
     const AbstractLogData* logData_;
 
@@ -431,6 +461,20 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     LineNumber firstLine_;
     bool lastLineAligned_ = false;
     int firstCol_ = 0;
+    // First row of firstLine_ shown when lines are wrapped
+    uint64_t firstRowInLine_ = 0;
+
+    // A row of text on the screen, lines are drawn on several rows
+    // when wrapped, their bullet and number only on the first one.
+    struct VisualRow {
+        LineNumber line;
+        int firstColumn;
+        int nbColumns;
+        bool isLineStart;
+    };
+    // Rows drawn the last time the text area was, used to know
+    // where the lines are when they are wrapped
+    std::vector<VisualRow> visualRows_;
 
     LineNumber searchStart_;
     LineNumber searchEnd_;
@@ -469,11 +513,6 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     // Our own QuickFind object
     QuickFind* quickFind_;
 
-#ifdef GLOGG_PERF_MEASURE_FPS
-    // Performance measurement
-    PerfCounter perfCounter_;
-#endif
-
     // Vertical offset (in pixels) at which the first line of text is written
     int drawingTopOffset_ = 0;
 
@@ -484,17 +523,49 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
         LineNumber first_line_;
         LineNumber last_line_;
         int first_column_;
+        uint64_t first_row_in_line_;
+        int line_number_digits_;
     };
     struct PullToFollowCache {
         QPixmap pixmap_;
         int nb_columns_;
     };
-    TextAreaCache textAreaCache_ = { {}, true, 0_lnum, 0_lnum, 0 };
+    TextAreaCache textAreaCache_ = { {}, true, 0_lnum, 0_lnum, 0, 0, 0 };
     PullToFollowCache pullToFollowCache_ = { {}, 0 };
+    HighlightEngine highlightEngine_;
+    // Inputs the rules of highlightEngine_ were built from
+    struct HighlightRulesKey {
+        uint64_t highlightersGeneration;
+        uint64_t viewGeneration;
+        bool highlightPatternMatches;
+        bool variateHighlightPatternMatches;
+        QColor mainSearchBackColor;
+
+        bool operator==( const HighlightRulesKey& other ) const
+        {
+            return highlightersGeneration == other.highlightersGeneration
+                   && viewGeneration == other.viewGeneration
+                   && highlightPatternMatches == other.highlightPatternMatches
+                   && variateHighlightPatternMatches == other.variateHighlightPatternMatches
+                   && mainSearchBackColor == other.mainSearchBackColor;
+        }
+    };
+    std::optional<HighlightRulesKey> highlightRulesKey_;
+    // Bumped when the search pattern or the quick highlighted words change
+    uint64_t highlightRulesGeneration_ = 0;
+    GlyphCache glyphCache_;
+    LinePrefetcher linePrefetcher_;
+    SelectionExporter selectionExporter_;
+    WrappedRowIndex wrappedRowIndex_;
     QFontMetrics pixmapFontMetrics_;
 
     LinesCount getNbVisibleLines() const;
     int getNbVisibleCols() const;
+    // Width of the rows lines are wrapped into
+    int getWrapColumns() const;
+
+    const VisualRow* visualRowAt( int yPos ) const;
+    bool isLineVisible( LineNumber line ) const;
 
     FilePos convertCoordToFilePos( const QPoint& pos ) const;
     OptionalLineNumber convertCoordToLine( int yPos ) const;
@@ -519,6 +590,8 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
 
     LineLength maxLineLength(const std::vector<LineNumber>& lines) const;
 
+    void exportLines( LineNumber firstLine, LinesCount count, const QString& fileName );
+
     // Search functions (for n/N)
     using QuickFindSearchFn = void ( QuickFind::* )( Selection, QuickFindMatcher );
     void searchUsingFunction( QuickFindSearchFn searchFunction );
@@ -526,10 +599,24 @@ class AbstractLogView : public QAbstractScrollArea, public SearchableWidgetInter
     void updateScrollBars();
 
     LineNumber verticalScrollToLineNumber( int scrollPosition ) const;
-    int lineNumberToVerticalScroll( LineNumber line ) const;
+    int lineNumberToVerticalScroll( LineNumber line );
+    int rowToVerticalScroll( uint64_t row ) const;
     double verticalScrollMultiplicator() const;
+    // Number of rows to scroll through, the number of lines unless wrapped
+    uint64_t getNbScrollRows() const;
+
+    // Rebuild the highlight rules if anything they are made of has changed
+    void updateHighlightRules();
 
+    // Draw the whole text area on the passed device.
     void drawTextArea( QPaintDevice* paintDevice );
+    // Redraw only the rows (relative to firstLine_) and columns (relative
+    // to firstCol_) passed, the rest of the device is left untouched.
+    void drawTextArea( QPaintDevice* paintDevice, int firstRow, int nbRows, int firstColumn,
+                       int nbColumns );
+    // Shift the cached text area after a scroll and redraw the exposed part,
+    // returns false if the cache can't be reused and needs a full redraw.
+    bool scrollTextAreaCache( int deltaRows, int deltaColumns );
     QPixmap drawPullToFollowBar( int width, qreal pixelRatio );
 
     void disableFollow();
@@ -47,6 +47,7 @@
 #include <QComboBox>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QLineEdit>
 #include <QMenu>
 #include <QPushButton>
 #include <QSplitter>
@@ -83,6 +84,7 @@ class CrawlerWidget : public QSplitter,
 
   public:
     CrawlerWidget( QWidget* parent = nullptr );
+    ~CrawlerWidget() override;
 
     // Get the line number of the first line displayed.
     LineNumber getTopLine() const;
@@ -120,6 +122,7 @@ class CrawlerWidget : public QSplitter,
 
     void focusSearchEdit();
     void goToLine();
+    void goToTime();
 
     // Instructs the widget to reconfigure itself because Config() has changed.
     void applyConfiguration();
@@ -193,9 +196,9 @@ class CrawlerWidget : public QSplitter,
     // Called when the main view is on a new line number
     void updateLineNumberHandler( LineNumber line );
     // Mark a line that has been clicked on the main (top) view.
-    void markLinesFromMain( const std::vector<LineNumber>& lines );
+    void markLinesFromMain( LineNumber firstLine, LinesCount count );
     // Mark a line that has been clicked on the filtered (bottom) view.
-    void markLinesFromFiltered( const std::vector<LineNumber>& lines );
+    void markLinesFromFiltered( LineNumber firstIndex, LinesCount count );
 
     void loadingFinishedHandler( LoadingStatus status );
     // Manages the info lines to inform the user the file has changed.
@@ -216,6 +219,9 @@ class CrawlerWidget : public QSplitter,
     // Called when the checkbox for using regex is changed
     void useRegexpChangeHandler( bool shouldUseRegex );
 
+    // Called when the checkbox for structured field filters is changed
+    void fieldFilterChangedHandler( bool useFieldFilter );
+
     // Called when the text on the search line is modified
     void searchTextChangeHandler( QString );
 
@@ -327,8 +333,18 @@ class CrawlerWidget : public QSplitter,
 
     void resetStateOnSearchPatternChanges();
 
+    // Parses a timestamp or a time of day, taken within the first day of the file
+    OptionalTimestamp parseTimeInFile( const QString& timeText ) const;
+    // Time range set in the search line, empty if none. Open ends are
+    // the smallest and biggest timestamps. isValid is false if a bound
+    // can't be parsed.
+    std::optional<std::pair<Timestamp, Timestamp>> getSearchTimeRange( bool& isValid ) const;
+
     void updateColorLabels( const ColorLabelsManager::QuickHighlightersCollection& labels );
 
+    // Mark all the lines passed, or unmark them if they all are already marked.
+    void markLines( const SearchResultArray& lines );
+
     // Palette for error notification (yellow background)
     static const QPalette ErrorPalette;
 
@@ -344,8 +360,8 @@ class CrawlerWidget : public QSplitter,
 
     std::shared_ptr<QuickFindPattern> quickFindPattern_;
 
-    LogMainView* logMainView_;
-    FilteredView* filteredView_;
+    LogMainView* logMainView_ = nullptr;
+    FilteredView* filteredView_ = nullptr;
 
     OverviewWidget* overviewWidget_;
 
@@ -367,8 +383,12 @@ class CrawlerWidget : public QSplitter,
     QToolButton* useRegexpButton_;
     QToolButton* inverseButton_;
     QToolButton* booleanButton_;
+    QToolButton* fieldFilterButton_;
     QToolButton* searchRefreshButton_;
 
+    QLineEdit* searchFromTimeEdit_;
+    QLineEdit* searchToTimeEdit_;
+
     std::map<QString, QShortcut*> shortcuts_;
 
     // Default palette to be remembered
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_DISPLAYLINE_H
+#define KLOGG_DISPLAYLINE_H
+
+#include <vector>
+
+#include <QString>
+
+#include "highlightedmatch.h"
+#include "linetypes.h"
+
+class AbstractLogData;
+
+// A line as shown by the view: the raw text highlighters run on, the same
+// text with tabs expanded as it is drawn, and the map between the columns
+// of the two so matches are translated without re-expanding any prefix.
+//
+// Very long lines only hold the part around the columns shown, starting
+// at firstColumn of the expanded line.
+class DisplayLine {
+  public:
+    explicit DisplayLine( QString raw, int firstColumn = 0 );
+
+    const QString& raw() const
+    {
+        return raw_;
+    }
+
+    const QString& expanded() const
+    {
+        return expanded_;
+    }
+
+    // Column of the whole expanded line the text starts at.
+    int firstColumn() const
+    {
+        return firstColumn_;
+    }
+
+    // Column in the whole expanded line of the passed raw column,
+    // one past the end of the line is valid.
+    int expandedColumn( int rawColumn ) const;
+
+    // Translates a match found in the raw text to the expanded text.
+    HighlightedMatch toExpanded( const HighlightedMatch& match ) const;
+
+  private:
+    QString raw_;
+    QString expanded_;
+    int firstColumn_;
+
+    // Expanded column for each raw column (plus one past the end),
+    // left empty if there is no tab in the line.
+    std::vector<int> expandedColumns_;
+};
+
+// Reads the passed range once and builds the display lines from it,
+// long lines are read only around the columns passed.
+std::vector<DisplayLine> getDisplayLines( const AbstractLogData& logData, LineNumber firstLine,
+                                          LinesCount number, int firstColumn, int nbColumns );
+
+#endif
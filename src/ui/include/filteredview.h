@@ -65,6 +65,8 @@ class FilteredView : public AbstractLogView
     LineNumber displayLineNumber(LineNumber lineNumber ) const override;
     LineNumber lineIndex( LineNumber lineNumber ) const override;
     LineNumber maxDisplayLineNumber() const override;
+    // Matches are inserted anywhere when searching
+    bool isDataAppendOnly() const override;
 
     void doRegisterShortcuts() override;
 
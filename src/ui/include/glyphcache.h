@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_GLYPHCACHE_H
+#define KLOGG_GLYPHCACHE_H
+
+#include <array>
+#include <vector>
+
+#include <QFont>
+#include <QPointF>
+#include <QRawFont>
+#include <QString>
+
+class QPainter;
+
+// Glyphs of the printable ASCII characters of a monospace font, looked up
+// once per font so lines made of them can be drawn by placing glyphs at
+// fixed advances instead of going through text shaping on each repaint.
+// Anything else (complex scripts, proportional fonts) must be drawn the
+// usual way.
+class GlyphCache {
+  public:
+    // Looks up the glyphs of the passed font, the fast path is only
+    // enabled if all printable ASCII characters share the same advance.
+    void setFont( const QFont& font );
+
+    bool isEnabled() const
+    {
+        return isEnabled_;
+    }
+
+    // Returns true if all the characters of the part of the text passed
+    // are in the cache.
+    bool canDraw( const QString& text, int from, int length ) const;
+
+    // Width in pixels of the number of characters passed.
+    int textWidth( int length ) const;
+
+    // Draws the part of the text passed starting at x on the passed baseline,
+    // canDraw must have returned true for it.
+    void draw( QPainter* painter, int x, int baseline, const QString& text, int from,
+               int length );
+
+  private:
+    static constexpr char16_t FirstChar = 0x20;
+    static constexpr char16_t LastChar = 0x7e;
+
+    bool isEnabled_ = false;
+    QRawFont rawFont_;
+    qreal advance_ = 0;
+    std::array<quint32, LastChar - FirstChar + 1> glyphs_ = {};
+
+    // Reused between draws to avoid allocations
+    std::vector<quint32> glyphIndexes_;
+    std::vector<QPointF> positions_;
+};
+
+#endif
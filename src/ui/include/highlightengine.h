@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef KLOGG_HIGHLIGHTENGINE_H
+#define KLOGG_HIGHLIGHTENGINE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <tbb/task_group.h>
+
+#include "displayline.h"
+#include "highlightedmatch.h"
+#include "highlighterset.h"
+#include "linetypes.h"
+
+class AbstractLogData;
+
+// Everything that decides how the text of a line is highlighted.
+struct HighlightRules {
+    HighlighterSet highlighterSet;
+    std::optional<Highlighter> searchHighlighter;
+    std::vector<Highlighter> quickHighlighters;
+
+    bool operator==( const HighlightRules& other ) const
+    {
+        return highlighterSet == other.highlighterSet
+               && searchHighlighter == other.searchHighlighter
+               && quickHighlighters == other.quickHighlighters;
+    }
+};
+
+// Highlights of one line, columns are in the expanded text.
+struct LineHighlights {
+    // Colours of the whole line if a highlighter matched it as a whole
+    std::optional<HighlightColor> lineColor;
+    std::vector<HighlightedMatch> matches;
+
+    // Part of the line matched, only long lines are matched by parts
+    int firstColumn = 0;
+    int rawLength = 0;
+
+    bool isComputedFor( const DisplayLine& line ) const
+    {
+        return firstColumn == line.firstColumn()
+               && rawLength == static_cast<int>( line.raw().size() );
+    }
+};
+
+// Computes and caches the highlights of the lines of a view.
+// Lines on screen missing from the cache are matched in parallel when asked
+// for, the lines around the screen are matched in the background so that
+// scrolling finds them ready.
+class HighlightEngine {
+  public:
+    using LineHighlightsPtr = std::shared_ptr<const LineHighlights>;
+
+    HighlightEngine();
+    ~HighlightEngine();
+
+    HighlightEngine( const HighlightEngine& ) = delete;
+    HighlightEngine& operator=( const HighlightEngine& ) = delete;
+
+    // Drops the cache if the rules are not the ones used so far.
+    void setRules( HighlightRules rules );
+
+    // Drops the cache and any pending work, to be called when the lines
+    // of the data have changed.
+    void invalidate();
+
+    // Returns the highlights of the passed lines, first of them being firstLine.
+    std::vector<LineHighlightsPtr> highlights( LineNumber firstLine,
+                                               const std::vector<DisplayLine>& lines );
+
+    // Waits for the background work to be over, pending prefetches are dropped.
+    void stop();
+
+    // Starts reading and matching in the background the screens above and
+    // below the one passed and forgets about lines further away.
+    void prefetch( const AbstractLogData& logData, LineNumber firstLine, LinesCount nbLines,
+                   int firstColumn, int nbColumns );
+
+  private:
+    static LineHighlights computeHighlights( const HighlightRules& rules,
+                                             const DisplayLine& line );
+
+  private:
+    std::shared_ptr<const HighlightRules> rules_;
+
+    // Bumped on each invalidation, background work from an older
+    // generation is thrown away.
+    std::atomic<uint64_t> generation_{ 0 };
+
+    // Lines being computed in the background have a null entry
+    std::mutex cacheMutex_;
+    std::unordered_map<LineNumber::UnderlyingType, LineHighlightsPtr> cache_;
+
+    tbb::task_group prefetchTasks_;
+};
+
+#endif
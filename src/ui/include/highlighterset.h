@@ -39,6 +39,8 @@
 #ifndef highlighterSet_H
 #define highlighterSet_H
 
+#include <cstdint>
+
 #include <QColor>
 #include <QMetaType>
 #include <QRegularExpression>
@@ -63,6 +65,12 @@ class Highlighter {
 
     bool matchLine( const QString& line, std::vector<HighlightedMatch>& matches ) const;
 
+    bool operator==( const Highlighter& other ) const;
+    bool operator!=( const Highlighter& other ) const
+    {
+        return !( *this == other );
+    }
+
     // Accessor functions
     QString pattern() const;
     void setPattern( const QString& pattern );
@@ -92,9 +100,12 @@ class Highlighter {
 
   private:
     std::pair<QColor, QColor> vairateColors( const QString& match ) const;
+    void updateMatchingRegex();
 
   private:
     QRegularExpression regexp_;
+    // Regex actually used for matching, kept compiled between lines
+    QRegularExpression matchingRegex_;
 
     bool useRegex_ = true;
     bool highlightOnlyMatch_ = false;
@@ -128,6 +139,13 @@ class HighlighterSet {
 
     bool isEmpty() const;
 
+    // Sets are equal if they highlight lines the same way
+    bool operator==( const HighlighterSet& other ) const;
+    bool operator!=( const HighlighterSet& other ) const
+    {
+        return !( *this == other );
+    }
+
     // Reads/writes the current config in the QSettings object passed
     void saveToStorage( QSettings& settings ) const;
     void retrieveFromStorage( QSettings& settings );
@@ -181,6 +199,10 @@ class HighlighterSetCollection final : public Persistable<HighlighterSetCollecti
     void saveToStorage( QSettings& settings ) const;
     void retrieveFromStorage( QSettings& settings );
 
+    // Bumped each time highlighters are saved or loaded, views rebuild
+    // their highlight rules when it changes.
+    static uint64_t generation();
+
   private:
     static constexpr int HighlighterSetCollection_VERSION = 2;
 
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_LINEPREFETCHER_H
+#define KLOGG_LINEPREFETCHER_H
+
+#include <chrono>
+
+#include "linetypes.h"
+
+class AbstractLogData;
+
+// Follows how fast and in which direction a view scrolls and asks its data
+// to read the lines it is about to show. Each request replaces the previous
+// one, so reads for a position the view already left are dropped.
+class LinePrefetcher {
+  public:
+    // To be called each time the first visible line of the view changes.
+    void scrolledTo( const AbstractLogData& logData, LineNumber firstLine,
+                     LinesCount nbVisibleLines );
+
+    // Forgets the scrolling history, e.g. when the data changes.
+    void reset();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    bool hasPosition_ = false;
+    LineNumber lastFirstLine_;
+    Clock::time_point lastScrollTime_;
+
+    // Smoothed scrolling speed in lines per second, negative when going up
+    double velocity_ = 0;
+};
+
+#endif
@@ -42,6 +42,7 @@
 #include <QMainWindow>
 #include <QSystemTrayIcon>
 #include <QTemporaryDir>
+#include <QTimer>
 
 #include <array>
 #include <memory>
@@ -57,10 +58,12 @@
 #include "session.h"
 #include "signalmux.h"
 #include "tabbedcrawlerwidget.h"
+#include "tabbedmergedviews.h"
 #include "tabbedscratchpad.h"
 
 class QAction;
 class QActionGroup;
+class QDockWidget;
 class Session;
 class RecentFiles;
 
@@ -100,6 +103,7 @@ class MainWindow : public QMainWindow {
 
   private Q_SLOTS:
     void open();
+    void openMerged();
     void openFileFromRecent( QAction* action );
     void openFileFromFavorites( QAction* action );
     void switchToOpenedFile( QAction* action );
@@ -134,6 +138,8 @@ class MainWindow : public QMainWindow {
     void toggleOverviewVisibility( bool isVisible );
     void toggleMainLineNumbersVisibility( bool isVisible );
     void toggleFilteredLineNumbersVisibility( bool isVisible );
+    void toggleLinesWrapped( bool isWrapped );
+    void toggleFieldColumnsVisibility( bool isVisible );
 
     // Change the follow mode checkbox and send the followSet signal down
     void changeFollowMode( bool follow );
@@ -188,6 +194,7 @@ class MainWindow : public QMainWindow {
     void loadIcons();
     void createMenus();
     void createToolBars();
+    void createDockWidgets();
     void createTrayIcon();
     void readSettings();
     void writeSettings();
@@ -206,12 +213,18 @@ class MainWindow : public QMainWindow {
     void displayQuickFindBar( QuickFindMux::QFDirection direction );
     void updateMenuBarFromDocument( const CrawlerWidget* crawler );
     void updateInfoLine();
+    void updateMemoryField();
     void showInfoLabels( bool show );
     void logScreenInfo( QScreen* screen );
     void removeFromFavorites( const QString& pathToRemove );
     void removeFromRecent( const QString& pathToRemove );
     void tryOpenClipboard( int tryTimes );
     void updateShortcuts();
+    // Starts loading a tab restored from the session if it is not loaded yet
+    void attachCrawler( CrawlerWidget* crawler );
+    void loadAllTabs();
+    // Loads the most recently used restored tab if no file is being read
+    void warmUpNextTab();
 
     WindowSession session_;
     QString loadingFileName;
@@ -234,18 +247,22 @@ class MainWindow : public QMainWindow {
     QLabel* sizeField;
     QLabel* dateField;
     QLabel* encodingField;
+    QLabel* memoryField;
     std::vector<QAction*> infoToolbarSeparators;
 
     QToolBar* toolBar;
 
     QAction* newWindowAction;
     QAction* openAction;
+    QAction* openMergedAction;
     QAction* closeAction;
     QAction* closeAllAction;
+    QAction* loadAllTabsAction;
     QAction* exitAction;
     QAction* copyAction;
     QAction* selectAllAction;
     QAction* goToLineAction;
+    QAction* goToTimeAction;
     QAction* findAction;
     QAction* clearLogAction;
     QAction* copyPathToClipboardAction;
@@ -256,6 +273,8 @@ class MainWindow : public QMainWindow {
     QAction* overviewVisibleAction;
     QAction* lineNumbersVisibleInMainAction;
     QAction* lineNumbersVisibleInFilteredAction;
+    QAction* linesWrappedAction;
+    QAction* fieldColumnsVisibleAction;
     QAction* followAction;
     QAction* reloadAction;
     QAction* stopAction;
@@ -301,12 +320,19 @@ class MainWindow : public QMainWindow {
     TabbedCrawlerWidget mainTabWidget_;
 
     TabbedScratchPad scratchPad_;
+    TabbedMergedViews mergedViews_;
+
+    QDockWidget* metricsDock_;
 
     QTemporaryDir tempDir_;
 
     bool isMaximized_ = false;
     bool isCloseFromTray_ = false;
 
+    // Tabs shown while restoring the session are not loaded
+    bool isRestoringSession_ = false;
+    QTimer warmUpTimer_;
+
     std::once_flag screenChangesConnect_;
 };
 
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_MERGEDVIEW_H
+#define KLOGG_MERGEDVIEW_H
+
+#include <memory>
+#include <vector>
+
+#include <QStringList>
+#include <QThreadPool>
+#include <QWidget>
+
+#include "abstractlogview.h"
+#include "atomicflag.h"
+#include "logfiltereddataworker.h"
+#include "quickfindpattern.h"
+
+class QLabel;
+class QLineEdit;
+class LogData;
+class MergedLogData;
+
+// View of a merged timeline, lines matching the last search get a bullet.
+class MergedLogView : public AbstractLogView {
+    Q_OBJECT
+
+  public:
+    MergedLogView( const MergedLogData* mergedData, const QuickFindPattern* quickFindPattern,
+                   QWidget* parent = nullptr );
+
+    void setMatches( SearchResultArray matches );
+
+    // Select the next or previous matching line from the current position
+    void selectNextMatch();
+    void selectPreviousMatch();
+
+  protected:
+    AbstractLogData::LineType lineType( LineNumber lineNumber ) const override;
+
+    void doRegisterShortcuts() override;
+
+  private:
+    SearchResultArray matches_;
+};
+
+// Several files shown as one log ordered by timestamps (see MergedLogData),
+// with a search running on all of them.
+class MergedView : public QWidget {
+    Q_OBJECT
+
+  public:
+    explicit MergedView( const QStringList& fileNames, QWidget* parent = nullptr );
+    ~MergedView() override;
+
+    MergedView( const MergedView& ) = delete;
+    MergedView& operator=( const MergedView& ) = delete;
+
+    void applyConfiguration();
+
+  private:
+    void startSearch();
+    void stopSearch();
+
+  private:
+    std::vector<std::shared_ptr<LogData>> sources_;
+    std::unique_ptr<MergedLogData> mergedData_;
+
+    QuickFindPattern quickFindPattern_;
+
+    QLineEdit* searchLineEdit_ = nullptr;
+    QLabel* statusLabel_ = nullptr;
+    MergedLogView* view_ = nullptr;
+
+    AtomicFlag searchInterruptRequested_;
+    QThreadPool searchPool_;
+};
+
+#endif // KLOGG_MERGEDVIEW_H
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_METRICSPANEL_H
+#define KLOGG_METRICSPANEL_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <QTimer>
+#include <QWidget>
+
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Shows the process wide metrics: throughput of indexing and searching,
+// depth of the work queues and latencies of reads and frames.
+// Refreshed every second while visible.
+class MetricsPanel : public QWidget {
+    Q_OBJECT
+  public:
+    explicit MetricsPanel( QWidget* parent = nullptr );
+
+  protected:
+    void showEvent( QShowEvent* event ) override;
+    void hideEvent( QHideEvent* event ) override;
+
+  private:
+    void refresh();
+    void copyToClipboard() const;
+
+    QTreeWidgetItem* item( QTreeWidgetItem* group, const std::string& name );
+
+  private:
+    QTreeWidget* tree_;
+    QTreeWidgetItem* throughputGroup_;
+    QTreeWidgetItem* queuesGroup_;
+    QTreeWidgetItem* latencyGroup_;
+
+    std::map<std::string, QTreeWidgetItem*> items_;
+
+    QTimer refreshTimer_;
+    std::map<std::string, uint64_t> lastCounters_;
+    std::chrono::milliseconds lastRefreshTime_{ 0 };
+};
+
+#endif
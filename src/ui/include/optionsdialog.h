@@ -98,6 +98,7 @@ class OptionsDialog : public QDialog, public Ui::OptionsDialog {
     void setupArchives();
     void setupStyles();
     void setupEncodings();
+    void setupTimestampFormats();
 
     void buildShortcutsTable();
 
@@ -21,9 +21,13 @@
 #define OVERVIEW_H
 
 #include "linetypes.h"
+#include "timestampparser.h"
 #include <QList>
 #include <QVector>
 
+#include <vector>
+
+class LogData;
 class LogFilteredData;
 
 // Class implementing the logic behind the matches overview bar.
@@ -70,10 +74,18 @@ class Overview {
         int weight_;
     };
 
+    // A point of the time axis: timestamp of the first line at this position
+    struct TimeTick {
+        int position;
+        Timestamp timestamp;
+    };
+
     Overview();
 
     // Associate the passed filteredData to this Overview
     void setFilteredData( const LogFilteredData* logFilteredData );
+    // Associate the passed logData, used to build the time axis
+    void setLogData( const LogData* logData );
     // Signal the overview its attached LogFilteredData has been changed and
     // the overview must be updated with the provided total number
     // of line of the file.
@@ -108,6 +120,11 @@ class Overview {
     const std::vector<WeightedLine>* getMarkLines() const;
     // Return a pair of lines (between 0 and 'height') representing the current view.
     std::pair<int, int> getViewLines() const;
+    // Returns evenly spaced points of the time axis, empty if the file has no timestamps.
+    // (pointer returned is valid until next call to update*()
+    const std::vector<TimeTick>* getTimeTicks() const;
+    // Returns the timestamp of the line at the passed overview y coordinate.
+    OptionalTimestamp timestampFromY( int y ) const;
 
     // Return the line number corresponding to the passed overview y coordinate.
     LineNumber fileLineFromY( int y ) const;
@@ -117,6 +134,7 @@ class Overview {
   private:
     // List of matches associated with this Overview.
     const LogFilteredData* logFilteredData_;
+    const LogData* logData_ = nullptr;
     // Total number of lines in the file.
     LinesCount linesInFile_;
     // Whether the overview is visible.
@@ -132,8 +150,10 @@ class Overview {
     // List of lines representing matches and marks (are shared with the client)
     std::vector<WeightedLine> matchLines_;
     std::vector<WeightedLine> markLines_;
+    std::vector<TimeTick> timeTicks_;
 
     void recalculatesLines();
+    void recalculatesTimeTicks();
 };
 
 #endif
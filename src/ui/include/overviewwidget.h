@@ -46,6 +46,7 @@ class OverviewWidget : public QWidget {
     void removeHighlight();
 
   protected:
+    bool event( QEvent* event ) override;
     void paintEvent( QPaintEvent* paintEvent ) override;
     void mousePressEvent( QMouseEvent* mouseEvent ) override;
     void mouseMoveEvent( QMouseEvent* mouseEvent ) override;
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_SELECTIONEXPORTER_H
+#define KLOGG_SELECTIONEXPORTER_H
+
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+
+#include "atomicflag.h"
+#include "linetypes.h"
+
+class AbstractLogData;
+
+// Reads a range of lines on a worker thread, chunk by chunk, either to
+// build the text copied to the clipboard or to write them to a file,
+// so huge selections don't freeze the view. Only one export runs at a
+// time, starting a new one cancels the previous.
+class SelectionExporter : public QObject {
+    Q_OBJECT
+
+  public:
+    explicit SelectionExporter( QObject* parent = nullptr );
+    ~SelectionExporter() override;
+
+    SelectionExporter( const SelectionExporter& ) = delete;
+    SelectionExporter& operator=( const SelectionExporter& ) = delete;
+
+    // Emits textReady with the lines passed joined the same way
+    // as the text of a selection.
+    void copyLines( const AbstractLogData* logData, LineNumber firstLine, LinesCount count );
+
+    // Writes the lines passed to the file, in the display encoding of the data.
+    void saveLines( const AbstractLogData* logData, LineNumber firstLine, LinesCount count,
+                    const QString& fileName );
+
+    bool isRunning() const;
+
+  public Q_SLOTS:
+    void cancel();
+
+  Q_SIGNALS:
+    // Percentage of the lines read so far
+    void progressChanged( int percent );
+    void textReady( const QString& text );
+    void finished( bool isCompleted );
+
+  private:
+    struct Result {
+        bool isCompleted = false;
+        bool hasText = false;
+        QString text;
+    };
+
+    void start( const AbstractLogData* logData, LineNumber firstLine, LinesCount count,
+                const QString& fileName );
+
+    Result readText( const AbstractLogData* logData, LineNumber firstLine, LinesCount count );
+    Result writeFile( const AbstractLogData* logData, LineNumber firstLine, LinesCount count,
+                      const QString& fileName );
+
+    void reportProgress( LinesCount done, LinesCount total );
+
+    void onExportFinished();
+
+  private:
+    AtomicFlag interruptRequested_;
+    QFuture<Result> exportFuture_;
+    QFutureWatcher<Result> exportWatcher_;
+    int lastProgress_ = -1;
+};
+
+#endif
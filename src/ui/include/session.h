@@ -31,6 +31,7 @@
 #include <QDateTime>
 
 #include "log.h"
+#include "memorybudget.h"
 #include "quickfindpattern.h"
 
 class ViewInterface;
@@ -83,6 +84,14 @@ class Session : public std::enable_shared_from_this<Session> {
     void getFileInfo( const ViewInterface* view, uint64_t* fileSize, uint64_t* fileNbLine,
                       QDateTime* lastModified ) const;
 
+    // Get the memory used by index and search results of the file.
+    MemoryBudget::Accounting getMemoryUsage( const ViewInterface* view ) const;
+
+    // Files restored from a session are not loaded until attached.
+    bool isAttached( const ViewInterface* view ) const;
+    // Starts loading the file of the view, does nothing if it is already loaded.
+    void attach( const ViewInterface* view );
+
     // Get a (non-const) reference to the QuickFind pattern.
     std::shared_ptr<QuickFindPattern> quickFindPattern() const
     {
@@ -112,12 +121,14 @@ class Session : public std::enable_shared_from_this<Session> {
         std::shared_ptr<LogData> logData;
         std::shared_ptr<LogFilteredData> logFilteredData;
         ViewInterface* view;
+        bool isAttached;
     };
 
-    // Open a file without checking if it is existing/readable
+    // Open a file without checking if it is existing/readable,
+    // loading is postponed until attach() if attachNow is false
     ViewInterface* openAlways( const QString& file_name,
                                const std::function<ViewInterface*()>& view_factory,
-                               const QString& view_context );
+                               const QString& view_context, bool attachNow = true );
 
     // Find an open file from its associated view
     OpenFile* findOpenFileFromView( const ViewInterface* view );
@@ -179,6 +190,21 @@ class WindowSession {
         return appSession_->getFileInfo( view, fileSize, fileNbLine, lastModified );
     }
 
+    MemoryBudget::Accounting getMemoryUsage( const ViewInterface* view ) const
+    {
+        return appSession_->getMemoryUsage( view );
+    }
+
+    bool isAttached( const ViewInterface* view ) const
+    {
+        return appSession_->isAttached( view );
+    }
+
+    void attach( const ViewInterface* view )
+    {
+        appSession_->attach( view );
+    }
+
     std::vector<QString> openedFiles() const
     {
         return openedFiles_;
@@ -200,8 +226,8 @@ class WindowSession {
         return windowIndex_;
     }
 
-    // Open all the files listed in the stored session
-    // (see ::open)
+    // Create views for all the files listed in the stored session,
+    // files are loaded when their view is attached (see Session::attach)
     // returns a vector of pairs (file_name, view) and the index of the
     // current file (or -1 if none).
     OpenedFilesList restore( const std::function<ViewInterface*()>& view_factory,
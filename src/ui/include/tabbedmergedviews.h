@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TABBEDMERGEDVIEWS_H
+#define KLOGG_TABBEDMERGEDVIEWS_H
+
+#include <QStringList>
+#include <QTabWidget>
+#include <QWidget>
+
+// Window holding the merged views, one tab per set of merged files.
+class TabbedMergedViews : public QWidget {
+    Q_OBJECT
+  public:
+    explicit TabbedMergedViews( QWidget* parent = nullptr );
+
+    TabbedMergedViews( const TabbedMergedViews& ) = delete;
+    TabbedMergedViews& operator=( const TabbedMergedViews& ) = delete;
+
+    // Opens a tab merging the passed files
+    void addMergedView( const QStringList& fileNames );
+
+    void applyConfiguration();
+
+  private:
+    void closeTab( int index );
+
+  private:
+    QTabWidget* tabWidget_{ nullptr };
+};
+
+#endif // KLOGG_TABBEDMERGEDVIEWS_H
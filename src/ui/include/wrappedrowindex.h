@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_WRAPPEDROWINDEX_H
+#define KLOGG_WRAPPEDROWINDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QObject>
+
+#include <tbb/task_group.h>
+
+#include "linetypes.h"
+
+class AbstractLogData;
+
+// Maps the visual rows of a view wrapping its lines at a given width to the
+// lines of the data and back.
+// Rows are counted by blocks of lines: the number of rows of each block is
+// kept in a Fenwick tree, so finding the block of a row and the first row of
+// a block take a logarithmic time whatever the size of the file.
+// Blocks not counted yet are assumed to be one row per line, the whole data
+// is counted in the background if it can be read from another thread and the
+// blocks the view asks about are counted right away, keeping the rows of
+// their lines for the next requests.
+class WrappedRowIndex : public QObject {
+    Q_OBJECT
+
+  public:
+    static constexpr LinesCount::UnderlyingType BlockSize = 1024;
+
+    struct RowPosition {
+        LineNumber line;
+        uint64_t rowInLine = 0;
+    };
+
+    WrappedRowIndex() = default;
+    ~WrappedRowIndex() noexcept override;
+
+    WrappedRowIndex( const WrappedRowIndex& ) = delete;
+    WrappedRowIndex& operator=( const WrappedRowIndex& ) = delete;
+
+    // Forgets everything and starts counting the rows of the passed data
+    // wrapped at wrapColumns, a null logData just stops counting.
+    void reset( const AbstractLogData* logData, int wrapColumns );
+
+    // Takes into account the lines added at the end of the data since the
+    // last call, the rows are counted again if the data got shorter.
+    void update();
+
+    int wrapColumns() const;
+
+    // Total number of rows, exact once the background count is over.
+    uint64_t totalRows() const;
+
+    // Number of rows the passed line is wrapped into.
+    uint64_t rowsOf( LineNumber line );
+
+    // Row on which the passed line starts.
+    uint64_t firstRowOf( LineNumber line );
+
+    // Line shown on the passed row and which of its rows it is.
+    RowPosition positionOfRow( uint64_t row );
+
+  Q_SIGNALS:
+    // Some row counts have changed, sent from the counting thread.
+    void rowsChanged();
+
+  private:
+    using LineRows = std::shared_ptr<const std::vector<uint32_t>>;
+
+    // Rows of each line of the block, counted now if needed.
+    LineRows blockLineRows( uint64_t blockIndex );
+    std::vector<uint32_t> countLineRows( uint64_t blockIndex, LinesCount nbLines ) const;
+
+    // These must be called with the mutex held
+    LinesCount blockLines( uint64_t blockIndex ) const;
+    void setBlockRows( uint64_t blockIndex, uint64_t rows, bool isExact );
+    void appendBlock( uint64_t rows );
+    uint64_t rowsBefore( uint64_t blockIndex ) const;
+    LineRows findRecentBlock( uint64_t blockIndex );
+    void addRecentBlock( uint64_t blockIndex, LineRows rows );
+
+    void startCounting();
+    void countInBackground( uint64_t generation );
+
+  private:
+    const AbstractLogData* logData_ = nullptr;
+    int wrapColumns_ = 1;
+
+    // Bumped on each reset, counts of an older generation are thrown away.
+    std::atomic<uint64_t> generation_{ 0 };
+
+    mutable std::mutex mutex_;
+    LinesCount nbLines_;
+    std::vector<uint64_t> tree_;
+    std::vector<uint64_t> blockRows_;
+    std::vector<bool> isBlockExact_;
+    uint64_t firstInexactBlock_ = 0;
+
+    // Most recently used blocks, the most recent first
+    std::list<std::pair<uint64_t, LineRows>> recentBlocks_;
+
+    bool isCounting_ = false;
+    tbb::task_group countTasks_;
+};
+
+#endif
@@ -73,30 +73,33 @@
 #include <QGestureEvent>
 #include <QInputDialog>
 #include <QMenu>
+#include <QMessageBox>
 #include <QPaintEvent>
 #include <QPainter>
 #include <QPalette>
 #include <QProgressDialog>
 #include <QRect>
+#include <QRegion>
 #include <QScrollBar>
 #include <QShortcut>
 #include <QtCore>
 
-#include <tbb/flow_graph.h>
-
 #include "abstractlogview.h"
 #include "linetypes.h"
 
 #include "configuration.h"
+#include "displayline.h"
 #include "highlighterset.h"
 #include "highlightersmenu.h"
 #include "log.h"
 #include "logmainview.h"
+#include "metrics.h"
 #include "overview.h"
 #include "quickfind.h"
 #include "quickfindpattern.h"
 #include "regularexpressionpattern.h"
 #include "shortcuts.h"
+#include "tracing.h"
 
 #ifdef Q_OS_WIN
 
@@ -205,6 +208,69 @@ QFontMetrics pixmapFontMetrics( const QFont& font )
     return devicePainter->fontMetrics();
 }
 
+// Splits the columns [0, nbColumns] of a line in runs of the same colours,
+// each highlight painting over the ones before it.
+// Highlights columns are relative to the first column drawn.
+std::vector<LineChunk> mergeHighlights( const std::vector<HighlightedMatch>& highlights,
+                                        int nbColumns, const QColor& foreColor,
+                                        const QColor& backColor )
+{
+    struct Span {
+        int start;
+        int end;
+        QColor foreColor;
+        QColor backColor;
+    };
+
+    std::vector<Span> spans{ { 0, nbColumns + 1, foreColor, backColor } };
+    std::vector<Span> mergedSpans;
+
+    for ( const auto& match : highlights ) {
+        const auto start = qMax( match.startColumn(), 0 );
+        const auto end = qMin( match.startColumn() + match.length(), nbColumns );
+
+        // Ignore matches that are *completely* outside view area
+        if ( start >= end ) {
+            continue;
+        }
+
+        mergedSpans.clear();
+        mergedSpans.reserve( spans.size() + 2 );
+        for ( const auto& span : spans ) {
+            if ( span.end <= start || span.start >= end ) {
+                mergedSpans.push_back( span );
+                continue;
+            }
+
+            if ( span.start < start ) {
+                mergedSpans.push_back( { span.start, start, span.foreColor, span.backColor } );
+            }
+            if ( span.start <= start ) {
+                mergedSpans.push_back( { start, end, match.foreColor(), match.backColor() } );
+            }
+            if ( span.end > end ) {
+                mergedSpans.push_back( { end, span.end, span.foreColor, span.backColor } );
+            }
+        }
+        spans.swap( mergedSpans );
+    }
+
+    std::vector<LineChunk> chunks;
+    chunks.reserve( spans.size() );
+    for ( const auto& span : spans ) {
+        if ( !chunks.empty() && chunks.back().foreColor() == span.foreColor
+             && chunks.back().backColor() == span.backColor ) {
+            chunks.back() = LineChunk{ chunks.back().start(), span.end - 1, span.foreColor,
+                                       span.backColor };
+        }
+        else {
+            chunks.emplace_back( span.start, span.end - 1, span.foreColor, span.backColor );
+        }
+    }
+
+    return chunks;
+}
+
 } // namespace
 
 inline void LineDrawer::addChunk( int firstCol, int lastCol, const QColor& fore,
@@ -226,8 +292,9 @@ inline void LineDrawer::addChunk( const LineChunk& chunk )
     addChunk( chunk.start(), chunk.end(), chunk.foreColor(), chunk.backColor() );
 }
 
-inline void LineDrawer::draw( QPainter* painter, int initialXPos, int initialYPos, int lineWidth,
-                              const QString& line, int leftExtraBackgroundPx )
+inline void LineDrawer::draw( QPainter* painter, GlyphCache& glyphCache, int initialXPos,
+                              int initialYPos, int lineWidth, const QString& line,
+                              int leftExtraBackgroundPx )
 {
     QFontMetrics fm = painter->fontMetrics();
     const int fontHeight = fm.height();
@@ -239,8 +306,12 @@ inline void LineDrawer::draw( QPainter* painter, int initialXPos, int initialYPo
     for ( const auto& chunk : chunks_ ) {
         // Draw each chunk
         // LOG_DEBUG << "Chunk: " << chunk.start() << " " << chunk.length();
-        const auto cutline = line.mid( chunk.start(), chunk.length() );
-        const int chunkWidth = textWidth( fm, cutline );
+        const auto useGlyphCache = glyphCache.canDraw( line, chunk.start(), chunk.length() );
+        const auto cutline = useGlyphCache ? QString{} : line.mid( chunk.start(), chunk.length() );
+        const auto charsInChunk
+            = qBound( 0, static_cast<int>( line.size() ) - chunk.start(), chunk.length() );
+        const int chunkWidth
+            = useGlyphCache ? glyphCache.textWidth( charsInChunk ) : textWidth( fm, cutline );
         if ( xPos == initialXPos ) {
             // First chunk, we extend the left background a bit,
             // it looks prettier.
@@ -252,7 +323,13 @@ inline void LineDrawer::draw( QPainter* painter, int initialXPos, int initialYPo
             painter->fillRect( xPos, yPos, chunkWidth, fontHeight, chunk.backColor() );
         }
         painter->setPen( chunk.foreColor() );
-        painter->drawText( xPos, yPos + fontAscent, cutline );
+        if ( useGlyphCache ) {
+            glyphCache.draw( painter, xPos, yPos + fontAscent, line, chunk.start(),
+                             chunk.length() );
+        }
+        else {
+            painter->drawText( xPos, yPos + fontAscent, cutline );
+        }
         xPos += chunkWidth;
     }
 
@@ -331,6 +408,17 @@ AbstractLogView::AbstractLogView( const AbstractLogData* newLogData,
     connect( &followElasticHook_, SIGNAL( lengthChanged() ), this, SLOT( repaint() ) );
     connect( &followElasticHook_, SIGNAL( hooked( bool ) ), this,
              SIGNAL( followModeChanged( bool ) ) );
+
+    connect( &selectionExporter_, &SelectionExporter::textReady, this, []( const QString& text ) {
+        try {
+            QApplication::clipboard()->setText( text );
+        } catch ( std::exception& err ) {
+            LOG_ERROR << "failed to copy data to clipboard " << err.what();
+        }
+    } );
+
+    connect( &wrappedRowIndex_, &WrappedRowIndex::rowsChanged, this,
+             &AbstractLogView::updateWrappedRows, Qt::QueuedConnection );
 }
 
 AbstractLogView::~AbstractLogView()
@@ -575,7 +663,7 @@ void AbstractLogView::mouseReleaseEvent( QMouseEvent* mouseEvent )
             // Invalidate our cache
             textAreaCache_.invalid_ = true;
 
-            Q_EMIT markLines( { *line } );
+            Q_EMIT markLines( *line, 1_lcount );
         }
     }
     else {
@@ -854,10 +942,15 @@ bool AbstractLogView::event( QEvent* e )
     return QAbstractScrollArea::event( e );
 }
 
-int AbstractLogView::lineNumberToVerticalScroll( LineNumber line ) const
+int AbstractLogView::lineNumberToVerticalScroll( LineNumber line )
+{
+    return rowToVerticalScroll( wrapLines_ ? wrappedRowIndex_.firstRowOf( line ) : line.get() );
+}
+
+int AbstractLogView::rowToVerticalScroll( uint64_t row ) const
 {
     return static_cast<int>(
-        std::round( static_cast<double>( line.get() ) * verticalScrollMultiplicator() ) );
+        std::round( static_cast<double>( row ) * verticalScrollMultiplicator() ) );
 }
 
 LineNumber AbstractLogView::verticalScrollToLineNumber( int scrollPosition ) const
@@ -871,7 +964,12 @@ double AbstractLogView::verticalScrollMultiplicator() const
     return verticalScrollBar()->maximum() < std::numeric_limits<int>::max()
                ? 1.0
                : static_cast<double>( std::numeric_limits<int>::max() )
-                     / static_cast<double>( logData_->getNbLine().get() );
+                     / static_cast<double>( getNbScrollRows() );
+}
+
+uint64_t AbstractLogView::getNbScrollRows() const
+{
+    return wrapLines_ ? wrappedRowIndex_.totalRows() : logData_->getNbLine().get();
 }
 
 void AbstractLogView::scrollContentsBy( int dx, int dy )
@@ -882,7 +980,18 @@ void AbstractLogView::scrollContentsBy( int dx, int dy )
 
     const auto scrollPosition = verticalScrollToLineNumber( verticalScrollBar()->value() );
 
-    if ( ( lastTopLine.get() > 0 ) && scrollPosition.get() > lastTopLine.get() ) {
+    if ( wrapLines_ ) {
+        // The scroll bar goes through rows, the same way it goes through lines otherwise
+        const auto nbRows = getNbScrollRows();
+        const auto nbVisibleRows = getNbVisibleLines().get();
+        const auto lastTopRow = nbRows > nbVisibleRows ? nbRows - nbVisibleRows : 0;
+        const auto topRow = scrollPosition.get();
+        const auto position = wrappedRowIndex_.positionOfRow( topRow );
+        firstLine_ = position.line;
+        firstRowInLine_ = position.rowInLine;
+        lastLineAligned_ = lastTopRow > 0 && topRow > lastTopRow;
+    }
+    else if ( ( lastTopLine.get() > 0 ) && scrollPosition.get() > lastTopLine.get() ) {
         // The user is going further than the last line, we need to lock the last line at the bottom
         LOG_DEBUG << "scrollContentsBy beyond!";
         firstLine_ = scrollPosition;
@@ -895,6 +1004,8 @@ void AbstractLogView::scrollContentsBy( int dx, int dy )
 
     firstCol_ = ( firstCol_ - dx ) > 0 ? firstCol_ - dx : 0;
 
+    linePrefetcher_.scrolledTo( *logData_, firstLine_, getNbVisibleLines() );
+
     // Update the overview if we have one
     if ( overview_ != nullptr ) {
         const auto lastLine = firstLine_ + getNbVisibleLines();
@@ -920,33 +1031,52 @@ void AbstractLogView::paintEvent( QPaintEvent* paintEvent )
               << ", " << invalidRect.topLeft().y() << ", " << invalidRect.bottomRight().x() << ", "
               << invalidRect.bottomRight().y();
 
-#ifdef GLOGG_PERF_MEASURE_FPS
-    static uint32_t maxline = logData_->getNbLine();
-    if ( !perfCounter_.addEvent() && logData_->getNbLine() > maxline ) {
-        LOG_WARNING << "Redraw per second: " << perfCounter_.readAndReset()
-                    << " lines: " << logData_->getNbLine();
-        perfCounter_.addEvent();
-        maxline = logData_->getNbLine();
-    }
-#endif
+    static auto& frameTime = Metrics::get().histogram( "view.frame_us" );
+    static auto& frames = Metrics::get().counter( "view.frames" );
+    frames.add();
+    const auto frameTimer = frameTime.startTimer();
+    KLOGG_TRACE_SCOPE( "view", "paint" );
 
     auto start = std::chrono::system_clock::now();
 
-    // Can we use our cache?
-    auto deltaY = textAreaCache_.first_line_.get() - firstLine_.get();
-
-    if ( textAreaCache_.invalid_ || ( textAreaCache_.first_column_ != firstCol_ ) ) {
-        // Force a full redraw
-        deltaY = std::numeric_limits<decltype( deltaY )>::max();
-    }
+    // First check the lines to be drawn are within range (might not be the case if
+    // the file has just changed)
+    const auto linesInFile = logData_->getNbLine();
+    if ( firstLine_ > linesInFile )
+        firstLine_ = LineNumber( linesInFile.get() ? linesInFile.get() - 1 : 0 );
 
-    if ( deltaY != 0 ) {
-        // Full or partial redraw
-        drawTextArea( &textAreaCache_.pixmap_ );
+    // Can we use our cache?
+    const auto lineNumberDigits
+        = lineNumbersVisible_ ? countDigits( maxDisplayLineNumber().get() ) : 0;
+    const auto deltaRows = static_cast<int64_t>( firstLine_.get() )
+                           - static_cast<int64_t>( textAreaCache_.first_line_.get() );
+    const auto deltaColumns = firstCol_ - textAreaCache_.first_column_;
+    const auto hasMoved = deltaRows != 0 || deltaColumns != 0
+                          || firstRowInLine_ != textAreaCache_.first_row_in_line_;
+
+    // Wrapped lines don't scroll by whole lines, they are redrawn instead
+    const auto isCacheValid
+        = !textAreaCache_.invalid_ && textAreaCache_.line_number_digits_ == lineNumberDigits;
+    const auto canScrollCache
+        = isCacheValid && !wrapLines_
+          && std::abs( deltaRows ) < static_cast<int64_t>( getNbVisibleLines().get() );
+
+    if ( hasMoved || !isCacheValid ) {
+        // Partial redraw of what scrolling exposed if possible, full redraw otherwise
+        if ( !canScrollCache
+             || !scrollTextAreaCache( static_cast<int>( deltaRows ), deltaColumns ) ) {
+            drawTextArea( &textAreaCache_.pixmap_ );
+        }
 
         textAreaCache_.invalid_ = false;
         textAreaCache_.first_line_ = firstLine_;
         textAreaCache_.first_column_ = firstCol_;
+        textAreaCache_.first_row_in_line_ = firstRowInLine_;
+        textAreaCache_.line_number_digits_ = lineNumberDigits;
+
+        // Get the highlights of the next screens ready
+        highlightEngine_.prefetch( *logData_, firstLine_, getNbVisibleLines(), firstCol_,
+                                   getNbVisibleCols() );
 
         LOG_DEBUG << "End of writing "
                   << std::chrono::duration_cast<std::chrono::microseconds>(
@@ -1028,6 +1158,11 @@ LineNumber AbstractLogView::maxDisplayLineNumber() const
     return LineNumber( logData_->getNbLine().get() );
 }
 
+bool AbstractLogView::isDataAppendOnly() const
+{
+    return true;
+}
+
 void AbstractLogView::setOverview( Overview* overview, OverviewWidget* overviewWidget )
 {
     overview_ = overview;
@@ -1117,6 +1252,7 @@ void AbstractLogView::allowFollowMode( bool allow )
 void AbstractLogView::setSearchPattern( const RegularExpressionPattern& pattern )
 {
     searchPattern_ = pattern;
+    ++highlightRulesGeneration_;
     forceRefresh();
 }
 
@@ -1124,6 +1260,7 @@ void AbstractLogView::setQuickHighlighters(
     const std::vector<QuickHighlighters>& quickHighlighters )
 {
     quickHighlighters_ = quickHighlighters;
+    ++highlightRulesGeneration_;
     forceRefresh();
 }
 
@@ -1218,6 +1355,36 @@ void AbstractLogView::findPreviousSelected()
 // Copy the selection to the clipboard
 void AbstractLogView::copy()
 {
+    // Bigger selections are read on a worker
+    static constexpr auto MaxSyncCopyLines = 10000_lcount;
+    // Beyond that the text might not even fit in memory
+    static constexpr auto MaxClipboardLines = 1000000_lcount;
+
+    const auto [ firstLine, count ] = selection_.getLineRange();
+    if ( count > MaxSyncCopyLines ) {
+        if ( count > MaxClipboardLines ) {
+            const auto answer = QMessageBox::question(
+                this, tr( "Copy" ),
+                tr( "%1 lines are selected. Save them to a file instead of the clipboard?" )
+                    .arg( count.get() ),
+                QMessageBox::Save | QMessageBox::Ignore | QMessageBox::Cancel );
+
+            if ( answer == QMessageBox::Cancel ) {
+                return;
+            }
+            else if ( answer == QMessageBox::Save ) {
+                const auto filename = QFileDialog::getSaveFileName( this, "Save selection" );
+                if ( !filename.isEmpty() ) {
+                    exportLines( firstLine, count, filename );
+                }
+                return;
+            }
+        }
+
+        exportLines( firstLine, count, {} );
+        return;
+    }
+
     try {
         auto clipboard = QApplication::clipboard();
         auto text = selection_.getSelectedText( logData_ );
@@ -1230,9 +1397,9 @@ void AbstractLogView::copy()
 
 void AbstractLogView::markSelected()
 {
-    auto lines = selection_.getLines();
-    if ( !lines.empty() ) {
-        Q_EMIT markLines( lines );
+    const auto [ firstLine, count ] = selection_.getLineRange();
+    if ( count.get() > 0 ) {
+        Q_EMIT markLines( firstLine, count );
     }
 }
 
@@ -1243,107 +1410,40 @@ void AbstractLogView::saveToFile()
         return;
     }
 
-    const auto totalLines = logData_->getNbLine();
-    QSaveFile saveFile{ filename };
-    saveFile.open( QIODevice::WriteOnly | QIODevice::Truncate );
-    if ( !saveFile.isOpen() ) {
-        LOG_ERROR << "Failed to open file to save";
-        return;
-    }
+    exportLines( 0_lnum, logData_->getNbLine(), filename );
+}
 
-    QProgressDialog progressDialog( this );
-    progressDialog.setLabelText( QString( "Saving content to %1" ).arg( filename ) );
+// Read the lines on a worker, either for the clipboard or to the file passed,
+// while a progress dialog allows to cancel.
+void AbstractLogView::exportLines( LineNumber firstLine, LinesCount count,
+                                   const QString& fileName )
+{
+    auto progressDialog = new QProgressDialog( this );
+    progressDialog->setAttribute( Qt::WA_DeleteOnClose );
+    progressDialog->setLabelText( fileName.isEmpty()
+                                      ? QString( "Copying %1 lines" ).arg( count.get() )
+                                      : QString( "Saving content to %1" ).arg( fileName ) );
+    progressDialog->setRange( 0, 100 );
+    progressDialog->setAutoClose( false );
 
-    std::vector<std::pair<LineNumber, LinesCount>> offsets;
-    auto lineOffset = 0_lnum;
-    const auto chunkSize = 5000_lcount;
+    connect( progressDialog, &QProgressDialog::canceled, &selectionExporter_,
+             &SelectionExporter::cancel );
+    connect( &selectionExporter_, &SelectionExporter::progressChanged, progressDialog,
+             &QProgressDialog::setValue );
+    connect( &selectionExporter_, &SelectionExporter::finished, progressDialog,
+             [ progressDialog ]( bool ) {
+                 progressDialog->disconnect();
+                 progressDialog->close();
+             } );
 
-    for ( ; lineOffset + chunkSize < LineNumber( totalLines.get() );
-          lineOffset += LineNumber( chunkSize.get() ) ) {
-        offsets.emplace_back( lineOffset, chunkSize );
-    }
-    offsets.emplace_back( lineOffset, LinesCount( totalLines.get() % chunkSize.get() ) );
+    progressDialog->open();
 
-    QTextCodec* codec = logData_->getDisplayEncoding();
-    if ( !codec ) {
-        codec = QTextCodec::codecForName( "utf-8" );
+    if ( fileName.isEmpty() ) {
+        selectionExporter_.copyLines( logData_, firstLine, count );
+    }
+    else {
+        selectionExporter_.saveLines( logData_, firstLine, count, fileName );
     }
-
-    AtomicFlag interruptRequest;
-
-    progressDialog.setRange( 0, 1000 );
-    connect( &progressDialog, &QProgressDialog::canceled,
-             [ &interruptRequest ]() { interruptRequest.set(); } );
-
-    tbb::flow::graph saveFileGraph;
-    using LinesData = std::pair<std::vector<QString>, bool>;
-    auto lineReader = tbb::flow::input_node<LinesData>(
-        saveFileGraph,
-        [ this, &offsets, &interruptRequest, &progressDialog, offsetIndex = 0u,
-          finalLine = false ]( tbb::flow_control& fc ) mutable -> LinesData {
-            if ( !interruptRequest && offsetIndex < offsets.size() ) {
-                const auto& offset = offsets.at( offsetIndex );
-                LinesData lines{ logData_->getLines( offset.first, offset.second ), true };
-                for ( auto& l : lines.first ) {
-#if !defined( Q_OS_WIN )
-                    l.append( QChar::CarriageReturn );
-#endif
-                    l.append( QChar::LineFeed );
-                }
-
-                offsetIndex++;
-                progressDialog.setValue( static_cast<int>(
-                    std::floor( static_cast<float>( offsetIndex )
-                                / static_cast<float>( offsets.size() + 1 ) * 1000.f ) ) );
-                return lines;
-            }
-            else if ( !finalLine ) {
-                finalLine = true;
-            }
-            else {
-                fc.stop();
-            }
-
-            return {};
-        } );
-
-    auto lineWriter = tbb::flow::function_node<LinesData, tbb::flow::continue_msg>(
-        saveFileGraph, 1,
-        [ &interruptRequest, &codec, &saveFile, &progressDialog,
-          linesCount = 0u ]( const LinesData& lines ) mutable {
-            if ( !lines.second ) {
-                if ( !interruptRequest ) {
-                    saveFile.commit();
-                    linesCount++;
-                }
-
-                progressDialog.finished( 0 );
-                return tbb::flow::continue_msg{};
-            }
-
-            for ( const auto& l : lines.first ) {
-
-                const auto encodedLine = codec->fromUnicode( l );
-                const auto written = saveFile.write( encodedLine );
-
-                if ( written != encodedLine.size() ) {
-                    LOG_ERROR << "Saving file write failed";
-                    interruptRequest.set();
-                    return tbb::flow::continue_msg{};
-                }
-
-                linesCount++;
-            }
-            return tbb::flow::continue_msg{};
-        } );
-
-    tbb::flow::make_edge( lineReader, lineWriter );
-
-    progressDialog.setWindowModality( Qt::ApplicationModal );
-    progressDialog.open();
-
-    lineReader.activate();
-    saveFileGraph.wait_for_all();
 }
 
 void AbstractLogView::updateSearchLimits()
@@ -1390,6 +1490,23 @@ void AbstractLogView::setSelectionEnd()
 // Public functions
 //
 
+void AbstractLogView::refreshLineLengths()
+{
+    // Lengths of the lines not indexed yet were estimated
+    if ( wrapLines_ ) {
+        wrappedRowIndex_.reset( logData_, getWrapColumns() );
+        updateScrollBars();
+    }
+
+    forceRefresh();
+}
+
+void AbstractLogView::stopBackgroundWork()
+{
+    highlightEngine_.stop();
+    wrappedRowIndex_.reset( nullptr, getWrapColumns() );
+}
+
 void AbstractLogView::updateData()
 {
     LOG_DEBUG << "AbstractLogView::updateData";
@@ -1399,6 +1516,7 @@ void AbstractLogView::updateData()
     // Check the top Line is within range
     if ( firstLine_ >= lastLineNumber ) {
         firstLine_ = 0_lnum;
+        firstRowInLine_ = 0;
         firstCol_ = 0;
         verticalScrollBar()->setValue( 0 );
         horizontalScrollBar()->setValue( 0 );
@@ -1407,6 +1525,19 @@ void AbstractLogView::updateData()
     // Crop selection if it become out of range
     selection_.crop( lastLineNumber - 1_lcount );
 
+    // Lines might have moved, the highlights we have are stale
+    highlightEngine_.invalidate();
+    linePrefetcher_.reset();
+
+    if ( wrapLines_ ) {
+        if ( isDataAppendOnly() && wrappedRowIndex_.wrapColumns() == getWrapColumns() ) {
+            wrappedRowIndex_.update();
+        }
+        else {
+            wrappedRowIndex_.reset( logData_, getWrapColumns() );
+        }
+    }
+
     // Adapt the scroll bars to the new content
     updateScrollBars();
 
@@ -1430,6 +1561,7 @@ void AbstractLogView::updateFont( const QFont& font )
 {
     setFont( font );
     pixmapFontMetrics_ = pixmapFontMetrics( font );
+    glyphCache_.setFont( font );
     updateDisplaySize();
     update();
 }
@@ -1440,6 +1572,15 @@ void AbstractLogView::updateDisplaySize()
     charHeight_ = std::max( pixmapFontMetrics_.height(), 1 );
     charWidth_ = textWidth( pixmapFontMetrics_, QString( "m" ) );
 
+    // Rows have to be counted again for the new width
+    if ( wrapLines_ && logData_ != nullptr
+         && wrappedRowIndex_.wrapColumns() != getWrapColumns() ) {
+        const auto topLine = firstLine_;
+        wrappedRowIndex_.reset( logData_, getWrapColumns() );
+        updateScrollBars();
+        verticalScrollBar()->setValue( lineNumberToVerticalScroll( topLine ) );
+    }
+
     // Update the scroll bars
     updateScrollBars();
     verticalScrollBar()->setPageStep( static_cast<int>( getNbVisibleLines().get() ) );
@@ -1509,6 +1650,14 @@ void AbstractLogView::selectAndDisplayLine( LineNumber line )
 // subtle: this one always jump, even if the line passed is visible.
 void AbstractLogView::jumpToLine( LineNumber line )
 {
+    if ( wrapLines_ ) {
+        const auto lineRow = wrappedRowIndex_.firstRowOf( line );
+        const auto halfScreen = getNbVisibleLines().get() / 2;
+        verticalScrollBar()->setValue(
+            rowToVerticalScroll( lineRow > halfScreen ? lineRow - halfScreen : 0 ) );
+        return;
+    }
+
     // Put the selected line in the middle if possible
     const auto newTopLine = line - LinesCount( getNbVisibleLines().get() / 2 );
     // This will also trigger a scrollContents event
@@ -1520,6 +1669,50 @@ void AbstractLogView::setLineNumbersVisible( bool lineNumbersVisible )
     lineNumbersVisible_ = lineNumbersVisible;
 }
 
+void AbstractLogView::setFieldColumnsVisible( bool fieldColumnsVisible )
+{
+    fieldColumnsVisible_ = fieldColumnsVisible;
+}
+
+void AbstractLogView::setLinesWrapped( bool wrapLines )
+{
+    if ( wrapLines == wrapLines_ ) {
+        return;
+    }
+
+    LOG_INFO << "Lines wrapped: " << wrapLines;
+
+    const auto topLine = firstLine_;
+    wrapLines_ = wrapLines;
+    firstRowInLine_ = 0;
+    visualRows_.clear();
+    wrappedRowIndex_.reset( wrapLines_ ? logData_ : nullptr, getWrapColumns() );
+
+    horizontalScrollBar()->setValue( 0 );
+    updateScrollBars();
+    verticalScrollBar()->setValue( lineNumberToVerticalScroll( topLine ) );
+    forceRefresh();
+}
+
+void AbstractLogView::updateWrappedRows()
+{
+    if ( !wrapLines_ ) {
+        return;
+    }
+
+    if ( followMode_ ) {
+        updateScrollBars();
+        jumpToBottom();
+        return;
+    }
+
+    // Keep the same row on top while the rows above it get counted
+    const QSignalBlocker blocker( verticalScrollBar() );
+    updateScrollBars();
+    verticalScrollBar()->setValue(
+        rowToVerticalScroll( wrappedRowIndex_.firstRowOf( firstLine_ ) + firstRowInLine_ ) );
+}
+
 void AbstractLogView::forceRefresh()
 {
     // Invalidate our cache
@@ -1552,10 +1745,46 @@ int AbstractLogView::getNbVisibleCols() const
     return ( viewport()->width() - leftMarginPx_ ) / charWidth_ + 1;
 }
 
+// Returns the number of columns fully visible, the width of wrapped rows
+int AbstractLogView::getWrapColumns() const
+{
+    return std::max( getNbVisibleCols() - 1, 1 );
+}
+
+// Returns the row drawn at the y coordinate if lines are wrapped
+const AbstractLogView::VisualRow* AbstractLogView::visualRowAt( int yPos ) const
+{
+    const auto offset = ( yPos - drawingTopOffset_ ) / charHeight_;
+    if ( !wrapLines_ || offset < 0 || static_cast<size_t>( offset ) >= visualRows_.size() ) {
+        return nullptr;
+    }
+    return &visualRows_[ static_cast<size_t>( offset ) ];
+}
+
+bool AbstractLogView::isLineVisible( LineNumber line ) const
+{
+    if ( wrapLines_ ) {
+        return !visualRows_.empty() && line >= visualRows_.front().line
+               && line <= visualRows_.back().line;
+    }
+    return ( line >= firstLine_ ) && ( line < ( firstLine_ + getNbVisibleLines() ) );
+}
+
 // Converts the mouse x, y coordinates to the line number in the file
 OptionalLineNumber AbstractLogView::convertCoordToLine( int yPos ) const
 {
+    if ( const auto row = visualRowAt( yPos ) ) {
+        return row->line;
+    }
+
     const auto offset = ( yPos - drawingTopOffset_ ) / charHeight_;
+    if ( wrapLines_ && offset >= 0 && !visualRows_.empty() ) {
+        // Past the rows drawn, count one line per row
+        return visualRows_.back().line
+               + LinesCount( static_cast<LinesCount::UnderlyingType>( offset )
+                             - visualRows_.size() + 1 );
+    }
+
     const auto linesOffset
         = LinesCount( static_cast<LinesCount::UnderlyingType>( std::abs( offset ) ) );
     if ( offset >= 0 ) {
@@ -1574,8 +1803,12 @@ AbstractLogView::FilePos AbstractLogView::convertCoordToFilePos( const QPoint& p
     if ( line >= logData_->getNbLine() )
         line = LineNumber( logData_->getNbLine().get() ) - 1_lcount;
 
+    // Wrapped rows start at their own column
+    const auto row = visualRowAt( pos.y() );
+    const auto firstColumn = row != nullptr && row->line == line ? row->firstColumn : firstCol_;
+
     const auto lineText = logData_->getExpandedLineString( line );
-    const auto visibleText = lineText.mid( firstCol_, getNbVisibleCols() + 1 );
+    const auto visibleText = lineText.mid( firstColumn, getNbVisibleCols() + 1 );
 
     std::vector<int> possibleColumns( static_cast<size_t>( visibleText.length() ) );
     std::iota( possibleColumns.begin(), possibleColumns.end(), 0 );
@@ -1592,7 +1825,7 @@ AbstractLogView::FilePos AbstractLogView::convertCoordToFilePos( const QPoint& p
     const auto length = static_cast<LineLength::UnderlyingType>( lineText.length() );
 
     auto column = columnIt != possibleColumns.end() ? *columnIt : length;
-    column += ( firstCol_ - 1 );
+    column += ( firstColumn - 1 );
     column = std::clamp( column, 0, length - 1 );
 
     LOG_DEBUG << "AbstractLogView::convertCoordToFilePos col=" << column << " line=" << line;
@@ -1604,7 +1837,7 @@ AbstractLogView::FilePos AbstractLogView::convertCoordToFilePos( const QPoint& p
 void AbstractLogView::displayLine( LineNumber line )
 {
     // If the line is already the screen
-    if ( ( line >= firstLine_ ) && ( line < ( firstLine_ + getNbVisibleLines() ) ) ) {
+    if ( isLineVisible( line ) ) {
         // Invalidate our cache
         forceRefresh();
     }
@@ -1623,14 +1856,14 @@ void AbstractLogView::moveSelection( LinesCount delta, bool isDeltaNegative )
 {
     LOG_DEBUG << "AbstractLogView::moveSelection delta=" << delta;
 
-    auto selection = selection_.getLines();
+    const auto [ firstSelected, nbSelected ] = selection_.getLineRange();
     LineNumber newLine;
 
-    if ( !selection.empty() ) {
+    if ( nbSelected.get() > 0 ) {
         if ( isDeltaNegative )
-            newLine = selection.front() - delta;
+            newLine = firstSelected - delta;
         else
-            newLine = selection.back() + delta;
+            newLine = firstSelected + nbSelected - 1_lcount + delta;
     }
 
     if ( newLine >= logData_->getNbLine() ) {
@@ -1694,6 +1927,13 @@ void AbstractLogView::jumpToTop()
 // Jump to the last line
 void AbstractLogView::jumpToBottom()
 {
+    if ( wrapLines_ ) {
+        // This will also trigger a scrollContents event
+        verticalScrollBar()->setValue( verticalScrollBar()->maximum() );
+        forceRefresh();
+        return;
+    }
+
     const auto newTopLine = ( logData_->getNbLine().get() < getNbVisibleLines().get() )
                                 ? 0
                                 : logData_->getNbLine().get() - getNbVisibleLines().get() + 1;
@@ -1872,25 +2112,98 @@ void AbstractLogView::considerMouseHovering( int xPos, int yPos )
 
 void AbstractLogView::updateScrollBars()
 {
-    if ( logData_->getNbLine() < getNbVisibleLines() ) {
+    const auto nbScrollRows = getNbScrollRows();
+    if ( nbScrollRows < getNbVisibleLines().get() ) {
         verticalScrollBar()->setRange( 0, 0 );
     }
     else {
         verticalScrollBar()->setRange(
-            0, static_cast<int>( qMin(
-                   logData_->getNbLine().get() - getNbVisibleLines().get()
-                       + LinesCount::UnderlyingType{ 1 },
-                   static_cast<LinesCount::UnderlyingType>( std::numeric_limits<int>::max() ) ) ) );
+            0, static_cast<int>(
+                   qMin( nbScrollRows - getNbVisibleLines().get() + uint64_t{ 1 },
+                         static_cast<uint64_t>( std::numeric_limits<int>::max() ) ) ) );
     }
 
     const int hScrollMaxValue
-        = qMax( 0, static_cast<int>( logData_->getMaxLength().get() ) - getNbVisibleCols() + 1 );
+        = wrapLines_ ? 0
+                     : qMax( 0, static_cast<int>( logData_->getMaxLength().get() )
+                                    - getNbVisibleCols() + 1 );
 
     horizontalScrollBar()->setRange( 0, hScrollMaxValue );
     horizontalScrollBar()->setPageStep( getNbVisibleCols() * 7 / 8 );
 }
 
+bool AbstractLogView::scrollTextAreaCache( int deltaRows, int deltaColumns )
+{
+    auto& pixmap = textAreaCache_.pixmap_;
+    const auto pixelRatio = pixmap.devicePixelRatio();
+
+    const auto nbVisibleRows = static_cast<int>( getNbVisibleLines().get() );
+    const auto nbVisibleCols = getNbVisibleCols();
+
+    // Scrolling diagonally exposes most of the area anyway
+    if ( ( deltaRows != 0 && deltaColumns != 0 ) || std::abs( deltaRows ) >= nbVisibleRows
+         || std::abs( deltaColumns ) >= nbVisibleCols ) {
+        return false;
+    }
+
+    // Shifting by a fractional number of device pixels would leave artifacts
+    const auto toDevicePixels = [ pixelRatio ]( int logicalPixels ) -> std::optional<int> {
+        const auto devicePixels = logicalPixels * pixelRatio;
+        if ( devicePixels != std::floor( devicePixels ) ) {
+            return {};
+        }
+        return static_cast<int>( devicePixels );
+    };
+
+    if ( deltaRows != 0 ) {
+        const auto shift = toDevicePixels( deltaRows * charHeight_ );
+        if ( !shift ) {
+            return false;
+        }
+
+        pixmap.scroll( 0, -*shift, pixmap.rect() );
+
+        if ( deltaRows > 0 ) {
+            drawTextArea( &pixmap, nbVisibleRows - deltaRows, deltaRows, 0, nbVisibleCols );
+        }
+        else {
+            drawTextArea( &pixmap, 0, -deltaRows, 0, nbVisibleCols );
+        }
+    }
+    else {
+        const auto shift = toDevicePixels( deltaColumns * charWidth_ );
+        const auto leftMargin = toDevicePixels( leftMarginPx_ );
+        if ( !shift || !leftMargin ) {
+            return false;
+        }
+
+        // The bullets and line numbers don't move horizontally
+        pixmap.scroll( -*shift, 0,
+                       QRect( *leftMargin, 0, pixmap.width() - *leftMargin, pixmap.height() ) );
+
+        if ( deltaColumns > 0 ) {
+            // The last visible column is only partially shown, so redraw one more
+            const auto firstExposed = std::max( nbVisibleCols - deltaColumns - 1, 0 );
+            drawTextArea( &pixmap, 0, nbVisibleRows, firstExposed, nbVisibleCols - firstExposed );
+        }
+        else {
+            drawTextArea( &pixmap, 0, nbVisibleRows, 0, -deltaColumns );
+        }
+    }
+
+    LOG_DEBUG << "Scrolled text area cache by " << deltaRows << " rows, " << deltaColumns
+              << " columns";
+    return true;
+}
+
 void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
+{
+    drawTextArea( paintDevice, 0, static_cast<int>( getNbVisibleLines().get() ), 0,
+                  getNbVisibleCols() );
+}
+
+void AbstractLogView::drawTextArea( QPaintDevice* paintDevice, int firstRow, int nbRows,
+                                    int firstColumn, int nbColumns )
 {
     // LOG_DEBUG << "devicePixelRatio: " << viewport()->devicePixelRatio();
     // LOG_DEBUG << "viewport size: " << viewport()->size().width();
@@ -1910,8 +2223,6 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
         = static_cast<int>( std::floor( paintDevice->width() / viewport()->devicePixelRatio() ) );
 
     const QPalette& palette = viewport()->palette();
-    const auto& highlighterSet = HighlighterSetCollection::get().currentActiveSet();
-    const auto& quickHighlighters = HighlighterSetCollection::get().quickHighlighters();
     QColor foreColor, backColor;
 
     static const QBrush normalBulletBrush = QBrush( Qt::white );
@@ -1924,28 +2235,24 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
     static constexpr int ContentMarginWidth = 1;
     static constexpr int LineNumberPadding = 3;
 
-    // First check the lines to be drawn are within range (might not be the case if
-    // the file has just changed)
     const auto linesInFile = logData_->getNbLine();
-
-    if ( firstLine_ > linesInFile )
-        firstLine_ = LineNumber( linesInFile.get() ? linesInFile.get() - 1 : 0 );
-
     const auto nbLines = qMin( getNbVisibleLines(), linesInFile - LinesCount( firstLine_.get() ) );
 
+    // Rows to actually draw, the ones past the end of file are only cleared
+    const auto rowsToDraw = qMin( LinesCount( static_cast<LinesCount::UnderlyingType>(
+                                      std::max( firstRow + nbRows, 0 ) ) ),
+                                  nbLines );
+    const auto firstRowToDraw
+        = LinesCount( static_cast<LinesCount::UnderlyingType>( std::max( firstRow, 0 ) ) );
+
     const int bottomOfTextPx = static_cast<int>( nbLines.get() ) * fontHeight;
 
-    LOG_DEBUG << "drawing lines from " << firstLine_ << " (" << nbLines << " lines)";
+    LOG_DEBUG << "drawing lines from " << firstLine_ + firstRowToDraw << " ("
+              << ( rowsToDraw > firstRowToDraw ? rowsToDraw - firstRowToDraw : 0_lcount )
+              << " lines), columns " << firstColumn << "+" << nbColumns;
     LOG_DEBUG << "bottomOfTextPx: " << bottomOfTextPx;
     LOG_DEBUG << "Height: " << paintDeviceHeight;
 
-    painter->fillRect( 0, 0, paintDeviceWidth, paintDeviceHeight,
-                       palette.color( QPalette::Window ) );
-
-    // First draw the bullet left margin
-    painter->setPen( palette.color( QPalette::Text ) );
-    painter->fillRect( 0, 0, BulletAreaWidth, paintDeviceHeight, Qt::darkGray );
-
     // Column at which the content should start (pixels)
     int contentStartPosX = BulletAreaWidth + SeparatorWidth;
 
@@ -1955,23 +2262,74 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
     // Update the length of line numbers
     const int nbDigitsInLineNumber = countDigits( maxDisplayLineNumber().get() );
 
-    // Draw the line numbers area
-    int lineNumberAreaStartX = 0;
+    const auto lineNumberAreaWidth
+        = 2 * LineNumberPadding + charWidth_ * nbDigitsInLineNumber;
+    const int lineNumberAreaStartX = lineNumbersVisible_ ? contentStartPosX : 0;
     if ( lineNumbersVisible_ ) {
-        const auto lineNumberWidth = charWidth_ * nbDigitsInLineNumber;
-        const auto lineNumberAreaWidth = 2 * LineNumberPadding + lineNumberWidth;
-        lineNumberAreaStartX = contentStartPosX;
+        contentStartPosX += lineNumberAreaWidth;
+    }
+
+    // Structured fields are parsed from the drawn lines and shown in columns
+    static constexpr int FieldColumnChars = 12;
+    const auto structuredFields
+        = fieldColumnsVisible_ ? Configuration::get().structuredFields() : QStringList{};
+    if ( structuredFields.isEmpty() ) {
+        fieldParser_.reset();
+    }
+    else {
+        std::vector<std::string> fields;
+        for ( const auto& field : structuredFields ) {
+            fields.push_back( field.trimmed().toStdString() );
+        }
+        if ( !fieldParser_ || fieldParser_->fields() != fields ) {
+            fieldParser_.emplace( std::move( fields ) );
+        }
+    }
+
+    const int nbFieldColumns
+        = fieldParser_ ? static_cast<int>( fieldParser_->fields().size() ) : 0;
+    const int fieldColumnWidth = 2 * LineNumberPadding + charWidth_ * FieldColumnChars;
+    const int fieldAreaStartX = contentStartPosX;
+    contentStartPosX += nbFieldColumns * fieldColumnWidth;
 
+    // This is the total width of the 'margin' (including line number if any)
+    // used for mouse calculation etc...
+    leftMarginPx_ = contentStartPosX + SeparatorWidth;
+
+    // Only touch the part of the device we have been asked to redraw,
+    // the margin next to the text always follows the first visible column.
+    const int clipTop = firstRow * fontHeight;
+    const int clipBottom
+        = firstRow + nbRows >= static_cast<int>( getNbVisibleLines().get() )
+              ? paintDeviceHeight
+              : ( firstRow + nbRows ) * fontHeight;
+    const int clipLeft = firstColumn == 0 ? 0 : leftMarginPx_ + firstColumn * charWidth_;
+    const int clipRight = firstColumn + nbColumns >= nbCols
+                              ? paintDeviceWidth
+                              : leftMarginPx_ + ( firstColumn + nbColumns ) * charWidth_;
+
+    QRegion clipRegion{ clipLeft, clipTop, clipRight - clipLeft, clipBottom - clipTop };
+    if ( firstColumn != 0 ) {
+        clipRegion += QRect{ contentStartPosX, clipTop, ContentMarginWidth, clipBottom - clipTop };
+    }
+    painter->setClipRegion( clipRegion );
+
+    painter->fillRect( 0, 0, paintDeviceWidth, paintDeviceHeight,
+                       palette.color( QPalette::Window ) );
+
+    // First draw the bullet left margin
+    painter->setPen( palette.color( QPalette::Text ) );
+    painter->fillRect( 0, 0, BulletAreaWidth, paintDeviceHeight, Qt::darkGray );
+
+    // Draw the line numbers area
+    if ( lineNumbersVisible_ ) {
         painter->setPen( palette.color( QPalette::Text ) );
-        painter->fillRect( contentStartPosX - SeparatorWidth, 0,
+        painter->fillRect( lineNumberAreaStartX - SeparatorWidth, 0,
                            lineNumberAreaWidth + SeparatorWidth, paintDeviceHeight, Qt::darkGray );
 
-        painter->drawLine( contentStartPosX + lineNumberAreaWidth - SeparatorWidth, 0,
-                           contentStartPosX + lineNumberAreaWidth - SeparatorWidth,
+        painter->drawLine( lineNumberAreaStartX + lineNumberAreaWidth - SeparatorWidth, 0,
+                           lineNumberAreaStartX + lineNumberAreaWidth - SeparatorWidth,
                            paintDeviceHeight );
-
-        // Update for drawing the actual text
-        contentStartPosX += lineNumberAreaWidth;
     }
     else {
         painter->fillRect( contentStartPosX - SeparatorWidth, 0, SeparatorWidth + 1,
@@ -1979,11 +2337,19 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
         // contentStartPosX += SEPARATOR_WIDTH;
     }
 
-    painter->drawLine( BulletAreaWidth, 0, BulletAreaWidth, paintDeviceHeight - 1 );
+    // Draw the field columns area
+    if ( nbFieldColumns > 0 ) {
+        painter->fillRect( fieldAreaStartX, 0, nbFieldColumns * fieldColumnWidth,
+                           paintDeviceHeight, palette.color( QPalette::AlternateBase ) );
+        painter->setPen( palette.color( QPalette::Disabled, QPalette::Text ) );
+        for ( int column = 1; column <= nbFieldColumns; ++column ) {
+            const int separatorX = fieldAreaStartX + column * fieldColumnWidth - SeparatorWidth;
+            painter->drawLine( separatorX, 0, separatorX, paintDeviceHeight );
+        }
+        painter->setPen( palette.color( QPalette::Text ) );
+    }
 
-    // This is the total width of the 'margin' (including line number if any)
-    // used for mouse calculation etc...
-    leftMarginPx_ = contentStartPosX + SeparatorWidth;
+    painter->drawLine( BulletAreaWidth, 0, BulletAreaWidth, paintDeviceHeight - 1 );
 
     const auto searchStartIndex = lineIndex( searchStart_ );
     const auto searchEndIndex = [ this ] {
@@ -1997,57 +2363,88 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
         return index;
     }();
 
-    // Lines to write
-    const auto expandedLines = logData_->getExpandedLines( firstLine_, nbLines );
+    // Lines to write, read once and shared by the highlighters and the drawing
+    std::vector<DisplayLine> displayLines;
+    std::vector<VisualRow> rows;
+    const auto firstDrawnLine = wrapLines_ ? firstLine_ : firstLine_ + firstRowToDraw;
+
+    if ( wrapLines_ ) {
+        // Wrapped lines are always drawn whole screen at a time, at the
+        // width their rows have been counted for
+        const auto wrapColumns = wrappedRowIndex_.wrapColumns();
+        const auto nbVisibleRows = getNbVisibleLines().get();
+        const auto firstRowInLine
+            = std::min( firstRowInLine_, wrappedRowIndex_.rowsOf( firstLine_ ) - 1 );
+
+        auto nbLinesToRead = 0_lcount;
+        for ( uint64_t nbRows = 0; nbRows < nbVisibleRows
+                                   && firstLine_ + nbLinesToRead < LineNumber( linesInFile.get() );
+              ++nbLinesToRead ) {
+            nbRows += wrappedRowIndex_.rowsOf( firstLine_ + nbLinesToRead )
+                      - ( nbLinesToRead.get() == 0 ? firstRowInLine : 0 );
+        }
 
-    const auto highlightPatternMatches = Configuration::get().mainSearchHighlight();
-    const auto variateHighlightPatternMatches = Configuration::get().variateMainSearchHighlight();
+        // Only the part of long lines that can fit on the screen is read,
+        // from its first visible row for the top line
+        const auto windowColumns = static_cast<int>( std::min(
+            nbVisibleRows * static_cast<uint64_t>( wrapColumns ),
+            static_cast<uint64_t>( std::numeric_limits<int>::max() ) ) );
+        if ( nbLinesToRead.get() > 0 ) {
+            displayLines = getDisplayLines( *logData_, firstLine_, 1_lcount,
+                                            static_cast<int>( firstRowInLine * wrapColumns ),
+                                            windowColumns );
+        }
+        if ( nbLinesToRead.get() > 1 ) {
+            auto nextLines = getDisplayLines( *logData_, firstLine_ + 1_lcount,
+                                              nbLinesToRead - 1_lcount, 0, windowColumns );
+            std::move( nextLines.begin(), nextLines.end(), std::back_inserter( displayLines ) );
+        }
 
-    std::optional<Highlighter> patternHighlight;
-    if ( highlightPatternMatches && !searchPattern_.isBoolean && !searchPattern_.isExclude
-         && !searchPattern_.pattern.isEmpty() ) {
-        const auto mainSearchBackColor = Configuration::get().mainSearchBackColor();
-        patternHighlight = Highlighter{};
-        patternHighlight->setHighlightOnlyMatch( true );
-        patternHighlight->setVariateColors( variateHighlightPatternMatches );
-        patternHighlight->setPattern( searchPattern_.pattern );
-        patternHighlight->setIgnoreCase( !searchPattern_.isCaseSensitive );
-        patternHighlight->setUseRegex( !searchPattern_.isPlainText );
+        for ( auto index = 0u; index < displayLines.size() && rows.size() < nbVisibleRows;
+              ++index ) {
+            const auto line = firstLine_ + LinesCount( index );
+            const auto lineRows = wrappedRowIndex_.rowsOf( line );
+            for ( auto row = index == 0 ? firstRowInLine : 0;
+                  row < lineRows && rows.size() < nbVisibleRows; ++row ) {
+                rows.push_back(
+                    { line, static_cast<int>( row * wrapColumns ), wrapColumns, row == 0 } );
+            }
+        }
 
-        patternHighlight->setBackColor( mainSearchBackColor );
-        patternHighlight->setForeColor( Qt::black );
+        visualRows_ = rows;
     }
-
-    std::vector<Highlighter> additionalHighlighters;
-    for ( auto i = 0u; i < quickHighlighters_.size(); ++i ) {
-        const auto quickHighlighterIndex = static_cast<int>( i );
-        if ( quickHighlighterIndex >= quickHighlighters.size() ) {
-            LOG_WARNING << "Not enough quickHighlighters configured";
-            break;
+    else {
+        if ( rowsToDraw > firstRowToDraw ) {
+            displayLines
+                = getDisplayLines( *logData_, firstDrawnLine, rowsToDraw - firstRowToDraw,
+                                   firstCol_ + firstColumn, nbColumns );
         }
 
-        const auto quickHighlighter = quickHighlighters.at( quickHighlighterIndex );
-
-        std::transform( quickHighlighters_[ i ].begin(), quickHighlighters_[ i ].end(),
-                        std::back_inserter( additionalHighlighters ),
-                        [ quickHighlighter ]( const QString& word ) {
-                            Highlighter h{ word, false, true, quickHighlighter.color.foreColor,
-                                           quickHighlighter.color.backColor };
-                            h.setUseRegex( false );
-                            return h;
-                        } );
+        for ( auto index = 0u; index < displayLines.size(); ++index ) {
+            rows.push_back( { firstDrawnLine + LinesCount( index ), firstCol_ + firstColumn,
+                              nbColumns, true } );
+        }
     }
 
-    // Then draw each line
-    for ( auto currentLine = 0_lcount; currentLine < nbLines; ++currentLine ) {
-        const auto lineNumber = firstLine_ + currentLine;
-        const QString logLine = logData_->getLineString( lineNumber );
+    updateHighlightRules();
+    const auto lineHighlights = highlightEngine_.highlights( firstDrawnLine, displayLines );
+
+    // Then draw each row
+    for ( auto rowIndex = 0u; rowIndex < rows.size(); ++rowIndex ) {
+        const auto& row = rows[ rowIndex ];
+        const auto lineNumber = row.line;
+        const auto& displayLine = displayLines[ ( lineNumber - firstDrawnLine ).get() ];
+        const auto& highlights = *lineHighlights[ ( lineNumber - firstDrawnLine ).get() ];
+        const auto isLineEnd
+            = rowIndex + 1 == rows.size() || rows[ rowIndex + 1 ].line != lineNumber;
 
         // Position in pixel of the base line of the line to print
-        const int yPos = static_cast<int>( currentLine.get() ) * fontHeight;
-        const int xPos = contentStartPosX + ContentMarginWidth;
+        const int yPos
+            = ( static_cast<int>( firstRowToDraw.get() ) + static_cast<int>( rowIndex ) )
+              * fontHeight;
+        const int xPos = contentStartPosX + ContentMarginWidth + firstColumn * charWidth_;
 
-        std::vector<HighlightedMatch> highlighterMatches;
+        std::vector<HighlightedMatch> allHighlights;
 
         if ( selection_.isLineSelected( lineNumber ) && !selection_.isSingleLine() ) {
             // Reverse the selected line
@@ -2056,12 +2453,10 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             painter->setPen( palette.color( QPalette::Text ) );
         }
         else {
-            const auto highlightType = highlighterSet.matchLine( logLine, highlighterMatches );
-
-            if ( highlightType == HighlighterMatchType::LineMatch ) {
+            if ( highlights.lineColor ) {
                 // color applies to whole line
-                foreColor = highlighterMatches.front().foreColor();
-                backColor = highlighterMatches.front().backColor();
+                foreColor = highlights.lineColor->foreColor;
+                backColor = highlights.lineColor->backColor;
             }
             else {
                 // Use the default colors
@@ -2075,63 +2470,25 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
                 backColor = palette.color( QPalette::Base );
             }
 
-            if ( patternHighlight ) {
-                std::vector<HighlightedMatch> patternMatches;
-                patternHighlight->matchLine( logLine, patternMatches );
-                highlighterMatches.insert( highlighterMatches.end(), patternMatches.begin(),
-                                           patternMatches.end() );
-            }
-
-            for ( const auto& highlighter : additionalHighlighters ) {
-                std::vector<HighlightedMatch> patternMatches;
-                highlighter.matchLine( logLine, patternMatches );
-                highlighterMatches.insert( highlighterMatches.end(), patternMatches.begin(),
-                                           patternMatches.end() );
-            }
+            allHighlights = highlights.matches;
         }
 
-        const auto untabifyHighlight = [ &logLine ]( const auto& match ) {
-#if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
-            const auto prefix = logLine.leftRef( match.startColumn() );
-#else
-            const auto prefix = QStringView{ logLine }.left( match.startColumn() );
-#endif
-            const auto expandedPrefixLength
-                = static_cast<LineLength::UnderlyingType>( untabify( prefix.toString() ).length() );
-            auto startDelta
-                = static_cast<LineLength::UnderlyingType>( expandedPrefixLength - prefix.length() );
-
-#if QT_VERSION < QT_VERSION_CHECK( 6, 0, 0 )
-            const auto matchPart = logLine.midRef( match.startColumn(), match.length() );
-#else
-            const auto matchPart
-                = QStringView{ logLine }.mid( match.startColumn(), match.length() );
-#endif
-            const auto expandedMatchLength = static_cast<LineLength::UnderlyingType>(
-                untabify( matchPart.toString(), expandedPrefixLength ).length() );
-
-            const auto lengthDelta = static_cast<LineLength::UnderlyingType>(
-                expandedMatchLength - matchPart.length() );
-
-            return HighlightedMatch{ match.startColumn() + startDelta, match.length() + lengthDelta,
-                                     match.foreColor(), match.backColor() };
-        };
-
-        std::vector<HighlightedMatch> allHighlights;
-        allHighlights.reserve( highlighterMatches.size() );
-        std::transform( highlighterMatches.cbegin(), highlighterMatches.cend(),
-                        std::back_inserter( allHighlights ), untabifyHighlight );
-
-        // string to print, cut to fit the length and position of the view
-        const QString expandedLine = expandedLines[ currentLine.get() ];
-        const QString cutLine = expandedLine.mid( firstCol_, nbCols );
+        // string to print, cut to fit the length and position of the view,
+        // long lines only hold the text around the view
+        const QString& expandedLine = displayLine.expanded();
+        const QString cutLine
+            = expandedLine.mid( row.firstColumn - displayLine.firstColumn(), row.nbColumns );
 
         // Has the line got elements to be highlighted
         std::vector<HighlightedMatch> quickFindMatches;
         quickFindPattern_->matchLine( expandedLine, quickFindMatches );
-        allHighlights.insert( allHighlights.end(),
-                              std::make_move_iterator( quickFindMatches.begin() ),
-                              std::make_move_iterator( quickFindMatches.end() ) );
+        std::transform( quickFindMatches.begin(), quickFindMatches.end(),
+                        std::back_inserter( allHighlights ),
+                        [ &displayLine ]( const HighlightedMatch& match ) {
+                            return HighlightedMatch{
+                                match.startColumn() + displayLine.firstColumn(), match.length(),
+                                match.foreColor(), match.backColor() };
+                        } );
 
         // Is there something selected in the line?
         const auto selectionPortion = selection_.getPortionForLine( lineNumber );
@@ -2149,43 +2506,21 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             // line has to be somehow highlighted
             LineDrawer lineDrawer( backColor );
 
-            auto foreColors = std::vector<QColor>( static_cast<size_t>( nbCols + 1 ), foreColor );
-            auto backColors = std::vector<QColor>( static_cast<size_t>( nbCols + 1 ), backColor );
-
-            for ( const auto& match : allHighlights ) {
-                const auto start = match.startColumn() - firstCol_;
-                const auto end = start + match.length();
-
-                // Ignore matches that are *completely* outside view area
-                if ( ( start < 0 && end < 0 ) || start >= nbCols )
-                    continue;
-
-                const auto firstColumn = static_cast<size_t>( qMax( start, 0 ) );
-                const auto lastColumn
-                    = static_cast<size_t>( qMin( start + match.length(), nbCols ) );
-
-                for ( auto column = firstColumn; column < lastColumn; ++column ) {
-                    foreColors[ column ] = match.foreColor();
-                    backColors[ column ] = match.backColor();
-                }
-            }
-
-            std::vector<LineChunk> highlightChunks;
-            auto lastMatchStart = 0;
-            for ( auto column = 0u; column < foreColors.size() - 1; ++column ) {
-                if ( foreColors[ column ] != foreColors[ column + 1 ]
-                     || backColors[ column ] != backColors[ column + 1 ] ) {
-                    lineDrawer.addChunk( { lastMatchStart, static_cast<int>( column ),
-                                           foreColors[ column ], backColors[ column ] } );
-                    lastMatchStart = static_cast<int>( column + 1 );
-                }
-            }
-            if ( lastMatchStart < nbCols ) {
-                lineDrawer.addChunk(
-                    { lastMatchStart, nbCols, foreColors.back(), backColors.back() } );
+            // Make the highlights relative to the first column drawn
+            const auto columnOffset = row.firstColumn;
+            std::transform( allHighlights.begin(), allHighlights.end(), allHighlights.begin(),
+                            [ columnOffset ]( const HighlightedMatch& match ) {
+                                return HighlightedMatch{ match.startColumn() - columnOffset,
+                                                         match.length(), match.foreColor(),
+                                                         match.backColor() };
+                            } );
+
+            for ( const auto& chunk :
+                  mergeHighlights( allHighlights, row.nbColumns, foreColor, backColor ) ) {
+                lineDrawer.addChunk( chunk );
             }
 
-            lineDrawer.draw( painter.get(), xPos, yPos, viewport()->width(), cutLine,
+            lineDrawer.draw( painter.get(), glyphCache_, xPos, yPos, viewport()->width(), cutLine,
                              ContentMarginWidth );
         }
         else {
@@ -2195,19 +2530,36 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             // (the rectangle is extended on the left to cover the small
             // margin, it looks better (LineDrawer does the same) )
             painter->setPen( foreColor );
-            painter->drawText( xPos, yPos + fontAscent, cutLine );
+            const auto cutLineLength = static_cast<int>( cutLine.size() );
+            if ( glyphCache_.canDraw( cutLine, 0, cutLineLength ) ) {
+                glyphCache_.draw( painter.get(), xPos, yPos + fontAscent, cutLine, 0,
+                                  cutLineLength );
+            }
+            else {
+                painter->drawText( xPos, yPos + fontAscent, cutLine );
+            }
         }
 
         if ( ( selection_.isLineSelected( lineNumber ) && selection_.isSingleLine() )
              || selection_.getPortionForLine( lineNumber ).isValid() ) {
             auto selectionPen = QPen( palette.color( QPalette::Highlight ) );
-            selectionPen.setWidth( 3 );
-            painter->setPen( selectionPen );
-            painter->drawLine( xPos - ContentMarginWidth + 1, yPos, viewport()->width(), yPos );
-            selectionPen.setWidth( 5 );
-            painter->setPen( selectionPen );
-            painter->drawLine( xPos - ContentMarginWidth + 2, yPos + fontHeight,
-                               viewport()->width(), yPos + fontHeight );
+            if ( row.isLineStart ) {
+                selectionPen.setWidth( 3 );
+                painter->setPen( selectionPen );
+                painter->drawLine( xPos - ContentMarginWidth + 1, yPos, viewport()->width(),
+                                   yPos );
+            }
+            if ( isLineEnd ) {
+                selectionPen.setWidth( 5 );
+                painter->setPen( selectionPen );
+                painter->drawLine( xPos - ContentMarginWidth + 2, yPos + fontHeight,
+                                   viewport()->width(), yPos + fontHeight );
+            }
+        }
+
+        // The next rows of a wrapped line have no bullet nor number
+        if ( !row.isLineStart ) {
+            continue;
         }
 
         // Then draw the bullet
@@ -2256,7 +2608,28 @@ void AbstractLogView::drawTextArea( QPaintDevice* paintDevice )
             painter->drawText( lineNumberAreaStartX + LineNumberPadding, yPos + fontAscent,
                                lineNumberStr );
         }
-    } // For each line
+
+        // Draw the structured fields, long values are cut
+        if ( nbFieldColumns > 0 ) {
+            std::vector<QString> values( fieldParser_->fields().size() );
+            fieldParser_->parse( displayLine.raw().toStdString(),
+                                 [ &values ]( size_t field, std::string_view value ) {
+                                     values[ field ] = QString::fromUtf8(
+                                         value.data(), static_cast<int>( value.size() ) );
+                                 } );
+
+            painter->setPen( palette.color( QPalette::Text ) );
+            for ( int column = 0; column < nbFieldColumns; ++column ) {
+                const auto& value = values[ static_cast<size_t>( column ) ];
+                const auto text = value.size() > FieldColumnChars
+                                      ? value.left( FieldColumnChars - 1 ) + QChar( 0x2026 )
+                                      : value;
+                painter->drawText( fieldAreaStartX + column * fieldColumnWidth
+                                       + LineNumberPadding,
+                                   yPos + fontAscent, text );
+            }
+        }
+    } // For each row
 }
 
 // Draw the "pull to follow" bar and return a pixmap.
@@ -2290,6 +2663,62 @@ void AbstractLogView::disableFollow()
     followElasticHook_.hook( false );
 }
 
+void AbstractLogView::updateHighlightRules()
+{
+    const auto& config = Configuration::get();
+    HighlightRulesKey key{ HighlighterSetCollection::generation(), highlightRulesGeneration_,
+                           config.mainSearchHighlight(), config.variateMainSearchHighlight(),
+                           config.mainSearchBackColor() };
+    if ( highlightRulesKey_ == key ) {
+        return;
+    }
+
+    const auto highlightPatternMatches = key.highlightPatternMatches;
+    const auto variateHighlightPatternMatches = key.variateHighlightPatternMatches;
+    const auto& quickHighlighters = HighlighterSetCollection::get().quickHighlighters();
+
+    HighlightRules highlightRules;
+    highlightRules.highlighterSet = HighlighterSetCollection::get().currentActiveSet();
+
+    auto& patternHighlight = highlightRules.searchHighlighter;
+    if ( highlightPatternMatches && !searchPattern_.isBoolean && !searchPattern_.isExclude
+         && !searchPattern_.pattern.isEmpty() ) {
+        const auto& mainSearchBackColor = key.mainSearchBackColor;
+        patternHighlight = Highlighter{};
+        patternHighlight->setHighlightOnlyMatch( true );
+        patternHighlight->setVariateColors( variateHighlightPatternMatches );
+        patternHighlight->setPattern( searchPattern_.pattern );
+        patternHighlight->setIgnoreCase( !searchPattern_.isCaseSensitive );
+        patternHighlight->setUseRegex( !searchPattern_.isPlainText );
+
+        patternHighlight->setBackColor( mainSearchBackColor );
+        patternHighlight->setForeColor( Qt::black );
+    }
+
+    auto& additionalHighlighters = highlightRules.quickHighlighters;
+    for ( auto i = 0u; i < quickHighlighters_.size(); ++i ) {
+        const auto quickHighlighterIndex = static_cast<int>( i );
+        if ( quickHighlighterIndex >= quickHighlighters.size() ) {
+            LOG_WARNING << "Not enough quickHighlighters configured";
+            break;
+        }
+
+        const auto quickHighlighter = quickHighlighters.at( quickHighlighterIndex );
+
+        std::transform( quickHighlighters_[ i ].begin(), quickHighlighters_[ i ].end(),
+                        std::back_inserter( additionalHighlighters ),
+                        [ quickHighlighter ]( const QString& word ) {
+                            Highlighter h{ word, false, true, quickHighlighter.color.foreColor,
+                                           quickHighlighter.color.backColor };
+                            h.setUseRegex( false );
+                            return h;
+                        } );
+    }
+
+    highlightEngine_.setRules( std::move( highlightRules ) );
+    highlightRulesKey_ = std::move( key );
+}
+
 void AbstractLogView::setHighlighterSet( QAction* action )
 {
     saveCurrentHighlighterFromAction( action );
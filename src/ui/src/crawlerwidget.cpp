@@ -48,10 +48,12 @@
 #include <cassert>
 #include <chrono>
 #include <iterator>
+#include <limits>
 
 #include <QAction>
 #include <QApplication>
 #include <QCompleter>
+#include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
 #include <QHeaderView>
@@ -60,6 +62,7 @@
 #include <QKeySequence>
 #include <QLineEdit>
 #include <QListView>
+#include <QMessageBox>
 #include <QShortcut>
 #include <QStandardItemModel>
 #include <QStringListModel>
@@ -72,6 +75,7 @@
 
 #include "configuration.h"
 #include "dispatch_to.h"
+#include "fieldquery.h"
 #include "fontutils.h"
 #include "infoline.h"
 #include "overview.h"
@@ -79,6 +83,7 @@
 #include "quickfindwidget.h"
 #include "savedsearches.h"
 #include "shortcuts.h"
+#include "timestampparser.h"
 
 static constexpr char AnsiColorSequenceRegex[] = "\\x1B\\[([0-9]{1,2}(;[0-9]{1,2})?)?[mK]";
 
@@ -170,6 +175,18 @@ CrawlerWidget::CrawlerWidget( QWidget* parent )
 {
 }
 
+CrawlerWidget::~CrawlerWidget()
+{
+    // Views are deleted with the children of the widget,
+    // after the data they read in the background.
+    if ( logMainView_ ) {
+        logMainView_->stopBackgroundWork();
+    }
+    if ( filteredView_ ) {
+        filteredView_->stopBackgroundWork();
+    }
+}
+
 // The top line is first one on the main display
 LineNumber CrawlerWidget::getTopLine() const
 {
@@ -308,6 +325,85 @@ void CrawlerWidget::goToLine()
     }
 }
 
+void CrawlerWidget::goToTime()
+{
+    if ( !logData_->hasTimestamps() ) {
+        QMessageBox::information( this, "Jump to time",
+                                  "No timestamps were found in this file, check the timestamp "
+                                  "format in the options." );
+        return;
+    }
+
+    const auto [ firstTimestamp, lastTimestamp ] = logData_->getTimestampRange();
+    const auto firstTime = QDateTime::fromMSecsSinceEpoch( firstTimestamp, Qt::UTC );
+    const auto lastTime = QDateTime::fromMSecsSinceEpoch( lastTimestamp, Qt::UTC );
+
+    bool isTimeEntered = false;
+    const auto timeText
+        = QInputDialog::getText( this, "Jump to time",
+                                 QString( "Time (%1 - %2)" )
+                                     .arg( firstTime.toString( Qt::ISODateWithMs ),
+                                           lastTime.toString( Qt::ISODateWithMs ) ),
+                                 QLineEdit::Normal, QString{}, &isTimeEntered )
+              .trimmed();
+
+    if ( !isTimeEntered || timeText.isEmpty() ) {
+        return;
+    }
+
+    const auto timestamp = parseTimeInFile( timeText );
+    if ( !timestamp ) {
+        QMessageBox::warning( this, "Jump to time", "Can't parse time" );
+        return;
+    }
+
+    const auto line = logData_->findLineByTimestamp( *timestamp ).value_or(
+        LineNumber( logData_->getNbLine().get() ) - 1_lcount );
+
+    filteredView_->trySelectLine( logFilteredData_->getLineIndexNumber( line ) );
+    logMainView_->trySelectLine( line );
+}
+
+OptionalTimestamp CrawlerWidget::parseTimeInFile( const QString& timeText ) const
+{
+    const auto text = timeText.trimmed().toStdString();
+    auto timestamp = parseTimestamp( text );
+    if ( !timestamp ) {
+        const auto timeOfDay = parseTimeOfDay( text );
+        if ( timeOfDay ) {
+            constexpr Timestamp MillisecondsInDay = 24 * 3600 * 1000;
+            const auto firstTimestamp = logData_->getTimestampRange().first;
+            timestamp = firstTimestamp - firstTimestamp % MillisecondsInDay + *timeOfDay;
+        }
+    }
+
+    return timestamp;
+}
+
+std::optional<std::pair<Timestamp, Timestamp>>
+CrawlerWidget::getSearchTimeRange( bool& isValid ) const
+{
+    isValid = true;
+
+    const auto fromText = searchFromTimeEdit_->text().trimmed();
+    const auto toText = searchToTimeEdit_->text().trimmed();
+    if ( !logData_->hasTimestamps() || ( fromText.isEmpty() && toText.isEmpty() ) ) {
+        return {};
+    }
+
+    const auto from = fromText.isEmpty()
+                          ? OptionalTimestamp{ std::numeric_limits<Timestamp>::min() }
+                          : parseTimeInFile( fromText );
+    const auto to = toText.isEmpty() ? OptionalTimestamp{ std::numeric_limits<Timestamp>::max() }
+                                     : parseTimeInFile( toText );
+    if ( !from || !to ) {
+        isValid = false;
+        return {};
+    }
+
+    return std::make_pair( *from, *to );
+}
+
 //
 // Protected functions
 //
@@ -518,32 +614,27 @@ void CrawlerWidget::updateLineNumberHandler( LineNumber line )
     Q_EMIT updateLineNumber( line );
 }
 
-void CrawlerWidget::markLinesFromMain( const std::vector<LineNumber>& lines )
+void CrawlerWidget::markLinesFromMain( LineNumber firstLine, LinesCount count )
 {
-    std::vector<LineNumber> alreadyMarkedLines;
-    alreadyMarkedLines.reserve( lines.size() );
+    const auto endLine = qMin( firstLine + count, LineNumber( logData_->getNbLine().get() ) );
 
-    bool markAdded = false;
-    for ( const auto& line : lines ) {
-        if ( line > logData_->getNbLine() ) {
-            continue;
-        }
-
-        if ( !logFilteredData_->lineTypeByLine( line ).testFlag(
-                 AbstractLogData::LineTypeFlags::Mark ) ) {
-            logFilteredData_->addMark( line );
-            markAdded = true;
-        }
-        else {
-            alreadyMarkedLines.push_back( line );
-        }
+    SearchResultArray lines;
+    if ( firstLine < endLine ) {
+        lines.addRange( firstLine.get(), endLine.get() );
     }
 
-    if ( !markAdded ) {
-        for ( const auto& line : alreadyMarkedLines ) {
-            logFilteredData_->toggleMark( line );
-        }
-    }
+    markLines( lines );
+}
+
+void CrawlerWidget::markLinesFromFiltered( LineNumber firstIndex, LinesCount count )
+{
+    markLines( logFilteredData_->getMatchingLines( firstIndex, count ) );
+}
+
+void CrawlerWidget::markLines( const SearchResultArray& lines )
+{
+    // Marks all of them, unless all are marked already
+    logFilteredData_->toggleMarks( lines );
 
     // Recompute the content of both window.
     filteredView_->updateData();
@@ -556,22 +647,6 @@ void CrawlerWidget::markLinesFromMain( const std::vector<LineNumber>& lines )
     update();
 }
 
-void CrawlerWidget::markLinesFromFiltered( const std::vector<LineNumber>& lines )
-{
-    std::vector<LineNumber> linesInMain( lines.size() );
-    std::transform( lines.cbegin(), lines.cend(), linesInMain.begin(),
-                    [ this ]( const auto& filteredLine ) {
-                        if ( filteredLine < logData_->getNbLine() ) {
-                            return logFilteredData_->getMatchingLineNumber( filteredLine );
-                        }
-                        else {
-                            return maxValue<LineNumber>();
-                        }
-                    } );
-
-    markLinesFromMain( linesInMain );
-}
-
 void CrawlerWidget::applyConfiguration()
 {
     const auto& config = Configuration::get();
@@ -600,6 +675,12 @@ void CrawlerWidget::applyConfiguration()
     logMainView_->setLineNumbersVisible( config.mainLineNumbersVisible() );
     filteredView_->setLineNumbersVisible( config.filteredLineNumbersVisible() );
 
+    logMainView_->setLinesWrapped( config.linesWrapped() );
+    filteredView_->setLinesWrapped( config.linesWrapped() );
+
+    logMainView_->setFieldColumnsVisible( config.fieldColumnsVisible() );
+    filteredView_->setFieldColumnsVisible( config.fieldColumnsVisible() );
+
     const auto isFollowModeAllowed = config.anyFileWatchEnabled();
     logMainView_->allowFollowMode( isFollowModeAllowed );
     filteredView_->allowFollowMode( isFollowModeAllowed );
@@ -646,6 +727,9 @@ void CrawlerWidget::loadingFinishedHandler( LoadingStatus status )
 {
     LOG_INFO << "file loading finished, status " << static_cast<int>( status );
 
+    searchFromTimeEdit_->setEnabled( logData_->hasTimestamps() );
+    searchToTimeEdit_->setEnabled( logData_->hasTimestamps() );
+
     // We need to refresh the main window because the view lines on the
     // overview have probably changed.
     overview_.updateData( logData_->getNbLine() );
@@ -775,6 +859,17 @@ void CrawlerWidget::useRegexpChangeHandler( bool )
     resetStateOnSearchPatternChanges();
 }
 
+void CrawlerWidget::fieldFilterChangedHandler( bool useFieldFilter )
+{
+    // Field filters have their own syntax, regular expression options don't apply
+    matchCaseButton_->setEnabled( !useFieldFilter );
+    useRegexpButton_->setEnabled( !useFieldFilter );
+    inverseButton_->setEnabled( !useFieldFilter );
+    booleanButton_->setEnabled( !useFieldFilter );
+
+    resetStateOnSearchPatternChanges();
+}
+
 void CrawlerWidget::searchTextChangeHandler( QString )
 {
     resetStateOnSearchPatternChanges();
@@ -928,6 +1023,7 @@ void CrawlerWidget::setup()
     filteredView_->setContentsMargins( 2, 0, 2, 0 );
 
     overviewWidget_->setOverview( &overview_ );
+    overview_.setLogData( logData_.get() );
     overviewWidget_->setParent( logMainView_ );
 
     // Connect the search to the top view
@@ -1019,6 +1115,14 @@ void CrawlerWidget::setup()
     booleanButton_->setFocusPolicy( Qt::NoFocus );
     booleanButton_->setContentsMargins( 2, 2, 2, 2 );
 
+    fieldFilterButton_ = new QToolButton();
+    fieldFilterButton_->setToolTip(
+        "Filter on structured fields (level=error AND service=payments)" );
+    fieldFilterButton_->setText( "{}" );
+    fieldFilterButton_->setCheckable( true );
+    fieldFilterButton_->setFocusPolicy( Qt::NoFocus );
+    fieldFilterButton_->setContentsMargins( 2, 2, 2, 2 );
+
     searchRefreshButton_ = new QToolButton();
     searchRefreshButton_->setToolTip( "Auto-refresh" );
     searchRefreshButton_->setCheckable( true );
@@ -1063,6 +1167,32 @@ void CrawlerWidget::setup()
 
     predefinedFilters_ = new PredefinedFiltersComboBox( this );
 
+    // Time range of the search, only enabled for files with timestamps
+    const auto timeEditFontMetrics = searchInfoLine_->fontMetrics();
+#if ( QT_VERSION >= QT_VERSION_CHECK( 5, 11, 0 ) )
+    const auto timeEditWidth = timeEditFontMetrics.horizontalAdvance( "0000-00-00 00:00:00.000" );
+#else
+    const auto timeEditWidth = timeEditFontMetrics.width( "0000-00-00 00:00:00.000" );
+#endif
+    const auto timeEditToolTip
+        = QString( "Only search lines logged %1 this time, as ISO-8601, syslog or time of day" );
+
+    searchFromTimeEdit_ = new QLineEdit;
+    searchFromTimeEdit_->setPlaceholderText( tr( "From time" ) );
+    searchFromTimeEdit_->setToolTip( timeEditToolTip.arg( "at or after" ) );
+    searchFromTimeEdit_->setMaximumWidth( timeEditWidth );
+    searchFromTimeEdit_->setClearButtonEnabled( true );
+    searchFromTimeEdit_->setEnabled( false );
+    searchFromTimeEdit_->setContentsMargins( 2, 2, 2, 2 );
+
+    searchToTimeEdit_ = new QLineEdit;
+    searchToTimeEdit_->setPlaceholderText( tr( "To time" ) );
+    searchToTimeEdit_->setToolTip( timeEditToolTip.arg( "at or before" ) );
+    searchToTimeEdit_->setMaximumWidth( timeEditWidth );
+    searchToTimeEdit_->setClearButtonEnabled( true );
+    searchToTimeEdit_->setEnabled( false );
+    searchToTimeEdit_->setContentsMargins( 2, 2, 2, 2 );
+
     auto* searchLineLayout = new QHBoxLayout;
     searchLineLayout->setContentsMargins( 2, 2, 2, 2 );
 
@@ -1071,9 +1201,12 @@ void CrawlerWidget::setup()
     searchLineLayout->addWidget( useRegexpButton_ );
     searchLineLayout->addWidget( inverseButton_ );
     searchLineLayout->addWidget( booleanButton_ );
+    searchLineLayout->addWidget( fieldFilterButton_ );
     searchLineLayout->addWidget( searchRefreshButton_ );
     searchLineLayout->addWidget( predefinedFilters_ );
     searchLineLayout->addWidget( searchLineEdit_ );
+    searchLineLayout->addWidget( searchFromTimeEdit_ );
+    searchLineLayout->addWidget( searchToTimeEdit_ );
     searchLineLayout->addWidget( searchButton_ );
     searchLineLayout->addWidget( stopButton_ );
     searchLineLayout->addWidget( searchInfoLine_ );
@@ -1109,6 +1242,10 @@ void CrawlerWidget::setup()
     // Connect the signals
     connect( searchLineEdit_->lineEdit(), &QLineEdit::returnPressed, searchButton_,
              &QToolButton::click );
+    connect( searchFromTimeEdit_, &QLineEdit::returnPressed, searchButton_,
+             &QToolButton::click );
+    connect( searchToTimeEdit_, &QLineEdit::returnPressed, searchButton_,
+             &QToolButton::click );
     connect( searchLineEdit_->lineEdit(), &QLineEdit::textEdited, this,
              &CrawlerWidget::searchTextChangeHandler );
 
@@ -1230,6 +1367,15 @@ void CrawlerWidget::setup()
              &CrawlerWidget::loadingFinishedHandler );
     connect( logData_.get(), &LogData::fileChanged, this, &CrawlerWidget::fileChangedHandler );
 
+    // Long lines are shown from their beginning until indexed
+    connect(
+        logData_.get(), &LogData::longLinesIndexed, this,
+        [ this ] {
+            logMainView_->refreshLineLengths();
+            filteredView_->refreshLineLengths();
+        },
+        Qt::QueuedConnection );
+
     // Search auto-refresh
     connect( searchRefreshButton_, &QPushButton::toggled, this,
              &CrawlerWidget::searchRefreshChangedHandler );
@@ -1243,6 +1389,9 @@ void CrawlerWidget::setup()
     connect( booleanButton_, &QPushButton::toggled, this,
              &CrawlerWidget::booleanCombiningChangedHandler );
 
+    connect( fieldFilterButton_, &QPushButton::toggled, this,
+             &CrawlerWidget::fieldFilterChangedHandler );
+
     // Advise the parent the checkboxes have been changed
     // (for maintaining default config)
     connect( searchRefreshButton_, &QPushButton::toggled, this,
@@ -1388,8 +1537,20 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
             searchText, matchCaseButton_->isChecked(), inverseButton_->isChecked(),
             booleanButton_->isChecked(), !useRegexpButton_->isChecked() );
 
+        // Field filters are resolved on the field index built while indexing
+        std::optional<FieldQuery> fieldQuery;
+        if ( fieldFilterButton_->isChecked() ) {
+            fieldQuery = FieldQuery::parse( searchText.toStdString(),
+                                            logData_->getStructuredFields() );
+            regexpPattern = {};
+        }
+
         RegularExpression hsExpression{ regexpPattern };
-        auto isValidExpression = hsExpression.isValid();
+        auto isValidExpression = fieldQuery ? fieldQuery->isValid() : hsExpression.isValid();
+
+        bool isValidTimeRange = true;
+        const auto timeRange = getSearchTimeRange( isValidTimeRange );
+        isValidExpression = isValidExpression && isValidTimeRange;
 
         if ( isValidExpression ) {
             // Activate the stop button
@@ -1397,7 +1558,25 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
             stopButton_->show();
             searchButton_->hide();
             // Start a new asynchronous search
-            logFilteredData_->runSearch( regexpPattern, searchStartLine_, searchEndLine_ );
+            if ( fieldQuery ) {
+                logFilteredData_->runFieldSearch( *fieldQuery, searchStartLine_,
+                                                  searchEndLine_ );
+            }
+            else {
+                // Matches the user is looking at are shown first
+                const auto focusLine = Configuration::get().searchVisibleLinesFirst()
+                                           ? OptionalLineNumber{ logMainView_->getTopLine() }
+                                           : OptionalLineNumber{};
+                if ( timeRange ) {
+                    logFilteredData_->runSearchInTimeRange( regexpPattern, searchStartLine_,
+                                                            searchEndLine_, timeRange->first,
+                                                            timeRange->second, focusLine );
+                }
+                else {
+                    logFilteredData_->runSearch( regexpPattern, searchStartLine_,
+                                                 searchEndLine_, focusLine );
+                }
+            }
             // Accept auto-refresh of the search
             searchState_.startSearch();
             searchInfoLine_->hide();
@@ -1411,8 +1590,17 @@ void CrawlerWidget::replaceCurrentSearch( const QString& searchText )
             searchState_.resetState();
 
             // Inform the user
-            QString errorString = hsExpression.errorString();
+            QString errorString = fieldQuery
+                                      ? QString::fromStdString( fieldQuery->errorString() )
+                                      : hsExpression.errorString();
+            if ( fieldQuery && logData_->getStructuredFields().empty() ) {
+                errorString = tr( "no structured fields are indexed for this file" );
+            }
             QString errorMessage = tr( "Error in expression" );
+            if ( !isValidTimeRange ) {
+                errorMessage = tr( "Error in time range" );
+                errorString = tr( "can't parse time" );
+            }
             // const int offset = regexp.patternErrorOffset();
             // if ( offset != -1 ) {
             //     errorMessage += " at position ";
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "displayline.h"
+
+#include <algorithm>
+#include <utility>
+#include <iterator>
+
+#include "abstractlogdata.h"
+
+DisplayLine::DisplayLine( QString raw, int firstColumn )
+    : raw_{ std::move( raw ) }
+    , firstColumn_{ firstColumn }
+{
+    const auto firstTab = raw_.indexOf( QChar::Tabulation );
+    if ( firstTab < 0 ) {
+        expanded_ = raw_;
+        expanded_.replace( QChar::Null, QChar::Space );
+        return;
+    }
+
+    // Same expansion as untabify, done in one pass so the column map
+    // comes for free.
+    expandedColumns_.reserve( static_cast<size_t>( raw_.size() ) + 1 );
+    expanded_.reserve( raw_.size() + TabStop );
+
+    for ( const auto& c : raw_ ) {
+        const auto expandedPosition = static_cast<int>( expanded_.size() );
+        expandedColumns_.push_back( expandedPosition );
+
+        if ( c == QChar::Tabulation ) {
+            const auto spaces = TabStop - ( ( firstColumn_ + expandedPosition ) % TabStop );
+            expanded_.append( QString( spaces, QChar::Space ) );
+        }
+        else if ( c == QChar::Null ) {
+            expanded_.append( QChar::Space );
+        }
+        else {
+            expanded_.append( c );
+        }
+    }
+    expandedColumns_.push_back( static_cast<int>( expanded_.size() ) );
+}
+
+int DisplayLine::expandedColumn( int rawColumn ) const
+{
+    if ( expandedColumns_.empty() ) {
+        return firstColumn_ + rawColumn;
+    }
+
+    const auto lastColumn = static_cast<int>( expandedColumns_.size() ) - 1;
+    if ( rawColumn > lastColumn ) {
+        return firstColumn_ + expandedColumns_.back() + ( rawColumn - lastColumn );
+    }
+
+    return firstColumn_ + expandedColumns_[ static_cast<size_t>( std::max( rawColumn, 0 ) ) ];
+}
+
+HighlightedMatch DisplayLine::toExpanded( const HighlightedMatch& match ) const
+{
+    const auto start = expandedColumn( match.startColumn() );
+    const auto end = expandedColumn( match.startColumn() + match.length() );
+
+    return HighlightedMatch{ start, end - start, match.foreColor(), match.backColor() };
+}
+
+std::vector<DisplayLine> getDisplayLines( const AbstractLogData& logData, LineNumber firstLine,
+                                          LinesCount number, int firstColumn, int nbColumns )
+{
+    auto windows = logData.getLineWindows( firstLine, number, firstColumn, nbColumns );
+
+    std::vector<DisplayLine> lines;
+    lines.reserve( windows.size() );
+    std::transform( std::make_move_iterator( windows.begin() ),
+                    std::make_move_iterator( windows.end() ), std::back_inserter( lines ),
+                    []( AbstractLogData::LineWindow&& window ) {
+                        return DisplayLine{ std::move( window.text ), window.firstColumn };
+                    } );
+
+    return lines;
+}
@@ -85,6 +85,11 @@ LineNumber FilteredView::maxDisplayLineNumber() const
     return LineNumber( logFilteredData_->getNbTotalLines().get() );
 }
 
+bool FilteredView::isDataAppendOnly() const
+{
+    return false;
+}
+
 void FilteredView::doRegisterShortcuts()
 {
     LOG_INFO << "Registering shortcuts for filtered view";
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "glyphcache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QGlyphRun>
+#include <QPainter>
+
+#include "log.h"
+
+void GlyphCache::setFont( const QFont& font )
+{
+    isEnabled_ = false;
+    rawFont_ = QRawFont::fromFont( font );
+    if ( !rawFont_.isValid() ) {
+        LOG_INFO << "No raw font for " << font.family() << ", glyph cache disabled";
+        return;
+    }
+
+    QString characters;
+    for ( auto c = FirstChar; c <= LastChar; ++c ) {
+        characters.append( QChar( c ) );
+    }
+
+    const auto glyphIndexes = rawFont_.glyphIndexesForString( characters );
+    if ( glyphIndexes.size() != static_cast<int>( glyphs_.size() )
+         || std::any_of( glyphIndexes.begin(), glyphIndexes.end(),
+                         []( quint32 glyph ) { return glyph == 0; } ) ) {
+        LOG_INFO << "Font " << font.family() << " misses ASCII glyphs, glyph cache disabled";
+        return;
+    }
+
+    const auto advances = rawFont_.advancesForGlyphIndexes( glyphIndexes );
+    advance_ = advances.front().x();
+    if ( advance_ <= 0
+         || std::any_of( advances.begin(), advances.end(), [ this ]( const QPointF& advance ) {
+                return std::abs( advance.x() - advance_ ) > 0.01;
+            } ) ) {
+        LOG_INFO << "Font " << font.family() << " is not monospace, glyph cache disabled";
+        return;
+    }
+
+    std::copy( glyphIndexes.begin(), glyphIndexes.end(), glyphs_.begin() );
+    isEnabled_ = true;
+
+    LOG_INFO << "Glyph cache enabled for " << font.family() << ", advance " << advance_;
+}
+
+bool GlyphCache::canDraw( const QString& text, int from, int length ) const
+{
+    if ( !isEnabled_ ) {
+        return false;
+    }
+
+    const auto begin = std::min( from, static_cast<int>( text.size() ) );
+    const auto end = std::min( from + length, static_cast<int>( text.size() ) );
+    return std::all_of( text.begin() + begin, text.begin() + end, []( const QChar& c ) {
+        return c.unicode() >= FirstChar && c.unicode() <= LastChar;
+    } );
+}
+
+int GlyphCache::textWidth( int length ) const
+{
+    return static_cast<int>( std::lround( length * advance_ ) );
+}
+
+void GlyphCache::draw( QPainter* painter, int x, int baseline, const QString& text, int from,
+                       int length )
+{
+    const auto end = std::min( from + length, static_cast<int>( text.size() ) );
+    if ( from >= end ) {
+        return;
+    }
+
+    glyphIndexes_.clear();
+    positions_.clear();
+    for ( auto index = from; index < end; ++index ) {
+        glyphIndexes_.push_back( glyphs_[ text[ index ].unicode() - FirstChar ] );
+        positions_.emplace_back( ( index - from ) * advance_, 0 );
+    }
+
+    QGlyphRun glyphRun;
+    glyphRun.setRawFont( rawFont_ );
+    glyphRun.setRawData( glyphIndexes_.data(), positions_.data(),
+                         static_cast<int>( glyphIndexes_.size() ) );
+
+    painter->drawGlyphRun( QPointF( x, baseline ), glyphRun );
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "highlightengine.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <tbb/parallel_for.h>
+
+#include "abstractlogdata.h"
+#include "log.h"
+
+HighlightEngine::HighlightEngine()
+    : rules_{ std::make_shared<const HighlightRules>() }
+{
+}
+
+HighlightEngine::~HighlightEngine()
+{
+    stop();
+}
+
+void HighlightEngine::stop()
+{
+    ++generation_;
+    prefetchTasks_.wait();
+}
+
+void HighlightEngine::setRules( HighlightRules rules )
+{
+    if ( *rules_ == rules ) {
+        return;
+    }
+
+    LOG_DEBUG << "Highlight rules changed";
+    rules_ = std::make_shared<const HighlightRules>( std::move( rules ) );
+    invalidate();
+}
+
+void HighlightEngine::invalidate()
+{
+    ++generation_;
+
+    std::lock_guard<std::mutex> lock( cacheMutex_ );
+    cache_.clear();
+}
+
+std::vector<HighlightEngine::LineHighlightsPtr>
+HighlightEngine::highlights( LineNumber firstLine, const std::vector<DisplayLine>& lines )
+{
+    std::vector<LineHighlightsPtr> lineHighlights( lines.size() );
+    std::vector<size_t> missingLines;
+
+    {
+        std::lock_guard<std::mutex> lock( cacheMutex_ );
+        for ( auto index = 0u; index < lines.size(); ++index ) {
+            const auto cached = cache_.find( firstLine.get() + index );
+            if ( cached != cache_.end() && cached->second
+                 && cached->second->isComputedFor( lines[ index ] ) ) {
+                lineHighlights[ index ] = cached->second;
+            }
+            else {
+                missingLines.push_back( index );
+            }
+        }
+    }
+
+    if ( missingLines.empty() ) {
+        return lineHighlights;
+    }
+
+    LOG_DEBUG << "Computing highlights for " << missingLines.size() << " lines";
+
+    const auto& rules = *rules_;
+    tbb::parallel_for( size_t{ 0 }, missingLines.size(), [ & ]( size_t missing ) {
+        const auto index = missingLines[ missing ];
+        lineHighlights[ index ]
+            = std::make_shared<const LineHighlights>( computeHighlights( rules, lines[ index ] ) );
+    } );
+
+    std::lock_guard<std::mutex> lock( cacheMutex_ );
+    for ( const auto index : missingLines ) {
+        cache_[ firstLine.get() + index ] = lineHighlights[ index ];
+    }
+
+    return lineHighlights;
+}
+
+void HighlightEngine::prefetch( const AbstractLogData& logData, LineNumber firstLine,
+                                LinesCount nbLines, int firstColumn, int nbColumns )
+{
+    const auto nbLinesInFile = logData.getNbLine();
+    const auto windowStart = firstLine - nbLines;
+    const auto windowEnd = qMin( firstLine + nbLines + nbLines, LineNumber( nbLinesInFile.get() ) );
+
+    std::vector<std::pair<LineNumber, LinesCount>> missingRuns;
+    {
+        std::lock_guard<std::mutex> lock( cacheMutex_ );
+
+        // Keep one more screen on both sides for when scrolling goes back and forth
+        const auto keepStart = windowStart - nbLines;
+        const auto keepEnd = windowEnd + nbLines;
+        for ( auto it = cache_.begin(); it != cache_.end(); ) {
+            if ( it->first < keepStart.get() || it->first >= keepEnd.get() ) {
+                it = cache_.erase( it );
+            }
+            else {
+                ++it;
+            }
+        }
+
+        for ( auto line = windowStart; line < windowEnd; ++line ) {
+            if ( cache_.count( line.get() ) ) {
+                continue;
+            }
+
+            cache_.emplace( line.get(), nullptr );
+            if ( !missingRuns.empty()
+                 && missingRuns.back().first + missingRuns.back().second == line ) {
+                ++missingRuns.back().second;
+            }
+            else {
+                missingRuns.emplace_back( line, 1_lcount );
+            }
+        }
+    }
+
+    // The view lines are mapped to the source data here, the source data
+    // can then be read on the background thread.
+    const auto sourceData = logData.getSourceData();
+    const auto generation = generation_.load();
+    for ( const auto& run : missingRuns ) {
+        prefetchTasks_.run( [ this, generation, rules = rules_, sourceData, firstColumn,
+                              nbColumns, runStart = run.first,
+                              sourceRuns = logData.getSourceRuns( run.first, run.second ) ] {
+            std::vector<DisplayLine> lines;
+            for ( const auto& sourceRun : sourceRuns ) {
+                if ( generation_ != generation ) {
+                    return;
+                }
+
+                auto runLines = getDisplayLines( *sourceData, sourceRun.first, sourceRun.second,
+                                                 firstColumn, nbColumns );
+                lines.insert( lines.end(), std::make_move_iterator( runLines.begin() ),
+                              std::make_move_iterator( runLines.end() ) );
+            }
+
+            for ( auto index = 0u; index < lines.size(); ++index ) {
+                if ( generation_ != generation ) {
+                    return;
+                }
+
+                auto highlights = std::make_shared<const LineHighlights>(
+                    computeHighlights( *rules, lines[ index ] ) );
+
+                std::lock_guard<std::mutex> lock( cacheMutex_ );
+                const auto pending = cache_.find( runStart.get() + index );
+                if ( generation_ == generation && pending != cache_.end() && !pending->second ) {
+                    pending->second = std::move( highlights );
+                }
+            }
+        } );
+    }
+}
+
+LineHighlights HighlightEngine::computeHighlights( const HighlightRules& rules,
+                                                   const DisplayLine& line )
+{
+    std::vector<HighlightedMatch> matches;
+
+    LineHighlights lineHighlights;
+    const auto matchType = rules.highlighterSet.matchLine( line.raw(), matches );
+    if ( matchType == HighlighterMatchType::LineMatch ) {
+        lineHighlights.lineColor
+            = HighlightColor{ matches.front().foreColor(), matches.front().backColor() };
+    }
+
+    const auto addMatches = [ &line, &matches ]( const Highlighter& highlighter ) {
+        std::vector<HighlightedMatch> highlighterMatches;
+        highlighter.matchLine( line.raw(), highlighterMatches );
+        matches.insert( matches.end(), highlighterMatches.begin(), highlighterMatches.end() );
+    };
+
+    if ( rules.searchHighlighter ) {
+        addMatches( *rules.searchHighlighter );
+    }
+    std::for_each( rules.quickHighlighters.begin(), rules.quickHighlighters.end(), addMatches );
+
+    lineHighlights.firstColumn = line.firstColumn();
+    lineHighlights.rawLength = static_cast<int>( line.raw().size() );
+
+    lineHighlights.matches.reserve( matches.size() );
+    std::transform( matches.cbegin(), matches.cend(),
+                    std::back_inserter( lineHighlights.matches ),
+                    [ &line ]( const auto& match ) { return line.toExpanded( match ); } );
+
+    return lineHighlights;
+}
@@ -38,6 +38,7 @@
 
 // This file implements classes Highlighter and HighlighterSet
 
+#include <atomic>
 #include <iterator>
 #include <qcolor.h>
 #include <qnamespace.h>
@@ -53,6 +54,10 @@
 
 #include "highlighterset.h"
 
+namespace {
+std::atomic<uint64_t> highlightersGeneration{ 0 };
+}
+
 QRegularExpression::PatternOptions getPatternOptions( bool ignoreCase )
 {
     QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption;
@@ -69,6 +74,7 @@ Highlighter::Highlighter( const QString& pattern, bool ignoreCase, bool onlyMatc
     , highlightOnlyMatch_( onlyMatch )
     , color_{ foreColor, backColor }
 {
+    updateMatchingRegex();
     LOG_DEBUG << "New Highlighter, fore: " << color_.foreColor.name()
               << " back: " << color_.backColor.name();
 }
@@ -81,6 +87,7 @@ QString Highlighter::pattern() const
 void Highlighter::setPattern( const QString& pattern )
 {
     regexp_.setPattern( pattern );
+    updateMatchingRegex();
 }
 
 bool Highlighter::ignoreCase() const
@@ -91,6 +98,7 @@ bool Highlighter::ignoreCase() const
 void Highlighter::setIgnoreCase( bool ignoreCase )
 {
     regexp_.setPatternOptions( getPatternOptions( ignoreCase ) );
+    updateMatchingRegex();
 }
 
 bool Highlighter::useRegex() const
@@ -101,6 +109,7 @@ bool Highlighter::useRegex() const
 void Highlighter::setUseRegex( bool useRegex )
 {
     useRegex_ = useRegex;
+    updateMatchingRegex();
 }
 
 bool Highlighter::highlightOnlyMatch() const
@@ -171,16 +180,12 @@ bool Highlighter::matchLine( const QString& line, std::vector<HighlightedMatch>&
 {
     matches.clear();
 
-    const auto pattern
-        = useRegex_ ? regexp_.pattern() : QRegularExpression::escape( regexp_.pattern() );
-
-    const auto matchingRegex = QRegularExpression( pattern, regexp_.patternOptions() );
-
-    QRegularExpressionMatchIterator matchIterator = matchingRegex.globalMatch( line );
+    QRegularExpressionMatchIterator matchIterator = matchingRegex_.globalMatch( line );
 
+    const auto hasCaptures = matchingRegex_.captureCount() > 0;
     while ( matchIterator.hasNext() ) {
         QRegularExpressionMatch match = matchIterator.next();
-        if ( matchingRegex.captureCount() > 0 ) {
+        if ( hasCaptures ) {
             for ( int i = 1; i <= match.lastCapturedIndex(); ++i ) {
 
                 const auto colors = vairateColors( match.captured( i ) );
@@ -200,6 +205,23 @@ bool Highlighter::matchLine( const QString& line, std::vector<HighlightedMatch>&
     return ( !matches.empty() );
 }
 
+bool Highlighter::operator==( const Highlighter& other ) const
+{
+    return regexp_ == other.regexp_ && useRegex_ == other.useRegex_
+           && highlightOnlyMatch_ == other.highlightOnlyMatch_
+           && variateColors_ == other.variateColors_ && colorVariance_ == other.colorVariance_
+           && color_.foreColor == other.color_.foreColor
+           && color_.backColor == other.color_.backColor;
+}
+
+void Highlighter::updateMatchingRegex()
+{
+    const auto pattern
+        = useRegex_ ? regexp_.pattern() : QRegularExpression::escape( regexp_.pattern() );
+
+    matchingRegex_ = QRegularExpression( pattern, regexp_.patternOptions() );
+}
+
 HighlighterSet HighlighterSet::createNewSet( const QString& name )
 {
     return HighlighterSet{ name };
@@ -226,6 +248,11 @@ bool HighlighterSet::isEmpty() const
     return highlighterList_.isEmpty();
 }
 
+bool HighlighterSet::operator==( const HighlighterSet& other ) const
+{
+    return highlighterList_ == other.highlighterList_;
+}
+
 HighlighterMatchType HighlighterSet::matchLine( const QString& line,
                                                 std::vector<HighlightedMatch>& matches ) const
 {
@@ -288,6 +315,8 @@ void Highlighter::retrieveFromStorage( QSettings& settings )
     colorVariance_ = settings.value( "color_variance", 15 ).toInt();
     color_.foreColor = QColor( settings.value( "fore_colour" ).toString() );
     color_.backColor = QColor( settings.value( "back_colour" ).toString() );
+
+    updateMatchingRegex();
 }
 
 void HighlighterSet::saveToStorage( QSettings& settings ) const
@@ -422,6 +451,11 @@ bool HighlighterSetCollection::hasSet( const QString& setId ) const
                         [ setId ]( const auto& s ) { return s.id() == setId; } );
 }
 
+uint64_t HighlighterSetCollection::generation()
+{
+    return highlightersGeneration.load();
+}
+
 QList<QuickHighlighter> HighlighterSetCollection::quickHighlighters() const
 {
     return quickHighlighters_;
@@ -437,6 +471,8 @@ void HighlighterSetCollection::saveToStorage( QSettings& settings ) const
 {
     LOG_INFO << "HighlighterSetCollection::saveToStorage, v" << HighlighterSetCollection_VERSION;
 
+    ++highlightersGeneration;
+
     settings.beginGroup( "HighlighterSetCollection" );
     settings.setValue( "version", HighlighterSetCollection_VERSION );
     settings.setValue( "active_sets", activeSets_ );
@@ -469,6 +505,8 @@ void HighlighterSetCollection::retrieveFromStorage( QSettings& settings )
 {
     LOG_DEBUG << "HighlighterSetCollection::retrieveFromStorage";
 
+    ++highlightersGeneration;
+
     highlighters_.clear();
     quickHighlighters_.clear();
 
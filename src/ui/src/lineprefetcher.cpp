@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lineprefetcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "abstractlogdata.h"
+
+namespace {
+// How far ahead, in time, the read ahead should cover at the current speed
+constexpr double LookAheadSeconds = 0.5;
+constexpr double MaxScreensAhead = 8;
+// Weight of the last measure in the smoothed speed
+constexpr double SpeedSmoothing = 0.5;
+} // namespace
+
+void LinePrefetcher::reset()
+{
+    hasPosition_ = false;
+    velocity_ = 0;
+}
+
+void LinePrefetcher::scrolledTo( const AbstractLogData& logData, LineNumber firstLine,
+                                 LinesCount nbVisibleLines )
+{
+    const auto now = Clock::now();
+    const auto screen = std::max( nbVisibleLines.get(), LinesCount::UnderlyingType{ 1 } );
+
+    const auto previousFirstLine = lastFirstLine_;
+    const auto hadPosition = hasPosition_;
+
+    hasPosition_ = true;
+    lastFirstLine_ = firstLine;
+
+    const auto elapsed = std::chrono::duration<double>( now - lastScrollTime_ ).count();
+    lastScrollTime_ = now;
+
+    if ( !hadPosition || firstLine == previousFirstLine ) {
+        return;
+    }
+
+    const auto isForward = firstLine > previousFirstLine;
+    const auto distance = static_cast<double>(
+        ( isForward ? firstLine - previousFirstLine : previousFirstLine - firstLine ).get() );
+
+    // A jump lands somewhere new, the next move can go either way
+    if ( distance > static_cast<double>( screen ) ) {
+        velocity_ = 0;
+        logData.prefetchLines( firstLine - LinesCount( screen ), LinesCount( 3 * screen ) );
+        return;
+    }
+
+    const auto speed = ( isForward ? distance : -distance ) / std::max( elapsed, 0.001 );
+    if ( ( speed > 0 ) != ( velocity_ > 0 ) ) {
+        velocity_ = speed;
+    }
+    else {
+        velocity_ = SpeedSmoothing * speed + ( 1 - SpeedSmoothing ) * velocity_;
+    }
+
+    const auto screensAhead = std::clamp( std::abs( velocity_ ) * LookAheadSeconds
+                                              / static_cast<double>( screen ),
+                                          1.0, MaxScreensAhead );
+    const auto linesAhead = LinesCount( static_cast<LinesCount::UnderlyingType>(
+        std::ceil( screensAhead * static_cast<double>( screen ) ) ) );
+
+    if ( velocity_ > 0 ) {
+        logData.prefetchLines( firstLine + LinesCount( screen ), linesAhead );
+    }
+    else {
+        logData.prefetchLines( firstLine - linesAhead, linesAhead );
+    }
+}
@@ -60,6 +60,7 @@
 #include <QClipboard>
 #include <QCloseEvent>
 #include <QDialogButtonBox>
+#include <QDockWidget>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QInputDialog>
@@ -89,9 +90,12 @@
 #include "favoritefiles.h"
 #include "highlightersdialog.h"
 #include "highlightersmenu.h"
+#include "ioscheduler.h"
 #include "issuereporter.h"
 #include "klogg_version.h"
 #include "logger.h"
+#include "memorybudget.h"
+#include "metricspanel.h"
 #include "openfilehelper.h"
 #include "optionsdialog.h"
 #include "predefinedfilters.h"
@@ -125,6 +129,7 @@ MainWindow::MainWindow( WindowSession session )
     , tempDir_( QDir::temp().filePath( "klogg_temp_" ) )
 {
     createActions();
+    createDockWidgets();
     createMenus();
     createToolBars();
 
@@ -189,11 +194,22 @@ MainWindow::MainWindow( WindowSession session )
     scratchPad_.setWindowIcon( mainIcon_ );
     scratchPad_.setWindowTitle( "klogg - scratchpad" );
 
+    mergedViews_.setWindowIcon( mainIcon_ );
+    mergedViews_.setWindowTitle( "klogg - merged views" );
+    connect( this, &MainWindow::optionsChanged, &mergedViews_,
+             &TabbedMergedViews::applyConfiguration );
+
     connect( &mainTabWidget_, &TabbedCrawlerWidget::tabCloseRequested, this,
              [ this ]( int index ) { this->closeTab( index, ActionInitiator::User ); } );
     connect( &mainTabWidget_, &TabbedCrawlerWidget::currentChanged, this,
              &MainWindow::currentTabChanged );
 
+    connect( &MemoryBudget::get(), &MemoryBudget::usageChanged, this,
+             &MainWindow::updateMemoryField, Qt::QueuedConnection );
+
+    warmUpTimer_.setInterval( 1000 );
+    connect( &warmUpTimer_, &QTimer::timeout, this, &MainWindow::warmUpNextTab );
+
     // Establish the QuickFindWidget and mux ( to send requests from the
     // QFWidget to the right window )
     connect( &quickFindWidget_, SIGNAL( patternConfirmed( const QString&, bool, bool ) ),
@@ -248,18 +264,28 @@ void MainWindow::reloadSession()
     const auto openedFiles
         = session_.restore( [] { return new CrawlerWidget(); }, &current_file_index );
 
+    // Only the file of the current tab is loaded, the others wait
+    // to be shown, loaded from the menu or warmed up when idle.
+    isRestoringSession_ = true;
     for ( const auto& open_file : openedFiles ) {
         QString file_name = { open_file.first };
         auto* crawler_widget = static_cast<CrawlerWidget*>( open_file.second );
 
         if ( crawler_widget ) {
-            mainTabWidget_.addCrawler( crawler_widget, file_name );
+            const auto index = mainTabWidget_.addCrawler( crawler_widget, file_name );
+
+            const QFileInfo fileInfo( file_name );
+            mainTabWidget_.setTabToolTip(
+                index, tr( "%1 (%2, not loaded yet)" )
+                           .arg( QDir::toNativeSeparators( file_name ),
+                                 readableSize( static_cast<uint64_t>( fileInfo.size() ) ) ) );
 
             if ( followFileOnLoad ) {
                 signalCrawlerToFollowFile( crawler_widget );
             }
         }
     }
+    isRestoringSession_ = false;
 
     if ( current_file_index >= 0 ) {
         mainTabWidget_.setCurrentIndex( current_file_index );
@@ -269,6 +295,14 @@ void MainWindow::reloadSession()
         }
     }
 
+    if ( auto current = currentCrawlerWidget() ) {
+        attachCrawler( current );
+    }
+
+    if ( config.warmUpSessionTabs() ) {
+        warmUpTimer_.start();
+    }
+
     updateOpenedFilesMenu();
 }
 
@@ -297,6 +331,11 @@ void MainWindow::createActions()
     openAction->setStatusTip( tr( "Open a file" ) );
     connect( openAction, &QAction::triggered, [ this ]( auto ) { this->open(); } );
 
+    openMergedAction = new QAction( tr( "Open &merged..." ), this );
+    openMergedAction->setStatusTip(
+        tr( "Open several files as one timeline ordered by timestamps" ) );
+    connect( openMergedAction, &QAction::triggered, [ this ]( auto ) { this->openMerged(); } );
+
     recentFilesCleanup = new QAction( tr( "Clear List" ), this );
     connect( recentFilesCleanup, &QAction::triggered, this,
              [ this ]( auto ) { this->clearRecentFileActions(); } );
@@ -311,6 +350,10 @@ void MainWindow::createActions()
     connect( closeAllAction, &QAction::triggered, this,
              [ this ]( auto ) { this->closeAll( ActionInitiator::User ); } );
 
+    loadAllTabsAction = new QAction( tr( "&Load All Tabs" ), this );
+    loadAllTabsAction->setStatusTip( tr( "Load all documents restored from the session" ) );
+    connect( loadAllTabsAction, &QAction::triggered, this, [ this ]( auto ) { loadAllTabs(); } );
+
     recentFilesGroup = new QActionGroup( this );
     connect( recentFilesGroup, &QActionGroup::triggered, this, &MainWindow::openFileFromRecent );
     for ( auto i = 0u; i < recentFileActions.size(); ++i ) {
@@ -335,6 +378,11 @@ void MainWindow::createActions()
     goToLineAction->setStatusTip( tr( "Scrolls selected main view to specified line" ) );
     signalMux_.connect( goToLineAction, SIGNAL( triggered() ), SLOT( goToLine() ) );
 
+    goToTimeAction = new QAction( tr( "Go to time..." ), this );
+    goToTimeAction->setStatusTip( tr( "Scrolls selected main view to the first line logged at "
+                                      "specified time" ) );
+    signalMux_.connect( goToTimeAction, SIGNAL( triggered() ), SLOT( goToTime() ) );
+
     findAction = new QAction( tr( "&Find..." ), this );
     findAction->setStatusTip( tr( "Find the text" ) );
     connect( findAction, &QAction::triggered, this, [ this ]( auto ) { this->find(); } );
@@ -386,6 +434,17 @@ void MainWindow::createActions()
     connect( lineNumbersVisibleInFilteredAction, &QAction::toggled, this,
              &MainWindow::toggleFilteredLineNumbersVisibility );
 
+    linesWrappedAction = new QAction( tr( "&Wrap long lines" ), this );
+    linesWrappedAction->setCheckable( true );
+    linesWrappedAction->setChecked( config.linesWrapped() );
+    connect( linesWrappedAction, &QAction::toggled, this, &MainWindow::toggleLinesWrapped );
+
+    fieldColumnsVisibleAction = new QAction( tr( "Structured &fields in columns" ), this );
+    fieldColumnsVisibleAction->setCheckable( true );
+    fieldColumnsVisibleAction->setChecked( config.fieldColumnsVisible() );
+    connect( fieldColumnsVisibleAction, &QAction::toggled, this,
+             &MainWindow::toggleFieldColumnsVisibility );
+
     followAction = new QAction( tr( "&Follow File" ), this );
     followAction->setCheckable( true );
     followAction->setEnabled( config.anyFileWatchEnabled() );
@@ -551,6 +610,7 @@ void MainWindow::createMenus()
     fileMenu->setToolTipsVisible( true );
     fileMenu->addAction( newWindowAction );
     fileMenu->addAction( openAction );
+    fileMenu->addAction( openMergedAction );
     fileMenu->addAction( openClipboardAction );
     fileMenu->addAction( openUrlAction );
     recentFilesMenu = fileMenu->addMenu( tr( "Open Recent" ) );
@@ -564,6 +624,7 @@ void MainWindow::createMenus()
 
     fileMenu->addAction( closeAction );
     fileMenu->addAction( closeAllAction );
+    fileMenu->addAction( loadAllTabsAction );
     fileMenu->addSeparator();
 
     fileMenu->addAction( optionsAction );
@@ -579,6 +640,7 @@ void MainWindow::createMenus()
     editMenu->addAction( findAction );
     editMenu->addSeparator();
     editMenu->addAction( goToLineAction );
+    editMenu->addAction( goToTimeAction );
     editMenu->addSeparator();
     editMenu->addAction( copyPathToClipboardAction );
     editMenu->addAction( openContainingFolderAction );
@@ -591,9 +653,12 @@ void MainWindow::createMenus()
     openedFilesMenu = viewMenu->addMenu( "Opened files" );
     viewMenu->addSeparator();
     viewMenu->addAction( overviewVisibleAction );
+    viewMenu->addAction( metricsDock_->toggleViewAction() );
     viewMenu->addSeparator();
     viewMenu->addAction( lineNumbersVisibleInMainAction );
     viewMenu->addAction( lineNumbersVisibleInFilteredAction );
+    viewMenu->addAction( linesWrappedAction );
+    viewMenu->addAction( fieldColumnsVisibleAction );
     viewMenu->addSeparator();
     viewMenu->addAction( followAction );
     viewMenu->addSeparator();
@@ -629,6 +694,18 @@ void MainWindow::createMenus()
     helpMenu->addAction( aboutAction );
 }
 
+void MainWindow::createDockWidgets()
+{
+    metricsDock_ = new QDockWidget( tr( "Performance metrics" ), this );
+    metricsDock_->setObjectName( "metricsDock" );
+    metricsDock_->setWidget( new MetricsPanel( metricsDock_ ) );
+    addDockWidget( Qt::BottomDockWidgetArea, metricsDock_ );
+    metricsDock_->hide();
+
+    metricsDock_->toggleViewAction()->setStatusTip(
+        tr( "Show indexing and search throughput, queue depths and frame times" ) );
+}
+
 void MainWindow::createToolBars()
 {
     infoLine = new PathLine();
@@ -646,6 +723,9 @@ void MainWindow::createToolBars()
     encodingField = new QLabel();
     dateField->setAlignment( Qt::AlignHCenter | Qt::AlignVCenter );
 
+    memoryField = new QLabel();
+    memoryField->setAlignment( Qt::AlignHCenter | Qt::AlignVCenter );
+
     lineNbField = new QLabel();
     lineNbField->setAlignment( Qt::AlignRight | Qt::AlignVCenter );
     lineNbField->setContentsMargins( 2, 0, 2, 0 );
@@ -668,6 +748,8 @@ void MainWindow::createToolBars()
     infoToolbarSeparators.push_back( toolBar->addSeparator() );
     toolBar->addWidget( encodingField );
     infoToolbarSeparators.push_back( toolBar->addSeparator() );
+    toolBar->addWidget( memoryField );
+    infoToolbarSeparators.push_back( toolBar->addSeparator() );
     toolBar->addWidget( lineNbField );
     infoToolbarSeparators.push_back( toolBar->addSeparator() );
     toolBar->addAction( showScratchPadAction );
@@ -751,6 +833,24 @@ void MainWindow::open()
     }
 }
 
+// Opens the file selection dialog and shows the selected files merged by timestamp
+void MainWindow::openMerged()
+{
+    QString defaultDir = ".";
+
+    if ( auto current = currentCrawlerWidget() ) {
+        QFileInfo fileInfo = QFileInfo( session_.getFilename( current ) );
+        defaultDir = fileInfo.path();
+    }
+
+    const auto selectedFiles = QFileDialog::getOpenFileNames(
+        this, tr( "Open files to merge" ), defaultDir, tr( "All files (*)" ) );
+
+    if ( !selectedFiles.isEmpty() ) {
+        mergedViews_.addMergedView( selectedFiles );
+    }
+}
+
 void MainWindow::openRemoteFile( const QUrl& url )
 {
     Downloader downloader;
@@ -1002,6 +1102,13 @@ void MainWindow::options()
 
         updateShortcuts();
         updateRecentFileActions();
+
+        if ( config.warmUpSessionTabs() ) {
+            warmUpTimer_.start();
+        }
+        else {
+            warmUpTimer_.stop();
+        }
     } );
     dialog.exec();
 
@@ -1113,6 +1220,24 @@ void MainWindow::toggleFilteredLineNumbersVisibility( bool isVisible )
     Q_EMIT optionsChanged();
 }
 
+void MainWindow::toggleLinesWrapped( bool isWrapped )
+{
+    auto& config = Configuration::get();
+
+    config.setLinesWrapped( isWrapped );
+    config.save();
+    Q_EMIT optionsChanged();
+}
+
+void MainWindow::toggleFieldColumnsVisibility( bool isVisible )
+{
+    auto& config = Configuration::get();
+
+    config.setFieldColumnsVisible( isVisible );
+    config.save();
+    Q_EMIT optionsChanged();
+}
+
 void MainWindow::changeFollowMode( bool follow )
 {
     auto& config = Configuration::get();
@@ -1251,10 +1376,18 @@ void MainWindow::currentTabChanged( int index )
         updateTitleBar( session_.getFilename( crawler_widget ) );
         updateFavoritesMenu();
 
+        // Reads of the visible file go first
+        IoScheduler::get().setForegroundFile( session_.getFilename( crawler_widget ) );
+        if ( !isRestoringSession_ ) {
+            attachCrawler( crawler_widget );
+        }
+
         editMenu->setEnabled( true );
     }
     else {
         // No tab left
+        IoScheduler::get().setForegroundFile( {} );
+
         signalMux_.setCurrentDocument( nullptr );
         quickFindMux_.registerSelector( nullptr );
 
@@ -1270,6 +1403,69 @@ void MainWindow::currentTabChanged( int index )
     }
 }
 
+void MainWindow::attachCrawler( CrawlerWidget* crawler )
+{
+    if ( session_.isAttached( crawler ) ) {
+        return;
+    }
+
+    const auto fileName = session_.getFilename( crawler );
+    const auto index = mainTabWidget_.indexOf( crawler );
+    if ( index >= 0 ) {
+        mainTabWidget_.setTabToolTip( index, QDir::toNativeSeparators( fileName ) );
+    }
+
+    session_.attach( crawler );
+}
+
+void MainWindow::loadAllTabs()
+{
+    for ( int i = 0; i < mainTabWidget_.count(); ++i ) {
+        attachCrawler( static_cast<CrawlerWidget*>( mainTabWidget_.widget( i ) ) );
+    }
+}
+
+void MainWindow::warmUpNextTab()
+{
+    if ( !Configuration::get().warmUpSessionTabs() ) {
+        warmUpTimer_.stop();
+        return;
+    }
+
+    if ( !IoScheduler::get().isIdle() ) {
+        return;
+    }
+
+    const auto recentFiles = RecentFiles::getSynced().recentFiles();
+    const auto recentIndex = [ &recentFiles ]( const QString& fileName ) {
+        const auto index = recentFiles.indexOf( fileName );
+        return index < 0 ? recentFiles.size() : index;
+    };
+
+    CrawlerWidget* nextCrawler = nullptr;
+    for ( int i = 0; i < mainTabWidget_.count(); ++i ) {
+        auto* crawler = static_cast<CrawlerWidget*>( mainTabWidget_.widget( i ) );
+        if ( session_.isAttached( crawler ) ) {
+            continue;
+        }
+
+        if ( !nextCrawler
+             || recentIndex( session_.getFilename( crawler ) )
+                    < recentIndex( session_.getFilename( nextCrawler ) ) ) {
+            nextCrawler = crawler;
+        }
+    }
+
+    if ( !nextCrawler ) {
+        LOG_INFO << "All restored tabs are loaded";
+        warmUpTimer_.stop();
+        return;
+    }
+
+    LOG_INFO << "Warming up " << session_.getFilename( nextCrawler );
+    attachCrawler( nextCrawler );
+}
+
 void MainWindow::changeQFPattern( const QString& newPattern )
 {
     quickFindWidget_.changeDisplayedPattern( newPattern, true );
@@ -1357,6 +1553,11 @@ void MainWindow::changeEvent( QEvent* event )
             }
         }
     }
+    else if ( event->type() == QEvent::ActivationChange && isActiveWindow() ) {
+        if ( auto current = currentCrawlerWidget() ) {
+            IoScheduler::get().setForegroundFile( session_.getFilename( current ) );
+        }
+    }
     else if ( event->type() == QEvent::StyleChange ) {
         dispatchToMainThread( [ this ] {
             loadIcons();
@@ -1703,6 +1904,7 @@ void MainWindow::updateInfoLine()
     infoLine->setPath( current_file );
     sizeField->setText( readableSize( fileSize ) );
     encodingField->setText( currentCrawlerWidget()->encodingText() );
+    updateMemoryField();
 
     if ( lastModified.isValid() ) {
         const QString date = defaultLocale.toString( lastModified, QLocale::NarrowFormat );
@@ -1714,6 +1916,32 @@ void MainWindow::updateInfoLine()
     }
 }
 
+void MainWindow::updateMemoryField()
+{
+    if ( currentCrawlerWidget() == nullptr ) {
+        return;
+    }
+
+    const auto& memoryBudget = MemoryBudget::get();
+    const auto fileUsage = session_.getMemoryUsage( currentCrawlerWidget() );
+    const auto totalUsage = memoryBudget.totalUsage();
+
+    memoryField->setText( tr( "%1 in memory" ).arg( readableSize( fileUsage.total() ) ) );
+
+    auto details = tr( "Index: %1\nSearch results: %2\nSearch cache: %3" )
+                       .arg( readableSize( fileUsage.index ) )
+                       .arg( readableSize( fileUsage.searchResults ) )
+                       .arg( readableSize( fileUsage.searchCache ) );
+    if ( fileUsage.spilled > 0 ) {
+        details += tr( "\nIndex moved to disk: %1" ).arg( readableSize( fileUsage.spilled ) );
+    }
+    details += tr( "\nAll files: %1 of %2 budget" )
+                   .arg( readableSize( totalUsage.total() ) )
+                   .arg( readableSize( memoryBudget.budget() ) );
+
+    memoryField->setToolTip( details );
+}
+
 void MainWindow::updateOpenedFilesMenu()
 {
     openedFilesMenu->clear();
@@ -1962,6 +2190,7 @@ void MainWindow::showInfoLabels( bool show )
         sizeField->clear();
         dateField->clear();
         encodingField->clear();
+        memoryField->clear();
         lineNbField->clear();
     }
 }
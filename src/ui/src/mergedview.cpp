@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mergedview.h"
+
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+#include "configuration.h"
+#include "ioscheduler.h"
+#include "log.h"
+#include "logdata.h"
+#include "mergedlogdata.h"
+#include "regularexpression.h"
+#include "runnable_lambda.h"
+#include "shortcuts.h"
+
+MergedLogView::MergedLogView( const MergedLogData* mergedData,
+                              const QuickFindPattern* quickFindPattern, QWidget* parent )
+    : AbstractLogView( mergedData, quickFindPattern, parent )
+{
+}
+
+void MergedLogView::setMatches( SearchResultArray matches )
+{
+    matches_ = std::move( matches );
+    forceRefresh();
+}
+
+void MergedLogView::selectNextMatch()
+{
+    const auto rank = matches_.rank( getViewPosition().get() );
+    LineNumber::UnderlyingType nextMatch;
+    if ( matches_.select( rank, &nextMatch ) ) {
+        selectAndDisplayLine( LineNumber( nextMatch ) );
+    }
+}
+
+void MergedLogView::selectPreviousMatch()
+{
+    const auto rank = matches_.rank( getViewPosition().get() );
+    if ( rank < 2 ) {
+        return;
+    }
+
+    LineNumber::UnderlyingType previousMatch;
+    if ( matches_.select( rank - 2, &previousMatch ) ) {
+        selectAndDisplayLine( LineNumber( previousMatch ) );
+    }
+}
+
+AbstractLogData::LineType MergedLogView::lineType( LineNumber lineNumber ) const
+{
+    return matches_.contains( lineNumber.get() ) ? AbstractLogData::LineTypeFlags::Match
+                                                 : AbstractLogData::LineTypeFlags::Plain;
+}
+
+void MergedLogView::doRegisterShortcuts()
+{
+    LOG_INFO << "Registering shortcuts for merged view";
+    AbstractLogView::doRegisterShortcuts();
+    registerShortcut( ShortcutAction::LogViewNextMark, [ this ] { selectNextMatch(); } );
+    registerShortcut( ShortcutAction::LogViewPrevMark, [ this ] { selectPreviousMatch(); } );
+}
+
+MergedView::MergedView( const QStringList& fileNames, QWidget* parent )
+    : QWidget( parent )
+{
+    searchPool_.setMaxThreadCount( 1 );
+
+    sources_.reserve( static_cast<size_t>( fileNames.size() ) );
+    while ( sources_.size() < static_cast<size_t>( fileNames.size() ) ) {
+        sources_.push_back( std::make_shared<LogData>() );
+    }
+
+    mergedData_ = std::make_unique<MergedLogData>( sources_ );
+
+    searchLineEdit_ = new QLineEdit;
+    searchLineEdit_->setPlaceholderText( tr( "Search all merged files" ) );
+
+    auto searchButton = new QPushButton( tr( "Search" ) );
+    auto previousButton = new QPushButton( tr( "Previous" ) );
+    auto nextButton = new QPushButton( tr( "Next" ) );
+    statusLabel_ = new QLabel( tr( "Merging %1 files" ).arg( fileNames.size() ) );
+
+    view_ = new MergedLogView( mergedData_.get(), &quickFindPattern_ );
+
+    auto searchLayout = new QHBoxLayout;
+    searchLayout->setContentsMargins( 2, 2, 2, 2 );
+    searchLayout->addWidget( searchLineEdit_ );
+    searchLayout->addWidget( searchButton );
+    searchLayout->addWidget( previousButton );
+    searchLayout->addWidget( nextButton );
+    searchLayout->addWidget( statusLabel_ );
+
+    auto layout = new QVBoxLayout;
+    layout->setContentsMargins( 0, 0, 0, 0 );
+    layout->addLayout( searchLayout );
+    layout->addWidget( view_ );
+    setLayout( layout );
+
+    connect( searchLineEdit_, &QLineEdit::returnPressed, this, &MergedView::startSearch );
+    connect( searchButton, &QPushButton::clicked, this, &MergedView::startSearch );
+    connect( previousButton, &QPushButton::clicked, view_, &MergedLogView::selectPreviousMatch );
+    connect( nextButton, &QPushButton::clicked, view_, &MergedLogView::selectNextMatch );
+
+    // Sent from the merge thread
+    connect( mergedData_.get(), &MergedLogData::mergeProgressed, this,
+             [ this, nbFiles = fileNames.size() ]( int percent ) {
+                 statusLabel_->setText(
+                     tr( "Merging %1 files: %2%" ).arg( nbFiles ).arg( percent ) );
+             } );
+    connect( mergedData_.get(), &MergedLogData::mergeFinished, this,
+             [ this, nbFiles = fileNames.size() ] {
+                 view_->updateData();
+                 statusLabel_->setText( tr( "%1 lines from %2 files" )
+                                            .arg( mergedData_->getNbLine().get() )
+                                            .arg( nbFiles ) );
+             } );
+
+    applyConfiguration();
+
+    // The merge index is rebuilt as each source finishes loading
+    for ( auto index = 0u; index < sources_.size(); ++index ) {
+        sources_[ index ]->attachFile( fileNames.at( static_cast<int>( index ) ) );
+    }
+}
+
+MergedView::~MergedView()
+{
+    stopSearch();
+    mergedData_->interruptRebuild();
+    view_->stopBackgroundWork();
+}
+
+void MergedView::applyConfiguration()
+{
+    const auto& config = Configuration::get();
+
+    QFont font = config.mainFont();
+    font.setKerning( false );
+    font.setFixedPitch( true );
+    if ( config.forceFontAntialiasing() ) {
+        font.setStyleStrategy( QFont::PreferAntialias );
+    }
+
+    view_->setLineNumbersVisible( config.mainLineNumbersVisible() );
+    view_->setLinesWrapped( config.linesWrapped() );
+    view_->updateFont( font );
+    view_->registerShortcuts();
+}
+
+void MergedView::startSearch()
+{
+    stopSearch();
+
+    const auto searchText = searchLineEdit_->text();
+    if ( searchText.isEmpty() ) {
+        view_->setSearchPattern( {} );
+        view_->setMatches( {} );
+        return;
+    }
+
+    const auto& config = Configuration::get();
+    const auto pattern = RegularExpressionPattern(
+        searchText, !config.isSearchIgnoreCaseDefault(), false, false,
+        config.mainRegexpType() == SearchRegexpType::FixedString );
+
+    const RegularExpression expression{ pattern };
+    if ( !expression.isValid() ) {
+        statusLabel_->setText( tr( "Error in expression: %1" ).arg( expression.errorString() ) );
+        return;
+    }
+
+    view_->setSearchPattern( pattern );
+    statusLabel_->setText( tr( "Searching..." ) );
+
+    searchInterruptRequested_.clear();
+    searchPool_.start( createRunnable( [ this, pattern ] {
+        auto results = mergedData_->search( pattern, searchInterruptRequested_ );
+        if ( searchInterruptRequested_ ) {
+            return;
+        }
+
+        // Posted events are dropped with the view if it is closed meanwhile
+        QMetaObject::invokeMethod(
+            this,
+            [ this, matches = std::move( results.newMatches ) ] {
+                view_->setMatches( matches );
+                statusLabel_->setText( tr( "%1 matches" ).arg( matches.cardinality() ) );
+            },
+            Qt::QueuedConnection );
+    } ) );
+}
+
+void MergedView::stopSearch()
+{
+    searchInterruptRequested_.set();
+    IoScheduler::get().notifyInterrupted();
+    searchPool_.waitForDone();
+}
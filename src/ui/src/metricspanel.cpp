@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metricspanel.h"
+
+#include <algorithm>
+
+#include <QApplication>
+#include <QClipboard>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QJsonDocument>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+#include "metrics.h"
+#include "readablesize.h"
+
+namespace {
+constexpr auto RefreshInterval = std::chrono::seconds{ 1 };
+
+bool endsWith( const std::string& name, const std::string& suffix )
+{
+    return name.size() >= suffix.size()
+           && name.compare( name.size() - suffix.size(), suffix.size(), suffix ) == 0;
+}
+
+bool isBytes( const std::string& name )
+{
+    return name.find( "bytes" ) != std::string::npos;
+}
+
+QString formatCount( const std::string& name, uint64_t value )
+{
+    return isBytes( name ) ? readableSize( value ) : QString::number( value );
+}
+
+QString formatMicroseconds( uint64_t value )
+{
+    return QString( "%1 ms" ).arg( static_cast<double>( value ) / 1000.0, 0, 'f', 2 );
+}
+
+QString formatGauge( const std::string& name, int64_t value )
+{
+    if ( endsWith( name, "_bps" ) ) {
+        return readableSize( static_cast<uint64_t>( std::max( int64_t{ 0 }, value ) ) ) + "/s";
+    }
+    else if ( endsWith( name, "_lps" ) ) {
+        return QString( "%1 lines/s" ).arg( value );
+    }
+    return QString::number( value );
+}
+
+QString formatHistogram( const std::string& name, const Metrics::Histogram::Snapshot& snapshot )
+{
+    const auto format = [ &name ]( uint64_t value ) {
+        return endsWith( name, "_us" ) ? formatMicroseconds( value ) : QString::number( value );
+    };
+
+    return QString( "p50 %1, p90 %2, p99 %3, max %4 (%5 samples)" )
+        .arg( format( snapshot.percentile( 50 ) ), format( snapshot.percentile( 90 ) ),
+              format( snapshot.percentile( 99 ) ), format( snapshot.max ) )
+        .arg( snapshot.count );
+}
+} // namespace
+
+MetricsPanel::MetricsPanel( QWidget* parent )
+    : QWidget( parent )
+    , tree_( new QTreeWidget )
+{
+    tree_->setColumnCount( 2 );
+    tree_->setHeaderLabels( { tr( "Metric" ), tr( "Value" ) } );
+    tree_->setRootIsDecorated( true );
+    tree_->header()->setSectionResizeMode( 0, QHeaderView::ResizeToContents );
+
+    throughputGroup_ = new QTreeWidgetItem( tree_, { tr( "Throughput" ) } );
+    queuesGroup_ = new QTreeWidgetItem( tree_, { tr( "Queues" ) } );
+    latencyGroup_ = new QTreeWidgetItem( tree_, { tr( "Latency" ) } );
+    tree_->expandAll();
+
+    auto copyButton = new QPushButton( tr( "Copy as JSON" ) );
+    copyButton->setToolTip( tr( "Copy all metrics to the clipboard" ) );
+    connect( copyButton, &QPushButton::clicked, this, [ this ] { copyToClipboard(); } );
+
+    auto buttonsLayout = new QHBoxLayout;
+    buttonsLayout->addStretch();
+    buttonsLayout->addWidget( copyButton );
+
+    auto layout = new QVBoxLayout;
+    layout->setContentsMargins( 0, 0, 0, 0 );
+    layout->addWidget( tree_ );
+    layout->addLayout( buttonsLayout );
+    setLayout( layout );
+
+    refreshTimer_.setInterval( RefreshInterval );
+    connect( &refreshTimer_, &QTimer::timeout, this, &MetricsPanel::refresh );
+}
+
+void MetricsPanel::showEvent( QShowEvent* event )
+{
+    refresh();
+    refreshTimer_.start();
+    QWidget::showEvent( event );
+}
+
+void MetricsPanel::hideEvent( QHideEvent* event )
+{
+    refreshTimer_.stop();
+    QWidget::hideEvent( event );
+}
+
+QTreeWidgetItem* MetricsPanel::item( QTreeWidgetItem* group, const std::string& name )
+{
+    auto& item = items_[ name ];
+    if ( !item ) {
+        item = new QTreeWidgetItem( group, { QString::fromStdString( name ) } );
+        group->sortChildren( 0, Qt::AscendingOrder );
+    }
+    return item;
+}
+
+void MetricsPanel::refresh()
+{
+    const auto& metrics = Metrics::get();
+
+    const auto refreshTime = metrics.uptime();
+    const auto elapsedSeconds
+        = static_cast<double>( ( refreshTime - lastRefreshTime_ ).count() ) / 1000.0;
+
+    auto counters = metrics.counters();
+    for ( const auto& counter : counters ) {
+        const auto& name = counter.first;
+        const auto lastValue = lastCounters_.find( name );
+        const auto delta
+            = counter.second
+              - ( lastValue != lastCounters_.end() ? lastValue->second : uint64_t{ 0 } );
+        const auto rate = elapsedSeconds > 0
+                              ? static_cast<uint64_t>( static_cast<double>( delta ) / elapsedSeconds )
+                              : uint64_t{ 0 };
+
+        item( throughputGroup_, name )
+            ->setText( 1, QString( "%1 (%2/s)" ).arg( formatCount( name, counter.second ),
+                                                     formatCount( name, rate ) ) );
+    }
+
+    for ( const auto& gauge : metrics.gauges() ) {
+        const auto group = endsWith( gauge.first, "_bps" ) || endsWith( gauge.first, "_lps" )
+                               ? throughputGroup_
+                               : queuesGroup_;
+        item( group, gauge.first )->setText( 1, formatGauge( gauge.first, gauge.second ) );
+    }
+
+    for ( const auto& histogram : metrics.histograms() ) {
+        item( latencyGroup_, histogram.first )
+            ->setText( 1, formatHistogram( histogram.first, histogram.second ) );
+    }
+
+    lastCounters_ = std::move( counters );
+    lastRefreshTime_ = refreshTime;
+}
+
+void MetricsPanel::copyToClipboard() const
+{
+    QApplication::clipboard()->setText(
+        QString::fromUtf8( QJsonDocument( Metrics::get().toJson() ).toJson() ) );
+}
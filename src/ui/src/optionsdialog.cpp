@@ -67,6 +67,7 @@ OptionsDialog::OptionsDialog( QWidget* parent )
     setupRegexp();
     setupStyles();
     setupEncodings();
+    setupTimestampFormats();
 
     // Validators
     QValidator* pollingIntervalValidator = new QIntValidator( PollIntervalMin, PollIntervalMax );
@@ -164,6 +165,16 @@ void OptionsDialog::setupEncodings()
     }
 }
 
+void OptionsDialog::setupTimestampFormats()
+{
+    timestampFormatComboBox->addItem( tr( "None" ), static_cast<int>( TimestampFormat::None ) );
+    timestampFormatComboBox->addItem( tr( "Auto" ), static_cast<int>( TimestampFormat::Auto ) );
+    timestampFormatComboBox->addItem( tr( "ISO-8601" ),
+                                      static_cast<int>( TimestampFormat::Iso8601 ) );
+    timestampFormatComboBox->addItem( tr( "Syslog" ),
+                                      static_cast<int>( TimestampFormat::Syslog ) );
+}
+
 void OptionsDialog::setupPolling()
 {
     pollIntervalLineEdit->setEnabled( pollingCheckBox->isChecked() );
@@ -172,6 +183,7 @@ void OptionsDialog::setupPolling()
 void OptionsDialog::setupSearchResultsCache()
 {
     searchCacheSpinBox->setEnabled( searchResultsCacheCheckBox->isChecked() );
+    persistSearchCacheCheckBox->setEnabled( searchResultsCacheCheckBox->isChecked() );
 }
 
 void OptionsDialog::setupLogging()
@@ -318,11 +330,17 @@ void OptionsDialog::updateDialogFromConfig()
     // Perf
     parallelSearchCheckBox->setChecked( config.useParallelSearch() );
     searchResultsCacheCheckBox->setChecked( config.useSearchResultsCache() );
-    searchCacheSpinBox->setValue( static_cast<int>( config.searchResultsCacheLines() ) );
+    searchCacheSpinBox->setValue( static_cast<int>( config.searchResultsCacheSizeMb() ) );
+    persistSearchCacheCheckBox->setChecked( config.persistSearchResultsCache() );
     indexReadBufferSpinBox->setValue( config.indexReadBufferSizeMb() );
-    searchReadBufferSpinBox->setValue( config.searchReadBufferSizeLines() );
     keepFileClosedCheckBox->setChecked( config.keepFileClosed() );
     optimizeForNotLatinEncodingsCheckBox->setChecked( config.optimizeForNotLatinEncodings() );
+    warmUpSessionTabsCheckBox->setChecked( config.warmUpSessionTabs() );
+    searchVisibleLinesFirstCheckBox->setChecked( config.searchVisibleLinesFirst() );
+    const auto timestampFormatIndex
+        = timestampFormatComboBox->findData( static_cast<int>( config.timestampFormat() ) );
+    timestampFormatComboBox->setCurrentIndex( timestampFormatIndex < 0 ? 0
+                                                                       : timestampFormatIndex );
 
     // version checking
     checkForNewVersionCheckBox->setChecked( config.versionCheckingEnabled() );
@@ -425,11 +443,15 @@ void OptionsDialog::updateConfigFromDialog()
 
     config.setUseParallelSearch( parallelSearchCheckBox->isChecked() );
     config.setUseSearchResultsCache( searchResultsCacheCheckBox->isChecked() );
-    config.setSearchResultsCacheLines( static_cast<unsigned>( searchCacheSpinBox->value() ) );
+    config.setSearchResultsCacheSizeMb( static_cast<unsigned>( searchCacheSpinBox->value() ) );
+    config.setPersistSearchResultsCache( persistSearchCacheCheckBox->isChecked() );
     config.setIndexReadBufferSizeMb( indexReadBufferSpinBox->value() );
-    config.setSearchReadBufferSizeLines( searchReadBufferSpinBox->value() );
     config.setKeepFileClosed( keepFileClosedCheckBox->isChecked() );
     config.setOptimizeForNotLatinEncodings( optimizeForNotLatinEncodingsCheckBox->isChecked() );
+    config.setWarmUpSessionTabs( warmUpSessionTabsCheckBox->isChecked() );
+    config.setSearchVisibleLinesFirst( searchVisibleLinesFirstCheckBox->isChecked() );
+    config.setTimestampFormat(
+        static_cast<TimestampFormat>( timestampFormatComboBox->currentData().toInt() ) );
 
     // version checking
     config.setVersionCheckingEnabled( checkForNewVersionCheckBox->isChecked() );
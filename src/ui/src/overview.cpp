@@ -24,10 +24,13 @@
 #include "linetypes.h"
 #include "log.h"
 
+#include "logdata.h"
 #include "logfiltereddata.h"
 
 #include "overview.h"
 
+#include <algorithm>
+
 Overview::Overview()
     : matchLines_()
     , markLines_()
@@ -43,6 +46,12 @@ void Overview::setFilteredData( const LogFilteredData* logFilteredData )
     logFilteredData_ = logFilteredData;
 }
 
+void Overview::setLogData( const LogData* logData )
+{
+    logData_ = logData;
+    dirty_ = true;
+}
+
 void Overview::updateData( LinesCount totalNbLine )
 {
     LOG_DEBUG << "OverviewWidget::updateData " << totalNbLine;
@@ -86,6 +95,20 @@ std::pair<int, int> Overview::getViewLines() const
     return std::make_pair( top, bottom );
 }
 
+const std::vector<Overview::TimeTick>* Overview::getTimeTicks() const
+{
+    return &timeTicks_;
+}
+
+OptionalTimestamp Overview::timestampFromY( int y ) const
+{
+    if ( logData_ == nullptr || height_ == 0 || linesInFile_.get() == 0 ) {
+        return {};
+    }
+
+    return logData_->getLineTimestamp( fileLineFromY( y ) );
+}
+
 LineNumber Overview::fileLineFromY( int position ) const
 {
     const auto line = static_cast<LineNumber::UnderlyingType>(
@@ -143,5 +166,43 @@ void Overview::recalculatesLines()
     else
         LOG_DEBUG << "Overview::recalculatesLines: logFilteredData_ == NULL";
 
+    recalculatesTimeTicks();
+
     dirty_ = false;
 }
+
+void Overview::recalculatesTimeTicks()
+{
+    timeTicks_.clear();
+
+    if ( logData_ == nullptr || height_ == 0 || !logData_->hasTimestamps() ) {
+        return;
+    }
+
+    // Ticks are placed on round times, not closer than MinTickSpacing pixels on average
+    static constexpr unsigned MinTickSpacing = 40;
+    static constexpr Timestamp Second = 1000;
+    static constexpr Timestamp Steps[]
+        = { Second,           10 * Second,       60 * Second,      600 * Second,
+            3600 * Second,    6 * 3600 * Second, 86400 * Second,   7 * 86400 * Second,
+            30 * 86400 * Second, 365 * 86400 * Second };
+
+    const auto [ firstTimestamp, lastTimestamp ] = logData_->getTimestampRange();
+    const auto maxTicks = std::max( 1u, height_ / MinTickSpacing );
+
+    auto step = std::end( Steps )[ -1 ];
+    for ( const auto candidate : Steps ) {
+        if ( ( lastTimestamp - firstTimestamp ) / candidate <= maxTicks ) {
+            step = candidate;
+            break;
+        }
+    }
+
+    for ( auto timestamp = firstTimestamp - firstTimestamp % step + step;
+          timestamp <= lastTimestamp; timestamp += step ) {
+        const auto line = logData_->findLineByTimestamp( timestamp );
+        if ( line ) {
+            timeTicks_.push_back( TimeTick{ yFromFileLine( *line ), timestamp } );
+        }
+    }
+}
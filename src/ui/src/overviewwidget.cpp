@@ -20,8 +20,11 @@
 // This file implements OverviewWidget.  This class is responsable for
 // managing and painting the matches overview widget.
 
+#include <QDateTime>
+#include <QHelpEvent>
 #include <QMouseEvent>
 #include <QPainter>
+#include <QToolTip>
 #include <cassert>
 
 #include "log.h"
@@ -185,6 +188,13 @@ void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
                               line.position() );
         }
 
+        // The time axis
+        painter.setOpacity( 0.5 );
+        painter.setPen( palette().color( QPalette::Text ) );
+        for ( const auto& tick : *( overview_->getTimeTicks() ) ) {
+            painter.drawLine( 1, tick.position, LINE_MARGIN, tick.position );
+        }
+
         // The 'view' lines
         painter.setOpacity( 1 );
         painter.setPen( palette().color( QPalette::Text ) );
@@ -209,6 +219,27 @@ void OverviewWidget::paintEvent( QPaintEvent* /* paintEvent */ )
     }
 }
 
+bool OverviewWidget::event( QEvent* event )
+{
+    if ( event->type() == QEvent::ToolTip && overview_ != nullptr ) {
+        const auto* helpEvent = static_cast<QHelpEvent*>( event );
+        const auto timestamp = overview_->timestampFromY( helpEvent->pos().y() );
+        if ( timestamp ) {
+            QToolTip::showText(
+                helpEvent->globalPos(),
+                QDateTime::fromMSecsSinceEpoch( *timestamp, Qt::UTC ).toString( Qt::ISODateWithMs ),
+                this );
+        }
+        else {
+            QToolTip::hideText();
+            event->ignore();
+        }
+        return true;
+    }
+
+    return QWidget::event( event );
+}
+
 void OverviewWidget::mousePressEvent( QMouseEvent* mouseEvent )
 {
     if ( mouseEvent->button() == Qt::LeftButton )
@@ -148,6 +148,21 @@ std::vector<LineNumber> Selection::getLines() const
     return selection;
 }
 
+std::pair<LineNumber, LinesCount> Selection::getLineRange() const
+{
+    if ( selectedLine_.has_value() ) {
+        return { *selectedLine_, 1_lcount };
+    }
+    else if ( selectedPartial_.line.has_value() ) {
+        return { *selectedPartial_.line, 1_lcount };
+    }
+    else if ( selectedRange_.startLine.has_value() ) {
+        return { *selectedRange_.startLine, selectedRange_.size() };
+    }
+
+    return { 0_lnum, 0_lcount };
+}
+
 // The tab behaviour is a bit odd at the moment, full lines are not expanded
 // but partials (part of line) are, they probably should not ideally.
 QString Selection::getSelectedText( const AbstractLogData* logData ) const
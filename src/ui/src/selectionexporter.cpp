@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "selectionexporter.h"
+
+#include <algorithm>
+#include <new>
+
+#include <QSaveFile>
+#include <QTextCodec>
+#include <QtConcurrent>
+
+#include "abstractlogdata.h"
+#include "log.h"
+#include "tracing.h"
+
+namespace {
+// Lines read from the data at once
+constexpr auto ChunkSize = 5000_lcount;
+} // namespace
+
+SelectionExporter::SelectionExporter( QObject* parent )
+    : QObject( parent )
+{
+    connect( &exportWatcher_, &QFutureWatcher<Result>::finished, this,
+             &SelectionExporter::onExportFinished );
+}
+
+SelectionExporter::~SelectionExporter()
+{
+    interruptRequested_.set();
+    exportWatcher_.waitForFinished();
+}
+
+void SelectionExporter::copyLines( const AbstractLogData* logData, LineNumber firstLine,
+                                   LinesCount count )
+{
+    start( logData, firstLine, count, {} );
+}
+
+void SelectionExporter::saveLines( const AbstractLogData* logData, LineNumber firstLine,
+                                   LinesCount count, const QString& fileName )
+{
+    start( logData, firstLine, count, fileName );
+}
+
+bool SelectionExporter::isRunning() const
+{
+    return exportWatcher_.isRunning();
+}
+
+void SelectionExporter::cancel()
+{
+    interruptRequested_.set();
+}
+
+void SelectionExporter::start( const AbstractLogData* logData, LineNumber firstLine,
+                               LinesCount count, const QString& fileName )
+{
+    interruptRequested_.set();
+    exportWatcher_.waitForFinished();
+
+    interruptRequested_.clear();
+    lastProgress_ = -1;
+
+    LOG_INFO << "Exporting " << count << " lines from " << firstLine
+             << ( fileName.isEmpty() ? QString( " to clipboard" ) : " to " + fileName );
+
+    exportFuture_ = QtConcurrent::run( [ this, logData, firstLine, count, fileName ] {
+        KLOGG_TRACE_SCOPE_ARG( "export", "export_lines", "lines", count.get() );
+        try {
+            return fileName.isEmpty() ? readText( logData, firstLine, count )
+                                      : writeFile( logData, firstLine, count, fileName );
+        } catch ( const std::bad_alloc& e ) {
+            LOG_ERROR << "not enough memory to export lines: " << e.what();
+            return Result{};
+        }
+    } );
+    exportWatcher_.setFuture( exportFuture_ );
+}
+
+void SelectionExporter::reportProgress( LinesCount done, LinesCount total )
+{
+    const auto percent = static_cast<int>( done.get() * 100 / std::max( total.get(), LinesCount::UnderlyingType{ 1 } ) );
+    if ( percent != lastProgress_ ) {
+        lastProgress_ = percent;
+        Q_EMIT progressChanged( percent );
+    }
+}
+
+SelectionExporter::Result SelectionExporter::readText( const AbstractLogData* logData,
+                                                       LineNumber firstLine, LinesCount count )
+{
+    Result result;
+    result.hasText = true;
+
+    auto done = 0_lcount;
+    while ( done < count ) {
+        if ( interruptRequested_ ) {
+            return {};
+        }
+
+        KLOGG_TRACE_SCOPE_ARG( "export", "copy_chunk", "first_line", ( firstLine + done ).get() );
+
+        const auto lines
+            = logData->getLines( firstLine + done, std::min( ChunkSize, count - done ) );
+        if ( lines.empty() ) {
+            break;
+        }
+
+        for ( const auto& line : lines ) {
+            if ( done.get() > 0 ) {
+#if defined( Q_OS_WIN )
+                result.text.append( QChar::CarriageReturn );
+#endif
+                result.text.append( QChar::LineFeed );
+            }
+            result.text.append( line );
+            ++done;
+        }
+
+        reportProgress( done, count );
+    }
+
+    result.text.replace( QChar::Null, QChar::Space );
+    result.isCompleted = true;
+    return result;
+}
+
+SelectionExporter::Result SelectionExporter::writeFile( const AbstractLogData* logData,
+                                                        LineNumber firstLine, LinesCount count,
+                                                        const QString& fileName )
+{
+    QSaveFile saveFile{ fileName };
+    saveFile.open( QIODevice::WriteOnly | QIODevice::Truncate );
+    if ( !saveFile.isOpen() ) {
+        LOG_ERROR << "Failed to open file to save";
+        return {};
+    }
+
+    QTextCodec* codec = logData->getDisplayEncoding();
+    if ( !codec ) {
+        codec = QTextCodec::codecForName( "utf-8" );
+    }
+
+    auto done = 0_lcount;
+    while ( done < count ) {
+        if ( interruptRequested_ ) {
+            return {};
+        }
+
+        KLOGG_TRACE_SCOPE_ARG( "export", "save_chunk", "first_line", ( firstLine + done ).get() );
+
+        auto lines = logData->getLines( firstLine + done, std::min( ChunkSize, count - done ) );
+        if ( lines.empty() ) {
+            break;
+        }
+
+        for ( auto& line : lines ) {
+#if !defined( Q_OS_WIN )
+            line.append( QChar::CarriageReturn );
+#endif
+            line.append( QChar::LineFeed );
+
+            const auto encodedLine = codec->fromUnicode( line );
+            if ( saveFile.write( encodedLine ) != encodedLine.size() ) {
+                LOG_ERROR << "Saving file write failed";
+                return {};
+            }
+            ++done;
+        }
+
+        reportProgress( done, count );
+    }
+
+    Result result;
+    result.isCompleted = saveFile.commit();
+    return result;
+}
+
+void SelectionExporter::onExportFinished()
+{
+    auto result = exportFuture_.result();
+    if ( result.isCompleted && result.hasText ) {
+        Q_EMIT textReady( result.text );
+    }
+
+    LOG_INFO << "Export finished, completed " << result.isCompleted;
+    Q_EMIT finished( result.isCompleted );
+}
@@ -87,14 +87,53 @@ void Session::getFileInfo( const ViewInterface* view, uint64_t* fileSize, uint64
 
     assert( file );
 
+    if ( !file->isAttached ) {
+        const QFileInfo fileInfo( file->fileName );
+        *fileSize = static_cast<uint64_t>( fileInfo.size() );
+        *fileNbLine = 0;
+        *lastModified = fileInfo.lastModified();
+        return;
+    }
+
     *fileSize = static_cast<uint64_t>( file->logData->getFileSize() );
     *fileNbLine = file->logData->getNbLine().get();
     *lastModified = file->logData->getLastModifiedDate();
 }
 
+MemoryBudget::Accounting Session::getMemoryUsage( const ViewInterface* view ) const
+{
+    const OpenFile* file = findOpenFileFromView( view );
+
+    assert( file );
+
+    return MemoryBudget::get().usage( file->logData.get() );
+}
+
+bool Session::isAttached( const ViewInterface* view ) const
+{
+    const OpenFile* file = findOpenFileFromView( view );
+
+    assert( file );
+
+    return file->isAttached;
+}
+
+void Session::attach( const ViewInterface* view )
+{
+    OpenFile* file = findOpenFileFromView( view );
+
+    assert( file );
+
+    if ( !file->isAttached ) {
+        LOG_INFO << "Attaching restored file " << file->fileName;
+        file->isAttached = true;
+        file->logData->attachFile( file->fileName );
+    }
+}
+
 ViewInterface* Session::openAlways( const QString& file_name,
                                     const std::function<ViewInterface*()>& view_factory,
-                                    const QString& view_context )
+                                    const QString& view_context, bool attachNow )
 {
     // Create the data objects
     auto log_data = std::make_shared<LogData>();
@@ -109,10 +148,12 @@ ViewInterface* Session::openAlways( const QString& file_name,
         view->setViewContext( view_context );
 
     // Insert in the hash
-    openFiles_.insert( { view, { file_name, log_data, log_filtered_data, view } } );
+    openFiles_.insert( { view, { file_name, log_data, log_filtered_data, view, attachNow } } );
 
     // Start loading the file
-    log_data->attachFile( file_name );
+    if ( attachNow ) {
+        log_data->attachFile( file_name );
+    }
 
     return view;
 }
@@ -195,7 +236,7 @@ WindowSession::restore( const std::function<ViewInterface*()>& view_factory,
     for ( auto file : session_files ) {
         LOG_DEBUG << "Create view for " << file.fileName;
         ViewInterface* view
-            = appSession_->openAlways( file.fileName, view_factory, file.viewContext );
+            = appSession_->openAlways( file.fileName, view_factory, file.viewContext, false );
         result.emplace_back( file.fileName, view );
         openedFiles_.emplace_back( file.fileName );
     }
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tabbedmergedviews.h"
+
+#include <QFileInfo>
+#include <QVBoxLayout>
+
+#include "mergedview.h"
+
+TabbedMergedViews::TabbedMergedViews( QWidget* parent )
+    : QWidget( parent )
+{
+    this->hide();
+
+    tabWidget_ = new QTabWidget;
+    tabWidget_->setDocumentMode( true );
+    tabWidget_->setTabsClosable( true );
+
+    connect( tabWidget_, &QTabWidget::tabCloseRequested, this, &TabbedMergedViews::closeTab );
+
+    auto layout = new QVBoxLayout;
+    layout->setContentsMargins( 0, 0, 0, 0 );
+    layout->addWidget( tabWidget_ );
+    setLayout( layout );
+}
+
+void TabbedMergedViews::addMergedView( const QStringList& fileNames )
+{
+    QStringList names;
+    for ( const auto& fileName : fileNames ) {
+        names.append( QFileInfo( fileName ).fileName() );
+    }
+
+    const auto index = tabWidget_->addTab( new MergedView( fileNames ), names.join( " + " ) );
+    tabWidget_->setTabToolTip( index, fileNames.join( "\n" ) );
+    tabWidget_->setCurrentIndex( index );
+
+    auto state = windowState();
+    state.setFlag( Qt::WindowMinimized, false );
+    setWindowState( state );
+    show();
+    activateWindow();
+}
+
+void TabbedMergedViews::applyConfiguration()
+{
+    for ( auto index = 0; index < tabWidget_->count(); ++index ) {
+        if ( auto mergedView = qobject_cast<MergedView*>( tabWidget_->widget( index ) ) ) {
+            mergedView->applyConfiguration();
+        }
+    }
+}
+
+void TabbedMergedViews::closeTab( int index )
+{
+    auto widget = tabWidget_->widget( index );
+    tabWidget_->removeTab( index );
+    delete widget;
+
+    if ( tabWidget_->count() == 0 ) {
+        hide();
+    }
+}
@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "wrappedrowindex.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "abstractlogdata.h"
+#include "log.h"
+
+namespace {
+constexpr size_t MaxRecentBlocks = 64;
+
+// Blocks whose count moves the searched row to another block are followed
+// that many times, further moves are left to the background count.
+constexpr int MaxRelocations = 8;
+
+// How often the progress of the background count is reported
+constexpr uint64_t BlocksPerNotification = 256;
+
+uint64_t lowestBit( uint64_t value )
+{
+    return value & ( ~value + 1 );
+}
+} // namespace
+
+WrappedRowIndex::~WrappedRowIndex() noexcept
+{
+    ++generation_;
+    countTasks_.wait();
+}
+
+void WrappedRowIndex::reset( const AbstractLogData* logData, int wrapColumns )
+{
+    ++generation_;
+    countTasks_.wait();
+
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        logData_ = logData;
+        wrapColumns_ = std::max( wrapColumns, 1 );
+        nbLines_ = 0_lcount;
+        tree_.clear();
+        blockRows_.clear();
+        isBlockExact_.clear();
+        firstInexactBlock_ = 0;
+        recentBlocks_.clear();
+        isCounting_ = false;
+    }
+
+    update();
+}
+
+void WrappedRowIndex::update()
+{
+    if ( logData_ == nullptr ) {
+        return;
+    }
+
+    // Only this thread changes the number of lines
+    const auto nbLines = logData_->getNbLine();
+    if ( nbLines == nbLines_ ) {
+        return;
+    }
+    else if ( nbLines < nbLines_ ) {
+        reset( logData_, wrapColumns_ );
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+
+        // The last block gets the new lines until it is full,
+        // they are counted as one row each until counted for real.
+        if ( !blockRows_.empty() ) {
+            const auto lastBlock = blockRows_.size() - 1;
+            const auto oldLines = blockLines( lastBlock );
+            nbLines_ = std::min( nbLines, LinesCount( ( lastBlock + 1 ) * BlockSize ) );
+            const auto addedLines = blockLines( lastBlock ) - oldLines;
+            if ( addedLines.get() > 0 ) {
+                setBlockRows( lastBlock, blockRows_[ lastBlock ] + addedLines.get(), false );
+                recentBlocks_.remove_if(
+                    [ lastBlock ]( const auto& block ) { return block.first == lastBlock; } );
+            }
+        }
+
+        while ( nbLines_ < nbLines ) {
+            const auto addedLines = std::min( LinesCount( BlockSize ), nbLines - nbLines_ );
+            nbLines_ += addedLines;
+            appendBlock( addedLines.get() );
+        }
+    }
+
+    startCounting();
+}
+
+int WrappedRowIndex::wrapColumns() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    return wrapColumns_;
+}
+
+uint64_t WrappedRowIndex::totalRows() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    return rowsBefore( blockRows_.size() );
+}
+
+uint64_t WrappedRowIndex::rowsOf( LineNumber line )
+{
+    const auto lineRows = blockLineRows( line.get() / BlockSize );
+    const auto lineInBlock = line.get() % BlockSize;
+    return lineInBlock < lineRows->size() ? ( *lineRows )[ lineInBlock ] : 1;
+}
+
+uint64_t WrappedRowIndex::firstRowOf( LineNumber line )
+{
+    const auto blockIndex = line.get() / BlockSize;
+    const auto lineRows = blockLineRows( blockIndex );
+    const auto lineInBlock
+        = std::min( static_cast<size_t>( line.get() % BlockSize ), lineRows->size() );
+
+    std::lock_guard<std::mutex> lock( mutex_ );
+    return rowsBefore( std::min( blockIndex, static_cast<uint64_t>( blockRows_.size() ) ) )
+           + std::accumulate( lineRows->begin(),
+                              lineRows->begin() + static_cast<std::ptrdiff_t>( lineInBlock ),
+                              uint64_t{ 0 } );
+}
+
+WrappedRowIndex::RowPosition WrappedRowIndex::positionOfRow( uint64_t row )
+{
+    for ( auto relocation = 0;; ++relocation ) {
+        uint64_t blockIndex = 0;
+        uint64_t rowInBlock = 0;
+        bool wasExact = false;
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            if ( blockRows_.empty() ) {
+                return {};
+            }
+
+            // Descend the tree to the last block starting at or before the row
+            auto remaining = std::min( row, rowsBefore( blockRows_.size() ) - 1 );
+            uint64_t position = 0;
+            uint64_t step = 1;
+            while ( step * 2 <= tree_.size() ) {
+                step *= 2;
+            }
+            for ( ; step > 0; step >>= 1 ) {
+                if ( position + step <= tree_.size()
+                     && tree_[ position + step - 1 ] <= remaining ) {
+                    position += step;
+                    remaining -= tree_[ position - 1 ];
+                }
+            }
+
+            blockIndex = position;
+            rowInBlock = remaining;
+            wasExact = isBlockExact_[ blockIndex ];
+        }
+
+        const auto lineRows = blockLineRows( blockIndex );
+        if ( !wasExact && relocation < MaxRelocations ) {
+            continue;
+        }
+
+        const auto blockStart = LineNumber( blockIndex * BlockSize );
+        for ( auto i = 0u; i < lineRows->size(); ++i ) {
+            if ( rowInBlock < ( *lineRows )[ i ] ) {
+                return { blockStart + LinesCount( i ), rowInBlock };
+            }
+            rowInBlock -= ( *lineRows )[ i ];
+        }
+
+        if ( lineRows->empty() ) {
+            return { blockStart, 0 };
+        }
+        return { blockStart + LinesCount( lineRows->size() - 1 ), lineRows->back() - 1 };
+    }
+}
+
+WrappedRowIndex::LineRows WrappedRowIndex::blockLineRows( uint64_t blockIndex )
+{
+    const auto generation = generation_.load();
+    LinesCount nbLines;
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        if ( auto lineRows = findRecentBlock( blockIndex ) ) {
+            return lineRows;
+        }
+        nbLines = blockLines( blockIndex );
+    }
+
+    auto lineRows
+        = std::make_shared<const std::vector<uint32_t>>( countLineRows( blockIndex, nbLines ) );
+
+    std::lock_guard<std::mutex> lock( mutex_ );
+    if ( generation == generation_ && nbLines == blockLines( blockIndex )
+         && nbLines.get() > 0 ) {
+        setBlockRows( blockIndex,
+                      std::accumulate( lineRows->begin(), lineRows->end(), uint64_t{ 0 } ),
+                      true );
+        addRecentBlock( blockIndex, lineRows );
+    }
+
+    return lineRows;
+}
+
+std::vector<uint32_t> WrappedRowIndex::countLineRows( uint64_t blockIndex,
+                                                      LinesCount nbLines ) const
+{
+    auto lengths = logData_->getLineLengths( LineNumber( blockIndex * BlockSize ), nbLines );
+    lengths.resize( nbLines.get() );
+
+    const auto wrapColumns = static_cast<uint32_t>( wrapColumns_ );
+
+    std::vector<uint32_t> lineRows( lengths.size() );
+    std::transform( lengths.begin(), lengths.end(), lineRows.begin(),
+                    [ wrapColumns ]( LineLength length ) {
+                        const auto columns = static_cast<uint32_t>( std::max( length.get(), 1 ) );
+                        return ( columns + wrapColumns - 1 ) / wrapColumns;
+                    } );
+    return lineRows;
+}
+
+LinesCount WrappedRowIndex::blockLines( uint64_t blockIndex ) const
+{
+    const auto blockStart = blockIndex * BlockSize;
+    return nbLines_.get() > blockStart
+               ? LinesCount( std::min( BlockSize, nbLines_.get() - blockStart ) )
+               : 0_lcount;
+}
+
+void WrappedRowIndex::setBlockRows( uint64_t blockIndex, uint64_t rows, bool isExact )
+{
+    // Unsigned arithmetic wraps around, so a smaller count is added as well
+    const auto delta = rows - blockRows_[ blockIndex ];
+    for ( auto position = blockIndex + 1; position <= tree_.size();
+          position += lowestBit( position ) ) {
+        tree_[ position - 1 ] += delta;
+    }
+
+    blockRows_[ blockIndex ] = rows;
+    isBlockExact_[ blockIndex ] = isExact;
+    if ( !isExact ) {
+        firstInexactBlock_ = std::min( firstInexactBlock_, blockIndex );
+    }
+}
+
+void WrappedRowIndex::appendBlock( uint64_t rows )
+{
+    // A node covers the blocks since the one after its lowest bit is cleared
+    const auto position = tree_.size() + 1;
+    const auto node
+        = rows + rowsBefore( position - 1 ) - rowsBefore( position - lowestBit( position ) );
+
+    tree_.push_back( node );
+    blockRows_.push_back( rows );
+    isBlockExact_.push_back( false );
+    firstInexactBlock_
+        = std::min( firstInexactBlock_, static_cast<uint64_t>( blockRows_.size() - 1 ) );
+}
+
+uint64_t WrappedRowIndex::rowsBefore( uint64_t blockIndex ) const
+{
+    uint64_t rows = 0;
+    for ( auto position = blockIndex; position > 0; position -= lowestBit( position ) ) {
+        rows += tree_[ position - 1 ];
+    }
+    return rows;
+}
+
+WrappedRowIndex::LineRows WrappedRowIndex::findRecentBlock( uint64_t blockIndex )
+{
+    const auto block = std::find_if(
+        recentBlocks_.begin(), recentBlocks_.end(),
+        [ blockIndex ]( const auto& recent ) { return recent.first == blockIndex; } );
+    if ( block == recentBlocks_.end() ) {
+        return {};
+    }
+
+    recentBlocks_.splice( recentBlocks_.begin(), recentBlocks_, block );
+    return block->second;
+}
+
+void WrappedRowIndex::addRecentBlock( uint64_t blockIndex, LineRows rows )
+{
+    recentBlocks_.remove_if(
+        [ blockIndex ]( const auto& recent ) { return recent.first == blockIndex; } );
+    recentBlocks_.emplace_front( blockIndex, std::move( rows ) );
+    if ( recentBlocks_.size() > MaxRecentBlocks ) {
+        recentBlocks_.pop_back();
+    }
+}
+
+void WrappedRowIndex::startCounting()
+{
+    // A filtered view changes its lines on the GUI thread, only data
+    // holding its own text is read from the counting thread. Blocks of
+    // other data are counted when the view asks for them.
+    if ( logData_->getSourceData() != logData_ ) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( mutex_ );
+    if ( isCounting_ || firstInexactBlock_ >= blockRows_.size() ) {
+        return;
+    }
+
+    isCounting_ = true;
+    const auto generation = generation_.load();
+    countTasks_.run( [ this, generation ] { countInBackground( generation ); } );
+}
+
+void WrappedRowIndex::countInBackground( uint64_t generation )
+{
+    LOG_DEBUG << "Counting wrapped rows in the background";
+
+    for ( uint64_t countedBlocks = 1;; ++countedBlocks ) {
+        uint64_t blockIndex = 0;
+        LinesCount nbLines;
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            while ( firstInexactBlock_ < blockRows_.size()
+                    && isBlockExact_[ firstInexactBlock_ ] ) {
+                ++firstInexactBlock_;
+            }
+
+            if ( generation != generation_ ) {
+                isCounting_ = false;
+                return;
+            }
+            else if ( firstInexactBlock_ >= blockRows_.size() ) {
+                isCounting_ = false;
+                break;
+            }
+
+            blockIndex = firstInexactBlock_;
+            nbLines = blockLines( blockIndex );
+        }
+
+        const auto lineRows = countLineRows( blockIndex, nbLines );
+
+        {
+            std::lock_guard<std::mutex> lock( mutex_ );
+            if ( generation != generation_ ) {
+                isCounting_ = false;
+                return;
+            }
+
+            // Lines added to the block meanwhile are counted on the next pass
+            if ( nbLines == blockLines( blockIndex ) ) {
+                setBlockRows( blockIndex,
+                              std::accumulate( lineRows.begin(), lineRows.end(), uint64_t{ 0 } ),
+                              true );
+            }
+        }
+
+        if ( countedBlocks % BlocksPerNotification == 0 ) {
+            Q_EMIT rowsChanged();
+        }
+    }
+
+    Q_EMIT rowsChanged();
+}
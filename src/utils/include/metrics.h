@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_METRICS_H
+#define KLOGG_METRICS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <QJsonObject>
+#include <QString>
+
+#include "synchronization.h"
+
+// Process wide registry of performance counters, gauges and latency
+// histograms. It is always on, so that performance problems can be looked
+// at in the metrics panel or in a dump made with --dump-metrics without
+// turning on debug logging.
+//
+// Metrics are created on first use and never destroyed, call sites keep
+// references to them in function local statics:
+//
+//     static auto& readLatency = Metrics::get().histogram( "logdata.read_lines_us" );
+//     const auto timer = readLatency.startTimer();
+//
+// Updating a metric takes no locks. Counters are split into cache line
+// sized shards picked by the calling thread. Readers sum up the shards and
+// may see values a bit behind the writers.
+class Metrics {
+  public:
+    class Counter {
+      public:
+        void add( uint64_t value = 1 );
+        uint64_t value() const;
+
+      private:
+        static constexpr size_t Shards = 16;
+
+        struct alignas( 64 ) Shard {
+            std::atomic<uint64_t> value{ 0 };
+        };
+
+        std::array<Shard, Shards> shards_;
+    };
+
+    class Gauge {
+      public:
+        void set( int64_t value )
+        {
+            value_.store( value, std::memory_order_relaxed );
+        }
+
+        void add( int64_t delta )
+        {
+            value_.fetch_add( delta, std::memory_order_relaxed );
+        }
+
+        int64_t value() const
+        {
+            return value_.load( std::memory_order_relaxed );
+        }
+
+      private:
+        std::atomic<int64_t> value_{ 0 };
+    };
+
+    // Log-linear histogram in the spirit of HdrHistogram: each power of two
+    // range is split into SubBuckets buckets, so recorded values keep
+    // 3 significant bits (relative error below 12.5%) over the whole
+    // uint64_t range in a fixed 4 KiB table.
+    class Histogram {
+      public:
+        static constexpr int SubBucketBits = 3;
+        static constexpr size_t SubBuckets = size_t{ 1 } << SubBucketBits;
+        static constexpr size_t BucketsCount = ( 64 - SubBucketBits + 1 ) * SubBuckets;
+
+        struct Snapshot {
+            uint64_t count = 0;
+            uint64_t sum = 0;
+            uint64_t max = 0;
+            std::array<uint64_t, BucketsCount> buckets{};
+
+            // Highest value of the bucket holding the given percentile
+            uint64_t percentile( double percent ) const;
+            double mean() const;
+        };
+
+        // Records microseconds elapsed until destroyed
+        class Timer {
+          public:
+            explicit Timer( Histogram& histogram )
+                : histogram_{ &histogram }
+                , startTime_{ std::chrono::steady_clock::now() }
+            {
+            }
+
+            Timer( Timer&& other ) noexcept
+                : histogram_{ other.histogram_ }
+                , startTime_{ other.startTime_ }
+            {
+                other.histogram_ = nullptr;
+            }
+
+            Timer( const Timer& ) = delete;
+            Timer& operator=( const Timer& ) = delete;
+            Timer& operator=( Timer&& ) = delete;
+
+            ~Timer()
+            {
+                if ( histogram_ ) {
+                    histogram_->record( std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - startTime_ ) );
+                }
+            }
+
+          private:
+            Histogram* histogram_;
+            std::chrono::steady_clock::time_point startTime_;
+        };
+
+        void record( uint64_t value );
+
+        void record( std::chrono::microseconds duration )
+        {
+            record( static_cast<uint64_t>( std::max( std::chrono::microseconds::rep{ 0 },
+                                                     duration.count() ) ) );
+        }
+
+        Timer startTimer()
+        {
+            return Timer{ *this };
+        }
+
+        Snapshot snapshot() const;
+
+        static size_t bucketIndex( uint64_t value );
+        static uint64_t bucketHighestValue( size_t index );
+
+      private:
+        std::array<std::atomic<uint64_t>, BucketsCount> buckets_{};
+        std::atomic<uint64_t> count_{ 0 };
+        std::atomic<uint64_t> sum_{ 0 };
+        std::atomic<uint64_t> max_{ 0 };
+    };
+
+    static Metrics& get();
+
+    Metrics( const Metrics& ) = delete;
+    Metrics& operator=( const Metrics& ) = delete;
+    Metrics( Metrics&& ) = delete;
+    Metrics& operator=( Metrics&& ) = delete;
+    ~Metrics() = default;
+
+    Counter& counter( const std::string& name );
+    Gauge& gauge( const std::string& name );
+    Histogram& histogram( const std::string& name );
+
+    std::map<std::string, uint64_t> counters() const;
+    std::map<std::string, int64_t> gauges() const;
+    std::map<std::string, Histogram::Snapshot> histograms() const;
+
+    std::chrono::milliseconds uptime() const;
+
+    // Histogram values are in the units given by the metric name suffix
+    QJsonObject toJson() const;
+    bool dumpToFile( const QString& fileName ) const;
+
+  private:
+    Metrics();
+
+  private:
+    const std::chrono::steady_clock::time_point startTime_;
+
+    mutable SharedMutex mutex_;
+    std::map<std::string, std::unique_ptr<Counter>> counters_;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+};
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KLOGG_TRACING_H
+#define KLOGG_TRACING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <QString>
+
+// Timeline of what klogg threads do, recorded when started with
+// --trace <file> and written on exit in Chrome trace event format.
+// Open it in chrome://tracing or https://ui.perfetto.dev.
+//
+// Code is instrumented with KLOGG_TRACE_SCOPE, which records the enclosing
+// scope as one event. Builds without KLOGG_USE_TRACING compile the macros
+// out, otherwise a scope costs one relaxed atomic load while not recording.
+// Categories, names and argument names must be string literals.
+class Tracer {
+  public:
+    static Tracer& get();
+
+    Tracer( const Tracer& ) = delete;
+    Tracer& operator=( const Tracer& ) = delete;
+    Tracer( Tracer&& ) = delete;
+    Tracer& operator=( Tracer&& ) = delete;
+    ~Tracer() = default;
+
+    void start( const QString& fileName );
+
+    // Stops recording and writes the trace file
+    bool stop();
+
+    bool isRecording() const
+    {
+        return isRecording_.load( std::memory_order_relaxed );
+    }
+
+    void addEvent( const char* category, const char* name,
+                   std::chrono::steady_clock::time_point startTime,
+                   std::chrono::steady_clock::time_point endTime, const char* argName,
+                   int64_t argValue );
+
+  private:
+    Tracer() = default;
+
+    struct Event {
+        const char* category;
+        const char* name;
+        const char* argName;
+        int64_t argValue;
+        std::chrono::steady_clock::time_point startTime;
+        std::chrono::steady_clock::time_point endTime;
+    };
+
+    // Each thread appends to its own buffer, the lock is only contended
+    // while the trace is written
+    struct ThreadBuffer {
+        uint32_t threadId;
+        std::string threadName;
+        std::mutex mutex;
+        std::vector<Event> events;
+        uint64_t droppedEvents = 0;
+    };
+
+    ThreadBuffer& currentThreadBuffer();
+
+  private:
+    std::atomic<bool> isRecording_{ false };
+
+    std::mutex mutex_;
+    QString fileName_;
+    std::chrono::steady_clock::time_point startTime_;
+    std::vector<std::shared_ptr<ThreadBuffer>> threadBuffers_;
+};
+
+class TraceScope {
+  public:
+    TraceScope( const char* category, const char* name, const char* argName = nullptr,
+                int64_t argValue = 0 )
+        : isRecording_{ Tracer::get().isRecording() }
+        , category_{ category }
+        , name_{ name }
+        , argName_{ argName }
+        , argValue_{ argValue }
+    {
+        if ( isRecording_ ) {
+            startTime_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if ( isRecording_ ) {
+            Tracer::get().addEvent( category_, name_, startTime_,
+                                    std::chrono::steady_clock::now(), argName_, argValue_ );
+        }
+    }
+
+    TraceScope( const TraceScope& ) = delete;
+    TraceScope& operator=( const TraceScope& ) = delete;
+    TraceScope( TraceScope&& ) = delete;
+    TraceScope& operator=( TraceScope&& ) = delete;
+
+  private:
+    const bool isRecording_;
+    const char* const category_;
+    const char* const name_;
+    const char* const argName_;
+    const int64_t argValue_;
+    std::chrono::steady_clock::time_point startTime_;
+};
+
+#ifdef KLOGG_USE_TRACING
+#define KLOGG_TRACE_CONCAT_IMPL( a, b ) a##b
+#define KLOGG_TRACE_CONCAT( a, b ) KLOGG_TRACE_CONCAT_IMPL( a, b )
+#define KLOGG_TRACE_SCOPE( category, name )                                                     \
+    const TraceScope KLOGG_TRACE_CONCAT( traceScope, __LINE__ )( category, name )
+#define KLOGG_TRACE_SCOPE_ARG( category, name, argName, argValue )                              \
+    const TraceScope KLOGG_TRACE_CONCAT( traceScope, __LINE__ )(                                \
+        category, name, argName, static_cast<int64_t>( argValue ) )
+#else
+#define KLOGG_TRACE_SCOPE( category, name ) static_cast<void>( 0 )
+#define KLOGG_TRACE_SCOPE_ARG( category, name, argName, argValue ) static_cast<void>( 0 )
+#endif
+
+#endif
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metrics.h"
+
+#include <cmath>
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QtAlgorithms>
+
+#include "log.h"
+
+namespace {
+
+// Threads are spread over counter shards in order of their first update
+size_t currentThreadShard()
+{
+    static std::atomic<size_t> nextShard{ 0 };
+    thread_local const size_t shard = nextShard.fetch_add( 1, std::memory_order_relaxed );
+    return shard;
+}
+
+template <typename Metric>
+Metric& findOrCreate( SharedMutex& mutex, std::map<std::string, std::unique_ptr<Metric>>& metrics,
+                      const std::string& name )
+{
+    {
+        SharedLock lock( mutex );
+        const auto metric = metrics.find( name );
+        if ( metric != metrics.end() ) {
+            return *metric->second;
+        }
+    }
+
+    UniqueLock lock( mutex );
+    auto& metric = metrics[ name ];
+    if ( !metric ) {
+        metric = std::make_unique<Metric>();
+    }
+    return *metric;
+}
+
+QJsonValue toJsonValue( uint64_t value )
+{
+    return QJsonValue( static_cast<qint64>( value ) );
+}
+
+} // namespace
+
+void Metrics::Counter::add( uint64_t value )
+{
+    shards_[ currentThreadShard() % Shards ].value.fetch_add( value, std::memory_order_relaxed );
+}
+
+uint64_t Metrics::Counter::value() const
+{
+    uint64_t total = 0;
+    for ( const auto& shard : shards_ ) {
+        total += shard.value.load( std::memory_order_relaxed );
+    }
+    return total;
+}
+
+size_t Metrics::Histogram::bucketIndex( uint64_t value )
+{
+    if ( value < 2 * SubBuckets ) {
+        return static_cast<size_t>( value );
+    }
+
+    const auto highestBit = 63 - static_cast<int>( qCountLeadingZeroBits( quint64{ value } ) );
+    const auto shift = highestBit - SubBucketBits;
+    return static_cast<size_t>( shift + 1 ) * SubBuckets
+           + static_cast<size_t>( ( value >> shift ) - SubBuckets );
+}
+
+uint64_t Metrics::Histogram::bucketHighestValue( size_t index )
+{
+    if ( index < 2 * SubBuckets ) {
+        return static_cast<uint64_t>( index );
+    }
+
+    const auto shift = index / SubBuckets - 1;
+    const auto lowestValue = static_cast<uint64_t>( SubBuckets + index % SubBuckets ) << shift;
+    return lowestValue + ( ( uint64_t{ 1 } << shift ) - 1 );
+}
+
+void Metrics::Histogram::record( uint64_t value )
+{
+    buckets_[ bucketIndex( value ) ].fetch_add( 1, std::memory_order_relaxed );
+    count_.fetch_add( 1, std::memory_order_relaxed );
+    sum_.fetch_add( value, std::memory_order_relaxed );
+
+    auto currentMax = max_.load( std::memory_order_relaxed );
+    while ( currentMax < value
+            && !max_.compare_exchange_weak( currentMax, value, std::memory_order_relaxed ) ) {
+    }
+}
+
+Metrics::Histogram::Snapshot Metrics::Histogram::snapshot() const
+{
+    Snapshot snapshot;
+    for ( auto index = 0u; index < BucketsCount; ++index ) {
+        snapshot.buckets[ index ] = buckets_[ index ].load( std::memory_order_relaxed );
+        snapshot.count += snapshot.buckets[ index ];
+    }
+    snapshot.sum = sum_.load( std::memory_order_relaxed );
+    snapshot.max = max_.load( std::memory_order_relaxed );
+    return snapshot;
+}
+
+uint64_t Metrics::Histogram::Snapshot::percentile( double percent ) const
+{
+    if ( count == 0 ) {
+        return 0;
+    }
+
+    const auto rank = std::max(
+        uint64_t{ 1 },
+        static_cast<uint64_t>( std::ceil( percent / 100.0 * static_cast<double>( count ) ) ) );
+
+    uint64_t seenValues = 0;
+    for ( auto index = 0u; index < BucketsCount; ++index ) {
+        seenValues += buckets[ index ];
+        if ( seenValues >= rank ) {
+            return std::min( bucketHighestValue( index ), max );
+        }
+    }
+
+    return max;
+}
+
+double Metrics::Histogram::Snapshot::mean() const
+{
+    return count > 0 ? static_cast<double>( sum ) / static_cast<double>( count ) : 0.0;
+}
+
+Metrics& Metrics::get()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics()
+    : startTime_{ std::chrono::steady_clock::now() }
+{
+}
+
+Metrics::Counter& Metrics::counter( const std::string& name )
+{
+    return findOrCreate( mutex_, counters_, name );
+}
+
+Metrics::Gauge& Metrics::gauge( const std::string& name )
+{
+    return findOrCreate( mutex_, gauges_, name );
+}
+
+Metrics::Histogram& Metrics::histogram( const std::string& name )
+{
+    return findOrCreate( mutex_, histograms_, name );
+}
+
+std::map<std::string, uint64_t> Metrics::counters() const
+{
+    SharedLock lock( mutex_ );
+    std::map<std::string, uint64_t> values;
+    for ( const auto& counter : counters_ ) {
+        values.emplace( counter.first, counter.second->value() );
+    }
+    return values;
+}
+
+std::map<std::string, int64_t> Metrics::gauges() const
+{
+    SharedLock lock( mutex_ );
+    std::map<std::string, int64_t> values;
+    for ( const auto& gauge : gauges_ ) {
+        values.emplace( gauge.first, gauge.second->value() );
+    }
+    return values;
+}
+
+std::map<std::string, Metrics::Histogram::Snapshot> Metrics::histograms() const
+{
+    SharedLock lock( mutex_ );
+    std::map<std::string, Histogram::Snapshot> values;
+    for ( const auto& histogram : histograms_ ) {
+        values.emplace( histogram.first, histogram.second->snapshot() );
+    }
+    return values;
+}
+
+std::chrono::milliseconds Metrics::uptime() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now()
+                                                                  - startTime_ );
+}
+
+QJsonObject Metrics::toJson() const
+{
+    QJsonObject counters;
+    for ( const auto& counter : this->counters() ) {
+        counters.insert( QString::fromStdString( counter.first ), toJsonValue( counter.second ) );
+    }
+
+    QJsonObject gauges;
+    for ( const auto& gauge : this->gauges() ) {
+        gauges.insert( QString::fromStdString( gauge.first ),
+                       QJsonValue( static_cast<qint64>( gauge.second ) ) );
+    }
+
+    QJsonObject histograms;
+    for ( const auto& histogram : this->histograms() ) {
+        const auto& snapshot = histogram.second;
+        QJsonObject values;
+        values.insert( "count", toJsonValue( snapshot.count ) );
+        values.insert( "sum", toJsonValue( snapshot.sum ) );
+        values.insert( "mean", snapshot.mean() );
+        values.insert( "p50", toJsonValue( snapshot.percentile( 50 ) ) );
+        values.insert( "p90", toJsonValue( snapshot.percentile( 90 ) ) );
+        values.insert( "p99", toJsonValue( snapshot.percentile( 99 ) ) );
+        values.insert( "max", toJsonValue( snapshot.max ) );
+        histograms.insert( QString::fromStdString( histogram.first ), values );
+    }
+
+    QJsonObject metrics;
+    metrics.insert( "uptime_ms", static_cast<qint64>( uptime().count() ) );
+    metrics.insert( "counters", counters );
+    metrics.insert( "gauges", gauges );
+    metrics.insert( "histograms", histograms );
+    return metrics;
+}
+
+bool Metrics::dumpToFile( const QString& fileName ) const
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG_ERROR << "Can't write metrics to " << fileName << ": " << file.errorString();
+        return false;
+    }
+
+    file.write( QJsonDocument( toJson() ).toJson() );
+    LOG_INFO << "Metrics written to " << fileName;
+    return true;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tracing.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QThread>
+
+#include "log.h"
+
+namespace {
+// Caps memory used by events of a busy thread at about 48 MiB
+constexpr size_t MaxEventsPerThread = 1024 * 1024;
+
+constexpr int FlushThreshold = 1024 * 1024;
+
+QByteArray escapeJson( const std::string& text )
+{
+    QByteArray escaped;
+    escaped.reserve( static_cast<int>( text.size() ) );
+    for ( const auto c : text ) {
+        if ( c == '"' || c == '\\' ) {
+            escaped.append( '\\' );
+            escaped.append( c );
+        }
+        else if ( static_cast<unsigned char>( c ) < 0x20 ) {
+            escaped.append( ' ' );
+        }
+        else {
+            escaped.append( c );
+        }
+    }
+    return escaped;
+}
+
+QByteArray microseconds( std::chrono::steady_clock::duration duration )
+{
+    const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>( duration );
+    return QByteArray::number( static_cast<double>( nanoseconds.count() ) / 1000.0, 'f', 3 );
+}
+} // namespace
+
+Tracer& Tracer::get()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::start( const QString& fileName )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    if ( isRecording() ) {
+        return;
+    }
+
+#ifndef KLOGG_USE_TRACING
+    LOG_WARNING << "klogg is built without tracing, trace will only have thread names";
+#endif
+
+    LOG_INFO << "Recording trace to " << fileName;
+    fileName_ = fileName;
+    startTime_ = std::chrono::steady_clock::now();
+    isRecording_.store( true, std::memory_order_relaxed );
+}
+
+Tracer::ThreadBuffer& Tracer::currentThreadBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+    if ( !threadBuffer ) {
+        threadBuffer = std::make_shared<ThreadBuffer>();
+
+        const auto currentThread = QThread::currentThread();
+        auto threadName = currentThread->objectName();
+        if ( QCoreApplication::instance()
+             && currentThread == QCoreApplication::instance()->thread() ) {
+            threadName = "main";
+        }
+
+        std::lock_guard<std::mutex> lock( mutex_ );
+        threadBuffer->threadId = static_cast<uint32_t>( threadBuffers_.size() + 1 );
+        threadBuffer->threadName
+            = ( threadName.isEmpty() ? QString( "thread %1" ).arg( threadBuffer->threadId )
+                                     : threadName )
+                  .toStdString();
+        threadBuffers_.push_back( threadBuffer );
+    }
+    return *threadBuffer;
+}
+
+void Tracer::addEvent( const char* category, const char* name,
+                       std::chrono::steady_clock::time_point startTime,
+                       std::chrono::steady_clock::time_point endTime, const char* argName,
+                       int64_t argValue )
+{
+    auto& threadBuffer = currentThreadBuffer();
+
+    std::lock_guard<std::mutex> lock( threadBuffer.mutex );
+    if ( threadBuffer.events.size() >= MaxEventsPerThread ) {
+        ++threadBuffer.droppedEvents;
+        return;
+    }
+
+    threadBuffer.events.push_back( { category, name, argName, argValue, startTime, endTime } );
+}
+
+bool Tracer::stop()
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    if ( !isRecording() ) {
+        return false;
+    }
+    isRecording_.store( false, std::memory_order_relaxed );
+
+    QFile file( fileName_ );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        LOG_ERROR << "Can't write trace to " << fileName_ << ": " << file.errorString();
+        return false;
+    }
+
+    const auto processId = QByteArray::number( QCoreApplication::applicationPid() );
+
+    QByteArray buffer;
+    buffer.append( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+
+    auto isFirstEvent = true;
+    const auto startEvent = [ &buffer, &isFirstEvent ]() {
+        buffer.append( isFirstEvent ? "\n" : ",\n" );
+        isFirstEvent = false;
+    };
+
+    uint64_t eventsCount = 0;
+    uint64_t droppedEvents = 0;
+    for ( const auto& threadBuffer : threadBuffers_ ) {
+        std::lock_guard<std::mutex> threadLock( threadBuffer->mutex );
+        const auto threadId = QByteArray::number( threadBuffer->threadId );
+
+        startEvent();
+        buffer.append( "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + processId
+                       + ",\"tid\":" + threadId + ",\"args\":{\"name\":\""
+                       + escapeJson( threadBuffer->threadName ) + "\"}}" );
+
+        for ( const auto& event : threadBuffer->events ) {
+            startEvent();
+            buffer.append( "{\"cat\":\"" );
+            buffer.append( event.category );
+            buffer.append( "\",\"name\":\"" );
+            buffer.append( event.name );
+            buffer.append( "\",\"ph\":\"X\",\"pid\":" + processId + ",\"tid\":" + threadId );
+            buffer.append( ",\"ts\":" + microseconds( event.startTime - startTime_ ) );
+            buffer.append( ",\"dur\":" + microseconds( event.endTime - event.startTime ) );
+            if ( event.argName ) {
+                buffer.append( ",\"args\":{\"" );
+                buffer.append( event.argName );
+                buffer.append( "\":" + QByteArray::number( static_cast<qint64>( event.argValue ) )
+                               + "}" );
+            }
+            buffer.append( "}" );
+
+            if ( buffer.size() > FlushThreshold ) {
+                file.write( buffer );
+                buffer.clear();
+            }
+        }
+
+        eventsCount += threadBuffer->events.size();
+        droppedEvents += threadBuffer->droppedEvents;
+        threadBuffer->events.clear();
+        threadBuffer->events.shrink_to_fit();
+        threadBuffer->droppedEvents = 0;
+    }
+
+    buffer.append( "\n]}\n" );
+    file.write( buffer );
+
+    LOG_INFO << "Trace written to " << fileName_ << ", " << eventsCount << " events, "
+             << droppedEvents << " dropped";
+    return file.error() == QFileDevice::NoError;
+}
@@ -78,7 +78,6 @@ int main( int argc, char* argv[] )
     qRegisterMetaType<LineLength>( "LineLength" );
 
     auto& config = Configuration::getSynced();
-    config.setSearchReadBufferSizeLines( 10 );
     config.setIndexReadBufferSizeMb( 1 );
     config.setUseSearchResultsCache( false );
 
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "booleansearchplan.h"
+#include "regularexpression.h"
+
+namespace {
+
+// Lines with every combination of the three words, lines with none of
+// them are the longest ones
+std::vector<std::string> makeLines()
+{
+    const std::vector<std::string> words = { "alpha", "beta", "gamma" };
+
+    std::vector<std::string> lines;
+    for ( auto index = 0u; index < 40; ++index ) {
+        const auto wordsMask = index % 8;
+        std::string line = "line " + std::to_string( index );
+        for ( auto word = 0u; word < words.size(); ++word ) {
+            if ( wordsMask & ( 1u << word ) ) {
+                line += " " + words[ word ];
+            }
+        }
+        if ( wordsMask == 0 ) {
+            line += std::string( 50 + index, '.' );
+        }
+        lines.push_back( std::move( line ) );
+    }
+    return lines;
+}
+
+LineLength lineLength( const std::string& line )
+{
+    return LineLength( static_cast<LineLength::UnderlyingType>( line.size() ) );
+}
+
+SubPatternResults searchLines( const std::vector<std::string>& lines,
+                               const RegularExpressionPattern& pattern, LineNumber startLine,
+                               LineNumber endLine )
+{
+    RegularExpression expression( pattern );
+    const auto matcher = expression.createMatcher();
+
+    SubPatternResults results{ {}, 0_length };
+    for ( auto line = startLine; line < endLine; ++line ) {
+        if ( matcher->hasMatch( lines[ line.get() ] ) ) {
+            results.matchingLines.add( line.get() );
+            results.maxLength = qMax( results.maxLength, lineLength( lines[ line.get() ] ) );
+        }
+    }
+    return results;
+}
+
+RegularExpressionPattern booleanPattern( const QString& expression, bool inverse = false )
+{
+    return RegularExpressionPattern( expression, true, inverse, true, true );
+}
+
+} // namespace
+
+SCENARIO( "Boolean search plan gives the results of a line by line search",
+          "[booleansearchplan]" )
+{
+    const auto lines = makeLines();
+    const auto startLine = 3_lnum;
+    const auto endLine = 37_lnum;
+
+    LineLength maxLineLength = 0_length;
+    for ( auto line = startLine; line < endLine; ++line ) {
+        maxLineLength = qMax( maxLineLength, lineLength( lines[ line.get() ] ) );
+    }
+
+    const auto cachedLookup = [ & ]( const RegularExpressionPattern& subPattern ) {
+        return std::make_optional( searchLines( lines, subPattern, startLine, endLine ) );
+    };
+
+    const auto pattern = GENERATE( booleanPattern( "\"alpha\" & \"beta\"" ),
+                                   booleanPattern( "\"alpha\" | \"gamma\"" ),
+                                   booleanPattern( "!(\"beta\")" ),
+                                   booleanPattern( "\"alpha\" & !(\"gamma\" | \"beta\")" ),
+                                   booleanPattern( "\"alpha\" | \"beta\"", true ) );
+
+    const auto expected = searchLines( lines, pattern, startLine, endLine );
+
+    GIVEN( "Cached results of all sub-patterns" )
+    {
+        const BooleanSearchPlan plan( pattern, cachedLookup );
+        REQUIRE( plan.isValid() );
+        REQUIRE( plan.isComplete() );
+
+        WHEN( "Combining the sub-pattern results" )
+        {
+            const auto combined = plan.combine( startLine, endLine, maxLineLength );
+
+            THEN( "The same lines match" )
+            {
+                REQUIRE( combined.matchingLines == expected.matchingLines );
+            }
+
+            THEN( "The max length covers the matching lines" )
+            {
+                REQUIRE( combined.maxLength >= expected.maxLength );
+                REQUIRE( combined.maxLength <= maxLineLength );
+            }
+        }
+
+        WHEN( "Matching line by line" )
+        {
+            const auto matcher = plan.createLineMatcher();
+
+            THEN( "The same lines match and no sub-pattern is matched" )
+            {
+                MatchedPatterns missingMatches;
+                for ( auto line = startLine; line < endLine; ++line ) {
+                    REQUIRE( matcher->hasMatch( lines[ line.get() ], line, missingMatches )
+                             == expected.matchingLines.contains( line.get() ) );
+                    REQUIRE( missingMatches.empty() );
+                }
+            }
+        }
+    }
+
+    GIVEN( "Cached results of some sub-patterns only" )
+    {
+        const BooleanSearchPlan plan(
+            pattern,
+            [ & ]( const RegularExpressionPattern& subPattern )
+                -> std::optional<SubPatternResults> {
+                if ( subPattern.pattern == "beta" ) {
+                    return {};
+                }
+                return cachedLookup( subPattern );
+            } );
+        REQUIRE( plan.isValid() );
+
+        const auto& subPatterns = plan.subPatterns();
+        const auto& missing = plan.missingSubPatterns();
+        REQUIRE( missing.size()
+                 == static_cast<size_t>( std::count_if(
+                     subPatterns.begin(), subPatterns.end(),
+                     []( const auto& subPattern ) { return subPattern.pattern == "beta"; } ) ) );
+
+        WHEN( "Matching line by line" )
+        {
+            const auto matcher = plan.createLineMatcher();
+
+            THEN( "The same lines match and missing sub-patterns are reported" )
+            {
+                MatchedPatterns missingMatches;
+                for ( auto line = startLine; line < endLine; ++line ) {
+                    const auto& text = lines[ line.get() ];
+                    REQUIRE( matcher->hasMatch( text, line, missingMatches )
+                             == expected.matchingLines.contains( line.get() ) );
+
+                    REQUIRE( missingMatches.size() == missing.size() );
+                    for ( auto index = 0u; index < missing.size(); ++index ) {
+                        REQUIRE( static_cast<bool>( missingMatches[ index ] )
+                                 == ( text.find( "beta" ) != std::string::npos ) );
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "Boolean search plan max length of lines matching no sub-pattern",
+          "[booleansearchplan]" )
+{
+    const auto lines = makeLines();
+    const auto startLine = 0_lnum;
+    const auto endLine = LineNumber( lines.size() );
+
+    LineLength maxLineLength = 0_length;
+    for ( const auto& line : lines ) {
+        maxLineLength = qMax( maxLineLength, lineLength( line ) );
+    }
+
+    const auto cachedLookup = [ & ]( const RegularExpressionPattern& subPattern ) {
+        return std::make_optional( searchLines( lines, subPattern, startLine, endLine ) );
+    };
+
+    GIVEN( "A negation matching the lines without any of the words" )
+    {
+        const auto pattern = booleanPattern( "!(\"alpha\" | \"beta\" | \"gamma\")" );
+        const BooleanSearchPlan plan( pattern, cachedLookup );
+        const auto combined = plan.combine( startLine, endLine, maxLineLength );
+
+        THEN( "The max length of all lines is used" )
+        {
+            REQUIRE( combined.matchingLines
+                     == searchLines( lines, pattern, startLine, endLine ).matchingLines );
+            REQUIRE( combined.maxLength == maxLineLength );
+        }
+    }
+
+    GIVEN( "A combination matching only lines with one of the words" )
+    {
+        const auto pattern = booleanPattern( "\"alpha\" | \"beta\"" );
+        const BooleanSearchPlan plan( pattern, cachedLookup );
+        const auto combined = plan.combine( startLine, endLine, maxLineLength );
+
+        THEN( "The max length of the sub-patterns is used" )
+        {
+            const auto expected = searchLines( lines, pattern, startLine, endLine );
+            REQUIRE( combined.matchingLines == expected.matchingLines );
+            REQUIRE( combined.maxLength == expected.maxLength );
+            REQUIRE( combined.maxLength < maxLineLength );
+        }
+    }
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <QByteArray>
+
+#include "encodingvalidator.h"
+#include "logdataworker.h"
+
+namespace {
+
+using Lines = std::vector<LinesCount::UnderlyingType>;
+
+EncodingParameters utf8Parameters()
+{
+    EncodingParameters parameters;
+    parameters.isUtf8Compatible = true;
+    return parameters;
+}
+
+EncodingParameters utf16LEParameters()
+{
+    EncodingParameters parameters;
+    parameters.isUtf16LE = true;
+    parameters.lineFeedWidth = 2;
+    return parameters;
+}
+
+// Validates text in blocks ending at the passed offsets, lines end after
+// each line feed like the indexing worker finds them
+std::vector<EncodingValidator::BlockResult> validate( const EncodingParameters& parameters,
+                                                      const QByteArray& text,
+                                                      std::vector<int> blockEnds )
+{
+    const auto lineFeedWidth = parameters.lineFeedWidth;
+
+    std::vector<int> lineEnds;
+    for ( auto i = 0; i + lineFeedWidth <= text.size(); i += lineFeedWidth ) {
+        if ( text[ i ] == '\n' && ( lineFeedWidth == 1 || text[ i + 1 ] == '\0' ) ) {
+            lineEnds.push_back( i + lineFeedWidth );
+        }
+    }
+
+    blockEnds.push_back( text.size() );
+
+    EncodingValidator validator( parameters );
+    std::vector<EncodingValidator::BlockResult> results;
+
+    auto blockBeginning = 0;
+    auto firstLineStart = 0;
+    for ( const auto blockEnd : blockEnds ) {
+        FastLinePositionArray blockLineEnds;
+        auto lastLineEnd = firstLineStart;
+        for ( const auto lineEnd : lineEnds ) {
+            if ( lineEnd > blockBeginning && lineEnd <= blockEnd ) {
+                blockLineEnds.append( LineOffset( lineEnd ) );
+                lastLineEnd = lineEnd;
+            }
+        }
+
+        results.push_back( validator.validateBlock(
+            blockBeginning, text.mid( blockBeginning, blockEnd - blockBeginning ),
+            firstLineStart, blockLineEnds ) );
+
+        blockBeginning = blockEnd;
+        firstLineStart = lastLineEnd;
+    }
+
+    return results;
+}
+
+bool allValid( const std::vector<EncodingValidator::BlockResult>& results )
+{
+    return std::all_of( results.begin(), results.end(), []( const auto& result ) {
+        return result.isValid && result.invalidLines.empty();
+    } );
+}
+
+// Lays out code points as UTF-16 (BMP only) or UTF-32 code units
+QByteArray encodeUnits( const std::vector<uint32_t>& codePoints, int unitSize, bool isBigEndian )
+{
+    QByteArray bytes;
+    for ( const auto codePoint : codePoints ) {
+        for ( auto i = 0; i < unitSize; ++i ) {
+            const auto shift = 8 * ( isBigEndian ? unitSize - 1 - i : i );
+            bytes.append( static_cast<char>( ( codePoint >> shift ) & 0xFF ) );
+        }
+    }
+    return bytes;
+}
+
+// Spaces the indexing worker adds for the tabs of a line starting the block,
+// columns are counted in bytes as the worker does
+LineLength::UnderlyingType expectedTabSpaces( const std::vector<uint32_t>& codePoints,
+                                              int unitSize,
+                                              LineLength::UnderlyingType additionalSpaces )
+{
+    for ( auto unit = 0u; unit < codePoints.size(); ++unit ) {
+        if ( codePoints[ unit ] == '\t' ) {
+            const auto expandedSize = static_cast<int>( unit ) * unitSize + additionalSpaces;
+            additionalSpaces += TabStop - ( expandedSize % TabStop ) - 1;
+        }
+    }
+    return additionalSpaces;
+}
+
+LineLength::UnderlyingType expandWideTabs( const std::vector<uint32_t>& codePoints, int unitSize,
+                                           bool isBigEndian,
+                                           LineLength::UnderlyingType additionalSpaces )
+{
+    using namespace parse_data_block;
+
+    EncodingParameters parameters;
+    parameters.isUtf16LE = unitSize == 2 && !isBigEndian;
+    parameters.lineFeedWidth = unitSize;
+    parameters.lineFeedIndex = isBigEndian ? unitSize - 1 : 0;
+
+    const auto block = encodeUnits( codePoints, unitSize, isBigEndian );
+    const auto findNextDelimeter
+        = unitSize == 2 ? findNextWideDelimeter<uint16_t> : findNextWideDelimeter<uint32_t>;
+
+    return expandTabsInLine( block,
+                             std::string_view( block.data(), static_cast<size_t>( block.size() ) ),
+                             0, parameters, findNextDelimeter, additionalSpaces );
+}
+
+} // namespace
+
+SCENARIO( "Encoding validation of UTF-8 blocks", "[encodingvalidator]" )
+{
+    // 2, 3 and 4 bytes characters
+    const QByteArray text( "h\xC3\xA9llo\n\xE2\x82\xAC" "uro\n\xF0\x9F\x98\x80!\n" );
+
+    GIVEN( "A character split between two blocks" )
+    {
+        const auto split = GENERATE_COPY( range( 1, text.size() ) );
+
+        THEN( "The text is valid" )
+        {
+            REQUIRE( allValid( validate( utf8Parameters(), text, { split } ) ) );
+        }
+    }
+
+    GIVEN( "A character split in blocks of one byte" )
+    {
+        std::vector<int> blockEnds;
+        for ( auto i = 1; i < text.size(); ++i ) {
+            blockEnds.push_back( i );
+        }
+
+        THEN( "The text is valid" )
+        {
+            REQUIRE( allValid( validate( utf8Parameters(), text, blockEnds ) ) );
+        }
+    }
+
+    GIVEN( "A character not completed in the next block" )
+    {
+        const auto results
+            = validate( utf8Parameters(), QByteArray( "ok\n\xE2\x82" "a\nb\nc\xFF\nd\n" ), { 5 } );
+
+        THEN( "The line continued in the next block is invalid" )
+        {
+            REQUIRE( results.size() == 2u );
+            REQUIRE( results[ 0 ].isValid );
+            REQUIRE_FALSE( results[ 1 ].isValid );
+            REQUIRE( results[ 1 ].invalidLines == Lines{ 0, 2 } );
+        }
+    }
+
+    GIVEN( "Invalid sequences in a block" )
+    {
+        const QByteArray invalidText( "ok\nbad\xFF\nok\nbad\xFE" );
+
+        THEN( "Lines are numbered from the first line ending in the block" )
+        {
+            const auto results = validate( utf8Parameters(), invalidText, {} );
+            REQUIRE_FALSE( results[ 0 ].isValid );
+            REQUIRE( results[ 0 ].invalidLines == Lines{ 1, 3 } );
+        }
+
+        THEN( "A line started in the previous block is line 0" )
+        {
+            const auto results = validate( utf8Parameters(), invalidText, { 5 } );
+            REQUIRE( results[ 0 ].isValid );
+            REQUIRE( results[ 1 ].invalidLines == Lines{ 0, 2 } );
+        }
+    }
+}
+
+SCENARIO( "Encoding validation of UTF-16LE blocks", "[encodingvalidator]" )
+{
+    // a, U+1F600 as a surrogate pair, b and a line feed, twice
+    const QByteArray line( "a\0\x3D\xD8\x00\xDE" "b\0\n\0", 10 );
+    const QByteArray text = line + line;
+
+    GIVEN( "A surrogate pair or a code unit split between two blocks" )
+    {
+        const auto split = GENERATE_COPY( range( 1, text.size() ) );
+
+        THEN( "The text is valid" )
+        {
+            REQUIRE( allValid( validate( utf16LEParameters(), text, { split } ) ) );
+        }
+    }
+
+    GIVEN( "Blocks with an odd number of bytes" )
+    {
+        THEN( "The text is valid" )
+        {
+            REQUIRE( allValid( validate( utf16LEParameters(), text, { 1, 4, 7, 9, 15 } ) ) );
+        }
+    }
+
+    GIVEN( "A high surrogate not followed by a low one in the next block" )
+    {
+        const QByteArray invalidText( "a\0\x3D\xD8" "b\0\n\0c\0\n\0", 12 );
+        const auto results = validate( utf16LEParameters(), invalidText, { 4 } );
+
+        THEN( "The line continued in the next block is invalid" )
+        {
+            REQUIRE( results[ 0 ].isValid );
+            REQUIRE_FALSE( results[ 1 ].isValid );
+            REQUIRE( results[ 1 ].invalidLines == Lines{ 0 } );
+        }
+    }
+
+    GIVEN( "A lone low surrogate" )
+    {
+        const QByteArray invalidText( "a\0\n\0\x00\xDE\n\0", 8 );
+        const auto results = validate( utf16LEParameters(), invalidText, {} );
+
+        THEN( "Its line is invalid" )
+        {
+            REQUIRE_FALSE( results[ 0 ].isValid );
+            REQUIRE( results[ 0 ].invalidLines == Lines{ 1 } );
+        }
+    }
+}
+
+SCENARIO( "Encoding validation of other encodings", "[encodingvalidator]" )
+{
+    GIVEN( "A single byte encoding" )
+    {
+        EncodingValidator validator( EncodingParameters{} );
+
+        THEN( "Nothing is validated" )
+        {
+            REQUIRE_FALSE( validator.isEnabled() );
+            REQUIRE( allValid( validate( EncodingParameters{}, QByteArray( "\xFF\xFE\n" ), {} ) ) );
+        }
+    }
+}
+
+SCENARIO( "Tab expansion of UTF-16 and UTF-32 lines", "[encodingvalidator]" )
+{
+    // UTF-16LE, UTF-16BE, UTF-32LE and UTF-32BE
+    const auto unitSize = GENERATE( 2, 4 );
+    const auto isBigEndian = GENERATE( false, true );
+
+    // Two 16 bytes vectors and a tail for both code unit sizes
+    constexpr auto UnitsCount = 37;
+
+    GIVEN( "Tabs at any unit, including both sides of a vector boundary and the tail" )
+    {
+        const auto tabUnit = GENERATE_COPY( range( 0, UnitsCount ) );
+        const auto initialSpaces = GENERATE( 0, 3 );
+
+        std::vector<uint32_t> codePoints( UnitsCount, 'a' );
+        codePoints[ static_cast<size_t>( tabUnit ) ] = '\t';
+        codePoints[ UnitsCount - 1 ] = '\t';
+
+        THEN( "Every tab is expanded" )
+        {
+            REQUIRE( expandWideTabs( codePoints, unitSize, isBigEndian, initialSpaces )
+                     == expectedTabSpaces( codePoints, unitSize, initialSpaces ) );
+        }
+    }
+
+    GIVEN( "Code units holding a tab byte that are not tabs" )
+    {
+        // U+0900 and U+0109 have 0x09 in their high and low byte
+        std::vector<uint32_t> codePoints;
+        for ( auto unit = 0; unit < UnitsCount; ++unit ) {
+            codePoints.push_back( unit % 2 ? 0x0109 : 0x0900 );
+        }
+
+        THEN( "They are not expanded" )
+        {
+            REQUIRE( expandWideTabs( codePoints, unitSize, isBigEndian, 0 ) == 0 );
+        }
+
+        WHEN( "A tab is inserted at any unit" )
+        {
+            const auto tabUnit = GENERATE_COPY( range( 0, UnitsCount + 1 ) );
+            codePoints.insert( codePoints.begin() + tabUnit, '\t' );
+
+            THEN( "Only the tab is expanded" )
+            {
+                REQUIRE( expandWideTabs( codePoints, unitSize, isBigEndian, 0 )
+                         == expectedTabSpaces( codePoints, unitSize, 0 ) );
+            }
+        }
+    }
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "fieldindex.h"
+#include "fieldquery.h"
+
+namespace {
+
+const std::vector<std::string> Fields{ "level", "service", "trace_id" };
+
+using Values = std::vector<std::optional<std::string>>;
+
+// Five lines with small fields, then enough distinct trace ids for
+// trace_id to be hashed
+std::vector<Values> makeLines()
+{
+    std::vector<Values> lines{
+        { "ERROR", "payments", {} },
+        { "info", "auth", {} },
+        { {}, {}, {} },
+        { "Warn", "db", {} },
+        { "error", "auth", {} },
+    };
+
+    for ( auto i = 0u; i <= FieldIndex::MaxDictionarySize; ++i ) {
+        lines.push_back( { "info", {}, "t" + std::to_string( i ) } );
+    }
+
+    return lines;
+}
+
+FieldIndex makeIndex( const std::vector<Values>& lines )
+{
+    FieldIndex index;
+    index.setFields( Fields );
+
+    FieldIndex::Batch batch( Fields.size() );
+    for ( const auto& values : lines ) {
+        for ( auto field = 0u; field < values.size(); ++field ) {
+            if ( values[ field ] ) {
+                batch.add( field, *values[ field ] );
+            }
+        }
+        batch.endLine();
+    }
+    index.append( batch );
+
+    return index;
+}
+
+Values normalized( const Values& values )
+{
+    Values result;
+    for ( const auto& value : values ) {
+        result.push_back( value ? std::make_optional( FieldIndex::normalize( *value ) )
+                                : std::nullopt );
+    }
+    return result;
+}
+
+std::vector<uint64_t> toVector( const roaring::Roaring64Map& lines )
+{
+    return { lines.begin(), lines.end() };
+}
+
+std::vector<uint64_t> exactLines( const std::string& text, const FieldIndex& index )
+{
+    const auto query = FieldQuery::parse( text, Fields );
+    REQUIRE( query.isValid() );
+
+    const auto matches = query.evaluate( index, 0_lnum, 5_lnum );
+    REQUIRE( toVector( matches.candidates ).empty() );
+    return toVector( matches.lines );
+}
+
+} // namespace
+
+SCENARIO( "Field query parsing", "[fieldquery]" )
+{
+    GIVEN( "Valid queries" )
+    {
+        const auto query = GENERATE( as<std::string>{}, "level=error", "level!=error",
+                                     "level = \"some error\"", "NOT level=error",
+                                     "!(level=error || service=db)", "notes=1 and level=info" );
+
+        THEN( "They are parsed unless a field is not indexed" )
+        {
+            const auto parsed = FieldQuery::parse( query, { "level", "service", "notes" } );
+            REQUIRE( parsed.isValid() );
+            REQUIRE( parsed.errorString().empty() );
+        }
+    }
+
+    GIVEN( "Invalid queries" )
+    {
+        const auto [ query, error ] = GENERATE( table<std::string, std::string>( {
+            { "", "Empty query" },
+            { "   ", "Empty query" },
+            { "(level=error", "Missing closing parenthesis" },
+            { "level=error)", "Unexpected text at position 12" },
+            { "level=", "Expected a value at position 7" },
+            { "level=\"error", "Missing closing quote" },
+            { "level", "Expected = or != after level" },
+            { "level=error AND", "Expected a field name at position 16" },
+            { "notes=1", "Field notes is not indexed" },
+        } ) );
+
+        THEN( "They report the error" )
+        {
+            const auto parsed = FieldQuery::parse( query, Fields );
+            REQUIRE_FALSE( parsed.isValid() );
+            REQUIRE( parsed.errorString() == error );
+        }
+    }
+}
+
+SCENARIO( "Field query evaluation", "[fieldquery]" )
+{
+    const auto lines = makeLines();
+    const auto index = makeIndex( lines );
+
+    GIVEN( "Exact fields" )
+    {
+        THEN( "Values are compared ignoring case" )
+        {
+            REQUIRE( exactLines( "level=error", index ) == std::vector<uint64_t>{ 0, 4 } );
+            REQUIRE( exactLines( "level=\"WARN\"", index ) == std::vector<uint64_t>{ 3 } );
+            REQUIRE( exactLines( "level=debug", index ).empty() );
+        }
+
+        THEN( "Not equal matches lines without the field" )
+        {
+            REQUIRE( exactLines( "level!=error", index ) == std::vector<uint64_t>{ 1, 2, 3 } );
+            REQUIRE( exactLines( "!service=auth", index ) == std::vector<uint64_t>{ 0, 2, 3 } );
+        }
+
+        THEN( "NOT binds tighter than AND, AND tighter than OR" )
+        {
+            REQUIRE( exactLines( "level=info OR level=error AND service=payments", index )
+                     == std::vector<uint64_t>{ 0, 1 } );
+            REQUIRE( exactLines( "level=error AND service=payments || level=info", index )
+                     == std::vector<uint64_t>{ 0, 1 } );
+            REQUIRE( exactLines( "NOT level=info AND service=auth", index )
+                     == std::vector<uint64_t>{ 4 } );
+            REQUIRE( exactLines( "not level=info or service=auth", index )
+                     == std::vector<uint64_t>{ 0, 1, 2, 3, 4 } );
+        }
+
+        THEN( "Parentheses and spaces group terms" )
+        {
+            REQUIRE( exactLines( "(level=info OR level=error) AND service=payments", index )
+                     == std::vector<uint64_t>{ 0 } );
+            REQUIRE( exactLines( "level=error service=auth", index )
+                     == std::vector<uint64_t>{ 4 } );
+            REQUIRE( exactLines( "NOT (level=info OR service=auth)", index )
+                     == std::vector<uint64_t>{ 0, 2, 3 } );
+        }
+
+        THEN( "Only lines of the range are returned" )
+        {
+            const auto query = FieldQuery::parse( "level=error", Fields );
+            REQUIRE( toVector( query.evaluate( index, 1_lnum, 4_lnum ).lines ).empty() );
+            REQUIRE( toVector( query.evaluate( index, 4_lnum, 4_lnum ).lines ).empty() );
+        }
+    }
+
+    GIVEN( "A hashed field" )
+    {
+        const auto endLine = LineNumber( lines.size() );
+
+        THEN( "Lookups give candidates to check with matches()" )
+        {
+            const auto query
+                = FieldQuery::parse( GENERATE( as<std::string>{}, "trace_id=t42",
+                                               "trace_id!=t42", "trace_id=t42 OR level=error",
+                                               "NOT (trace_id=t7 AND level=info)" ),
+                                     Fields );
+            REQUIRE( query.isValid() );
+
+            const auto matches = query.evaluate( index, 0_lnum, endLine );
+            REQUIRE_FALSE( toVector( matches.candidates ).empty() );
+
+            for ( auto line = 0u; line < lines.size(); ++line ) {
+                const auto isMatch = query.matches( normalized( lines[ line ] ) );
+                const auto isExact = matches.lines.contains( line );
+                const auto isCandidate = matches.candidates.contains( line );
+
+                REQUIRE_FALSE( ( isExact && isCandidate ) );
+                if ( isExact ) {
+                    REQUIRE( isMatch );
+                }
+                if ( isMatch ) {
+                    REQUIRE( ( isExact || isCandidate ) );
+                }
+            }
+        }
+
+        THEN( "Exact terms on other fields stay exact" )
+        {
+            const auto query = FieldQuery::parse( "level=error OR trace_id=t42", Fields );
+            const auto matches = query.evaluate( index, 0_lnum, endLine );
+            REQUIRE( matches.lines.contains( 0 ) );
+            REQUIRE( matches.lines.contains( 4 ) );
+            REQUIRE( matches.candidates.contains( 5 + 42 ) );
+        }
+    }
+
+    GIVEN( "An invalid query" )
+    {
+        const auto query = FieldQuery::parse( "level=", Fields );
+
+        THEN( "Nothing matches" )
+        {
+            const auto matches = query.evaluate( index, 0_lnum, 5_lnum );
+            REQUIRE( toVector( matches.lines ).empty() );
+            REQUIRE( toVector( matches.candidates ).empty() );
+            REQUIRE_FALSE( query.matches( normalized( lines[ 0 ] ) ) );
+        }
+    }
+}
+
+SCENARIO( "Field index updates", "[fieldquery]" )
+{
+    auto index = makeIndex( makeLines() );
+
+    WHEN( "Lines are truncated" )
+    {
+        index.truncate( 2_lcount );
+
+        THEN( "Dropped lines are not found anymore" )
+        {
+            REQUIRE( index.size() == 2_lcount );
+            REQUIRE( toVector( index.find( 0, "error" ).lines ) == std::vector<uint64_t>{ 0 } );
+            REQUIRE( toVector( index.find( 0, "info" ).lines ) == std::vector<uint64_t>{ 1 } );
+        }
+    }
+
+    WHEN( "Lines are appended" )
+    {
+        const auto size = index.size();
+
+        FieldIndex::Batch batch( Fields.size() );
+        batch.endLine();
+        batch.add( 1, "Payments" );
+        batch.endLine();
+        index.append( batch );
+
+        THEN( "Line numbers follow the existing lines" )
+        {
+            REQUIRE( index.size() == size + 2_lcount );
+            REQUIRE( toVector( index.find( 1, "payments" ).lines )
+                     == std::vector<uint64_t>{ 0, size.get() + 1 } );
+        }
+    }
+
+    WHEN( "The index is cleared" )
+    {
+        index.clear();
+
+        THEN( "Fields are kept" )
+        {
+            REQUIRE( index.size() == 0_lcount );
+            REQUIRE_FALSE( index.hasValues() );
+            REQUIRE( index.findField( "service" ) == 1u );
+            REQUIRE( toVector( index.find( 0, "error" ).lines ).empty() );
+        }
+    }
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <QTemporaryFile>
+
+#include "fileholder.h"
+
+namespace {
+
+constexpr qint64 FileSize = 1024 * 1024 + 123;
+
+char expectedByte( qint64 offset )
+{
+    return static_cast<char>( ( offset * 31 + offset / 251 ) & 0xFF );
+}
+
+QByteArray expectedBytes( qint64 offset, qint64 size )
+{
+    QByteArray bytes;
+    for ( auto i = offset; i < std::min( offset + size, FileSize ); ++i ) {
+        bytes.append( expectedByte( i ) );
+    }
+    return bytes;
+}
+
+void writeTestFile( QTemporaryFile& file )
+{
+    REQUIRE( file.open() );
+    file.write( expectedBytes( 0, FileSize ) );
+    file.flush();
+}
+
+} // namespace
+
+SCENARIO( "Positional readers share a file holder", "[fileholder]" )
+{
+    QTemporaryFile file;
+    writeTestFile( file );
+
+    GIVEN( "A holder keeping the file open" )
+    {
+        FileHolder holder( false );
+        holder.open( file.fileName() );
+        REQUIRE( holder.isOpen() );
+
+        WHEN( "Several readers read at random offsets while the holder seeks and reads" )
+        {
+            constexpr int ReadersCount = 8;
+            constexpr int ReadsPerReader = 200;
+
+            std::atomic<int> mismatches{ 0 };
+            std::atomic<int> closedReaders{ 0 };
+
+            std::vector<std::thread> readers;
+            for ( int reader = 0; reader < ReadersCount; ++reader ) {
+                readers.emplace_back( [ &, reader ] {
+                    PositionalFileReader fileReader( holder );
+                    if ( !fileReader.isOpen() ) {
+                        closedReaders++;
+                        return;
+                    }
+
+                    std::mt19937 generator( static_cast<unsigned>( reader ) );
+                    std::uniform_int_distribution<qint64> offsets( 0, FileSize - 1 );
+                    std::uniform_int_distribution<qint64> sizes( 1, 64 * 1024 );
+
+                    QByteArray buffer;
+                    for ( int i = 0; i < ReadsPerReader; ++i ) {
+                        const auto offset = offsets( generator );
+                        const auto size = sizes( generator );
+                        buffer.resize( static_cast<int>( size ) );
+
+                        const auto bytesRead = fileReader.read( offset, buffer.data(), size );
+                        if ( bytesRead < 0
+                             || buffer.left( static_cast<int>( bytesRead ) )
+                                    != expectedBytes( offset, size ) ) {
+                            mismatches++;
+                        }
+                    }
+                } );
+            }
+
+            int holderMismatches = 0;
+            for ( qint64 offset = 0; offset < FileSize; offset += 4093 ) {
+                ScopedFileHolder<FileHolder> locker( &holder );
+                auto* heldFile = locker.getFile();
+                heldFile->seek( offset );
+                if ( heldFile->read( 512 ) != expectedBytes( offset, 512 ) ) {
+                    holderMismatches++;
+                }
+            }
+
+            for ( auto& reader : readers ) {
+                reader.join();
+            }
+
+            THEN( "Every read returns the bytes at its own offset" )
+            {
+                REQUIRE( closedReaders.load() == 0 );
+                REQUIRE( mismatches.load() == 0 );
+                REQUIRE( holderMismatches == 0 );
+            }
+        }
+
+        WHEN( "Reading across the end of the file" )
+        {
+            PositionalFileReader fileReader( holder );
+            REQUIRE( fileReader.isOpen() );
+
+            QByteArray buffer( 100, '\0' );
+            const auto bytesRead = fileReader.read( FileSize - 10, buffer.data(), 100 );
+
+            THEN( "Only the bytes up to the end are read" )
+            {
+                REQUIRE( bytesRead == 10 );
+                REQUIRE( buffer.left( 10 ) == expectedBytes( FileSize - 10, 10 ) );
+            }
+        }
+    }
+
+    GIVEN( "A holder keeping the file closed between reads" )
+    {
+        FileHolder holder( true );
+        holder.open( file.fileName() );
+
+        THEN( "Readers are not opened" )
+        {
+            PositionalFileReader fileReader( holder );
+            REQUIRE_FALSE( fileReader.isOpen() );
+        }
+    }
+}
@@ -22,15 +22,30 @@
 #include "log.h"
 
 #include "linepositionarray.h"
+#include "logdataworker.h"
 
 #include <algorithm>
 #include <random>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include <configuration.h>
 
+namespace {
+
+using Encoding = CompressedLinePositionStorage::Encoding;
+
+LinePositionArray makeLinePositionArray( Encoding encoding )
+{
+    return LinePositionArray( CompressedLinePositionStorage( encoding ) );
+}
+
+} // namespace
+
 SCENARIO( "LinePositionArray with small number of lines", "[linepositionarray]" )
 {
+    const auto encoding = GENERATE( Encoding::Blocks, Encoding::EliasFano );
 
     std::vector<LineOffset> offsets = { 4_offset,     8_offset, 10_offset,
                                         345_offset,   // A longer (>128) line
@@ -40,7 +55,7 @@ SCENARIO( "LinePositionArray with small number of lines", "[linepositionarray]"
     GIVEN( "LinePositionArray with small number of lines" )
     {
 
-        LinePositionArray line_array;
+        auto line_array = makeLinePositionArray( encoding );
 
         for ( const auto& offset : offsets ) {
             line_array.append( offset );
@@ -98,7 +113,7 @@ SCENARIO( "LinePositionArray with small number of lines", "[linepositionarray]"
 
         WHEN( "Add line to single line array with fake lf" )
         {
-            LinePositionArray one_line_array;
+            auto one_line_array = makeLinePositionArray( encoding );
             one_line_array.append(10_offset);
             one_line_array.setFakeFinalLF();
             one_line_array.append(20_offset);
@@ -153,11 +168,12 @@ SCENARIO( "LinePositionArray with small number of lines", "[linepositionarray]"
 
 SCENARIO( "LinePositionArray with full block of lines", "[linepositionarray]" )
 {
+    const auto encoding = GENERATE( Encoding::Blocks, Encoding::EliasFano );
 
     GIVEN( "LinePositionArray with block of lines" )
     {
 
-        LinePositionArray line_array;
+        auto line_array = makeLinePositionArray( encoding );
 
         // Add 255 lines (of various sizes)
         const int lines = 255;
@@ -194,6 +210,7 @@ SCENARIO( "LinePositionArray with full block of lines", "[linepositionarray]" )
 
 SCENARIO( "LinePositionArray with UINT32_MAX offsets", "[linepositionarray]" )
 {
+    const auto encoding = GENERATE( Encoding::Blocks, Encoding::EliasFano );
 
     std::vector<LineOffset> offsets = { 4_offset,
                                         8_offset,
@@ -207,7 +224,7 @@ SCENARIO( "LinePositionArray with UINT32_MAX offsets", "[linepositionarray]" )
 
     GIVEN( "LinePositionArray with long offsets" )
     {
-        LinePositionArray line_array;
+        auto line_array = makeLinePositionArray( encoding );
 
         for ( const auto& offset : offsets ) {
             line_array.append( offset );
@@ -242,7 +259,7 @@ SCENARIO( "LinePositionArray with UINT32_MAX offsets", "[linepositionarray]" )
     GIVEN( "LinePositionArray with small lines" )
     {
 
-        LinePositionArray line_array;
+        auto line_array = makeLinePositionArray( encoding );
         line_array.append( 4_offset );
         line_array.append( 8_offset );
 
@@ -266,3 +283,216 @@ SCENARIO( "LinePositionArray with UINT32_MAX offsets", "[linepositionarray]" )
         }
     }
 }
+
+SCENARIO( "LinePositionArray with lines of various lengths", "[linepositionarray]" )
+{
+    const auto encoding = GENERATE( Encoding::Blocks, Encoding::EliasFano );
+
+    GIVEN( "LinePositionArray with lines of various lengths" )
+    {
+        std::vector<LineOffset> offsets;
+        int64_t pos = 0;
+        for ( int i = 0; i < 1000; ++i ) {
+            // Mix short, long (>16384) and empty lines
+            pos += ( i % 7 == 0 ) ? 20000 + i : ( i % 11 == 0 ) ? 0 : 4 + i % 100;
+            offsets.push_back( LineOffset( pos ) );
+        }
+
+        auto line_array = makeLinePositionArray( encoding );
+        for ( const auto& offset : offsets ) {
+            line_array.append( offset );
+        }
+
+        REQUIRE( line_array.size() == LinesCount( offsets.size() ) );
+
+        WHEN( "Access items in random order" )
+        {
+            std::random_device rd;
+            std::mt19937 g( rd() );
+
+            auto index = std::vector<uint32_t>( offsets.size() );
+            std::generate( index.begin(), index.end(), [ n = 0u ]() mutable { return n++; } );
+            std::shuffle( index.begin(), index.end(), g );
+
+            THEN( "Corrent offsets returned" )
+            {
+                for ( auto i : index ) {
+                    REQUIRE( line_array.at( i ) == offsets[ i ] );
+                }
+            }
+        }
+
+        WHEN( "Adding lines after fake lf" )
+        {
+            THEN( "Correct offset is returned" )
+            for ( uint32_t i = 0; i < 1000; ++i ) {
+                pos += 35LL;
+                line_array.append( LineOffset( pos ) );
+                line_array.setFakeFinalLF();
+                REQUIRE( line_array.at( 1000 + i ) == LineOffset( pos ) );
+                pos += 21LL;
+                line_array.append( LineOffset( pos ) );
+                REQUIRE( line_array.at( 1000 + i ) == LineOffset( pos ) );
+            }
+        }
+    }
+
+    GIVEN( "LinePositionArray with full block of lines" )
+    {
+        auto line_array = makeLinePositionArray( encoding );
+        for ( int i = 0; i < 256; ++i )
+            line_array.append( LineOffset( i * 4 ) );
+
+        WHEN( "Replacing last line of the block after fake lf" )
+        {
+            line_array.setFakeFinalLF();
+            line_array.append( LineOffset( 255 * 4 + 10 ) );
+            line_array.append( LineOffset( 255 * 4 + 20 ) );
+
+            THEN( "Correct offsets are returned" )
+            {
+                REQUIRE( line_array.size() == 257_lcount );
+                REQUIRE( line_array.at( 254 ) == LineOffset( 254 * 4 ) );
+                REQUIRE( line_array.at( 255 ) == LineOffset( 255 * 4 + 10 ) );
+                REQUIRE( line_array.at( 256 ) == LineOffset( 255 * 4 + 20 ) );
+            }
+        }
+    }
+
+    GIVEN( "LinePositionArray with UINT32_MAX offsets" )
+    {
+        std::vector<LineOffset> offsets = { 4_offset,
+                                            8_offset,
+                                            LineOffset( UINT32_MAX - 10 ),
+                                            LineOffset( (uint64_t)UINT32_MAX + 10LL ),
+                                            LineOffset( (uint64_t)2 * UINT32_MAX ),
+                                            LineOffset( (uint64_t)3 * UINT32_MAX ) };
+
+        auto line_array = makeLinePositionArray( encoding );
+        for ( const auto& offset : offsets ) {
+            line_array.append( offset );
+        }
+
+        WHEN( "Appending other array after fake lf" )
+        {
+            FastLinePositionArray other_array;
+            for ( int i = 0; i < 600; ++i ) {
+                other_array.append( LineOffset( (uint64_t)3 * UINT32_MAX + 100000LL * i + 5 ) );
+            }
+
+            line_array.setFakeFinalLF();
+            line_array.append_list( other_array );
+
+            THEN( "Correct offsets are returned" )
+            {
+                REQUIRE( line_array.size() == 605_lcount );
+                for ( auto i = 0u; i < offsets.size() - 1; ++i ) {
+                    REQUIRE( line_array.at( i ) == offsets[ i ] );
+                }
+                for ( auto i = 0u; i < 600; ++i ) {
+                    REQUIRE( line_array.at( 5 + i ) == other_array.at( i ) );
+                }
+            }
+        }
+    }
+}
+
+namespace {
+
+// Lays out code points as UTF-16 (BMP only) or UTF-32 code units
+std::string encodeUnits( const std::vector<uint32_t>& codePoints, int unitSize, bool isBigEndian )
+{
+    std::string bytes;
+    for ( const auto codePoint : codePoints ) {
+        for ( auto i = 0; i < unitSize; ++i ) {
+            const auto shift = 8 * ( isBigEndian ? unitSize - 1 - i : i );
+            bytes.push_back( static_cast<char>( ( codePoint >> shift ) & 0xFF ) );
+        }
+    }
+    return bytes;
+}
+
+EncodingParameters wideParameters( int unitSize, bool isBigEndian )
+{
+    EncodingParameters parameters;
+    parameters.isUtf16LE = unitSize == 2 && !isBigEndian;
+    parameters.lineFeedWidth = unitSize;
+    parameters.lineFeedIndex = isBigEndian ? unitSize - 1 : 0;
+    return parameters;
+}
+
+std::string_view::size_type findNextWideLineFeed( const EncodingParameters& parameters,
+                                                  std::string_view data )
+{
+    using namespace parse_data_block;
+    return parameters.lineFeedWidth == 2
+               ? findNextWideDelimeter<uint16_t>( parameters, data, '\n' )
+               : findNextWideDelimeter<uint32_t>( parameters, data, '\n' );
+}
+
+} // namespace
+
+SCENARIO( "Line feeds lookup in UTF-16 and UTF-32 blocks", "[linepositionarray]" )
+{
+    using parse_data_block::findNextMultiByteDelimeter;
+
+    // UTF-16LE, UTF-16BE, UTF-32LE and UTF-32BE
+    const auto unitSize = GENERATE( 2, 4 );
+    const auto isBigEndian = GENERATE( false, true );
+    const auto parameters = wideParameters( unitSize, isBigEndian );
+
+    // Two 16 bytes vectors and a tail for both code unit sizes
+    constexpr auto UnitsCount = 37;
+
+    GIVEN( "A line feed at any unit, including both sides of a vector boundary and the tail" )
+    {
+        const auto lineFeedUnit = GENERATE_COPY( range( 0, UnitsCount ) );
+
+        std::vector<uint32_t> codePoints( UnitsCount, 'a' );
+        codePoints[ static_cast<size_t>( lineFeedUnit ) ] = '\n';
+        const auto data = encodeUnits( codePoints, unitSize, isBigEndian );
+
+        THEN( "The line feed byte is found" )
+        {
+            const auto expected = static_cast<std::string_view::size_type>(
+                lineFeedUnit * unitSize + parameters.lineFeedIndex );
+            REQUIRE( findNextWideLineFeed( parameters, data ) == expected );
+            REQUIRE( findNextMultiByteDelimeter( parameters, data, '\n' ) == expected );
+        }
+    }
+
+    GIVEN( "Code units holding a line feed byte that are not line feeds" )
+    {
+        const auto lineFeedUnit = GENERATE_COPY( range( 0, UnitsCount + 1 ) );
+
+        // U+0A00 and U+010A have 0x0A in their high and low byte
+        std::vector<uint32_t> codePoints;
+        for ( auto unit = 0; unit < UnitsCount; ++unit ) {
+            codePoints.push_back( unit % 2 ? 0x010A : 0x0A00 );
+        }
+        codePoints.insert( codePoints.begin() + lineFeedUnit, '\n' );
+        const auto data = encodeUnits( codePoints, unitSize, isBigEndian );
+
+        THEN( "Only the line feed is found" )
+        {
+            const auto expected = static_cast<std::string_view::size_type>(
+                lineFeedUnit * unitSize + parameters.lineFeedIndex );
+            REQUIRE( findNextWideLineFeed( parameters, data ) == expected );
+            REQUIRE( findNextMultiByteDelimeter( parameters, data, '\n' ) == expected );
+        }
+    }
+
+    GIVEN( "No line feed and a partial code unit at the end" )
+    {
+        const auto length = GENERATE_COPY( range( 0, UnitsCount ) );
+
+        auto data = encodeUnits( std::vector<uint32_t>( static_cast<size_t>( length ), 0x0A00 ),
+                                 unitSize, isBigEndian );
+        data.push_back( '\n' );
+
+        THEN( "Nothing is found" )
+        {
+            REQUIRE( findNextWideLineFeed( parameters, data ) == std::string_view::npos );
+        }
+    }
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <memory>
+
+#include <QTextCodec>
+
+#include "longlineindex.h"
+
+namespace {
+
+TextDecoder makeDecoder( QTextCodec* codec )
+{
+    return { std::make_unique<QTextDecoder>( codec ), EncodingParameters( codec ) };
+}
+
+QByteArray encode( QTextCodec* codec, const QString& text )
+{
+    QTextCodec::ConverterState state( QTextCodec::IgnoreHeader );
+    return codec->fromUnicode( text.constData(), text.size(), &state );
+}
+
+std::string_view toView( const QByteArray& bytes )
+{
+    return std::string_view( bytes.constData(), static_cast<size_t>( bytes.size() ) );
+}
+
+// Decoding from any checkpoint must give the text from its column on,
+// the text has no tabs so columns are the indexes of the characters.
+void checkCheckpoints( const LongLineIndex::Line& line, const QByteArray& bytes,
+                       QTextCodec* codec, const QString& text )
+{
+    REQUIRE( line.byteLength == bytes.size() );
+    REQUIRE( line.expandedLength == text.size() );
+    REQUIRE( line.checkpoints.front().byteOffset == 0 );
+    REQUIRE( line.checkpoints.front().column == 0 );
+
+    for ( const auto& checkpoint : line.checkpoints ) {
+        const auto decoded = makeDecoder( codec ).decoder->toUnicode(
+            bytes.constData() + checkpoint.byteOffset,
+            static_cast<int>( bytes.size() - checkpoint.byteOffset ) );
+        REQUIRE( decoded == text.mid( static_cast<int>( checkpoint.column ) ) );
+    }
+}
+
+QString repeat( const QString& pattern, int minLength )
+{
+    QString text;
+    while ( text.size() < minLength ) {
+        text += pattern;
+    }
+    return text;
+}
+
+} // namespace
+
+SCENARIO( "Long line window", "[longlineindex]" )
+{
+    LongLineIndex::Line line;
+    line.checkpoints = { { 0, 0 }, { 100, 80 }, { 200, 160 } };
+    line.byteLength = 300;
+    line.expandedLength = 240;
+
+    THEN( "Window starts at the last checkpoint before its first column" )
+    {
+        REQUIRE( line.byteRange( 0, 10 ).first.byteOffset == 0 );
+        REQUIRE( line.byteRange( 79, 90 ).first.byteOffset == 0 );
+        REQUIRE( line.byteRange( 80, 90 ).first.byteOffset == 100 );
+        REQUIRE( line.byteRange( 200, 210 ).first.byteOffset == 200 );
+        REQUIRE( line.byteRange( 200, 210 ).first.column == 160 );
+        REQUIRE( line.byteRange( -5, 10 ).first.byteOffset == 0 );
+    }
+
+    THEN( "Window ends at the first checkpoint at or after its last column" )
+    {
+        REQUIRE( line.byteRange( 0, 10 ).second == 100 );
+        REQUIRE( line.byteRange( 0, 80 ).second == 100 );
+        REQUIRE( line.byteRange( 0, 81 ).second == 200 );
+        REQUIRE( line.byteRange( 90, 160 ).second == 200 );
+        REQUIRE( line.byteRange( 150, 170 ).second == 300 );
+        REQUIRE( line.byteRange( 200, 1000 ).second == 300 );
+    }
+}
+
+SCENARIO( "Long line index checkpoints", "[longlineindex]" )
+{
+    constexpr int LineLength = 100 * 1024;
+
+    GIVEN( "Single byte text with tabs and carriage return" )
+    {
+        static_assert( TabStop == 8, "Each 4 bytes below expand to 8 columns" );
+
+        const auto codec = QTextCodec::codecForName( "ISO-8859-1" );
+        const auto bytes = encode( codec, repeat( "abc\t", LineLength ) + "\r" );
+        const auto line = LongLineIndex::build( toView( bytes ), makeDecoder( codec ) );
+
+        THEN( "Tabs are expanded and carriage return is not counted" )
+        {
+            REQUIRE( line.checkpoints.size() > 1 );
+            REQUIRE( line.expandedLength == ( bytes.size() - 1 ) * 2 );
+
+            // Letters can be in double-byte encodings, tabs are the only boundaries
+            for ( auto checkpoint = line.checkpoints.begin() + 1;
+                  checkpoint != line.checkpoints.end(); ++checkpoint ) {
+                REQUIRE( checkpoint->byteOffset % 4 == 3 );
+                REQUIRE( checkpoint->column == checkpoint->byteOffset * 2 - 3 );
+            }
+        }
+    }
+
+    GIVEN( "UTF-8 text" )
+    {
+        const auto codec = QTextCodec::codecForName( "UTF-8" );
+        const auto text = repeat( QString::fromUtf8( "\xc3\xa9\xe6\x97\xa5\xe6\x9c\xac"
+                                                     "\xe8\xaa\x9e" ),
+                                  LineLength );
+        const auto bytes = encode( codec, text );
+
+        THEN( "Checkpoints are at the first byte of characters" )
+        {
+            const auto line = LongLineIndex::build( toView( bytes ), makeDecoder( codec ) );
+            REQUIRE( line.checkpoints.size() > 1 );
+            checkCheckpoints( line, bytes, codec, text );
+        }
+    }
+
+    GIVEN( "UTF-16LE text with surrogate pairs" )
+    {
+        const auto codec = QTextCodec::codecForName( "UTF-16LE" );
+        const auto text = repeat( QString::fromUtf8( "a\xf0\x9f\x98\x80" ), LineLength );
+        const auto bytes = encode( codec, text );
+
+        THEN( "Checkpoints are not in the middle of surrogate pairs" )
+        {
+            const auto line = LongLineIndex::build( toView( bytes ), makeDecoder( codec ) );
+            REQUIRE( line.checkpoints.size() > 1 );
+            checkCheckpoints( line, bytes, codec, text );
+        }
+    }
+
+    GIVEN( "GB18030 text" )
+    {
+        const auto codec = QTextCodec::codecForName( "GB18030" );
+        if ( codec == nullptr ) {
+            WARN( "GB18030 codec is not available" );
+            return;
+        }
+
+        // Latin-1 letters take four bytes, the second and the fourth are digits
+        const auto letters = QString::fromUtf8( "\xc3\x80\xc3\x81\xc3\x82\xc3\x83" );
+
+        WHEN( "Line has spaces" )
+        {
+            const auto text = repeat( letters + "0123 ", LineLength );
+            const auto bytes = encode( codec, text );
+
+            THEN( "Checkpoints are at characters below digits" )
+            {
+                const auto line = LongLineIndex::build( toView( bytes ), makeDecoder( codec ) );
+                REQUIRE( line.checkpoints.size() > 1 );
+                checkCheckpoints( line, bytes, codec, text );
+            }
+        }
+
+        WHEN( "Line has only four byte characters and digits" )
+        {
+            const auto text = repeat( letters + "0", LineLength );
+            const auto bytes = encode( codec, text );
+            REQUIRE( bytes.size() == text.size() / 5 * 17 );
+
+            THEN( "Line is decoded from its beginning" )
+            {
+                const auto line = LongLineIndex::build( toView( bytes ), makeDecoder( codec ) );
+                REQUIRE( line.checkpoints.size() == 1 );
+                checkCheckpoints( line, bytes, codec, text );
+            }
+        }
+    }
+
+    GIVEN( "ISO-2022-JP text" )
+    {
+        const auto codec = QTextCodec::codecForName( "ISO-2022-JP" );
+        if ( codec == nullptr ) {
+            WARN( "ISO-2022-JP codec is not available" );
+            return;
+        }
+
+        const auto text = repeat(
+            QString::fromUtf8( "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e abc " ), LineLength );
+        const auto bytes = encode( codec, text );
+
+        THEN( "Line is decoded from its beginning" )
+        {
+            const auto line = LongLineIndex::build( toView( bytes ), makeDecoder( codec ) );
+            REQUIRE( line.checkpoints.size() == 1 );
+            checkCheckpoints( line, bytes, codec, text );
+        }
+    }
+}
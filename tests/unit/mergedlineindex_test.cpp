@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "mergedlineindex.h"
+
+#include <random>
+#include <utility>
+#include <vector>
+
+SCENARIO( "MergedLineIndex maps merged lines to sources", "[mergedlineindex]" )
+{
+    GIVEN( "Index built from interleaved runs of three sources" )
+    {
+        constexpr size_t NbSources = 3;
+        MergedLineIndex index( NbSources );
+
+        std::vector<std::pair<size_t, uint64_t>> expected;
+        std::vector<uint64_t> positions( NbSources, 0 );
+
+        std::mt19937 generator( 42 );
+        for ( auto run = 0; run < 10000; ++run ) {
+            const auto source = generator() % NbSources;
+            const auto length = ( run % 100 == 0 ) ? 20000u : generator() % 5;
+            index.append( source, LinesCount( length ) );
+
+            for ( auto line = 0u; line < length; ++line ) {
+                expected.emplace_back( source, positions[ source ] + line );
+            }
+            positions[ source ] += length;
+        }
+
+        REQUIRE( index.size().get() == expected.size() );
+
+        WHEN( "Access lines one by one" )
+        {
+            THEN( "Correct source lines returned" )
+            {
+                for ( auto line = 0u; line < expected.size(); line += 7 ) {
+                    const auto location = index.at( LineNumber( line ) );
+                    REQUIRE( location.source == expected[ line ].first );
+                    REQUIRE( location.line.get() == expected[ line ].second );
+                }
+            }
+        }
+
+        WHEN( "Access range of lines" )
+        {
+            const auto first = LineNumber( expected.size() / 3 );
+            const auto segments = index.segments( first, 50000_lcount );
+
+            THEN( "Segments cover the range in order" )
+            {
+                auto mergedLine = first.get();
+                for ( const auto& segment : segments ) {
+                    REQUIRE( segment.mergedLine.get() == mergedLine );
+                    for ( auto line = 0u; line < segment.count.get(); ++line ) {
+                        REQUIRE( segment.source == expected[ mergedLine + line ].first );
+                        REQUIRE( segment.sourceLine.get() + line
+                                 == expected[ mergedLine + line ].second );
+                    }
+                    mergedLine += segment.count.get();
+                }
+                REQUIRE( mergedLine == first.get() + 50000 );
+            }
+        }
+
+        WHEN( "Same source is appended twice" )
+        {
+            const auto sizeBefore = index.allocatedSize();
+            const auto last = index.at( LineNumber( expected.size() - 1 ) );
+            index.append( last.source, 10_lcount );
+
+            THEN( "Last run is extended" )
+            {
+                REQUIRE( index.allocatedSize() <= sizeBefore + 1 );
+                REQUIRE( index.at( LineNumber( expected.size() + 9 ) ).line.get()
+                         == last.line.get() + 10 );
+            }
+        }
+    }
+}
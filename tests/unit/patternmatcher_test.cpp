@@ -65,3 +65,34 @@ SCENARIO( "Pattern matcher in boolean mode", "[patternmatcher]" )
         REQUIRE_FALSE( expression.isValid() );
     }
 }
+
+SCENARIO( "Pattern matcher reporting matched sub-patterns", "[patternmatcher]" )
+{
+    std::string_view matchLine = "\"This\" is matching pattern";
+
+    WHEN( "Matching several patterns in one pass" )
+    {
+        RegularExpression expression( std::vector<RegularExpressionPattern>{
+            RegularExpressionPattern( "match", false, false, false, true ),
+            RegularExpressionPattern( "missing", false, false, false, true ),
+            RegularExpressionPattern( "pattern", false, false, false, true ) } );
+        REQUIRE( expression.isValid() );
+
+        const auto matched = expression.createMatcher()->matchedPatterns( matchLine );
+        REQUIRE( matched.size() == 3 );
+        REQUIRE( matched[ 0 ] );
+        REQUIRE_FALSE( matched[ 1 ] );
+        REQUIRE( matched[ 2 ] );
+    }
+
+    WHEN( "Comparing sub-patterns with plain patterns" )
+    {
+        RegularExpression expression(
+            RegularExpressionPattern( "\"match\" & \"pattern\"", false, false, true, true ) );
+        REQUIRE( expression.subPatterns().size() == 2 );
+        REQUIRE( expression.subPatterns().front()
+                 == RegularExpressionPattern( "match", false, false, false, true ) );
+        REQUIRE_FALSE( expression.subPatterns().front()
+                       == RegularExpressionPattern( "match", false, true, false, true ) );
+    }
+}
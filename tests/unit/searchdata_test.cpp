@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "logfiltereddataworker.h"
+
+namespace {
+
+SearchResultArray makeMatches( std::initializer_list<uint64_t> lines )
+{
+    SearchResultArray matches;
+    for ( const auto line : lines ) {
+        matches.add( line );
+    }
+    return matches;
+}
+
+} // namespace
+
+SCENARIO( "Search data with chunks scanned out of order", "[searchdata]" )
+{
+    SearchData searchData;
+    searchData.beginScan( 0_lnum );
+
+    GIVEN( "A chunk scanned ahead of the processed lines" )
+    {
+        searchData.addAll( 10_length, makeMatches( { 25, 28 } ), 20_lnum, 10_lcount );
+
+        THEN( "Its matches are counted but the processed lines do not move" )
+        {
+            REQUIRE( searchData.getNbMatches() == 2_lcount );
+            REQUIRE( searchData.getLastProcessedLine() == 0_lnum );
+        }
+
+        WHEN( "The gap is filled" )
+        {
+            searchData.addAll( 10_length, makeMatches( { 5 } ), 0_lnum, 20_lcount );
+
+            THEN( "The processed lines go past the chunk scanned ahead" )
+            {
+                REQUIRE( searchData.getNbMatches() == 3_lcount );
+                REQUIRE( searchData.getLastProcessedLine() == 30_lnum );
+            }
+        }
+
+        WHEN( "The scan is interrupted and resumed from the processed lines" )
+        {
+            searchData.beginScan( searchData.getLastProcessedLine() );
+            searchData.addAll( 10_length, makeMatches( { 5 } ), 0_lnum, 20_lcount );
+            searchData.addAll( 10_length, makeMatches( { 25, 28 } ), 20_lnum, 10_lcount );
+
+            THEN( "Matches scanned again are counted once" )
+            {
+                REQUIRE( searchData.getNbMatches() == 3_lcount );
+                REQUIRE( searchData.getLastProcessedLine() == 30_lnum );
+                REQUIRE( searchData.takeCurrentResults().newMatches.cardinality() == 3 );
+            }
+        }
+
+        WHEN( "A resumed scan covers part of the chunk scanned ahead" )
+        {
+            searchData.beginScan( 15_lnum );
+            searchData.addAll( 10_length, makeMatches( { 18, 25 } ), 15_lnum, 12_lcount );
+
+            THEN( "Only the matches of lines not scanned before are counted" )
+            {
+                REQUIRE( searchData.getNbMatches() == 3_lcount );
+                REQUIRE( searchData.getLastProcessedLine() == 30_lnum );
+            }
+        }
+
+        WHEN( "Another chunk scanned ahead overlaps it" )
+        {
+            searchData.addAll( 10_length, makeMatches( { 28, 35 } ), 25_lnum, 15_lcount );
+            searchData.addAll( 10_length, makeMatches( {} ), 0_lnum, 20_lcount );
+
+            THEN( "Both are counted once and merged into the processed lines" )
+            {
+                REQUIRE( searchData.getNbMatches() == 3_lcount );
+                REQUIRE( searchData.getLastProcessedLine() == 40_lnum );
+            }
+        }
+    }
+
+    GIVEN( "A last line scanned again by an update" )
+    {
+        searchData.addAll( 10_length, makeMatches( { 3, 9 } ), 0_lnum, 10_lcount );
+        searchData.deleteMatch( 9_lnum );
+
+        WHEN( "It still matches" )
+        {
+            searchData.beginScan( 9_lnum );
+            searchData.addAll( 12_length, makeMatches( { 9, 12 } ), 9_lnum, 5_lcount );
+
+            THEN( "It is counted once" )
+            {
+                REQUIRE( searchData.getNbMatches() == 3_lcount );
+                REQUIRE( searchData.getLastProcessedLine() == 14_lnum );
+            }
+        }
+
+        WHEN( "It does not match anymore" )
+        {
+            searchData.beginScan( 9_lnum );
+            searchData.addAll( 12_length, makeMatches( {} ), 9_lnum, 1_lcount );
+
+            THEN( "It is not counted" )
+            {
+                REQUIRE( searchData.getNbMatches() == 1_lcount );
+            }
+        }
+    }
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include "timestampindex.h"
+#include "timestampparser.h"
+
+namespace {
+constexpr Timestamp Second = 1000;
+constexpr Timestamp Day = 86400 * Second;
+
+// 2021-03-04 05:06:07 UTC
+constexpr Timestamp SampleTime = ( 18690 * 86400 + 5 * 3600 + 6 * 60 + 7 ) * Second;
+} // namespace
+
+SCENARIO( "Parsing line timestamps", "[timestamp]" )
+{
+    GIVEN( "ISO-8601 lines" )
+    {
+        THEN( "Date and time separators are recognized" )
+        {
+            REQUIRE( parseTimestamp( "2021-03-04T05:06:07 message" ) == SampleTime );
+            REQUIRE( parseTimestamp( "2021-03-04 05:06:07 message" ) == SampleTime );
+            REQUIRE( parseTimestamp( "1970-01-01 00:00:00" ) == 0 );
+        }
+
+        THEN( "Fraction is parsed to milliseconds" )
+        {
+            REQUIRE( parseTimestamp( "2021-03-04 05:06:07.123 message" ) == SampleTime + 123 );
+            REQUIRE( parseTimestamp( "2021-03-04 05:06:07,5 message" ) == SampleTime + 500 );
+            REQUIRE( parseTimestamp( "2021-03-04 05:06:07.123456" ) == SampleTime + 123 );
+        }
+
+        THEN( "Opening bracket is skipped" )
+        {
+            REQUIRE( parseTimestamp( "[2021-03-04 05:06:07] message" ) == SampleTime );
+        }
+
+        THEN( "Explicit layout is respected" )
+        {
+            REQUIRE( parseTimestamp( "2021-03-04 05:06:07", TimestampLayout::Iso8601 )
+                     == SampleTime );
+            REQUIRE_FALSE( parseTimestamp( "2021-03-04 05:06:07", TimestampLayout::Syslog ) );
+        }
+
+        THEN( "Invalid dates and times are rejected" )
+        {
+            REQUIRE_FALSE( parseTimestamp( "2021-13-04 05:06:07" ) );
+            REQUIRE_FALSE( parseTimestamp( "2021-03-00 05:06:07" ) );
+            REQUIRE_FALSE( parseTimestamp( "2021-03-04 24:06:07" ) );
+            REQUIRE_FALSE( parseTimestamp( "2021-03-04 05:60:07" ) );
+            REQUIRE_FALSE( parseTimestamp( "2021-03-04/05:06:07" ) );
+            REQUIRE_FALSE( parseTimestamp( "2021-0a-04 05:06:07" ) );
+            REQUIRE_FALSE( parseTimestamp( "2021-03-04 05:06" ) );
+        }
+    }
+
+    GIVEN( "syslog lines" )
+    {
+        THEN( "Year 1970 is assumed" )
+        {
+            REQUIRE( parseTimestamp( "Jan  1 00:00:01 host message" ) == Second );
+            REQUIRE( parseTimestamp( "Jan 12 00:00:00 host message" ) == 11 * Day );
+            REQUIRE( parseTimestamp( "Mar  4 05:06:07 host message" )
+                     == ( 62 * 86400 + 5 * 3600 + 6 * 60 + 7 ) * Second );
+        }
+
+        THEN( "Explicit layout is respected" )
+        {
+            REQUIRE( parseTimestamp( "Jan  1 00:00:01", TimestampLayout::Syslog ) == Second );
+            REQUIRE_FALSE( parseTimestamp( "Jan  1 00:00:01", TimestampLayout::Iso8601 ) );
+        }
+
+        THEN( "Invalid dates and times are rejected" )
+        {
+            REQUIRE_FALSE( parseTimestamp( "Foo  1 00:00:01" ) );
+            REQUIRE_FALSE( parseTimestamp( "Jan  0 00:00:01" ) );
+            REQUIRE_FALSE( parseTimestamp( "Jan  1 00:61:01" ) );
+            REQUIRE_FALSE( parseTimestamp( "Jan  1" ) );
+        }
+    }
+
+    GIVEN( "Lines without timestamps" )
+    {
+        THEN( "Nothing is parsed" )
+        {
+            REQUIRE_FALSE( parseTimestamp( "" ) );
+            REQUIRE_FALSE( parseTimestamp( "[" ) );
+            REQUIRE_FALSE( parseTimestamp( "message without timestamp" ) );
+        }
+    }
+
+    GIVEN( "Time of day" )
+    {
+        THEN( "Seconds and fraction are optional" )
+        {
+            REQUIRE( parseTimeOfDay( "05:06" ) == ( 5 * 3600 + 6 * 60 ) * Second );
+            REQUIRE( parseTimeOfDay( "05:06:07" ) == ( 5 * 3600 + 6 * 60 + 7 ) * Second );
+            REQUIRE( parseTimeOfDay( "05:06:07.250" )
+                     == ( 5 * 3600 + 6 * 60 + 7 ) * Second + 250 );
+        }
+
+        THEN( "Invalid times are rejected" )
+        {
+            REQUIRE_FALSE( parseTimeOfDay( "5:06" ) );
+            REQUIRE_FALSE( parseTimeOfDay( "25:00" ) );
+            REQUIRE_FALSE( parseTimeOfDay( "05-06" ) );
+        }
+    }
+}
+
+SCENARIO( "Timestamp index", "[timestamp]" )
+{
+    GIVEN( "Index with lines before the first timestamp and lines without timestamps" )
+    {
+        TimestampIndex index;
+        index.append( {} );
+        index.append( {} );
+        REQUIRE_FALSE( index.hasTimestamps() );
+        REQUIRE( index.size() == 2_lcount );
+
+        index.append( 100 );
+        index.append( {} );
+        index.append( 50 );
+        index.append( 300 );
+
+        THEN( "Missing timestamps are filled in" )
+        {
+            REQUIRE( index.hasTimestamps() );
+            REQUIRE( index.size() == 6_lcount );
+            REQUIRE( index.at( 0_lnum ) == 100 );
+            REQUIRE( index.at( 1_lnum ) == 100 );
+            REQUIRE( index.at( 2_lnum ) == 100 );
+            REQUIRE( index.at( 3_lnum ) == 100 );
+            REQUIRE( index.at( 4_lnum ) == 50 );
+            REQUIRE( index.at( 5_lnum ) == 300 );
+        }
+
+        THEN( "Range covers out of order lines" )
+        {
+            REQUIRE( index.range() == std::make_pair( Timestamp{ 50 }, Timestamp{ 300 } ) );
+        }
+
+        THEN( "First line at or after timestamp is found" )
+        {
+            REQUIRE( index.findLineAtOrAfter( 0 ) == 0_lnum );
+            REQUIRE( index.findLineAtOrAfter( 100 ) == 0_lnum );
+            REQUIRE( index.findLineAtOrAfter( 101 ) == 5_lnum );
+            REQUIRE( index.findLineAtOrAfter( 300 ) == 5_lnum );
+            REQUIRE_FALSE( index.findLineAtOrAfter( 301 ) );
+        }
+    }
+
+    GIVEN( "Index with several blocks of lines" )
+    {
+        TimestampIndex index;
+        constexpr uint64_t NbLines = 1000;
+        for ( auto line = 0u; line < NbLines; ++line ) {
+            // Big jumps need multi-byte deltas
+            index.append( static_cast<Timestamp>( line ) * ( line % 3 == 0 ? 100000 : 1 ) );
+        }
+
+        const auto timestampAt = []( uint64_t line ) {
+            return static_cast<Timestamp>( line ) * ( line % 3 == 0 ? 100000 : 1 );
+        };
+
+        THEN( "All timestamps are decoded" )
+        {
+            for ( auto line = 0u; line < NbLines; ++line ) {
+                REQUIRE( index.at( LineNumber( line ) ) == timestampAt( line ) );
+            }
+        }
+
+        THEN( "Lines are found across block boundaries" )
+        {
+            for ( auto line : { 3u, 255u, 258u, 510u, 768u, 999u } ) {
+                REQUIRE( index.findLineAtOrAfter( timestampAt( line ) ) == LineNumber( line ) );
+            }
+            REQUIRE_FALSE( index.findLineAtOrAfter( timestampAt( 999 ) + 1 ) );
+        }
+
+        THEN( "Slices across block boundaries are decoded" )
+        {
+            for ( auto [ first, count ] : { std::make_pair( 0u, 1000u ), std::make_pair( 250u, 10u ),
+                                           std::make_pair( 255u, 513u ),
+                                           std::make_pair( 998u, 5u ) } ) {
+                const auto timestamps = index.slice( LineNumber( first ), LinesCount( count ) );
+                REQUIRE( timestamps.size() == count );
+                for ( auto line = first; line < first + count; ++line ) {
+                    REQUIRE( timestamps[ line - first ]
+                             == timestampAt( std::min<uint64_t>( line, NbLines - 1 ) ) );
+                }
+            }
+        }
+
+        WHEN( "Truncating inside a block" )
+        {
+            index.truncate( 300_lcount );
+
+            THEN( "Kept lines are unchanged" )
+            {
+                REQUIRE( index.size() == 300_lcount );
+                for ( auto line = 0u; line < 300u; ++line ) {
+                    REQUIRE( index.at( LineNumber( line ) ) == timestampAt( line ) );
+                }
+                REQUIRE( index.range().second == timestampAt( 297 ) );
+                REQUIRE_FALSE( index.findLineAtOrAfter( timestampAt( 297 ) + 1 ) );
+            }
+
+            THEN( "New lines can be appended" )
+            {
+                index.append( 1 );
+                REQUIRE( index.size() == 301_lcount );
+                REQUIRE( index.at( 300_lnum ) == 1 );
+                REQUIRE( index.at( 299_lnum ) == timestampAt( 299 ) );
+            }
+        }
+    }
+}
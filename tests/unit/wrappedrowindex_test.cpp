@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2021 Anton Filimonov and other contributors
+ *
+ * This file is part of klogg.
+ *
+ * klogg is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * klogg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with klogg.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "abstractlogdata.h"
+#include "wrappedrowindex.h"
+
+namespace {
+
+// Lines of the given lengths, only their lengths can be read
+class LineLengthsData : public AbstractLogData {
+  public:
+    LineLengthsData( std::vector<int> lengths, bool isSource )
+        : lengths_( std::move( lengths ) )
+        , isSource_( isSource )
+    {
+    }
+
+    void append( int length )
+    {
+        lengths_.push_back( length );
+    }
+
+  private:
+    QString doGetLineString( LineNumber ) const override
+    {
+        return {};
+    }
+    QString doGetExpandedLineString( LineNumber ) const override
+    {
+        return {};
+    }
+    std::vector<QString> doGetLines( LineNumber, LinesCount ) const override
+    {
+        return {};
+    }
+    std::vector<QString> doGetExpandedLines( LineNumber, LinesCount ) const override
+    {
+        return {};
+    }
+    std::vector<LineWindow> doGetLineWindows( LineNumber, LinesCount, int, int ) const override
+    {
+        return {};
+    }
+    LinesCount doGetNbLine() const override
+    {
+        return LinesCount( lengths_.size() );
+    }
+    LineLength doGetMaxLength() const override
+    {
+        return LineLength( *std::max_element( lengths_.begin(), lengths_.end() ) );
+    }
+    LineLength doGetLineLength( LineNumber line ) const override
+    {
+        return LineLength( lengths_[ line.get() ] );
+    }
+    std::vector<LineLength> doGetLineLengths( LineNumber first, LinesCount number ) const override
+    {
+        std::vector<LineLength> lengths;
+        for ( auto line = first.get(); line < first.get() + number.get(); ++line ) {
+            lengths.emplace_back( lengths_[ line ] );
+        }
+        return lengths;
+    }
+    void doSetDisplayEncoding( const char* ) override
+    {
+    }
+    QTextCodec* doGetDisplayEncoding() const override
+    {
+        return nullptr;
+    }
+    void doAttachReader() const override
+    {
+    }
+    void doDetachReader() const override
+    {
+    }
+    void doPrefetchLines( LineNumber, LinesCount ) const override
+    {
+    }
+    const AbstractLogData* doGetSourceData() const override
+    {
+        return isSource_ ? this : nullptr;
+    }
+    SourceRuns doGetSourceRuns( LineNumber first, LinesCount number ) const override
+    {
+        return { { first, number } };
+    }
+
+  private:
+    std::vector<int> lengths_;
+    bool isSource_;
+};
+
+constexpr int WrapColumns = 10;
+
+std::vector<int> makeLengths( size_t nbLines )
+{
+    // Empty lines, lines fitting in a row and lines wrapped into several rows
+    std::vector<int> lengths( nbLines );
+    for ( auto line = 0u; line < nbLines; ++line ) {
+        lengths[ line ] = static_cast<int>( ( line * 7 ) % 45 );
+    }
+    return lengths;
+}
+
+uint64_t rowsOfLength( int length )
+{
+    return static_cast<uint64_t>( ( std::max( length, 1 ) + WrapColumns - 1 ) / WrapColumns );
+}
+
+std::vector<uint64_t> firstRows( const std::vector<int>& lengths )
+{
+    std::vector<uint64_t> rows( lengths.size() + 1 );
+    for ( auto line = 0u; line < lengths.size(); ++line ) {
+        rows[ line + 1 ] = rows[ line ] + rowsOfLength( lengths[ line ] );
+    }
+    return rows;
+}
+
+void checkAllRows( WrappedRowIndex& index, const std::vector<int>& lengths )
+{
+    const auto rows = firstRows( lengths );
+    for ( auto line = 0u; line < lengths.size(); ++line ) {
+        REQUIRE( index.rowsOf( LineNumber( line ) ) == rowsOfLength( lengths[ line ] ) );
+        REQUIRE( index.firstRowOf( LineNumber( line ) ) == rows[ line ] );
+
+        for ( auto row = rows[ line ]; row < rows[ line + 1 ]; ++row ) {
+            const auto position = index.positionOfRow( row );
+            REQUIRE( position.line == LineNumber( line ) );
+            REQUIRE( position.rowInLine == row - rows[ line ] );
+        }
+    }
+
+    // Blocks are all counted once their lines were asked for
+    REQUIRE( index.totalRows() == rows.back() );
+}
+
+} // namespace
+
+SCENARIO( "Wrapped row index", "[wrappedrowindex]" )
+{
+    // Several blocks, the last one partial
+    constexpr auto NbLines = WrappedRowIndex::BlockSize * 5 + 123;
+    auto lengths = makeLengths( NbLines );
+
+    GIVEN( "Data read from the counting thread" )
+    {
+        std::mutex countMutex;
+        std::condition_variable countChanged;
+
+        LineLengthsData data( lengths, true );
+        WrappedRowIndex index;
+        QObject::connect( &index, &WrappedRowIndex::rowsChanged, [ & ] {
+            std::lock_guard<std::mutex> lock( countMutex );
+            countChanged.notify_all();
+        } );
+        index.reset( &data, WrapColumns );
+
+        WHEN( "Background count is over" )
+        {
+            const auto expectedRows = firstRows( lengths ).back();
+
+            std::unique_lock<std::mutex> lock( countMutex );
+            const auto isCounted = countChanged.wait_for(
+                lock, std::chrono::seconds( 10 ),
+                [ & ] { return index.totalRows() == expectedRows; } );
+            lock.unlock();
+
+            REQUIRE( isCounted );
+
+            THEN( "Rows and lines map to each other" )
+            {
+                checkAllRows( index, lengths );
+            }
+        }
+    }
+
+    GIVEN( "Data read only when asked for" )
+    {
+        LineLengthsData data( lengths, false );
+        WrappedRowIndex index;
+        index.reset( &data, WrapColumns );
+
+        THEN( "Blocks not asked for count one row per line" )
+        {
+            REQUIRE( index.totalRows() == NbLines );
+        }
+
+        WHEN( "A block in the middle is asked for" )
+        {
+            const auto blockStart = WrappedRowIndex::BlockSize * 2;
+            const auto line = LineNumber( blockStart + 10 );
+            const auto blockRows = firstRows( lengths );
+
+            THEN( "Only this block is counted" )
+            {
+                REQUIRE( index.firstRowOf( line ) - blockStart
+                         == blockRows[ line.get() ] - blockRows[ blockStart ] );
+                REQUIRE( index.totalRows()
+                         == NbLines - WrappedRowIndex::BlockSize
+                                + ( blockRows[ blockStart + WrappedRowIndex::BlockSize ]
+                                    - blockRows[ blockStart ] ) );
+            }
+        }
+
+        WHEN( "All blocks are asked for" )
+        {
+            for ( auto blockStart = 0u; blockStart < NbLines;
+                  blockStart += WrappedRowIndex::BlockSize ) {
+                index.rowsOf( LineNumber( blockStart ) );
+            }
+
+            THEN( "Rows and lines map to each other" )
+            {
+                checkAllRows( index, lengths );
+            }
+
+            AND_WHEN( "Lines are appended" )
+            {
+                for ( auto line = 0u; line < WrappedRowIndex::BlockSize; ++line ) {
+                    lengths.push_back( static_cast<int>( line % 25 ) );
+                    data.append( lengths.back() );
+                }
+                index.update();
+
+                THEN( "Rows of the new lines are counted when asked for" )
+                {
+                    checkAllRows( index, lengths );
+                }
+            }
+        }
+    }
+}